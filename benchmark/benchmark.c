@@ -1,14 +1,78 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include "CPlotLib.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 #include <time.h>
+#include <dirent.h>
+#include <unistd.h>
 
 // Benchmark configuration
 #define BENCHMARK_POINTS 100000
 #define BENCHMARK_ITERATIONS 100
 #define BENCHMARK_PLOTS 10
 
+#define ENCODE_WIDTH 1200
+#define ENCODE_HEIGHT 800
+#define ENCODE_ITERATIONS 20
+
+#define BACKEND_ITERATIONS 10
+
+#define CHURN_FIGURES 100
+#define CHURN_LIVE 16
+
+#define ZOOM_POINTS 2000000
+#define ZOOM_FRAMES 3
+
+#define PICK_POINTS 10000000
+#define PICK_QUERIES 100000
+#define PICK_RADIUS 8.0
+
+#define SCALE_POINTS 2000000
+#define SCALE_FRAMES 3
+
+#define PRECISION_POINTS 2000000
+
+#define SCATTER_POINTS 1000000
+#define SCATTER_FRAMES 3
+
+#define DENSITY_POINTS 20000000
+#define DENSITY_FRAMES 3
+
+#define PERSISTENCE_TRACES 20000
+#define PERSISTENCE_SAMPLES 500
+#define PERSISTENCE_BATCH 200
+#define PERSISTENCE_FRAMES 10
+
+#define WATERFALL_BINS 4096
+#define WATERFALL_ROWS 1024
+#define WATERFALL_FRAMES 100
+#define WATERFALL_BATCH 16
+
+#define IMSHOW_SIZE 8000
+#define IMSHOW_FRAMES 50
+
+#define HIST_SAMPLES (1u << 26)
+#define HIST_BINS 256
+#define HIST_FRAMES 20
+
+#define CONTOUR_SIZE 4096
+#define CONTOUR_LEVELS 10
+#define CONTOUR_FRAMES 20
+
+#define QUIVER_GRID 1024
+#define QUIVER_FRAMES 20
+
+#define CANDLE_TICKS 20000000
+#define CANDLE_BATCH 10000
+#define CANDLE_FRAMES 20
+
+#define BATCH_JOBS 64
+#define BATCH_WIDTH 640
+#define BATCH_HEIGHT 480
+
 // Benchmark results
 typedef struct {
     double setup_time;
@@ -139,7 +203,1256 @@ BenchmarkResult benchmark_subplots(size_t rows, size_t cols) {
     return result;
 }
 
+// Wall-clock time (clock() sums CPU time over all threads)
+static double wall_time(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Plot-like RGBA test image: white background, grid lines and a few curves
+static unsigned char* generate_plot_image(size_t width, size_t height) {
+    unsigned char* pixels = malloc(width * height * 4);
+    if (!pixels) return NULL;
+    memset(pixels, 255, width * height * 4);
+    
+    for (size_t y = 0; y < height; y++) {
+        for (size_t x = 0; x < width; x++) {
+            if (x % 120 == 0 || y % 80 == 0) {
+                unsigned char* px = pixels + (y * width + x) * 4;
+                px[0] = px[1] = px[2] = 180;
+            }
+        }
+    }
+    
+    for (int curve = 0; curve < 3; curve++) {
+        for (size_t x = 0; x < width; x++) {
+            double t = (double)x / width * 4 * M_PI;
+            double v = sin(t * (curve + 1)) * 0.4 + 0.5;
+            size_t y = (size_t)(v * (height - 3));
+            for (size_t dy = 0; dy < 2; dy++) {
+                unsigned char* px = pixels + ((y + dy) * width + x) * 4;
+                px[0] = curve == 0 ? 220 : 30;
+                px[1] = curve == 1 ? 180 : 40;
+                px[2] = curve == 2 ? 220 : 50;
+            }
+        }
+    }
+    return pixels;
+}
+
+// Benchmark image encoders on a figure-sized RGBA buffer
+void benchmark_encoders(void) {
+    unsigned char* pixels = generate_plot_image(ENCODE_WIDTH, ENCODE_HEIGHT);
+    if (!pixels) return;
+    
+    double megabytes = ENCODE_WIDTH * ENCODE_HEIGHT * 4 / (1024.0 * 1024.0);
+    size_t threads = cpl_image_default_threads();
+    
+    printf("\n=== Image Encoding (%dx%d, %d iterations) ===\n", ENCODE_WIDTH, ENCODE_HEIGHT, ENCODE_ITERATIONS);
+    
+    for (int format = 0; format < 3; format++) {
+        size_t encoded_size = 0;
+        double start = wall_time();
+        for (int i = 0; i < ENCODE_ITERATIONS; i++) {
+            unsigned char* encoded = NULL;
+            if (format == 0) {
+                encoded_size = cpl_encode_png(pixels, ENCODE_WIDTH, ENCODE_HEIGHT, ENCODE_WIDTH * 4, 1, &encoded);
+            } else if (format == 1) {
+                encoded_size = cpl_encode_png(pixels, ENCODE_WIDTH, ENCODE_HEIGHT, ENCODE_WIDTH * 4, threads, &encoded);
+            } else {
+                encoded_size = cpl_encode_qoi(pixels, ENCODE_WIDTH, ENCODE_HEIGHT, ENCODE_WIDTH * 4, &encoded);
+            }
+            free(encoded);
+        }
+        double elapsed = (wall_time() - start) / ENCODE_ITERATIONS;
+        
+        if (format == 0) printf("PNG (1 thread):   ");
+        else if (format == 1) printf("PNG (%2zu threads): ", threads);
+        else printf("QOI:              ");
+        printf("%8.3f ms/image, %8.1f MB/s, %6.1f images/s, %zu bytes\n",
+               elapsed * 1000.0, megabytes / elapsed, 1.0 / elapsed, encoded_size);
+    }
+    
+    free(pixels);
+}
+
 // Print benchmark results
+// Build the same 2x2 subplot figure on the given backend
+static CPLFigure* create_backend_figure(bool software, size_t n_points) {
+    CPLFigure* fig = software ? cpl_create_software_figure(ENCODE_WIDTH, ENCODE_HEIGHT)
+                              : cpl_create_headless_figure(ENCODE_WIDTH, ENCODE_HEIGHT);
+    if (!fig) return NULL;
+    
+    double* x = malloc(n_points * sizeof(double));
+    double* y = malloc(n_points * sizeof(double));
+    if (!x || !y) {
+        free(x);
+        free(y);
+        cpl_free_figure(fig);
+        return NULL;
+    }
+    generate_test_data(x, y, n_points);
+    
+    cpl_add_subplots(fig, 2, 2);
+    for (size_t i = 0; i < 4; i++) {
+        CPLPlot* plot = cpl_get_subplot(fig, i);
+        if (!plot) continue;
+        cpl_set_x_range(plot, 0, 4 * M_PI);
+        cpl_set_y_range(plot, -1.5, 1.5);
+        cpl_plot(plot, x, y, n_points, i % 2 ? COLOR_RED : COLOR_BLUE, NULL, NULL);
+    }
+    
+    free(x);
+    free(y);
+    return fig;
+}
+
+// Compare the CPU rasterizer with the GL path (llvmpipe on GPU-less machines)
+void benchmark_backends(void) {
+    const size_t point_counts[] = { BENCHMARK_POINTS / 10, BENCHMARK_POINTS, BENCHMARK_POINTS * 10 };
+    unsigned char* pixels = malloc(ENCODE_WIDTH * ENCODE_HEIGHT * 4);
+    if (!pixels) return;
+    
+    printf("\n=== Backends (%dx%d, 2x2 subplots, %d iterations) ===\n",
+           ENCODE_WIDTH, ENCODE_HEIGHT, BACKEND_ITERATIONS);
+    
+    for (size_t c = 0; c < sizeof(point_counts) / sizeof(point_counts[0]); c++) {
+        for (int software = 0; software < 2; software++) {
+            const char* name = software ? "Software" : "OpenGL  ";
+            CPLFigure* fig = create_backend_figure(software, point_counts[c]);
+            if (!fig) {
+                printf("%s %8zu points/plot: unavailable\n", name, point_counts[c]);
+                continue;
+            }
+            
+            // Render plus synchronous readback, as cpl_save_figure does before encoding
+            double start = wall_time();
+            for (int i = 0; i < BACKEND_ITERATIONS; i++) {
+                cpl_render_offscreen(fig, pixels);
+            }
+            double elapsed = (wall_time() - start) / BACKEND_ITERATIONS;
+            
+            printf("%s %8zu points/plot: %8.3f ms/frame, %6.1f frames/s, %8.1f Mpoints/s\n",
+                   name, point_counts[c], elapsed * 1000.0, 1.0 / elapsed,
+                   4.0 * point_counts[c] / elapsed / 1e6);
+            cpl_free_figure(fig);
+        }
+    }
+    
+    free(pixels);
+}
+
+// Headless figure create/plot/destroy cycles (the renderer pool makes all but
+// the first cheap; batches wider than the pool create fresh shared contexts)
+static void churn_batch(size_t live, size_t rounds) {
+    double x[1000], y[1000];
+    generate_test_data(x, y, 1000);
+    
+    CPLFigure* figs[CHURN_LIVE];
+    for (size_t r = 0; r < rounds; r++) {
+        for (size_t i = 0; i < live; i++) {
+            figs[i] = cpl_create_headless_figure(ENCODE_WIDTH, ENCODE_HEIGHT);
+            if (figs[i]) {
+                CPLPlot* plot = cpl_add_plot(figs[i]);
+                cpl_plot(plot, x, y, 1000, COLOR_BLUE, NULL, NULL);
+            }
+        }
+        for (size_t i = 0; i < live; i++) {
+            cpl_free_figure(figs[i]);
+        }
+    }
+}
+
+void benchmark_figure_churn(void) {
+    printf("\n=== Figure churn (headless %dx%d) ===\n", ENCODE_WIDTH, ENCODE_HEIGHT);
+    
+    // Start from an empty pool so the first figure pays for its context and shaders
+    cpl_terminate();
+    double start = wall_time();
+    churn_batch(1, 1);
+    printf("Cold figure (context + shaders):  %8.3f ms\n", (wall_time() - start) * 1000.0);
+    
+    start = wall_time();
+    churn_batch(1, CHURN_FIGURES);
+    printf("Create/destroy, 1 live:           %8.3f ms/figure\n", (wall_time() - start) * 1000.0 / CHURN_FIGURES);
+    
+    start = wall_time();
+    churn_batch(CHURN_LIVE, CHURN_FIGURES / CHURN_LIVE);
+    printf("Create/destroy, %2d live:          %8.3f ms/figure\n", CHURN_LIVE,
+           (wall_time() - start) * 1000.0 / (CHURN_FIGURES / CHURN_LIVE * CHURN_LIVE));
+}
+
+// First headless figure from an empty pool: context creation plus all programs
+static double first_figure_ms(void) {
+    cpl_terminate();
+    double start = wall_time();
+    churn_batch(1, 1);
+    return (wall_time() - start) * 1000.0;
+}
+
+void benchmark_shader_startup(void) {
+    char dir[] = "/tmp/cplotlib-bench-XXXXXX";
+    if (!mkdtemp(dir)) return;
+    
+    const char* previous = getenv("CPL_SHADER_CACHE_DIR");
+    char* saved = previous ? strdup(previous) : NULL;
+    
+    printf("\n=== Shader startup (first headless figure) ===\n");
+    setenv("CPL_SHADER_CACHE_DIR", "", 1);
+    printf("Binary cache off:             %8.3f ms\n", first_figure_ms());
+    setenv("CPL_SHADER_CACHE_DIR", dir, 1);
+    printf("Cold (compile + store):       %8.3f ms\n", first_figure_ms());
+    printf("Warm (load program binaries): %8.3f ms\n", first_figure_ms());
+    
+    // Remove the temporary cache
+    DIR* entries = opendir(dir);
+    if (entries) {
+        struct dirent* entry;
+        char path[sizeof(dir) + 256];
+        while ((entry = readdir(entries)) != NULL) {
+            if (entry->d_name[0] == '.') continue;
+            snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name);
+            unlink(path);
+        }
+        closedir(entries);
+    }
+    rmdir(dir);
+    
+    if (saved) {
+        setenv("CPL_SHADER_CACHE_DIR", saved, 1);
+        free(saved);
+    } else {
+        unsetenv("CPL_SHADER_CACHE_DIR");
+    }
+}
+
+// Batch export job: one sine plot whose frequency depends on the job index
+static void build_batch_figure(CPLFigure* fig, void* user_data) {
+    double x[1000], y[1000];
+    size_t index = (size_t)user_data;
+    for (size_t i = 0; i < 1000; i++) {
+        x[i] = (double)i / 999.0 * 4 * M_PI;
+        y[i] = sin(x[i] * (double)(1 + index % 8));
+    }
+    
+    CPLPlot* plot = cpl_add_plot(fig);
+    cpl_set_x_range(plot, 0, 4 * M_PI);
+    cpl_set_y_range(plot, -1.5, 1.5);
+    cpl_plot(plot, x, y, 1000, COLOR_BLUE, NULL, NULL);
+}
+
+void benchmark_batch_export(void) {
+    char dir[] = "/tmp/cplotlib-batch-XXXXXX";
+    if (!mkdtemp(dir)) return;
+    
+    CPLExportJob* jobs = (CPLExportJob*)calloc(BATCH_JOBS, sizeof(CPLExportJob));
+    char (*names)[sizeof(dir) + 32] = malloc(BATCH_JOBS * sizeof(*names));
+    if (!jobs || !names) {
+        free(jobs);
+        free(names);
+        rmdir(dir);
+        return;
+    }
+    
+    for (size_t i = 0; i < BATCH_JOBS; i++) {
+        snprintf(names[i], sizeof(names[i]), "%s/figure_%03zu.png", dir, i);
+        jobs[i].filename = names[i];
+        jobs[i].width = BATCH_WIDTH;
+        jobs[i].height = BATCH_HEIGHT;
+        jobs[i].build = build_batch_figure;
+        jobs[i].user_data = (void*)i;
+    }
+    
+    printf("\n=== Batch export (%d PNG figures, %dx%d) ===\n", BATCH_JOBS, BATCH_WIDTH, BATCH_HEIGHT);
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t max_threads = cores > 1 ? (size_t)cores : 1;
+    for (size_t threads = 1; ; threads *= 2) {
+        if (threads > max_threads) threads = max_threads;
+        
+        double start = wall_time();
+        size_t written = cpl_export_batch(jobs, BATCH_JOBS, threads);
+        double elapsed = wall_time() - start;
+        
+        double build = 0.0, render = 0.0, encode = 0.0;
+        for (size_t i = 0; i < BATCH_JOBS; i++) {
+            build += jobs[i].build_ms;
+            render += jobs[i].render_ms;
+            encode += jobs[i].encode_ms;
+        }
+        printf("%2zu threads: %7.1f figures/s (%zu written)  per job: build %6.2f  render %6.2f  encode %6.2f ms\n",
+               threads, written / elapsed, written, build / BATCH_JOBS, render / BATCH_JOBS, encode / BATCH_JOBS);
+        
+        if (threads == max_threads) break;
+    }
+    
+    for (size_t i = 0; i < BATCH_JOBS; i++) {
+        unlink(names[i]);
+    }
+    rmdir(dir);
+    free(names);
+    free(jobs);
+}
+
+// Offscreen frame time for a time series zoomed to a fraction of its x extent
+static double zoomed_frame_ms(const double* x, const double* y, double fraction) {
+    CPLFigure* fig = cpl_create_headless_figure(ENCODE_WIDTH, ENCODE_HEIGHT);
+    unsigned char* pixels = malloc(ENCODE_WIDTH * ENCODE_HEIGHT * 4);
+    if (!fig || !pixels) {
+        cpl_free_figure(fig);
+        free(pixels);
+        return 0.0;
+    }
+    
+    CPLPlot* plot = cpl_add_plot(fig);
+    double center = 0.5 * ZOOM_POINTS;
+    cpl_set_x_range(plot, center, center + fraction * ZOOM_POINTS);
+    cpl_set_y_range(plot, -1.5, 1.5);
+    cpl_plot(plot, x, y, ZOOM_POINTS, COLOR_BLUE, NULL, NULL);
+    cpl_render_offscreen(fig, pixels);
+    
+    double start = wall_time();
+    for (int i = 0; i < ZOOM_FRAMES; i++) {
+        cpl_render_offscreen(fig, pixels);
+    }
+    double elapsed = (wall_time() - start) * 1000.0 / ZOOM_FRAMES;
+    
+    free(pixels);
+    cpl_free_figure(fig);
+    return elapsed;
+}
+
+void benchmark_zoomed_series(void) {
+    double* x = malloc(ZOOM_POINTS * sizeof(double));
+    double* y = malloc(ZOOM_POINTS * sizeof(double));
+    if (!x || !y) {
+        free(x);
+        free(y);
+        return;
+    }
+    
+    // Sorted x: draws binary-search the visible samples
+    for (size_t i = 0; i < ZOOM_POINTS; i++) {
+        x[i] = (double)i;
+        y[i] = sin(i * 0.001) + 0.2 * sin(i * 0.37);
+    }
+    
+    printf("\n=== Zoomed time series (%d points, %dx%d) ===\n", ZOOM_POINTS, ENCODE_WIDTH, ENCODE_HEIGHT);
+    printf("Full extent:  %8.2f ms/frame\n", zoomed_frame_ms(x, y, 1.0));
+    printf("1%% visible:   %8.2f ms/frame\n", zoomed_frame_ms(x, y, 0.01));
+    printf("0.01%% visible: %7.2f ms/frame\n", zoomed_frame_ms(x, y, 0.0001));
+    
+    free(x);
+    free(y);
+}
+
+// Cursor-rate picking: index build on the first query, then random hover positions
+static void pick_queries(const char* name, const double* x, const double* y, double range) {
+    CPLFigure* fig = cpl_create_software_figure(ENCODE_WIDTH, ENCODE_HEIGHT);
+    if (!fig) return;
+    
+    CPLPlot* plot = cpl_add_plot(fig);
+    cpl_set_x_range(plot, -range, range);
+    cpl_set_y_range(plot, -range, range);
+    cpl_plot(plot, x, y, PICK_POINTS, COLOR_BLUE, NULL, NULL);
+    
+    CPLPickResult result;
+    double start = wall_time();
+    cpl_pick(plot, 0.5 * ENCODE_WIDTH, 0.5 * ENCODE_HEIGHT, PICK_RADIUS, &result);
+    double build_ms = (wall_time() - start) * 1000.0;
+    
+    srand(42);
+    size_t hits = 0;
+    start = wall_time();
+    for (int i = 0; i < PICK_QUERIES; i++) {
+        double sx = (double)rand() / RAND_MAX * ENCODE_WIDTH;
+        double sy = (double)rand() / RAND_MAX * ENCODE_HEIGHT;
+        hits += cpl_pick(plot, sx, sy, PICK_RADIUS, &result);
+    }
+    double query_us = (wall_time() - start) * 1e6 / PICK_QUERIES;
+    
+    printf("%-8s first query (index build) %7.1f ms, then %6.2f us/query (%zu/%d hits)\n",
+           name, build_ms, query_us, hits, PICK_QUERIES);
+    cpl_free_figure(fig);
+}
+
+void benchmark_picking(void) {
+    double* x = malloc(PICK_POINTS * sizeof(double));
+    double* y = malloc(PICK_POINTS * sizeof(double));
+    if (!x || !y) {
+        free(x);
+        free(y);
+        return;
+    }
+    
+    printf("\n=== Picking (%d points, radius %.0f px) ===\n", PICK_POINTS, PICK_RADIUS);
+    
+    // Sorted x: binary search plus per-block y bounds
+    for (size_t i = 0; i < PICK_POINTS; i++) {
+        x[i] = -1.0 + 2.0 * i / (PICK_POINTS - 1);
+        y[i] = 0.5 * sin(i * 1e-5) + 0.1 * sin(i * 0.37);
+    }
+    pick_queries("Sorted", x, y, 1.0);
+    
+    // Unordered Gaussian cloud: uniform grid
+    srand(7);
+    for (size_t i = 0; i < PICK_POINTS; i++) {
+        double u = (rand() + 1.0) / ((double)RAND_MAX + 2.0);
+        double v = (double)rand() / RAND_MAX;
+        x[i] = sqrt(-2.0 * log(u)) * cos(2.0 * M_PI * v);
+        y[i] = sqrt(-2.0 * log(u)) * sin(2.0 * M_PI * v);
+    }
+    pick_queries("Scatter", x, y, 4.0);
+    
+    free(x);
+    free(y);
+}
+
+// Offscreen frame time right after switching a plot's axis transform
+static double scaled_frame_ms(CPLFigure* fig, CPLPlot* plot, CPLAxisScale scale, bool polar, unsigned char* pixels) {
+    double start = wall_time();
+    for (int i = 0; i < SCALE_FRAMES; i++) {
+        cpl_set_y_scale(plot, scale);
+        cpl_set_polar(plot, polar);
+        cpl_render_offscreen(fig, pixels);
+    }
+    return (wall_time() - start) * 1000.0 / SCALE_FRAMES;
+}
+
+void benchmark_axis_scales(void) {
+    double* x = malloc(SCALE_POINTS * sizeof(double));
+    double* y = malloc(SCALE_POINTS * sizeof(double));
+    double* log_y = malloc(SCALE_POINTS * sizeof(double));
+    unsigned char* pixels = malloc(ENCODE_WIDTH * ENCODE_HEIGHT * 4);
+    CPLFigure* fig = cpl_create_headless_figure(ENCODE_WIDTH, ENCODE_HEIGHT);
+    if (!x || !y || !log_y || !pixels || !fig) {
+        free(x);
+        free(y);
+        free(log_y);
+        free(pixels);
+        cpl_free_figure(fig);
+        return;
+    }
+    
+    for (size_t i = 0; i < SCALE_POINTS; i++) {
+        x[i] = i * (6.283185307179586 / SCALE_POINTS);
+        y[i] = 1.5 + sin(i * 0.0001) + 0.2 * sin(i * 0.37);
+    }
+    
+    CPLPlot* plot = cpl_add_plot(fig);
+    cpl_set_x_range(plot, 0.0, 6.283185307179586);
+    cpl_set_y_range(plot, 0.1, 3.0);
+    cpl_plot(plot, x, y, SCALE_POINTS, COLOR_BLUE, NULL, NULL);
+    cpl_render_offscreen(fig, pixels);
+    
+    printf("\n=== Axis scale switching (%d points, %dx%d) ===\n", SCALE_POINTS, ENCODE_WIDTH, ENCODE_HEIGHT);
+    printf("Linear:             %8.2f ms/frame\n", scaled_frame_ms(fig, plot, CPL_SCALE_LINEAR, false, pixels));
+    printf("Log10:              %8.2f ms/frame\n", scaled_frame_ms(fig, plot, CPL_SCALE_LOG10, false, pixels));
+    printf("Symlog:             %8.2f ms/frame\n", scaled_frame_ms(fig, plot, CPL_SCALE_SYMLOG, false, pixels));
+    printf("Polar:              %8.2f ms/frame\n", scaled_frame_ms(fig, plot, CPL_SCALE_LINEAR, true, pixels));
+    cpl_free_figure(fig);
+    
+    // What a scale toggle cost before: transforming on the CPU and re-plotting
+    // (data rebuild only, the frame itself is not included)
+    fig = cpl_create_headless_figure(ENCODE_WIDTH, ENCODE_HEIGHT);
+    if (fig) {
+        plot = cpl_add_plot(fig);
+        cpl_set_x_range(plot, 0.0, 6.283185307179586);
+        cpl_set_y_range(plot, log10(0.1), log10(3.0));
+        double start = wall_time();
+        for (size_t i = 0; i < SCALE_POINTS; i++) {
+            log_y[i] = log10(y[i]);
+        }
+        cpl_plot(plot, x, log_y, SCALE_POINTS, COLOR_BLUE, NULL, NULL);
+        printf("CPU log10 + replot: %6.2f ms per toggle before drawing\n", (wall_time() - start) * 1000.0);
+        cpl_free_figure(fig);
+    }
+    
+    free(x);
+    free(y);
+    free(log_y);
+    free(pixels);
+}
+
+// Plot and frame cost of a deep-zoomed epoch-nanosecond series
+static void precision_run(const char* name, const double* x, const double* y, bool high_precision) {
+    CPLFigure* fig = cpl_create_headless_figure(ENCODE_WIDTH, ENCODE_HEIGHT);
+    unsigned char* pixels = malloc(ENCODE_WIDTH * ENCODE_HEIGHT * 4);
+    if (!fig || !pixels) {
+        cpl_free_figure(fig);
+        free(pixels);
+        return;
+    }
+    
+    // A 1 ms window near the end of the capture, where float offsets step by milliseconds
+    CPLPlot* plot = cpl_add_plot(fig);
+    double start = x[PRECISION_POINTS - 1] - 5e6;
+    cpl_set_high_precision(plot, high_precision);
+    cpl_set_x_range(plot, start, start + 1e6);
+    cpl_set_y_range(plot, -1.5, 1.5);
+    
+    double begin = wall_time();
+    cpl_plot(plot, x, y, PRECISION_POINTS, COLOR_BLUE, NULL, NULL);
+    double plotted = wall_time();
+    cpl_render_offscreen(fig, pixels);
+    double rendered = wall_time();
+    
+    printf("%-15s plot %7.2f ms, zoomed frame %7.2f ms\n", name,
+           (plotted - begin) * 1000.0, (rendered - plotted) * 1000.0);
+    
+    free(pixels);
+    cpl_free_figure(fig);
+}
+
+void benchmark_high_precision(void) {
+    double* x = malloc(PRECISION_POINTS * sizeof(double));
+    double* y = malloc(PRECISION_POINTS * sizeof(double));
+    if (!x || !y) {
+        free(x);
+        free(y);
+        return;
+    }
+    
+    // A day of epoch-nanosecond timestamps, the last seconds sampled every microsecond
+    double epoch = 1.7e18;
+    for (size_t i = 0; i < PRECISION_POINTS; i++) {
+        double t = i == 0 ? 0.0 : 86400e9 - (double)(PRECISION_POINTS - i) * 1000.0;
+        x[i] = epoch + t;
+        y[i] = sin(t * 6.283185307179586 / 100e3);
+    }
+    
+    printf("\n=== High-precision positions (%d points, 1 ms of a day) ===\n", PRECISION_POINTS);
+    precision_run("Standard", x, y, false);
+    precision_run("High precision", x, y, true);
+    
+    free(x);
+    free(y);
+}
+
+// Scatter cloud with per-point RGBA8 colors and pixel diameters
+static void build_scatter(CPLFigure* fig, const double* x, const double* y, const unsigned char* colors,
+                          const unsigned char* sizes) {
+    CPLPlot* plot = cpl_add_plot(fig);
+    cpl_set_x_range(plot, -4.0, 4.0);
+    cpl_set_y_range(plot, -4.0, 4.0);
+    cpl_scatter(plot, x, y, SCATTER_POINTS, COLOR_BLUE, 2.0f, colors, sizes);
+}
+
+void benchmark_scatter(void) {
+    double* x = malloc(SCATTER_POINTS * sizeof(double));
+    double* y = malloc(SCATTER_POINTS * sizeof(double));
+    unsigned char* colors = malloc(SCATTER_POINTS * 4);
+    unsigned char* sizes = malloc(SCATTER_POINTS);
+    unsigned char* pixels = malloc(ENCODE_WIDTH * ENCODE_HEIGHT * 4);
+    CPLFigure* fig = cpl_create_headless_figure(ENCODE_WIDTH, ENCODE_HEIGHT);
+    if (!x || !y || !colors || !sizes || !pixels || !fig) {
+        free(x);
+        free(y);
+        free(colors);
+        free(sizes);
+        free(pixels);
+        cpl_free_figure(fig);
+        return;
+    }
+    
+    // Gaussian cloud, colored by x, opaque and translucent points alternating
+    srand(42);
+    for (size_t i = 0; i < SCATTER_POINTS; i++) {
+        double u = (rand() + 1.0) / (RAND_MAX + 2.0);
+        double v = rand() / (RAND_MAX + 1.0);
+        double r = sqrt(-2.0 * log(u));
+        x[i] = r * cos(6.283185307179586 * v);
+        y[i] = r * sin(6.283185307179586 * v);
+        colors[i * 4 + 0] = (unsigned char)(128.0 + 120.0 * tanh(x[i]));
+        colors[i * 4 + 1] = 60;
+        colors[i * 4 + 2] = (unsigned char)(128.0 - 120.0 * tanh(x[i]));
+        colors[i * 4 + 3] = i % 2 ? 255 : 96;
+        sizes[i] = (unsigned char)(1 + i % 4);
+    }
+    
+    printf("\n=== Scatter plots (%d points, per-point color and size, %dx%d) ===\n", SCATTER_POINTS,
+           ENCODE_WIDTH, ENCODE_HEIGHT);
+    
+    double start = wall_time();
+    build_scatter(fig, x, y, colors, sizes);
+    double plotted = wall_time();
+    cpl_render_offscreen(fig, pixels);
+    printf("OpenGL:   plot %7.2f ms, first frame %7.2f ms\n", (plotted - start) * 1000.0,
+           (wall_time() - plotted) * 1000.0);
+    
+    // Panning only changes uniforms; the points stay on the GPU
+    CPLPlot* plot = fig->plots[0];
+    start = wall_time();
+    for (int i = 0; i < SCATTER_FRAMES; i++) {
+        double shift = 0.25 * (i + 1);
+        cpl_set_x_range(plot, -4.0 + shift, 4.0 + shift);
+        cpl_render_offscreen(fig, pixels);
+    }
+    printf("OpenGL:   pan frame %7.2f ms\n", (wall_time() - start) * 1000.0 / SCATTER_FRAMES);
+    
+    char dir[] = "/tmp/cplotlib-scatter-XXXXXX";
+    if (mkdtemp(dir)) {
+        char path[sizeof(dir) + 16];
+        snprintf(path, sizeof(path), "%s/scatter.svg", dir);
+        start = wall_time();
+        cpl_save_figure(fig, path);
+        double written = wall_time();
+        FILE* file = fopen(path, "rb");
+        long bytes = 0;
+        if (file) {
+            fseek(file, 0, SEEK_END);
+            bytes = ftell(file);
+            fclose(file);
+        }
+        printf("SVG:      export %7.2f ms, %.1f MB (hidden points dropped)\n", (written - start) * 1000.0,
+               bytes / 1e6);
+        unlink(path);
+        rmdir(dir);
+    }
+    cpl_free_figure(fig);
+    
+    fig = cpl_create_software_figure(ENCODE_WIDTH, ENCODE_HEIGHT);
+    if (fig) {
+        build_scatter(fig, x, y, colors, sizes);
+        start = wall_time();
+        cpl_render_offscreen(fig, pixels);
+        printf("Software: frame %7.2f ms\n", (wall_time() - start) * 1000.0);
+        cpl_free_figure(fig);
+    }
+    
+    free(x);
+    free(y);
+    free(colors);
+    free(sizes);
+    free(pixels);
+}
+
+// Density view of a scatter cloud; points are binned per frame on the CPU
+static double density_frame_ms(CPLFigure* fig, unsigned char* pixels) {
+    double start = wall_time();
+    cpl_render_offscreen(fig, pixels);
+    return (wall_time() - start) * 1000.0;
+}
+
+void benchmark_density(void) {
+    double* x = malloc(DENSITY_POINTS * sizeof(double));
+    double* y = malloc(DENSITY_POINTS * sizeof(double));
+    unsigned char* pixels = malloc(ENCODE_WIDTH * ENCODE_HEIGHT * 4);
+    CPLFigure* fig = cpl_create_headless_figure(ENCODE_WIDTH, ENCODE_HEIGHT);
+    if (!x || !y || !pixels || !fig) {
+        free(x);
+        free(y);
+        free(pixels);
+        cpl_free_figure(fig);
+        return;
+    }
+    
+    srand(42);
+    for (size_t i = 0; i < DENSITY_POINTS; i++) {
+        double u = (rand() + 1.0) / (RAND_MAX + 2.0);
+        double v = rand() / (RAND_MAX + 1.0);
+        double r = sqrt(-2.0 * log(u));
+        x[i] = r * cos(6.283185307179586 * v);
+        y[i] = r * sin(6.283185307179586 * v);
+    }
+    
+    printf("\n=== Density plots (%d points, %dx%d) ===\n", DENSITY_POINTS, ENCODE_WIDTH, ENCODE_HEIGHT);
+    
+    CPLPlot* plot = cpl_add_plot(fig);
+    cpl_set_x_range(plot, -4.0, 4.0);
+    cpl_set_y_range(plot, -4.0, 4.0);
+    cpl_set_density(plot, CPL_DENSITY_LINEAR);
+    cpl_scatter(plot, x, y, DENSITY_POINTS, COLOR_BLUE, 1.0f, NULL, NULL);
+    
+    static const char* norms[] = { "linear", "log", "eq-hist" };
+    for (int n = 0; n < 3; n++) {
+        cpl_set_density(plot, (CPLDensityNorm)(CPL_DENSITY_LINEAR + n));
+        cpl_set_x_range(plot, -4.0, 4.0);
+        double binned = density_frame_ms(fig, pixels);
+        double cached = density_frame_ms(fig, pixels);
+        double panned = 0.0;
+        for (int i = 0; i < DENSITY_FRAMES; i++) {
+            double shift = 0.25 * (i + 1);
+            cpl_set_x_range(plot, -4.0 + shift, 4.0 + shift);
+            panned += density_frame_ms(fig, pixels);
+        }
+        printf("OpenGL:   %-8s bin %7.2f ms, cached frame %7.2f ms, pan frame %7.2f ms\n", norms[n], binned,
+               cached, panned / DENSITY_FRAMES);
+    }
+    
+    char dir[] = "/tmp/cplotlib-density-XXXXXX";
+    if (mkdtemp(dir)) {
+        char path[sizeof(dir) + 16];
+        snprintf(path, sizeof(path), "%s/density.svg", dir);
+        double start = wall_time();
+        cpl_save_figure(fig, path);
+        double written = wall_time();
+        FILE* file = fopen(path, "rb");
+        long bytes = 0;
+        if (file) {
+            fseek(file, 0, SEEK_END);
+            bytes = ftell(file);
+            fclose(file);
+        }
+        printf("SVG:      export %7.2f ms, %.1f KB (embedded image)\n", (written - start) * 1000.0, bytes / 1e3);
+        unlink(path);
+        rmdir(dir);
+    }
+    cpl_free_figure(fig);
+    
+    fig = cpl_create_software_figure(ENCODE_WIDTH, ENCODE_HEIGHT);
+    if (fig) {
+        plot = cpl_add_plot(fig);
+        cpl_set_x_range(plot, -4.0, 4.0);
+        cpl_set_y_range(plot, -4.0, 4.0);
+        cpl_set_density(plot, CPL_DENSITY_LOG);
+        cpl_scatter(plot, x, y, DENSITY_POINTS, COLOR_BLUE, 1.0f, NULL, NULL);
+        printf("Software: log      frame %7.2f ms\n", density_frame_ms(fig, pixels));
+        cpl_free_figure(fig);
+    }
+    
+    free(x);
+    free(y);
+    free(pixels);
+}
+
+// Eye diagram of noisy bit transitions: a first large batch, then live frames
+// that each add a small batch while older traces decay
+static void persistence_traces(double* y, const double* x, size_t n_traces) {
+    for (size_t t = 0; t < n_traces; t++) {
+        int bits[3] = { rand() & 1, rand() & 1, rand() & 1 };
+        double jitter = 0.1 * (rand() / (double)RAND_MAX - 0.5);
+        for (size_t i = 0; i < PERSISTENCE_SAMPLES; i++) {
+            double u = x[i] + jitter;
+            int from = u < 1.0 ? bits[0] : bits[1];
+            int to = u < 1.0 ? bits[1] : bits[2];
+            double phase = fmin(fmax(2.5 * (u < 1.0 ? u : u - 1.0), 0.0), 1.0);
+            double edge = 0.5 - 0.5 * cos(3.141592653589793 * phase);
+            y[t * PERSISTENCE_SAMPLES + i] = 2.0 * (from + (to - from) * edge) - 1.0 +
+                                              0.05 * (rand() / (double)RAND_MAX - 0.5);
+        }
+    }
+}
+
+void benchmark_persistence(void) {
+    double* x = malloc(PERSISTENCE_SAMPLES * sizeof(double));
+    double* y = malloc((size_t)PERSISTENCE_TRACES * PERSISTENCE_SAMPLES * sizeof(double));
+    unsigned char* pixels = malloc(ENCODE_WIDTH * ENCODE_HEIGHT * 4);
+    CPLFigure* fig = cpl_create_headless_figure(ENCODE_WIDTH, ENCODE_HEIGHT);
+    if (!x || !y || !pixels || !fig) {
+        free(x);
+        free(y);
+        free(pixels);
+        cpl_free_figure(fig);
+        return;
+    }
+    
+    srand(42);
+    for (size_t i = 0; i < PERSISTENCE_SAMPLES; i++) {
+        x[i] = -0.5 + 2.0 * i / (PERSISTENCE_SAMPLES - 1);
+    }
+    persistence_traces(y, x, PERSISTENCE_TRACES);
+    
+    printf("\n=== Persistence traces (%d traces of %d samples, %dx%d) ===\n", PERSISTENCE_TRACES,
+           PERSISTENCE_SAMPLES, ENCODE_WIDTH, ENCODE_HEIGHT);
+    
+    CPLPlot* plot = cpl_add_plot(fig);
+    cpl_set_x_range(plot, -0.5, 1.5);
+    cpl_set_y_range(plot, -1.5, 1.5);
+    cpl_set_colormap(plot, CPL_COLORMAP_INFERNO);
+    cpl_set_persistence(plot, x, PERSISTENCE_SAMPLES, 0.9f, CPL_DENSITY_EQ_HIST);
+    double start = wall_time();
+    cpl_add_traces(plot, y, PERSISTENCE_TRACES);
+    double added = wall_time();
+    cpl_render_offscreen(fig, pixels);
+    double drawn = wall_time();
+    printf("OpenGL:   add %7.2f ms, accumulate all %7.2f ms\n", (added - start) * 1000.0, (drawn - added) * 1000.0);
+    
+    double live = 0.0;
+    for (int i = 0; i < PERSISTENCE_FRAMES; i++) {
+        persistence_traces(y, x, PERSISTENCE_BATCH);
+        start = wall_time();
+        cpl_add_traces(plot, y, PERSISTENCE_BATCH);
+        cpl_render_offscreen(fig, pixels);
+        live += wall_time() - start;
+    }
+    printf("OpenGL:   live frame (+%d traces, decayed) %7.2f ms\n", PERSISTENCE_BATCH,
+           live * 1000.0 / PERSISTENCE_FRAMES);
+    cpl_free_figure(fig);
+    
+    fig = cpl_create_software_figure(ENCODE_WIDTH, ENCODE_HEIGHT);
+    if (fig) {
+        persistence_traces(y, x, PERSISTENCE_TRACES);
+        plot = cpl_add_plot(fig);
+        cpl_set_x_range(plot, -0.5, 1.5);
+        cpl_set_y_range(plot, -1.5, 1.5);
+        cpl_set_persistence(plot, x, PERSISTENCE_SAMPLES, 1.0f, CPL_DENSITY_LOG);
+        cpl_add_traces(plot, y, PERSISTENCE_TRACES);
+        printf("Software: log      frame %7.2f ms\n", density_frame_ms(fig, pixels));
+        cpl_free_figure(fig);
+    }
+    
+    free(x);
+    free(y);
+    free(pixels);
+}
+
+// Scrolling spectrogram: a peak wandering over noise, one row per call or
+// several rows per frame (1 kHz rows at 60 frames per second)
+static void waterfall_rows(float* rows, size_t n_rows, size_t first_row) {
+    for (size_t r = 0; r < n_rows; r++) {
+        double peak = 0.25 + 0.2 * sin(0.01 * (double)(first_row + r));
+        for (size_t i = 0; i < WATERFALL_BINS; i++) {
+            double f = (double)i / WATERFALL_BINS - peak;
+            rows[r * WATERFALL_BINS + i] = (float)(exp(-f * f * 40000.0) + 1e-6 * (1 + rand() % 100));
+        }
+    }
+}
+
+void benchmark_waterfall(void) {
+    float* rows = malloc((size_t)WATERFALL_ROWS * WATERFALL_BINS * sizeof(float));
+    unsigned char* pixels = malloc(ENCODE_WIDTH * ENCODE_HEIGHT * 4);
+    CPLFigure* fig = cpl_create_headless_figure(ENCODE_WIDTH, ENCODE_HEIGHT);
+    if (!rows || !pixels || !fig) {
+        free(rows);
+        free(pixels);
+        cpl_free_figure(fig);
+        return;
+    }
+    
+    printf("\n=== Waterfall (%d bins x %d rows, %dx%d) ===\n", WATERFALL_BINS, WATERFALL_ROWS, ENCODE_WIDTH,
+           ENCODE_HEIGHT);
+    
+    srand(42);
+    CPLPlot* plot = cpl_add_plot(fig);
+    cpl_set_x_range(plot, 0.0, 24000.0);
+    cpl_set_y_range(plot, -1.0, 0.0);
+    cpl_set_waterfall(plot, WATERFALL_BINS, WATERFALL_ROWS, 0.0, 24000.0, -1.0, 0.0);
+    cpl_set_waterfall_levels(plot, -60.0f, 0.0f, true);
+    waterfall_rows(rows, WATERFALL_ROWS, 0);
+    cpl_add_waterfall_rows(plot, rows, WATERFALL_ROWS);
+    double start = wall_time();
+    cpl_render_offscreen(fig, pixels);
+    printf("OpenGL:   first frame (full upload) %7.2f ms\n", (wall_time() - start) * 1000.0);
+    
+    // Row generation stays outside the timings
+    size_t next = WATERFALL_ROWS;
+    double adding = 0.0, drawing = 0.0;
+    for (int i = 0; i < WATERFALL_FRAMES; i++) {
+        waterfall_rows(rows, WATERFALL_BATCH, next);
+        next += WATERFALL_BATCH;
+        start = wall_time();
+        for (int r = 0; r < WATERFALL_BATCH; r++) {
+            cpl_add_waterfall_rows(plot, rows + (size_t)r * WATERFALL_BINS, 1);
+        }
+        double added = wall_time();
+        cpl_render_offscreen(fig, pixels);
+        adding += added - start;
+        drawing += wall_time() - added;
+    }
+    printf("OpenGL:   add row %7.4f ms, frame (+%d rows) %7.2f ms\n",
+           adding * 1000.0 / (WATERFALL_FRAMES * WATERFALL_BATCH), WATERFALL_BATCH,
+           drawing * 1000.0 / WATERFALL_FRAMES);
+    cpl_free_figure(fig);
+    
+    fig = cpl_create_software_figure(ENCODE_WIDTH, ENCODE_HEIGHT);
+    if (fig) {
+        plot = cpl_add_plot(fig);
+        cpl_set_x_range(plot, 0.0, 24000.0);
+        cpl_set_y_range(plot, -1.0, 0.0);
+        cpl_set_waterfall(plot, WATERFALL_BINS, WATERFALL_ROWS, 0.0, 24000.0, -1.0, 0.0);
+        cpl_set_waterfall_levels(plot, -60.0f, 0.0f, true);
+        waterfall_rows(rows, WATERFALL_ROWS, 0);
+        cpl_add_waterfall_rows(plot, rows, WATERFALL_ROWS);
+        start = wall_time();
+        cpl_render_offscreen(fig, pixels);
+        printf("Software: frame %7.2f ms\n", (wall_time() - start) * 1000.0);
+        cpl_free_figure(fig);
+    }
+    
+    free(rows);
+    free(pixels);
+}
+
+void benchmark_imshow(void) {
+    size_t count = (size_t)IMSHOW_SIZE * IMSHOW_SIZE;
+    float* values = malloc(count * sizeof(float));
+    unsigned char* pixels = malloc(ENCODE_WIDTH * ENCODE_HEIGHT * 4);
+    CPLFigure* fig = cpl_create_headless_figure(ENCODE_WIDTH, ENCODE_HEIGHT);
+    if (!values || !pixels || !fig) {
+        free(values);
+        free(pixels);
+        cpl_free_figure(fig);
+        return;
+    }
+    
+    printf("\n=== Matrix image (%dx%d floats, %dx%d) ===\n", IMSHOW_SIZE, IMSHOW_SIZE, ENCODE_WIDTH, ENCODE_HEIGHT);
+    
+    for (size_t y = 0; y < IMSHOW_SIZE; y++) {
+        for (size_t x = 0; x < IMSHOW_SIZE; x++) {
+            values[y * IMSHOW_SIZE + x] = (float)(sin(x * 0.01) * cos(y * 0.013));
+        }
+    }
+    
+    CPLPlot* plot = cpl_add_plot(fig);
+    cpl_set_x_range(plot, 0.0, IMSHOW_SIZE);
+    cpl_set_y_range(plot, 0.0, IMSHOW_SIZE);
+    double start = wall_time();
+    cpl_imshow(plot, values, CPL_MATRIX_FLOAT32, IMSHOW_SIZE, IMSHOW_SIZE, NULL, CPL_MATRIX_MEAN);
+    printf("Pyramid build:          %7.2f ms\n", (wall_time() - start) * 1000.0);
+    start = wall_time();
+    cpl_render_offscreen(fig, pixels);
+    printf("OpenGL:   first frame   %7.2f ms\n", (wall_time() - start) * 1000.0);
+    
+    // Zoom in towards the centre, then pan across at the deepest level
+    start = wall_time();
+    for (int i = 0; i < IMSHOW_FRAMES; i++) {
+        double span = IMSHOW_SIZE / pow(1.1, i + 1);
+        cpl_set_x_range(plot, (IMSHOW_SIZE - span) * 0.5, (IMSHOW_SIZE + span) * 0.5);
+        cpl_set_y_range(plot, (IMSHOW_SIZE - span) * 0.5, (IMSHOW_SIZE + span) * 0.5);
+        cpl_render_offscreen(fig, pixels);
+    }
+    printf("OpenGL:   zoom frame    %7.2f ms\n", (wall_time() - start) * 1000.0 / IMSHOW_FRAMES);
+    start = wall_time();
+    for (int i = 0; i < IMSHOW_FRAMES; i++) {
+        double left = (double)i * (IMSHOW_SIZE - 1000) / IMSHOW_FRAMES;
+        cpl_set_x_range(plot, left, left + 1000.0);
+        cpl_render_offscreen(fig, pixels);
+    }
+    printf("OpenGL:   pan frame     %7.2f ms\n", (wall_time() - start) * 1000.0 / IMSHOW_FRAMES);
+    cpl_free_figure(fig);
+    
+    fig = cpl_create_software_figure(ENCODE_WIDTH, ENCODE_HEIGHT);
+    if (fig) {
+        plot = cpl_add_plot(fig);
+        cpl_set_x_range(plot, 0.0, IMSHOW_SIZE);
+        cpl_set_y_range(plot, 0.0, IMSHOW_SIZE);
+        cpl_imshow(plot, values, CPL_MATRIX_FLOAT32, IMSHOW_SIZE, IMSHOW_SIZE, NULL, CPL_MATRIX_MEAN);
+        start = wall_time();
+        cpl_render_offscreen(fig, pixels);
+        printf("Software: frame         %7.2f ms\n", (wall_time() - start) * 1000.0);
+        cpl_free_figure(fig);
+    }
+    
+    free(values);
+    free(pixels);
+}
+
+void benchmark_histogram(void) {
+    double* samples = malloc((size_t)HIST_SAMPLES * sizeof(double));
+    uint64_t* reference = calloc(HIST_BINS, sizeof(uint64_t));
+    unsigned char* pixels = malloc(ENCODE_WIDTH * ENCODE_HEIGHT * 4);
+    CPLFigure* fig = cpl_create_headless_figure(ENCODE_WIDTH, ENCODE_HEIGHT);
+    if (!samples || !reference || !pixels || !fig) {
+        free(samples);
+        free(reference);
+        free(pixels);
+        cpl_free_figure(fig);
+        return;
+    }
+    
+    printf("\n=== Histogram (%u samples, %d bins) ===\n", HIST_SAMPLES, HIST_BINS);
+    
+    // Sum of uniforms: a bell shape without calling into libm per sample
+    srand(42);
+    for (size_t i = 0; i < HIST_SAMPLES; i++) {
+        samples[i] = (double)(rand() % 1000 + rand() % 1000 + rand() % 1000) / 3000.0;
+    }
+    const double range[2] = { 0.0, 1.0 };
+    
+    // Reference: one thread, one sample at a time
+    double start = wall_time();
+    for (size_t i = 0; i < HIST_SAMPLES; i++) {
+        double x = samples[i];
+        if (x >= range[0] && x <= range[1]) {
+            size_t bin = (size_t)((x - range[0]) * HIST_BINS / (range[1] - range[0]));
+            reference[bin < HIST_BINS ? bin : HIST_BINS - 1]++;
+        }
+    }
+    double scalar = wall_time() - start;
+    printf("Scalar loop:       %8.2f ms (%6.0f M samples/s)\n", scalar * 1000.0, HIST_SAMPLES / scalar / 1e6);
+    
+    Color color = { 0.2f, 0.4f, 0.8f, 1.0f };
+    CPLPlot* plot = cpl_add_plot(fig);
+    cpl_set_x_range(plot, 0.0, 1.0);
+    cpl_set_y_range(plot, 0.0, HIST_SAMPLES / 64.0);
+    start = wall_time();
+    cpl_hist(plot, samples, HIST_SAMPLES, HIST_BINS, range, color);
+    double counted = wall_time() - start;
+    printf("cpl_hist:          %8.2f ms (%6.0f M samples/s)\n", counted * 1000.0, HIST_SAMPLES / counted / 1e6);
+    start = wall_time();
+    cpl_hist_add(plot, samples, HIST_SAMPLES);
+    counted = wall_time() - start;
+    printf("cpl_hist_add:      %8.2f ms (%6.0f M samples/s)\n", counted * 1000.0, HIST_SAMPLES / counted / 1e6);
+    
+    bool match = true;
+    for (size_t i = 0; i < HIST_BINS; i++) {
+        match = match && plot->data->histogram->counts[i] == 2 * reference[i];
+    }
+    printf("Counts match the scalar loop: %s\n", match ? "yes" : "NO");
+    
+    start = wall_time();
+    for (int i = 0; i < HIST_FRAMES; i++) {
+        cpl_set_x_range(plot, 0.1 * i / HIST_FRAMES, 1.0 - 0.1 * i / HIST_FRAMES);
+        cpl_render_offscreen(fig, pixels);
+    }
+    printf("OpenGL:   frame    %8.2f ms\n", (wall_time() - start) * 1000.0 / HIST_FRAMES);
+    cpl_free_figure(fig);
+    
+    fig = cpl_create_software_figure(ENCODE_WIDTH, ENCODE_HEIGHT);
+    if (fig) {
+        plot = cpl_add_plot(fig);
+        cpl_set_x_range(plot, 0.0, 1.0);
+        cpl_set_y_range(plot, 0.0, HIST_SAMPLES / 64.0);
+        cpl_hist(plot, samples, HIST_SAMPLES, HIST_BINS, range, color);
+        start = wall_time();
+        cpl_render_offscreen(fig, pixels);
+        printf("Software: frame    %8.2f ms\n", (wall_time() - start) * 1000.0);
+        cpl_free_figure(fig);
+    }
+    
+    free(samples);
+    free(reference);
+    free(pixels);
+}
+
+// Fills a CONTOUR_SIZE^2 field of bumps moving with `phase`
+static void contour_field(float* field, double phase) {
+    for (size_t y = 0; y < CONTOUR_SIZE; y++) {
+        double wave_y = cos(y * 0.011 + phase);
+        for (size_t x = 0; x < CONTOUR_SIZE; x++) {
+            field[y * CONTOUR_SIZE + x] = (float)(sin(x * 0.007 - phase) * wave_y + 0.2 * sin((x + y) * 0.003));
+        }
+    }
+}
+
+void benchmark_contour(void) {
+    float* field = malloc((size_t)CONTOUR_SIZE * CONTOUR_SIZE * sizeof(float));
+    unsigned char* pixels = malloc(ENCODE_WIDTH * ENCODE_HEIGHT * 4);
+    CPLFigure* fig = cpl_create_headless_figure(ENCODE_WIDTH, ENCODE_HEIGHT);
+    if (!field || !pixels || !fig) {
+        free(field);
+        free(pixels);
+        cpl_free_figure(fig);
+        return;
+    }
+    
+    printf("\n=== Contours (%dx%d field, %d levels) ===\n", CONTOUR_SIZE, CONTOUR_SIZE, CONTOUR_LEVELS);
+    
+    double levels[CONTOUR_LEVELS];
+    for (int i = 0; i < CONTOUR_LEVELS; i++) levels[i] = -1.0 + 2.0 * (i + 0.5) / CONTOUR_LEVELS;
+    contour_field(field, 0.0);
+    
+    CPLPlot* plot = cpl_add_plot(fig);
+    cpl_set_x_range(plot, 0.0, CONTOUR_SIZE);
+    cpl_set_y_range(plot, 0.0, CONTOUR_SIZE);
+    double start = wall_time();
+    cpl_contour(plot, field, CONTOUR_SIZE, CONTOUR_SIZE, NULL, levels, CONTOUR_LEVELS);
+    double traced = wall_time() - start;
+    const CPLContour* contour = plot->data->contour;
+    printf("First field:       %8.2f ms (%zu polylines, %zu vertices)\n", traced * 1000.0,
+           contour ? contour->num_polylines : 0, contour ? contour->num_vertices : 0);
+    
+    // Same grid: the marching and vertex buffers are reused
+    contour_field(field, 0.5);
+    start = wall_time();
+    cpl_contour(plot, field, CONTOUR_SIZE, CONTOUR_SIZE, NULL, levels, CONTOUR_LEVELS);
+    traced = wall_time() - start;
+    printf("Updated field:     %8.2f ms (%6.0f M cells/s)\n", traced * 1000.0,
+           (double)(CONTOUR_SIZE - 1) * (CONTOUR_SIZE - 1) / traced / 1e6);
+    
+    // The first frame uploads the batched buffer
+    start = wall_time();
+    cpl_render_offscreen(fig, pixels);
+    printf("OpenGL:   upload   %8.2f ms\n", (wall_time() - start) * 1000.0);
+    start = wall_time();
+    for (int i = 0; i < CONTOUR_FRAMES; i++) {
+        double inset = 0.25 * CONTOUR_SIZE * i / CONTOUR_FRAMES;
+        cpl_set_x_range(plot, inset, CONTOUR_SIZE - inset);
+        cpl_set_y_range(plot, inset, CONTOUR_SIZE - inset);
+        cpl_render_offscreen(fig, pixels);
+    }
+    printf("OpenGL:   frame    %8.2f ms\n", (wall_time() - start) * 1000.0 / CONTOUR_FRAMES);
+    cpl_free_figure(fig);
+    
+    fig = cpl_create_software_figure(ENCODE_WIDTH, ENCODE_HEIGHT);
+    if (fig) {
+        plot = cpl_add_plot(fig);
+        cpl_set_x_range(plot, 0.0, CONTOUR_SIZE);
+        cpl_set_y_range(plot, 0.0, CONTOUR_SIZE);
+        cpl_contour(plot, field, CONTOUR_SIZE, CONTOUR_SIZE, NULL, levels, CONTOUR_LEVELS);
+        start = wall_time();
+        cpl_render_offscreen(fig, pixels);
+        printf("Software: frame    %8.2f ms\n", (wall_time() - start) * 1000.0);
+        cpl_free_figure(fig);
+    }
+    
+    free(field);
+    free(pixels);
+}
+
+void benchmark_quiver(void) {
+    size_t n = (size_t)QUIVER_GRID * QUIVER_GRID;
+    double* x = malloc(n * sizeof(double));
+    double* y = malloc(n * sizeof(double));
+    double* u = malloc(n * sizeof(double));
+    double* v = malloc(n * sizeof(double));
+    unsigned char* pixels = malloc(ENCODE_WIDTH * ENCODE_HEIGHT * 4);
+    CPLFigure* fig = cpl_create_headless_figure(ENCODE_WIDTH, ENCODE_HEIGHT);
+    if (!x || !y || !u || !v || !pixels || !fig) {
+        free(x);
+        free(y);
+        free(u);
+        free(v);
+        free(pixels);
+        cpl_free_figure(fig);
+        return;
+    }
+    
+    printf("\n=== Quiver (%zu arrows) ===\n", n);
+    
+    // A grid of vortices
+    for (size_t j = 0; j < QUIVER_GRID; j++) {
+        for (size_t i = 0; i < QUIVER_GRID; i++) {
+            size_t k = j * QUIVER_GRID + i;
+            x[k] = (double)i;
+            y[k] = (double)j;
+            u[k] = sin(i * 0.02) * cos(j * 0.02);
+            v[k] = -cos(i * 0.02) * sin(j * 0.02);
+        }
+    }
+    
+    CPLPlot* plot = cpl_add_plot(fig);
+    cpl_set_x_range(plot, 0.0, QUIVER_GRID);
+    cpl_set_y_range(plot, 0.0, QUIVER_GRID);
+    double start = wall_time();
+    cpl_quiver(plot, x, y, u, v, n, 0.0f, (Color){ 0.1f, 0.3f, 0.8f, 1.0f });
+    printf("Build:             %8.2f ms\n", (wall_time() - start) * 1000.0);
+    
+    // The first frame uploads the records; zooming in draws longer prefixes
+    start = wall_time();
+    cpl_render_offscreen(fig, pixels);
+    printf("OpenGL:   upload   %8.2f ms\n", (wall_time() - start) * 1000.0);
+    start = wall_time();
+    for (int i = 0; i < QUIVER_FRAMES; i++) {
+        double inset = 0.45 * QUIVER_GRID * i / QUIVER_FRAMES;
+        cpl_set_x_range(plot, inset, QUIVER_GRID - inset);
+        cpl_set_y_range(plot, inset, QUIVER_GRID - inset);
+        cpl_render_offscreen(fig, pixels);
+    }
+    printf("OpenGL:   frame    %8.2f ms\n", (wall_time() - start) * 1000.0 / QUIVER_FRAMES);
+    cpl_free_figure(fig);
+    
+    fig = cpl_create_software_figure(ENCODE_WIDTH, ENCODE_HEIGHT);
+    if (fig) {
+        plot = cpl_add_plot(fig);
+        cpl_set_x_range(plot, 0.0, QUIVER_GRID);
+        cpl_set_y_range(plot, 0.0, QUIVER_GRID);
+        cpl_quiver(plot, x, y, u, v, n, 0.0f, (Color){ 0.1f, 0.3f, 0.8f, 1.0f });
+        start = wall_time();
+        cpl_render_offscreen(fig, pixels);
+        printf("Software: frame    %8.2f ms\n", (wall_time() - start) * 1000.0);
+        cpl_free_figure(fig);
+    }
+    
+    free(x);
+    free(y);
+    free(u);
+    free(v);
+    free(pixels);
+}
+
+void benchmark_candles(void) {
+    double* time = malloc(CANDLE_BATCH * sizeof(double));
+    double* price = malloc(CANDLE_BATCH * sizeof(double));
+    double* volume = malloc(CANDLE_BATCH * sizeof(double));
+    unsigned char* pixels = malloc(ENCODE_WIDTH * ENCODE_HEIGHT * 4);
+    CPLFigure* fig = cpl_create_headless_figure(ENCODE_WIDTH, ENCODE_HEIGHT);
+    if (!time || !price || !volume || !pixels || !fig) {
+        free(time);
+        free(price);
+        free(volume);
+        free(pixels);
+        cpl_free_figure(fig);
+        return;
+    }
+    
+    printf("\n=== Candlesticks (%d ticks) ===\n", CANDLE_TICKS);
+    
+    // A random walk with ten ticks per second, streamed in batches from 2024-01-01
+    const double epoch = 1704067200.0;
+    const double span = CANDLE_TICKS / 10.0;
+    CPLPlot* plot = cpl_add_plot(fig);
+    cpl_set_x_range(plot, epoch, epoch + span);
+    cpl_set_y_range(plot, 0.0, 200.0);
+    cpl_set_candles(plot, (Color){ 0.1f, 0.7f, 0.3f, 1.0f }, (Color){ 0.85f, 0.2f, 0.2f, 1.0f });
+    double last = 100.0;
+    unsigned int seed = 7;
+    double elapsed = 0.0;
+    for (size_t done = 0; done < CANDLE_TICKS; done += CANDLE_BATCH) {
+        for (size_t i = 0; i < CANDLE_BATCH; i++) {
+            seed = seed * 1103515245u + 12345u;
+            last += ((double)((seed >> 16) & 0x7FFF) / 32767.0 - 0.5) * 0.05;
+            time[i] = epoch + (done + i) * 0.1;
+            price[i] = last;
+            volume[i] = 1.0;
+        }
+        double start = wall_time();
+        cpl_add_ticks(plot, time, price, volume, CANDLE_BATCH);
+        elapsed += wall_time() - start;
+    }
+    printf("Aggregate:         %8.2f M ticks/s\n", CANDLE_TICKS / elapsed / 1e6);
+    
+    // The first frame uploads the chosen level; zooming in switches to finer buckets
+    double start = wall_time();
+    cpl_render_offscreen(fig, pixels);
+    printf("OpenGL:   upload   %8.2f ms\n", (wall_time() - start) * 1000.0);
+    start = wall_time();
+    for (int i = 0; i < CANDLE_FRAMES; i++) {
+        double width = span * pow(0.5, i);
+        cpl_set_x_range(plot, epoch + span - width, epoch + span);
+        cpl_render_offscreen(fig, pixels);
+    }
+    printf("OpenGL:   frame    %8.2f ms\n", (wall_time() - start) * 1000.0 / CANDLE_FRAMES);
+    
+    // Live updates: one batch per frame re-sends only the latest candles
+    cpl_set_x_range(plot, epoch, epoch + span);
+    cpl_render_offscreen(fig, pixels);
+    start = wall_time();
+    for (int i = 0; i < CANDLE_FRAMES; i++) {
+        for (size_t k = 0; k < CANDLE_BATCH; k++) {
+            time[k] = epoch + span + (i * CANDLE_BATCH + k) * 0.1;
+        }
+        cpl_add_ticks(plot, time, price, volume, CANDLE_BATCH);
+        cpl_render_offscreen(fig, pixels);
+    }
+    printf("OpenGL:   live     %8.2f ms\n", (wall_time() - start) * 1000.0 / CANDLE_FRAMES);
+    cpl_free_figure(fig);
+    
+    fig = cpl_create_software_figure(ENCODE_WIDTH, ENCODE_HEIGHT);
+    if (fig) {
+        plot = cpl_add_plot(fig);
+        double low = price[0], high = price[0];
+        for (size_t k = 1; k < CANDLE_BATCH; k++) {
+            low = fmin(low, price[k]);
+            high = fmax(high, price[k]);
+        }
+        cpl_set_x_range(plot, time[0], time[CANDLE_BATCH - 1]);
+        cpl_set_y_range(plot, low, high);
+        cpl_set_candles(plot, (Color){ 0.1f, 0.7f, 0.3f, 1.0f }, (Color){ 0.85f, 0.2f, 0.2f, 1.0f });
+        cpl_add_ticks(plot, time, price, volume, CANDLE_BATCH);
+        start = wall_time();
+        cpl_render_offscreen(fig, pixels);
+        printf("Software: frame    %8.2f ms\n", (wall_time() - start) * 1000.0);
+        cpl_free_figure(fig);
+    }
+    
+    free(time);
+    free(price);
+    free(volume);
+    free(pixels);
+}
+
 void print_results(const char* test_name, BenchmarkResult result) {
     printf("\n=== %s ===\n", test_name);
     printf("Setup time: %.6f seconds\n", result.setup_time);
@@ -170,6 +1483,61 @@ int main() {
     BenchmarkResult result4 = benchmark_subplots(3, 3);
     print_results("3x3 Subplots Performance", result4);
     
+    // Test 5: Image encoding throughput
+    benchmark_encoders();
+    
+    // Test 6: Software rasterizer vs OpenGL
+    benchmark_backends();
+    
+    // Test 7: Figure creation churn
+    benchmark_figure_churn();
+    
+    // Test 8: Startup with and without the program binary cache
+    benchmark_shader_startup();
+    
+    // Test 9: Batch export across worker threads
+    benchmark_batch_export();
+    
+    // Test 10: Zoomed-in sorted series (binary-searched draw ranges)
+    benchmark_zoomed_series();
+    
+    // Test 11: Nearest-sample picking on large series
+    benchmark_picking();
+    
+    // Test 12: Switching axis scales (shader-side transforms)
+    benchmark_axis_scales();
+    
+    // Test 13: Deep zoom with double-float (hi/lo) positions
+    benchmark_high_precision();
+    
+    // Test 14: Instanced scatter plots
+    benchmark_scatter();
+    
+    // Test 15: Density aggregation of massive scatters
+    benchmark_density();
+    
+    // Test 16: Persistence traces (eye diagram)
+    benchmark_persistence();
+    
+    // Test 17: Scrolling waterfall
+    benchmark_waterfall();
+    
+    // Test 18: Tiled matrix image pyramid
+    benchmark_imshow();
+    
+    // Test 19: Parallel histogram counting and instanced bars
+    benchmark_histogram();
+    
+    // Test 20: Parallel marching squares into one batched buffer
+    benchmark_contour();
+    
+    // Test 21: Instanced quiver arrows thinned by zoom level
+    benchmark_quiver();
+    
+    // Test 22: Candlesticks aggregated from streamed ticks
+    benchmark_candles();
+    
+    cpl_terminate();
     printf("\nBenchmark completed successfully!\n");
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,45 @@
+#include "CPlotLib.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+int main() {
+    printf("CPlotLib Headless Example\n");
+    printf("=========================\n");
+    
+    // Headless figures render offscreen: no window or display server needed
+    CPLFigure* fig = cpl_create_headless_figure(1200, 800);
+    if (!fig) {
+        printf("Failed to create headless figure\n");
+        return 1;
+    }
+    
+    CPLPlot* plot = cpl_add_plot(fig);
+    cpl_set_x_range(plot, 0, 4 * M_PI);
+    cpl_set_y_range(plot, -1.5, 1.5);
+    cpl_set_title(plot, "Damped Sine");
+    
+    const size_t n_points = 1000;
+    double* x = malloc(n_points * sizeof(double));
+    double* y = malloc(n_points * sizeof(double));
+    if (!x || !y) {
+        printf("Failed to allocate data arrays\n");
+        return 1;
+    }
+    
+    for (size_t i = 0; i < n_points; i++) {
+        x[i] = (double)i / (n_points - 1) * 4 * M_PI;
+        y[i] = exp(-0.2 * x[i]) * sin(3 * x[i]);
+    }
+    
+    cpl_plot(plot, x, y, n_points, COLOR_BLUE, NULL, NULL);
+    
+    // Write the figure to disk
+    cpl_save_figure(fig, "headless_example.png");
+    printf("Saved headless_example.png\n");
+    
+    free(x);
+    free(y);
+    cpl_free_figure(fig);
+    return 0;
+}
@@ -34,10 +34,25 @@ extern const Color COLOR_PURPLE;
 extern const Color COLOR_PINK;
 extern const Color COLOR_BROWN;
 
+// Colormaps for scalar fields (density scatters); sampled at t in [0, 1]
+typedef enum {
+    CPL_COLORMAP_VIRIDIS = 0,    // Perceptually uniform blue-green-yellow (default)
+    CPL_COLORMAP_INFERNO,        // Perceptually uniform black-red-yellow
+    CPL_COLORMAP_GRAY,           // Black to white
+    CPL_COLORMAP_COUNT
+} CPLColormap;
+
+#define CPL_COLORMAP_STOPS 9     // Evenly spaced stops, linearly interpolated
+
 // Color conversion functions
 void cpl_hsv_to_rgb(float h, float s, float v, Color* out);
 void cpl_rgb_to_hsv(float r, float g, float b, ColorHSV* out);
 
+// Colormap lookup (t is clamped; alpha is 1) and its stops as RGB triples
+// (CPL_COLORMAP_STOPS * 3 floats), as uploaded to the GPU
+Color cpl_colormap_color(CPLColormap map, float t);
+void cpl_colormap_stops(CPLColormap map, float* rgb);
+
 #ifdef __cplusplus
 }
 #endif
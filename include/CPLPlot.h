@@ -9,41 +9,315 @@ extern "C" {
 
 #include <stddef.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 // Forward declarations
 struct CPLFigure;
 struct CPLRenderer;
+struct CPLGeometryCache;
+struct CPLRecorder;
+struct CPLPickIndex;
+struct CPLDensity;
+struct CPLContourScratch;
+
+// Axis scales, applied to data coordinates in the vertex shader
+typedef enum {
+    CPL_SCALE_LINEAR = 0,
+    CPL_SCALE_LOG10,             // Non-positive values are clipped below the axis
+    CPL_SCALE_SYMLOG             // Linear within the plot's symlog threshold of zero, logarithmic beyond
+} CPLAxisScale;
+
+// Density mode: scatters are binned into a count per pixel of the plot box and
+// the counts are drawn through the plot's colormap
+typedef enum {
+    CPL_DENSITY_OFF = 0,         // Scatters are drawn point by point
+    CPL_DENSITY_LINEAR,          // Count / maximum count
+    CPL_DENSITY_LOG,             // log(1 + count) / log(1 + maximum count)
+    CPL_DENSITY_EQ_HIST          // Histogram equalization: rank of the count among the non-empty pixels
+} CPLDensityNorm;
 
 // Internal structures
 typedef struct CPLLine {
     unsigned int vbo, vao;
     size_t num_vertices;
-    float* vertices;
+    float* vertices;             // x, y offsets from `origin` (data units), r, g, b
+    float* low;                  // High precision: x, y residuals of the offsets (NULL otherwise)
+    double origin[2];            // Data point the stored offsets are relative to
+    float bounds[4];             // Bounding box of the offsets: min x, min y, max x, max y
+    bool monotonic_x;            // x never decreases: visible samples are found by binary search
+    struct CPLPickIndex* pick;   // Nearest-sample index, built by the first cpl_pick that reaches the line
     bool is_loaded;
 } CPLLine;
 
+// Scatter cloud: one instanced point sprite per sample, transformed on the GPU like lines
+typedef struct CPLScatter {
+    unsigned int vbo, vao;
+    size_t num_points;
+    float* offsets;              // x, y offsets from `origin` (data units)
+    float* low;                  // High precision: x, y residuals of the offsets (NULL otherwise)
+    unsigned char* colors;       // Per-point RGBA8 (NULL: every point uses `color`)
+    unsigned char* sizes;        // Per-point diameter in pixels (NULL: every point uses `size`)
+    double origin[2];            // Data point the stored offsets are relative to
+    float bounds[4];             // Bounding box of the offsets: min x, min y, max x, max y
+    Color color;
+    float size;                  // Diameter in pixels
+    float max_size;              // Largest diameter, for culling
+    struct CPLPickIndex* pick;   // Nearest-point grid, built by the first cpl_pick that reaches the scatter
+    bool is_loaded;
+} CPLScatter;
+
+// Persistence traces (oscilloscope persistence, eye diagrams): captures sharing
+// their x positions, stored back to back and accumulated additively per pixel
+typedef struct CPLTraces {
+    size_t samples;              // Samples per trace
+    float* x;                    // Shared x offsets from `origin` (samples)
+    float* y;                    // y offsets from `origin`, one trace after another
+    unsigned int* frames;        // Per trace: frame it was added in
+    size_t num_traces;
+    size_t capacity;             // Traces the CPU arrays hold
+    double origin[2];            // Data point the stored offsets are relative to (y: set by the first traces)
+    bool monotonic_x;            // x never decreases: visible samples are found by binary search
+    float decay;                 // Weight kept per frame (1: infinite persistence)
+    CPLDensityNorm norm;         // Normalization of the accumulated weights
+    unsigned int frame;          // Current frame (one per cpl_add_traces call)
+    
+    // OpenGL objects: y values as one vertex per sample, x offsets and trace
+    // frames as buffer textures
+    unsigned int vbo, vao;
+    unsigned int x_buffer, x_texture;
+    unsigned int frames_buffer, frames_texture;
+    size_t uploaded;             // Traces in the GPU buffers
+    size_t buffer_capacity;      // Traces the GPU buffers hold
+    
+    // Accumulated weights: in a float render target (GL figures) or binned on
+    // the CPU (software figures and vector exports)
+    struct CPLDensity* accumulation;
+    struct CPLDensity* grid;
+} CPLTraces;
+
+// Waterfall (scrolling spectrogram): the latest `rows` rows of `bins` values in
+// a ring buffer, newest at the top of the image. The GL texture is the same
+// ring, so a new row is one row upload and scrolling is a row offset.
+typedef struct CPLWaterfall {
+    size_t bins, rows;
+    float* values;               // rows * bins, ring rows in texture order
+    size_t newest;               // Ring row of the newest row
+    size_t filled;               // Rows received so far, up to `rows`
+    double x_range[2];           // Data x of the first bin's left and the last bin's right edge
+    double y_range[2];           // Data y of the oldest row's bottom and the newest row's top edge
+    float levels[2];             // Values (dB when `decibels`) mapped to the colormap ends
+    bool decibels;               // Values are powers shown as 10 * log10(value)
+    
+    // OpenGL ring texture (created by the first GL draw)
+    unsigned int texture, vao;
+    size_t pending;              // Newest rows not uploaded yet
+} CPLWaterfall;
+
+// Matrix images (cpl_imshow): element formats, and the reduction that builds
+// each coarser level from 2x2 elements of the one below
+typedef enum {
+    CPL_MATRIX_FLOAT32 = 0,
+    CPL_MATRIX_UINT16,
+    CPL_MATRIX_UINT8
+} CPLMatrixFormat;
+
+typedef enum {
+    CPL_MATRIX_MEAN = 0,         // Average (NaN elements are skipped)
+    CPL_MATRIX_MIN,              // Keeps dark outliers visible when zoomed out
+    CPL_MATRIX_MAX               // Keeps bright outliers visible when zoomed out
+} CPLMatrixReduce;
+
+// One level of a matrix pyramid, split into square tiles that are uploaded as
+// separate textures when the view needs them
+typedef struct CPLMatrixLevel {
+    void* values;                // width * height elements in the matrix format, top row first
+    size_t width, height;
+    size_t tiles_x, tiles_y;
+    unsigned int* textures;      // Per tile (row-major from the top left), 0 when not resident
+    unsigned int* last_used;     // Per tile: frame it was last drawn in
+} CPLMatrixLevel;
+
+// Large matrix shown as an image: level 0 is the matrix, each further level
+// halves both sizes until one tile holds it
+typedef struct CPLMatrix {
+    CPLMatrixFormat format;
+    CPLMatrixReduce reduce;
+    size_t width, height;
+    double extent[4];            // Data x of the left and right, y of the bottom and top edges
+    double origin[2];            // Data point the tile positions are offsets from
+    float levels[2];             // Element values mapped to the colormap ends
+    CPLMatrixLevel* mips;
+    int num_levels;
+    
+    // OpenGL tile cache (least recently drawn tiles are evicted)
+    size_t resident;             // Tile textures alive
+    unsigned int frame;          // Draws so far
+    unsigned int vao;
+} CPLMatrix;
+
+// Histogram (cpl_hist): sample counts of `bins` equal-width bins, drawn as one
+// instanced bar per bin. cpl_hist_add keeps counting into the same bins.
+typedef struct CPLHistogram {
+    size_t bins;
+    double range[2];             // Left edge of the first bin, right edge of the last (inclusive)
+    double origin;               // Data x the bar positions are offsets from
+    uint64_t* counts;
+    Color color;
+    
+    // OpenGL objects: bar heights, one float per instance
+    unsigned int vbo, vao;
+    bool dirty;                  // Counts changed since the last upload
+} CPLHistogram;
+
+// Contour lines (cpl_contour): the polylines of every level, stored back to
+// back in the line vertex format and drawn with one multi-draw. The marching
+// buffers are kept, so updating a field reuses the allocations.
+typedef struct CPLContour {
+    size_t nx, ny;               // Field samples per row, rows
+    double extent[4];            // As cpl_imshow: edges of the elements, samples at their centres
+    double origin[2];            // Data point the stored offsets are relative to
+    float* vertices;             // x, y offsets from `origin` (data units), r, g, b
+    size_t num_vertices, vertex_capacity;
+    int* firsts;                 // Per polyline: first vertex and vertex count
+    int* counts;
+    size_t num_polylines, polyline_capacity;
+    float bounds[4];             // Bounding box of the offsets: min x, min y, max x, max y
+    struct CPLContourScratch* scratch;
+    
+    // OpenGL objects (the buffer only grows)
+    unsigned int vbo, vao;
+    size_t buffer_capacity;      // Vertices the buffer holds
+    bool dirty;                  // Vertices changed since the last upload
+} CPLContour;
+
+// Quiver (cpl_quiver): one record per arrow, expanded into a line arrow in the
+// vertex shader. Records are ordered coarse to fine so every prefix is an even
+// subset of the arrows; a view draws the prefix that keeps them apart on screen.
+#define CPL_QUIVER_LEVELS 18     // Thinning levels: grids of 2^0 to 2^16 cells per axis, then duplicate tails
+typedef struct CPLQuiver {
+    size_t num_arrows;           // Arrows with finite tails and vectors
+    float* records;              // Per arrow: tail x, y offsets from `origin` (data units), scaled u, v
+    size_t level_ends[CPL_QUIVER_LEVELS]; // Arrows in the levels up to each one
+    double origin[2];            // Data point the tail offsets are relative to
+    float bounds[4];             // Bounding box of tails and tips: min x, min y, max x, max y
+    float tails[4];              // Bounding box of the tails
+    Color color;
+    bool auto_scale;             // Arrows lengthen with the spacing of the thinned ones drawn
+    
+    // OpenGL objects: the records, one instance each
+    unsigned int vbo, vao;
+    bool dirty;                  // Records changed since the last upload
+} CPLQuiver;
+
+// Candlestick chart (cpl_set_candles): ticks aggregated into OHLC buckets of
+// every size in a fixed ladder, each level kept up to date as ticks arrive. A
+// view draws the finest level whose candles are a few pixels wide, one
+// instanced body and wick per candle.
+#define CPL_CANDLE_LEVELS 10     // Bucket sizes: 1 s, 5 s, 15 s, 1 min, 5 min, 15 min, 1 h, 4 h, 1 day, 1 week
+typedef struct CPLCandle {
+    double time;                 // Bucket start (seconds; UTC days, weeks from Monday)
+    double open, high, low, close;
+    double volume;
+    double first, last;          // Times of the earliest and latest ticks (open and close)
+} CPLCandle;
+
+typedef struct CPLCandleLevel {
+    double size;                 // Bucket length in seconds
+    CPLCandle* candles;          // Buckets with ticks, by time
+    size_t count, capacity;
+    
+    // OpenGL objects: one record per candle, re-uploaded from the first changed one
+    unsigned int vbo, vao;
+    size_t buffer_capacity;      // Candles the buffer holds
+    size_t stale;                // First candle changed since the last upload
+} CPLCandleLevel;
+
+typedef struct CPLCandles {
+    CPLCandleLevel levels[CPL_CANDLE_LEVELS];
+    double origin[2];            // Data point the GPU records are relative to (set by the first tick)
+    bool has_origin;
+    Color up, down;              // Candles closing at or above their open, and below
+} CPLCandles;
+
+// Static plot box / grid geometry shared between plots through the figure cache
+typedef struct CPLGeometry {
+    unsigned int vbo, vao;
+    size_t num_vertices;
+    
+    // Cache key
+    float margin;
+    int grid_lines;              // 0 for plot boxes
+    bool show_axes;
+    
+    size_t ref_count;            // Number of plots referencing this geometry
+} CPLGeometry;
+
+// Small multiples: a grid of sparkline tiles stored in one buffer and drawn with instancing
+#define CPL_TILE_FLOATS 12       // Floats per tile record (3 RGBA32F texels)
+typedef struct CPLSmallMultiples {
+    size_t rows, cols;           // Tile grid
+    size_t samples;              // Maximum samples per tile
+    float* values;               // rows * cols * samples series values
+    float* tiles;                // Per tile: rect[4], range[4] (min, max, count, -), color[4]
+    bool* auto_range;            // Per tile: range follows the data
+    
+    // OpenGL objects (buffer textures read by the vertex shader)
+    unsigned int values_buffer, values_texture;
+    unsigned int tiles_buffer, tiles_texture;
+    unsigned int vao;            // Attributeless VAO for the instanced draws
+    bool dirty;                  // CPU data changed since the last upload
+} CPLSmallMultiples;
+
 typedef struct CPLPlotData {
     CPLLine* lines;
     size_t num_lines;
     size_t capacity;
     
-    // OpenGL objects for plot box and grid
-    unsigned int box_vbo, box_vao;
-    unsigned int grid_vbo, grid_vao;
-    bool grid_loaded;
-    bool box_loaded;
+    // Scatter clouds, drawn above the lines
+    CPLScatter* scatters;
+    size_t num_scatters;
+    size_t scatter_capacity;
+    
+    // Shared OpenGL geometry for plot box and grid (NULL until set up)
+    CPLGeometry* box;
+    CPLGeometry* grid;
     
     float margin;
+    int grid_lines;              // Grid density (lines per axis)
+    
+    CPLSmallMultiples* multiples; // Set for small-multiples plots
+    struct CPLDensity* density;  // Density mode: count grid of the last view it was binned for
+    CPLTraces* traces;           // Persistence traces (NULL until cpl_set_persistence)
+    CPLWaterfall* waterfall;     // Waterfall image (NULL until cpl_set_waterfall)
+    CPLMatrix* matrix;           // Matrix image (NULL until cpl_imshow)
+    CPLHistogram* histogram;     // Histogram bars (NULL until cpl_hist)
+    CPLContour* contour;         // Contour lines (NULL until cpl_contour)
+    CPLQuiver* quiver;           // Quiver arrows (NULL until cpl_quiver)
+    CPLCandles* candles;         // Candlestick chart (NULL until cpl_set_candles)
 } CPLPlotData;
 
 // Constants
 #define CPL_DEFAULT_MARGIN 0.1f
+#define CPL_DEFAULT_GRID_LINES 10
 #define CPL_INITIAL_CAPACITY 4
 #define CPL_MAX_STRING_LENGTH 63
 
 // Function pointer type for color callbacks
 typedef Color (*CPLColorCallback)(double t, void* user_data);
 
+// Per-frame callback for animated / streaming figures (frame counts from 0)
+typedef void (*CPLFrameCallback)(struct CPLFigure* fig, size_t frame, void* user_data);
+
+// Builds a batch export job's figure (called on a worker thread with a fresh headless figure)
+typedef void (*CPLBuildCallback)(struct CPLFigure* fig, void* user_data);
+
+// Recording output formats
+typedef enum {
+    CPL_RECORD_RGBA = 0,         // Raw top-down RGBA frames
+    CPL_RECORD_Y4M,              // YUV4MPEG2 (4:4:4) video stream
+    CPL_RECORD_PNG_SEQUENCE      // One PNG per frame; path is a printf pattern ("frame_%05d.png")
+} CPLRecordFormat;
+
 // Subplot layout structure
 typedef struct CPLSubplotLayout {
     size_t rows;                 // Number of rows
@@ -62,6 +336,16 @@ typedef struct CPLPlot {
     double x_range[2];           // X-axis range [min, max]
     double y_range[2];           // Y-axis range [min, max]
     
+    // Axis transforms: evaluated on the GPU from the current ranges, so changing
+    // them never rebuilds line data
+    CPLAxisScale x_scale;
+    CPLAxisScale y_scale;
+    double symlog_threshold[2];  // Linear range around zero of symlog axes (x, y)
+    bool polar;                  // x is the angle in radians, y the radius
+    bool high_precision;         // Lines and scatters plotted from now on keep hi/lo offset pairs
+    CPLDensityNorm density;      // Scatters drawn as a per-pixel count image (CPL_DENSITY_OFF: as points)
+    CPLColormap colormap;        // Colormap of density, persistence, waterfall and matrix images and contours
+    
     // Plot properties
     char title[64];              // Plot title
     char x_label[64];            // X-axis label
@@ -87,6 +371,7 @@ typedef struct CPLPlot {
 // Figure structure
 typedef struct CPLFigure {
     struct CPLRenderer* renderer; // OpenGL renderer
+    struct CPLGeometryCache* geometry_cache; // Shared plot box / grid geometry
     CPLPlot** plots;             // Array of plots
     size_t num_plots;            // Number of plots
     size_t capacity;             // Current capacity
@@ -94,13 +379,74 @@ typedef struct CPLFigure {
     size_t width;                // Figure width
     size_t height;               // Figure height
     Color bg_color;              // Background color
+    
+    // Animation and recording
+    CPLFrameCallback frame_callback; // Called before each frame is drawn
+    void* frame_user_data;
+    struct CPLRecorder* recorder;    // Active recording (NULL when not recording)
 } CPLFigure;
 
+// Batch export job: one independent figure written to one file
+typedef struct CPLExportJob {
+    const char* filename;        // .png, .qoi, .svg or .pdf
+    size_t width, height;        // Figure size
+    CPLBuildCallback build;      // Adds plots and data to the job's figure
+    void* user_data;
+
+    // Results, filled in by cpl_export_batch
+    bool ok;                     // File written
+    double build_ms;             // Figure creation and build callback
+    double render_ms;            // Offscreen render and readback (0 for vector formats)
+    double encode_ms;            // Encoding and writing the file
+} CPLExportJob;
+
+// Nearest sample under the cursor (cpl_pick)
+typedef struct CPLPickResult {
+    size_t line;                 // Line (or scatter, when `scatter` is set) index in plotting order
+    bool scatter;                // The sample is a scatter point
+    size_t index;                // Sample index within the line or scatter
+    double x, y;                 // Sample in data coordinates (origin plus the stored float offset)
+    float distance;              // Distance from the query point in pixels
+} CPLPickResult;
+
 // Core API functions
 CPLFigure* cpl_create_figure(size_t width, size_t height);
+CPLFigure* cpl_create_headless_figure(size_t width, size_t height);
+CPLFigure* cpl_create_software_figure(size_t width, size_t height);
+CPLFigure* cpl_create_embedded_figure(size_t width, size_t height);  // Uses the caller's current GL context
 void cpl_show_figure(CPLFigure* fig);
 void cpl_free_figure(CPLFigure* fig);
 void cpl_save_figure(CPLFigure* fig, const char* filename);
+void cpl_terminate(void);        // Optional at exit: frees pooled GL contexts and shared shader programs
+bool cpl_save_figure_tiled(CPLFigure* fig, const char* filename, size_t width, size_t height);
+
+// Offscreen rendering (headless and software figures): one frame into `pixels`,
+// width * height RGBA8 with rows bottom-up. False when the figure cannot render offscreen.
+bool cpl_render_offscreen(CPLFigure* fig, unsigned char* pixels);
+
+// In-memory image encoding of RGBA8 pixels whose rows are at pixels + y * stride,
+// top-down (a bottom-up readback is passed as its last row and a negative stride).
+// Returns the encoded size (0 on failure); *out is freed by the caller. PNG deflates
+// on `threads` workers; cpl_image_default_threads() is the count cpl_save_figure uses.
+size_t cpl_encode_png(const unsigned char* pixels, size_t width, size_t height, ptrdiff_t stride,
+                      size_t threads, unsigned char** out);
+size_t cpl_encode_qoi(const unsigned char* pixels, size_t width, size_t height, ptrdiff_t stride,
+                      unsigned char** out);
+size_t cpl_image_default_threads(void);
+
+// Embedded figures: draw one frame into rectangle (x, y, width, height) of framebuffer `fbo`
+// (0 = default) of the current context. Host GL state is restored afterwards.
+void cpl_render_figure_to(CPLFigure* fig, unsigned int fbo, int x, int y, int width, int height);
+
+// Batch export: jobs run on `threads` workers (0 = one per core), each with its own headless context.
+// Build callbacks run concurrently. Returns the number of files written.
+size_t cpl_export_batch(CPLExportJob* jobs, size_t n_jobs, size_t threads);
+
+// Animation and recording
+void cpl_set_frame_callback(CPLFigure* fig, CPLFrameCallback callback, void* user_data);
+bool cpl_start_recording(CPLFigure* fig, const char* path, CPLRecordFormat format, int fps);
+void cpl_stop_recording(CPLFigure* fig);
+void cpl_render_frames(CPLFigure* fig, size_t n_frames);
 
 // Plot management
 CPLPlot* cpl_add_plot(CPLFigure* fig);
@@ -108,6 +454,11 @@ void cpl_add_subplots(CPLFigure* fig, size_t rows, size_t cols);
 CPLPlot* cpl_get_subplot(CPLFigure* fig, size_t index);
 CPLPlot* cpl_get_subplot_at(CPLFigure* fig, size_t row, size_t col, size_t rows, size_t cols);
 
+// Small multiples (thousands of sparkline tiles in one plot)
+CPLPlot* cpl_add_small_multiples(CPLFigure* fig, size_t rows, size_t cols, size_t samples);
+void cpl_set_small_multiple(CPLPlot* plot, size_t index, const double* y, size_t n_points, Color color);
+void cpl_set_small_multiple_range(CPLPlot* plot, size_t index, double min, double max);
+
 // Subplot layout management
 void cpl_set_subplot_layout(CPLPlot* plot, size_t rows, size_t cols, size_t index);
 void cpl_set_subplot_layout_with_grid(CPLPlot* plot, size_t rows, size_t cols, size_t index, float grid_x_start, float grid_width);
@@ -117,6 +468,13 @@ void cpl_update_subplot_viewports(CPLFigure* fig);
 // Plot configuration
 void cpl_set_x_range(CPLPlot* plot, double min, double max);
 void cpl_set_y_range(CPLPlot* plot, double min, double max);
+void cpl_set_x_scale(CPLPlot* plot, CPLAxisScale scale);
+void cpl_set_y_scale(CPLPlot* plot, CPLAxisScale scale);
+void cpl_set_symlog_threshold(CPLPlot* plot, double x_threshold, double y_threshold);
+void cpl_set_polar(CPLPlot* plot, bool polar);   // x = angle in radians, y = radius (y range and scale)
+void cpl_set_high_precision(CPLPlot* plot, bool enable);  // Double-float positions for later cpl_plot/cpl_scatter calls
+void cpl_set_density(CPLPlot* plot, CPLDensityNorm norm);  // Aggregate the plot's scatters (for tens of millions of points)
+void cpl_set_colormap(CPLPlot* plot, CPLColormap colormap);
 void cpl_set_title(CPLPlot* plot, const char* title);
 void cpl_set_x_label(CPLPlot* plot, const char* label);
 void cpl_set_y_label(CPLPlot* plot, const char* label);
@@ -133,6 +491,84 @@ void cpl_set_box_line_width(CPLPlot* plot, float width);
 void cpl_plot(CPLPlot* plot, const double* x, const double* y, size_t n_points, Color color, CPLColorCallback color_fn, void* user_data);
 void cpl_plot_parametric(CPLPlot* plot, const double* t, const double* x,  const double* y, size_t n_points, Color color, CPLColorCallback color_fn, void* user_data);
 
+// Scatter plots: discs of diameter `size` pixels in `color` (its alpha is the
+// opacity). Optional per-point streams override them: `colors` holds RGBA8
+// quadruples, `sizes` diameters in whole pixels; either may be NULL.
+void cpl_scatter(CPLPlot* plot, const double* x, const double* y, size_t n_points, Color color, float size,
+                 const unsigned char* colors, const unsigned char* sizes);
+
+// Persistence traces (oscilloscope persistence, eye diagrams): captures of
+// `samples` values at the shared positions `x`, accumulated additively per
+// pixel and drawn through the plot's colormap with normalization `norm`. Each
+// cpl_add_traces call is one frame (n_traces may be 0); traces of earlier
+// frames fade by `decay` per frame, 1 keeps them at full weight. Calling
+// cpl_set_persistence again with another sample count clears the traces.
+void cpl_set_persistence(CPLPlot* plot, const double* x, size_t samples, float decay, CPLDensityNorm norm);
+void cpl_add_traces(CPLPlot* plot, const double* y, size_t n_traces);  // n_traces * samples values
+void cpl_clear_traces(CPLPlot* plot);
+
+// Waterfall: an image of the latest `rows` rows of `bins` values, spanning
+// [x_min, x_max] across the bins and [y_min, y_max] from the oldest row to the
+// newest, drawn below the plot's lines through the plot's colormap. Each
+// cpl_add_waterfall_rows call scrolls the image by n_rows. Values are shown
+// between the levels, by default 0 and 1 (decibels: -100 and 0 dB of
+// 10 * log10(value)). Calling cpl_set_waterfall again clears the rows.
+void cpl_set_waterfall(CPLPlot* plot, size_t bins, size_t rows, double x_min, double x_max, double y_min,
+                       double y_max);
+void cpl_set_waterfall_levels(CPLPlot* plot, float min, float max, bool decibels);
+void cpl_add_waterfall_rows(CPLPlot* plot, const float* values, size_t n_rows);  // n_rows * bins values, oldest first
+
+// Matrix image of `width` x `height` elements (row-major, top row first) in
+// `format`, drawn below the plot's lines through the plot's colormap. The data
+// is copied; coarser levels are reduced with `reduce` and shown when the matrix
+// has more elements than the view has pixels. `extent` is x_min, x_max, y_min,
+// y_max (NULL: element edges at 0..width and 0..height). The levels default to
+// the data range. Calling cpl_imshow again replaces the matrix.
+void cpl_imshow(CPLPlot* plot, const void* data, CPLMatrixFormat format, size_t width, size_t height,
+                const double* extent, CPLMatrixReduce reduce);
+void cpl_set_matrix_levels(CPLPlot* plot, float min, float max);
+
+// Histogram of `n` samples counted into `bins` equal bins over `range` (min,
+// max; NULL: the finite data range), drawn as bars of `color` from 0 to each
+// count. Samples outside the range and NaNs are not counted; the last bin
+// includes its right edge. Counting is spread over all cores. Calling cpl_hist
+// again replaces the histogram; cpl_hist_add counts more samples into it.
+void cpl_hist(CPLPlot* plot, const double* data, size_t n, size_t bins, const double* range, Color color);
+void cpl_hist_add(CPLPlot* plot, const double* data, size_t n);
+
+// Contour lines of a `nx` x `ny` field (row-major, top row first, as in
+// cpl_imshow; `extent` likewise gives the element edges, NULL: 0..nx and
+// 0..ny) at `nlevels` levels, colored through the plot's colormap (as set at
+// the call) from the first level to the last. Marching squares runs over row
+// bands on all cores; cells with a NaN corner are skipped. Calling cpl_contour
+// again replaces the lines and reuses their buffers.
+void cpl_contour(CPLPlot* plot, const float* field, size_t nx, size_t ny, const double* extent, const double* levels,
+                 size_t nlevels);
+
+// Quiver of `n` arrows from (x, y) along (u, v) * `scale` (<= 0: the longest
+// arrow spans the mean spacing of the arrows drawn), as line arrows of `color`.
+// Arrows with a non-finite component are skipped. Views are thinned to about
+// one arrow per 12 x 12 pixels, evenly over the tails, so zooming in reveals
+// more of them. Calling cpl_quiver again replaces the arrows.
+void cpl_quiver(CPLPlot* plot, const double* x, const double* y, const double* u, const double* v, size_t n,
+                float scale, Color color);
+
+// Candlestick chart of raw ticks: cpl_add_ticks aggregates `n` ticks (time in
+// seconds since the epoch, price, volume; NULL volume counts 0) into OHLC
+// candles of 1 s up to 1 week, updating only the buckets they touch, in any
+// order. Each view draws the finest buckets at least a few pixels wide, with
+// `up` candles closing at or above their open and `down` ones below. Ticks
+// with a non-finite time or price are skipped. Calling cpl_set_candles again
+// keeps the candles and changes the colors.
+void cpl_set_candles(CPLPlot* plot, Color up, Color down);
+void cpl_add_ticks(CPLPlot* plot, const double* time, const double* price, const double* volume, size_t n);
+
+// Picking: nearest line sample or scatter point within `radius` pixels of a
+// point given in figure pixels from the top-left corner (window cursor
+// coordinates). Samples clipped by the plot box are ignored. Returns false when
+// nothing is in reach.
+bool cpl_pick(CPLPlot* plot, double screen_x, double screen_y, double radius, CPLPickResult* result);
+
 // Plot rendering
 void cpl_render_plot(CPLPlot* plot);
 
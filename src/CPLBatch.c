@@ -0,0 +1,193 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "CPLPlot.h"
+#include "utils/CPLRenderer.h"
+#include "utils/CPLImage.h"
+#include "utils/CPLVector.h"
+#include "utils/CPLUtils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+// Work queue shared by the batch workers
+typedef struct {
+    CPLExportJob* jobs;
+    size_t num_jobs;
+    size_t encoder_threads;     // PNG deflate workers per job
+
+    pthread_mutex_t lock;       // Guards next_job
+    size_t next_job;
+} CPLExportQueue;
+
+// Per-worker state: the readback buffer is reused across jobs
+typedef struct {
+    CPLExportQueue* queue;
+    unsigned char* pixels;
+    size_t capacity;
+} CPLExportWorker;
+
+// Internal function declarations
+static void* cpl_export_worker_main(void* arg);
+static void cpl_export_job(CPLExportWorker* worker, CPLExportJob* job);
+static bool cpl_export_pixels(CPLExportWorker* worker, CPLExportJob* job, CPLFigure* fig);
+static double cpl_export_now_ms(void);
+static void cpl_batch_error(const char* message);
+
+size_t cpl_export_batch(CPLExportJob* jobs, size_t n_jobs, size_t threads) {
+    if (!jobs || n_jobs == 0) return 0;
+
+    for (size_t i = 0; i < n_jobs; i++) {
+        jobs[i].ok = false;
+        jobs[i].build_ms = jobs[i].render_ms = jobs[i].encode_ms = 0.0;
+    }
+
+    size_t num_workers = threads;
+    if (num_workers == 0) {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        num_workers = cores > 0 ? (size_t)cores : 1;
+    }
+#ifndef CPL_ENABLE_EGL
+    // Hidden GLFW windows are tied to the main thread
+    num_workers = 1;
+#endif
+    if (num_workers > n_jobs) num_workers = n_jobs;
+
+    // Cores left over when there are fewer jobs than cores go to the PNG encoder
+    CPLExportQueue queue = { 0 };
+    queue.jobs = jobs;
+    queue.num_jobs = n_jobs;
+    queue.encoder_threads = cpl_image_default_threads() / num_workers;
+    if (queue.encoder_threads == 0) queue.encoder_threads = 1;
+
+    CPLExportWorker* workers = (CPLExportWorker*)calloc(num_workers, sizeof(CPLExportWorker));
+    if (!workers || pthread_mutex_init(&queue.lock, NULL) != 0) {
+        cpl_batch_error("Failed to set up export workers");
+        free(workers);
+        return 0;
+    }
+
+    // Worker 0 runs on the calling thread; a worker that fails to start runs
+    // inline and simply finds the queue drained or shorter
+    for (size_t i = 0; i < num_workers; i++) {
+        workers[i].queue = &queue;
+    }
+    cpl_run_workers(workers, sizeof(CPLExportWorker), num_workers, cpl_export_worker_main);
+
+    pthread_mutex_destroy(&queue.lock);
+    free(workers);
+
+    size_t written = 0;
+    for (size_t i = 0; i < n_jobs; i++) {
+        if (jobs[i].ok) written++;
+    }
+    return written;
+}
+
+// Internal helper functions
+static void* cpl_export_worker_main(void* arg) {
+    CPLExportWorker* worker = (CPLExportWorker*)arg;
+    CPLExportQueue* queue = worker->queue;
+
+    // Jobs are claimed one at a time, so uneven jobs balance across workers
+    for (;;) {
+        pthread_mutex_lock(&queue->lock);
+        size_t index = queue->next_job++;
+        pthread_mutex_unlock(&queue->lock);
+        if (index >= queue->num_jobs) break;
+
+        cpl_export_job(worker, &queue->jobs[index]);
+    }
+
+    free(worker->pixels);
+    worker->pixels = NULL;
+    worker->capacity = 0;
+    return NULL;
+}
+
+static void cpl_export_job(CPLExportWorker* worker, CPLExportJob* job) {
+    if (!job->filename || !job->build) {
+        cpl_batch_error("Export job needs a filename and a build callback");
+        return;
+    }
+
+    // The figure's context comes from the renderer pool and is current on this
+    // thread until the figure is freed
+    double start = cpl_export_now_ms();
+    CPLFigure* fig = cpl_create_headless_figure(job->width, job->height);
+    if (!fig) return;
+    job->build(fig, job->user_data);
+    double built = cpl_export_now_ms();
+    job->build_ms = built - start;
+
+    // Vector formats are written straight from the plot data
+    if (cpl_has_extension(job->filename, ".svg")) {
+        job->ok = cpl_write_svg(fig, job->filename);
+        job->encode_ms = cpl_export_now_ms() - built;
+    } else if (cpl_has_extension(job->filename, ".pdf")) {
+        job->ok = cpl_write_pdf(fig, job->filename);
+        job->encode_ms = cpl_export_now_ms() - built;
+    } else {
+        job->ok = cpl_export_pixels(worker, job, fig);
+    }
+
+    cpl_free_figure(fig);
+}
+
+static bool cpl_export_pixels(CPLExportWorker* worker, CPLExportJob* job, CPLFigure* fig) {
+    bool qoi = cpl_has_extension(job->filename, ".qoi");
+    if (!qoi && !cpl_has_extension(job->filename, ".png")) {
+        cpl_batch_error("Unsupported image format (use .png, .qoi, .svg or .pdf)");
+        return false;
+    }
+
+    size_t size = fig->width * fig->height * 4;
+    if (size > worker->capacity) {
+        unsigned char* pixels = (unsigned char*)realloc(worker->pixels, size);
+        if (!pixels) {
+            cpl_batch_error("Failed to allocate memory for figure pixels");
+            return false;
+        }
+        worker->pixels = pixels;
+        worker->capacity = size;
+    }
+
+    double start = cpl_export_now_ms();
+    if (!cpl_render_offscreen(fig, worker->pixels)) {
+        cpl_batch_error("Failed to render figure offscreen");
+        return false;
+    }
+    double rendered = cpl_export_now_ms();
+    job->render_ms = rendered - start;
+
+    // Readback rows are bottom-up: encode from the last row with a negative stride
+    ptrdiff_t stride = (ptrdiff_t)fig->width * 4;
+    const unsigned char* top_row = worker->pixels + (fig->height - 1) * stride;
+    bool ok;
+    if (qoi) {
+        ok = cpl_write_qoi(job->filename, top_row, fig->width, fig->height, -stride);
+    } else {
+        // The whole image as one band, on this job's share of the encoder threads
+        CPLPngStream* stream = cpl_png_stream_open(job->filename, fig->width, fig->height,
+                                                   worker->queue->encoder_threads);
+        ok = stream != NULL;
+        if (stream) {
+            ok = cpl_png_stream_write(stream, top_row, fig->height, -stride);
+            ok = cpl_png_stream_close(stream) && ok;
+        }
+    }
+    job->encode_ms = cpl_export_now_ms() - rendered;
+    return ok;
+}
+
+static double cpl_export_now_ms(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec * 1e3 + (double)now.tv_nsec * 1e-6;
+}
+
+static void cpl_batch_error(const char* message) {
+    fprintf(stderr, "CPlotLib Error: %s\n", message);
+}
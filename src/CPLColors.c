@@ -84,3 +84,36 @@ void cpl_rgb_to_hsv(float r, float g, float b, ColorHSV* out) {
         out->h += 360.0f;
     }
 }
+
+// Colormap stops (0xRRGGBB at t = 0, 1/8, ..., 1)
+static const unsigned int cpl_colormap_table[CPL_COLORMAP_COUNT][CPL_COLORMAP_STOPS] = {
+    { 0x440154, 0x472d7b, 0x3b528b, 0x2c728e, 0x21918c, 0x28ae80, 0x5ec962, 0xaddc30, 0xfde725 },
+    { 0x000004, 0x1f0c48, 0x550f6d, 0x88226a, 0xba3655, 0xe35933, 0xf98c0a, 0xf9c932, 0xfcffa4 },
+    { 0x000000, 0x202020, 0x404040, 0x606060, 0x808080, 0x9f9f9f, 0xbfbfbf, 0xdfdfdf, 0xffffff }
+};
+
+void cpl_colormap_stops(CPLColormap map, float* rgb) {
+    if (!rgb) return;
+    if ((unsigned int)map >= CPL_COLORMAP_COUNT) map = CPL_COLORMAP_VIRIDIS;
+
+    for (int i = 0; i < CPL_COLORMAP_STOPS; i++) {
+        unsigned int stop = cpl_colormap_table[map][i];
+        rgb[i * 3 + 0] = (float)((stop >> 16) & 0xFF) / 255.0f;
+        rgb[i * 3 + 1] = (float)((stop >> 8) & 0xFF) / 255.0f;
+        rgb[i * 3 + 2] = (float)(stop & 0xFF) / 255.0f;
+    }
+}
+
+Color cpl_colormap_color(CPLColormap map, float t) {
+    float stops[CPL_COLORMAP_STOPS * 3];
+    cpl_colormap_stops(map, stops);
+
+    // Same interpolation as the colormap shader function
+    float x = (t > 0.0f ? (t < 1.0f ? t : 1.0f) : 0.0f) * (float)(CPL_COLORMAP_STOPS - 1);
+    int i = (int)x < CPL_COLORMAP_STOPS - 2 ? (int)x : CPL_COLORMAP_STOPS - 2;
+    float f = x - (float)i;
+    const float* a = stops + i * 3;
+    const float* b = a + 3;
+    Color out = { a[0] + f * (b[0] - a[0]), a[1] + f * (b[1] - a[1]), a[2] + f * (b[2] - a[2]), 1.0f };
+    return out;
+}
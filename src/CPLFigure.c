@@ -1,12 +1,24 @@
 #include "CPLPlot.h"
 #include "utils/CPLRenderer.h"
+#include "utils/CPLGeometry.h"
+#include "utils/CPLImage.h"
+#include "utils/CPLRecorder.h"
+#include "utils/CPLVector.h"
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <limits.h>
 
 // Internal function declarations
+static CPLFigure* cpl_create_figure_with_renderer(size_t width, size_t height, CPLRenderer* renderer);
 static void cpl_plot_error(const char* message);
 
+// Constants
+#define CPL_EXPORT_MAX_TILE 8192        // Widest GL tile for tiled exports
+#define CPL_EXPORT_BAND_ROWS 256        // Rows rendered and encoded per band
+
 // Forward declarations for functions in other modules
 extern void cpl_free_plot(CPLPlot* plot);
 
@@ -17,29 +29,40 @@ CPLFigure* cpl_create_figure(size_t width, size_t height) {
         return NULL;
     }
 
-    CPLFigure* fig = (CPLFigure*)calloc(1, sizeof(CPLFigure));
-    if (!fig) {
-        cpl_plot_error("Failed to allocate memory for figure");
+    return cpl_create_figure_with_renderer(width, height, cpl_create_renderer(width, height));
+}
+
+CPLFigure* cpl_create_headless_figure(size_t width, size_t height) {
+    if (width == 0 || height == 0) {
+        cpl_plot_error("Invalid figure dimensions");
         return NULL;
     }
 
-    // Initialize renderer
-    fig->renderer = cpl_create_renderer(width, height);
-    if (!fig->renderer) {
-        cpl_plot_error("Failed to create renderer");
-        free(fig);
+    return cpl_create_figure_with_renderer(width, height, cpl_create_headless_renderer(width, height));
+}
+
+CPLFigure* cpl_create_software_figure(size_t width, size_t height) {
+    if (width == 0 || height == 0) {
+        cpl_plot_error("Invalid figure dimensions");
         return NULL;
     }
 
-    // Initialize figure properties
-    fig->plots = NULL;
-    fig->num_plots = 0;
-    fig->capacity = 0;
-    fig->width = width;
-    fig->height = height;
-    fig->bg_color = COLOR_WHITE;
+    return cpl_create_figure_with_renderer(width, height, cpl_create_software_renderer());
+}
 
-    return fig;
+CPLFigure* cpl_create_embedded_figure(size_t width, size_t height) {
+    if (width == 0 || height == 0) {
+        cpl_plot_error("Invalid figure dimensions");
+        return NULL;
+    }
+
+    // The host's context must be current here and for every later call on the figure
+    return cpl_create_figure_with_renderer(width, height, cpl_create_external_renderer());
+}
+
+void cpl_terminate(void) {
+    // Live figures keep their own contexts; only pooled ones are released
+    cpl_shutdown_renderers();
 }
 
 void cpl_show_figure(CPLFigure* fig) {
@@ -54,6 +77,14 @@ void cpl_show_figure(CPLFigure* fig) {
 void cpl_free_figure(CPLFigure* fig) {
     if (!fig) return;
 
+    // Plot GL objects belong to this figure's context
+    if (fig->renderer) {
+        cpl_make_renderer_current(fig->renderer);
+    }
+
+    // Flush any recording still in progress
+    cpl_stop_recording(fig);
+
     // Free all plots
     if (fig->plots) {
         for (size_t i = 0; i < fig->num_plots; i++) {
@@ -64,6 +95,11 @@ void cpl_free_figure(CPLFigure* fig) {
         free(fig->plots);
     }
 
+    // Plots have released their geometry references by now
+    if (fig->geometry_cache) {
+        cpl_destroy_geometry_cache(fig->geometry_cache);
+    }
+
     // Free renderer
     if (fig->renderer) {
         cpl_destroy_renderer(fig->renderer);
@@ -78,11 +114,247 @@ void cpl_save_figure(CPLFigure* fig, const char* filename) {
         return;
     }
     
-    // TODO: Implement actual file saving functionality
-    printf("Save functionality not yet implemented: %s\n", filename);
+    // Vector formats are written straight from the plot data, without rendering
+    if (cpl_has_extension(filename, ".svg")) {
+        cpl_write_svg(fig, filename);
+        return;
+    }
+    if (cpl_has_extension(filename, ".pdf")) {
+        cpl_write_pdf(fig, filename);
+        return;
+    }
+    
+    bool qoi = cpl_has_extension(filename, ".qoi");
+    if (!qoi && !cpl_has_extension(filename, ".png")) {
+        cpl_plot_error("Unsupported image format (use .png, .qoi, .svg or .pdf)");
+        return;
+    }
+    
+    unsigned char* pixels = (unsigned char*)malloc(fig->width * fig->height * 4);
+    if (!pixels) {
+        cpl_plot_error("Failed to allocate memory for figure pixels");
+        return;
+    }
+    
+    // Render into the offscreen framebuffer; readback rows are bottom-up, so the
+    // encoders walk them in place from the last row with a negative stride
+    if (cpl_render_offscreen(fig, pixels)) {
+        ptrdiff_t stride = (ptrdiff_t)fig->width * 4;
+        const unsigned char* top_row = pixels + (fig->height - 1) * stride;
+        if (qoi) {
+            cpl_write_qoi(filename, top_row, fig->width, fig->height, -stride);
+        } else {
+            cpl_write_png(filename, top_row, fig->width, fig->height, -stride);
+        }
+    } else {
+        cpl_plot_error("Failed to render figure offscreen");
+    }
+    
+    free(pixels);
+}
+
+void cpl_render_figure_to(CPLFigure* fig, unsigned int fbo, int x, int y, int width, int height) {
+    if (!fig || !cpl_renderer_has_gl(fig->renderer)) {
+        cpl_plot_error("Invalid figure or renderer");
+        return;
+    }
+    
+    if (!cpl_render_to_framebuffer(fig, fbo, x, y, width, height)) {
+        cpl_plot_error("Invalid target rectangle");
+    }
+}
+
+bool cpl_save_figure_tiled(CPLFigure* fig, const char* filename, size_t width, size_t height) {
+    if (!fig || !fig->renderer || !filename) {
+        cpl_plot_error("Invalid figure or filename");
+        return false;
+    }
+    
+    if (width == 0 || height == 0 || width > INT_MAX || height > INT_MAX) {
+        cpl_plot_error("Invalid export dimensions");
+        return false;
+    }
+    
+    if (!cpl_has_extension(filename, ".png")) {
+        cpl_plot_error("Tiled export only supports .png");
+        return false;
+    }
+    
+    // Tiles must fit the offscreen target; the rasterizer renders whole bands
+    int max_width, max_height;
+    if (!cpl_max_offscreen_size(fig, &max_width, &max_height)) {
+        cpl_plot_error("Failed to query the maximum render target size");
+        return false;
+    }
+    size_t tile_width = width;
+    if (tile_width > (size_t)max_width) tile_width = (size_t)max_width;
+    if (tile_width > CPL_EXPORT_MAX_TILE) tile_width = CPL_EXPORT_MAX_TILE;
+    if (!cpl_renderer_has_gl(fig->renderer)) tile_width = width;
+    size_t band_height = height < CPL_EXPORT_BAND_ROWS ? height : CPL_EXPORT_BAND_ROWS;
+    if (band_height > (size_t)max_height) band_height = (size_t)max_height;
+    
+    // One band of tiles is resident at a time; rows go to the encoder as soon as
+    // the band is complete
+    unsigned char* band = (unsigned char*)malloc(width * band_height * 4);
+    if (!band) {
+        cpl_plot_error("Failed to allocate memory for export band");
+        return false;
+    }
+    
+    CPLPngStream* stream = cpl_png_stream_open(filename, width, height, cpl_image_default_threads());
+    if (!stream) {
+        free(band);
+        return false;
+    }
+    
+    bool ok = true;
+    ptrdiff_t stride = (ptrdiff_t)width * 4;
+    for (size_t top = 0; ok && top < height; top += band_height) {
+        // Bands run top-down in the image, regions are bottom-up on the canvas
+        size_t rows = height - top < band_height ? height - top : band_height;
+        for (size_t x = 0; ok && x < width; x += tile_width) {
+            int region[4];
+            region[0] = (int)x;
+            region[1] = (int)(height - top - rows);
+            region[2] = (int)(width - x < tile_width ? width - x : tile_width);
+            region[3] = (int)rows;
+            ok = cpl_render_offscreen_region(fig, (int)width, (int)height, region, band + x * 4, width);
+        }
+        
+        if (!ok) {
+            cpl_plot_error("Failed to render export tile");
+            break;
+        }
+        ok = cpl_png_stream_write(stream, band + (rows - 1) * stride, rows, -stride);
+    }
+    
+    ok = cpl_png_stream_close(stream) && ok;
+    free(band);
+    return ok;
+}
+
+// Animation and recording
+void cpl_set_frame_callback(CPLFigure* fig, CPLFrameCallback callback, void* user_data) {
+    if (!fig) return;
+    fig->frame_callback = callback;
+    fig->frame_user_data = user_data;
+}
+
+bool cpl_start_recording(CPLFigure* fig, const char* path, CPLRecordFormat format, int fps) {
+    if (!fig || !fig->renderer || !path) {
+        cpl_plot_error("Invalid figure or recording path");
+        return false;
+    }
+    
+    if (fig->recorder) {
+        cpl_plot_error("Figure is already recording");
+        return false;
+    }
+    
+    if (!cpl_renderer_has_gl(fig->renderer)) {
+        cpl_plot_error("Recording requires an OpenGL figure");
+        return false;
+    }
+    
+    // Windowed figures record the window's framebuffer, headless ones the figure size
+    int width = (int)fig->width;
+    int height = (int)fig->height;
+    if (fig->renderer->window && !fig->renderer->headless) {
+        glfwGetFramebufferSize(fig->renderer->window, &width, &height);
+    }
+    
+    cpl_make_renderer_current(fig->renderer);
+    fig->recorder = cpl_create_recorder(path, format, width, height, fps);
+    return fig->recorder != NULL;
+}
+
+void cpl_stop_recording(CPLFigure* fig) {
+    if (!fig || !fig->recorder) return;
+    
+    cpl_make_renderer_current(fig->renderer);
+    cpl_destroy_recorder(fig->recorder);
+    fig->recorder = NULL;
+}
+
+void cpl_render_frames(CPLFigure* fig, size_t n_frames) {
+    if (!fig || !fig->renderer) {
+        cpl_plot_error("Invalid figure or renderer");
+        return;
+    }
+    
+    if (!cpl_renderer_has_gl(fig->renderer)) {
+        cpl_plot_error("Frame rendering requires an OpenGL figure");
+        return;
+    }
+    
+    // Offscreen equivalent of the window loop: callback, draw, capture
+    for (size_t frame = 0; frame < n_frames; frame++) {
+        if (fig->frame_callback) {
+            fig->frame_callback(fig, frame, fig->frame_user_data);
+        }
+        
+        if (!cpl_render_offscreen_frame(fig)) {
+            cpl_plot_error("Failed to render figure offscreen");
+            return;
+        }
+        
+        if (fig->recorder) {
+            cpl_recorder_capture(fig->recorder, (int)fig->width, (int)fig->height);
+        }
+    }
+    
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
 // Internal helper functions
+static CPLFigure* cpl_create_figure_with_renderer(size_t width, size_t height, CPLRenderer* renderer) {
+    if (!renderer) {
+        cpl_plot_error("Failed to create renderer");
+        return NULL;
+    }
+
+    CPLFigure* fig = (CPLFigure*)calloc(1, sizeof(CPLFigure));
+    if (!fig) {
+        cpl_plot_error("Failed to allocate memory for figure");
+        cpl_destroy_renderer(renderer);
+        return NULL;
+    }
+
+    fig->renderer = renderer;
+
+    // Shared plot box / grid geometry for all plots of this figure
+    fig->geometry_cache = cpl_create_geometry_cache(cpl_renderer_has_gl(renderer));
+    if (!fig->geometry_cache) {
+        cpl_plot_error("Failed to create geometry cache");
+        cpl_destroy_renderer(fig->renderer);
+        free(fig);
+        return NULL;
+    }
+
+    // Initialize figure properties
+    fig->plots = NULL;
+    fig->num_plots = 0;
+    fig->capacity = 0;
+    fig->width = width;
+    fig->height = height;
+    fig->bg_color = COLOR_WHITE;
+
+    return fig;
+}
+
+// Case-insensitive suffix test (also used by the batch exporter)
+bool cpl_has_extension(const char* filename, const char* extension) {
+    size_t name_length = strlen(filename);
+    size_t ext_length = strlen(extension);
+    if (name_length < ext_length) return false;
+    
+    const char* suffix = filename + name_length - ext_length;
+    for (size_t i = 0; i < ext_length; i++) {
+        if (tolower((unsigned char)suffix[i]) != extension[i]) return false;
+    }
+    return true;
+}
+
 static void cpl_plot_error(const char* message) {
     fprintf(stderr, "CPlotLib Error: %s\n", message);
 }
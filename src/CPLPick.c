@@ -0,0 +1,485 @@
+#include "CPLPlot.h"
+#include "utils/CPLRenderer.h"
+#include "utils/CPLTransform.h"
+#include "utils/CPLUtils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+
+// Constants
+#define CPL_PICK_BLOCK 64                  // Samples per y-bounds block, blocks per group
+#define CPL_PICK_LEVELS 2
+#define CPL_PICK_CELL_SAMPLES 4            // Target samples per grid cell
+#define CPL_PICK_MAX_CELLS (1u << 22)
+
+// Nearest-sample index for one line or scatter. Monotonic lines are
+// binary-searched by x and keep y bounds per block of samples (and per group of
+// blocks), so runs of samples far above or below the cursor are skipped. Other
+// lines and scatters (and everything in a polar plot) bucket their projected
+// samples into a uniform grid over their NDC bounding box.
+typedef struct CPLPickIndex {
+    // Monotonic lines: min y, max y offset per block of CPL_PICK_BLOCK samples
+    // (level 0) and per group of CPL_PICK_BLOCK blocks (level 1)
+    float* bounds[CPL_PICK_LEVELS];
+
+    // Grid: cols * rows cells, samples sorted by cell. Positions depend on the
+    // view, so the grid is rebuilt when the ranges, scales or polar flag change.
+    CPLViewTransform view;       // View the grid was built for
+    float* positions;            // NDC x, y per sample
+    size_t cols, rows;
+    float origin[2];             // NDC of the grid's lower-left corner
+    float cells_per_unit[2];     // Cells per NDC unit along x and y
+    uint32_t* cell_start;        // First entry of each cell in `samples` (cols * rows + 1)
+    uint32_t* samples;           // Sample indices
+} CPLPickIndex;
+
+// Samples of one line or scatter, as the grid and the searches read them
+typedef struct {
+    const float* offsets;        // x, y offsets from `origin`, `stride` floats apart
+    size_t stride;
+    const float* low;            // High precision: x, y residuals of the offsets (NULL otherwise)
+    size_t count;
+    const double* origin;
+    const float* bounds;         // Bounding box of the offsets
+    bool scatter;                // Points of scatter `item` rather than vertices of line `item`
+    size_t item;
+} CPLPickSamples;
+
+// One query against the lines and scatters of a plot (all coordinates in the plot's NDC)
+typedef struct {
+    CPLViewTransform view;       // Data -> NDC mapping of the plot
+    float x, y;                  // Query point
+    float scale[2];              // Pixels per NDC unit
+    float box[2];                // Plot box: samples outside [box[0], box[1]] are clipped away
+    float best;                  // Squared pixel distance of the best sample so far
+    bool found;                  // A sample is within the radius
+    bool scatter;                // Best sample: scatter point rather than line vertex
+    size_t item;                 // Line or scatter of the best sample
+    size_t index;
+} CPLPickQuery;
+
+// Internal function declarations
+static bool cpl_build_pick_blocks(CPLPickIndex* index, const CPLLine* line);
+static bool cpl_build_pick_grid(CPLPickIndex* index, const CPLPickSamples* samples, const CPLViewTransform* view);
+static void cpl_free_pick_grid(CPLPickIndex* index);
+static void cpl_pick_line(CPLPickQuery* query, CPLLine* line, size_t item);
+static void cpl_pick_scatter(CPLPickQuery* query, CPLScatter* scatter, size_t item);
+static bool cpl_pick_in_reach(const CPLPickQuery* query, const CPLPickSamples* samples);
+static void cpl_pick_indexed(CPLPickQuery* query, CPLPickIndex* index, const CPLPickSamples* samples);
+static void cpl_pick_sorted(CPLPickQuery* query, const CPLLine* line, const CPLPickSamples* samples);
+static void cpl_pick_grid(CPLPickQuery* query, const CPLPickIndex* index, const CPLPickSamples* samples);
+static void cpl_pick_linear(CPLPickQuery* query, const CPLPickSamples* samples);
+static void cpl_pick_sample(CPLPickQuery* query, const CPLPickSamples* samples, size_t index, const float* ndc);
+static void cpl_pick_map(const CPLPickQuery* query, const CPLPickSamples* samples, size_t index, float* ndc);
+static float cpl_pick_reach(const CPLPickQuery* query, const CPLPickSamples* samples, float* window);
+static size_t cpl_pick_skip_span(const CPLPickIndex* index, const float* window, size_t sample);
+static size_t cpl_pick_cell(float value, float origin, float cells_per_unit, size_t cells);
+static void cpl_pick_error(const char* message);
+
+// Internal functions used by other modules
+void cpl_free_pick_index(struct CPLPickIndex* index);
+
+bool cpl_pick(CPLPlot* plot, double screen_x, double screen_y, double radius, CPLPickResult* result) {
+    if (!plot || !plot->data || !plot->figure || !result || !(radius >= 0.0)) {
+        cpl_pick_error("Invalid pick query");
+        return false;
+    }
+
+    CPLFigure* fig = plot->figure;
+    int viewport[4];
+    cpl_plot_viewport(plot, (int)fig->width, (int)fig->height, viewport);
+    if (viewport[2] <= 0 || viewport[3] <= 0) return false;
+
+    // Zeroed first so views compare with memcmp against a grid's
+    CPLPickQuery query;
+    memset(&query, 0, sizeof(query));
+    cpl_view_transform(plot, viewport, &query.view);
+
+    // Screen y grows downwards, framebuffer y upwards
+    query.scale[0] = 0.5f * (float)viewport[2];
+    query.scale[1] = 0.5f * (float)viewport[3];
+    query.x = (float)((screen_x - viewport[0]) / query.scale[0] - 1.0);
+    query.y = (float)(((double)fig->height - screen_y - viewport[1]) / query.scale[1] - 1.0);
+    query.box[0] = -1.0f + plot->data->margin;
+    query.box[1] = 1.0f - plot->data->margin;
+    query.best = (float)(radius * radius);
+
+    // Later items are drawn on top, so they win ties: scatters over lines, and
+    // later ones of each over earlier ones
+    for (size_t i = plot->data->num_scatters; i-- > 0;) {
+        cpl_pick_scatter(&query, &plot->data->scatters[i], i);
+    }
+    for (size_t i = plot->data->num_lines; i-- > 0;) {
+        cpl_pick_line(&query, &plot->data->lines[i], i);
+    }
+    if (!query.found) return false;
+
+    const float* offset;
+    const float* low;
+    const double* origin;
+    if (query.scatter) {
+        const CPLScatter* scatter = &plot->data->scatters[query.item];
+        offset = scatter->offsets + query.index * 2;
+        low = scatter->low ? scatter->low + query.index * 2 : NULL;
+        origin = scatter->origin;
+    } else {
+        const CPLLine* line = &plot->data->lines[query.item];
+        offset = line->vertices + query.index * 5;
+        low = line->low ? line->low + query.index * 2 : NULL;
+        origin = line->origin;
+    }
+    result->line = query.item;
+    result->scatter = query.scatter;
+    result->index = query.index;
+    result->x = origin[0] + ((double)offset[0] + (low ? low[0] : 0.0f));
+    result->y = origin[1] + ((double)offset[1] + (low ? low[1] : 0.0f));
+    result->distance = sqrtf(query.best);
+    return true;
+}
+
+void cpl_free_pick_index(struct CPLPickIndex* index) {
+    if (!index) return;
+
+    for (int level = 0; level < CPL_PICK_LEVELS; level++) {
+        free(index->bounds[level]);
+    }
+    cpl_free_pick_grid(index);
+    free(index);
+}
+
+// Internal helper functions
+static bool cpl_build_pick_blocks(CPLPickIndex* index, const CPLLine* line) {
+    // Level 0 summarizes samples, each further level the blocks of the level below
+    size_t count = line->num_vertices;
+    for (int level = 0; level < CPL_PICK_LEVELS; level++) {
+        size_t num_blocks = (count + CPL_PICK_BLOCK - 1) / CPL_PICK_BLOCK;
+        float* bounds = (float*)malloc(num_blocks * 2 * sizeof(float));
+        if (!bounds) return false;
+        index->bounds[level] = bounds;
+
+        // NaN samples never widen a block; an all-NaN block stays empty and is always skipped
+        for (size_t block = 0; block < num_blocks; block++) {
+            size_t begin = block * CPL_PICK_BLOCK;
+            size_t end = begin + CPL_PICK_BLOCK < count ? begin + CPL_PICK_BLOCK : count;
+            float min_y = INFINITY;
+            float max_y = -INFINITY;
+            for (size_t i = begin; i < end; i++) {
+                float low = level == 0 ? line->vertices[i * 5 + 1] : index->bounds[level - 1][i * 2 + 0];
+                float high = level == 0 ? low : index->bounds[level - 1][i * 2 + 1];
+                if (low < min_y) min_y = low;
+                if (high > max_y) max_y = high;
+            }
+            bounds[block * 2 + 0] = min_y;
+            bounds[block * 2 + 1] = max_y;
+        }
+        count = num_blocks;
+    }
+    return true;
+}
+
+static bool cpl_build_pick_grid(CPLPickIndex* index, const CPLPickSamples* samples, const CPLViewTransform* view) {
+    // Sample indices are stored as 32 bits; bigger lines and scatters fall back to a linear scan
+    if (samples->count > UINT32_MAX) return false;
+
+    index->positions = (float*)malloc(samples->count * 2 * sizeof(float));
+    if (!index->positions) return false;
+
+    // Project every sample once; NaN and clipped log values stay out of the bounds
+    float bounds[4] = { INFINITY, INFINITY, -INFINITY, -INFINITY };
+    for (size_t i = 0; i < samples->count; i++) {
+        float* ndc = index->positions + i * 2;
+        cpl_view_map(view, samples->origin, samples->offsets + i * samples->stride,
+                     samples->low ? samples->low + i * 2 : NULL, ndc);
+        if (!cpl_is_finitef(ndc[0]) || !cpl_is_finitef(ndc[1])) continue;
+        if (ndc[0] < bounds[0]) bounds[0] = ndc[0];
+        if (ndc[1] < bounds[1]) bounds[1] = ndc[1];
+        if (ndc[0] > bounds[2]) bounds[2] = ndc[0];
+        if (ndc[1] > bounds[3]) bounds[3] = ndc[1];
+    }
+
+    // Roughly square cells over the bounding box, a few samples each
+    size_t cells = samples->count / CPL_PICK_CELL_SAMPLES;
+    if (cells < 1) cells = 1;
+    if (cells > CPL_PICK_MAX_CELLS) cells = CPL_PICK_MAX_CELLS;
+
+    float width = bounds[2] - bounds[0];
+    float height = bounds[3] - bounds[1];
+    if (!(width > 1e-6f)) width = 1e-6f;     // Also covers samples with no finite position
+    if (!(height > 1e-6f)) height = 1e-6f;
+
+    size_t cols = (size_t)sqrt((double)cells * width / height);
+    if (cols < 1) cols = 1;
+    if (cols > cells) cols = cells;
+    size_t rows = cells / cols;
+
+    index->cols = cols;
+    index->rows = rows;
+    index->origin[0] = cpl_is_finitef(bounds[0]) ? bounds[0] : 0.0f;
+    index->origin[1] = cpl_is_finitef(bounds[1]) ? bounds[1] : 0.0f;
+    index->cells_per_unit[0] = (float)cols / width;
+    index->cells_per_unit[1] = (float)rows / height;
+    index->cell_start = (uint32_t*)calloc(cols * rows + 1, sizeof(uint32_t));
+    index->samples = (uint32_t*)malloc(samples->count * sizeof(uint32_t));
+    uint32_t* fill = (uint32_t*)malloc(cols * rows * sizeof(uint32_t));
+    if (!index->cell_start || !index->samples || !fill) {
+        free(fill);
+        return false;
+    }
+
+    // Counting sort by cell; samples without a finite position are left out
+    for (size_t i = 0; i < samples->count; i++) {
+        const float* ndc = index->positions + i * 2;
+        if (!cpl_is_finitef(ndc[0]) || !cpl_is_finitef(ndc[1])) continue;
+        size_t cx = cpl_pick_cell(ndc[0], index->origin[0], index->cells_per_unit[0], cols);
+        size_t cy = cpl_pick_cell(ndc[1], index->origin[1], index->cells_per_unit[1], rows);
+        index->cell_start[cy * cols + cx + 1]++;
+    }
+    for (size_t cell = 0; cell < cols * rows; cell++) {
+        index->cell_start[cell + 1] += index->cell_start[cell];
+        fill[cell] = index->cell_start[cell];
+    }
+    for (size_t i = 0; i < samples->count; i++) {
+        const float* ndc = index->positions + i * 2;
+        if (!cpl_is_finitef(ndc[0]) || !cpl_is_finitef(ndc[1])) continue;
+        size_t cx = cpl_pick_cell(ndc[0], index->origin[0], index->cells_per_unit[0], cols);
+        size_t cy = cpl_pick_cell(ndc[1], index->origin[1], index->cells_per_unit[1], rows);
+        index->samples[fill[cy * cols + cx]++] = (uint32_t)i;
+    }
+
+    free(fill);
+    memcpy(&index->view, view, sizeof(CPLViewTransform));
+    return true;
+}
+
+static void cpl_free_pick_grid(CPLPickIndex* index) {
+    free(index->positions);
+    free(index->cell_start);
+    free(index->samples);
+    index->positions = NULL;
+    index->cell_start = NULL;
+    index->samples = NULL;
+}
+
+static void cpl_pick_line(CPLPickQuery* query, CPLLine* line, size_t item) {
+    if (!line->vertices || line->num_vertices == 0) return;
+
+    CPLPickSamples samples = { line->vertices, 5, line->low, line->num_vertices, line->origin, line->bounds,
+                               false, item };
+    if (!cpl_pick_in_reach(query, &samples)) return;
+
+    // Built on the first query that reaches the line
+    if (!line->pick) {
+        line->pick = (CPLPickIndex*)calloc(1, sizeof(CPLPickIndex));
+        if (!line->pick) {
+            cpl_pick_linear(query, &samples);
+            return;
+        }
+    }
+    CPLPickIndex* index = line->pick;
+
+    if (line->monotonic_x && !query->view.polar) {
+        if (!index->bounds[0] && !cpl_build_pick_blocks(index, line)) {
+            for (int level = 0; level < CPL_PICK_LEVELS; level++) {
+                free(index->bounds[level]);
+                index->bounds[level] = NULL;
+            }
+            cpl_pick_linear(query, &samples);
+            return;
+        }
+        cpl_pick_sorted(query, line, &samples);
+        return;
+    }
+    cpl_pick_indexed(query, index, &samples);
+}
+
+static void cpl_pick_scatter(CPLPickQuery* query, CPLScatter* scatter, size_t item) {
+    if (!scatter->offsets || scatter->num_points == 0) return;
+
+    CPLPickSamples samples = { scatter->offsets, 2, scatter->low, scatter->num_points, scatter->origin,
+                               scatter->bounds, true, item };
+    if (!cpl_pick_in_reach(query, &samples)) return;
+
+    // Built on the first query that reaches the scatter
+    if (!scatter->pick) {
+        scatter->pick = (CPLPickIndex*)calloc(1, sizeof(CPLPickIndex));
+        if (!scatter->pick) {
+            cpl_pick_linear(query, &samples);
+            return;
+        }
+    }
+    cpl_pick_indexed(query, scatter->pick, &samples);
+}
+
+// Items entirely out of reach never need their index (polar views cannot tell)
+static bool cpl_pick_in_reach(const CPLPickQuery* query, const CPLPickSamples* samples) {
+    float reach_x = sqrtf(query->best) / query->scale[0];
+    float reach_y = sqrtf(query->best) / query->scale[1];
+    float reach[4] = { query->x - reach_x, query->y - reach_y, query->x + reach_x, query->y + reach_y };
+    float window[4];
+    return cpl_view_window(&query->view, samples->origin, samples->bounds, reach, window);
+}
+
+static void cpl_pick_indexed(CPLPickQuery* query, CPLPickIndex* index, const CPLPickSamples* samples) {
+    // Grids hold projected positions: stale once the view changes
+    if (index->positions && memcmp(&index->view, &query->view, sizeof(CPLViewTransform)) != 0) {
+        cpl_free_pick_grid(index);
+    }
+    if (!index->positions && !cpl_build_pick_grid(index, samples, &query->view)) {
+        cpl_free_pick_grid(index);
+        cpl_pick_linear(query, samples);
+        return;
+    }
+    cpl_pick_grid(query, index, samples);
+}
+
+static void cpl_pick_sorted(CPLPickQuery* query, const CPLLine* line, const CPLPickSamples* samples) {
+    // The query's x as an offset (every scale is monotonic)
+    float window[4];
+    float point[4] = { query->x, query->y, query->x, query->y };
+    cpl_view_window(&query->view, line->origin, line->bounds, point, window);
+
+    size_t first, count;
+    cpl_line_visible_range(line, window[0], window[0], &first, &count);
+
+    // Walk outwards from the query x until the x offset alone is out of reach,
+    // and skip the rest of any block whose y bounds are out of reach. Both tests
+    // run on offsets against the reach window, refreshed whenever the best
+    // distance shrinks; only samples that pass are projected.
+    float window_best = -1.0f;
+    float ndc[2];
+    for (size_t i = first; i < line->num_vertices;) {
+        if (query->best != window_best) window_best = cpl_pick_reach(query, samples, window);
+        if (line->vertices[i * 5] > window[2]) break;
+        size_t span = cpl_pick_skip_span(line->pick, window, i);
+        if (span) {
+            i = (i / span + 1) * span;
+            continue;
+        }
+        cpl_pick_map(query, samples, i, ndc);
+        cpl_pick_sample(query, samples, i, ndc);
+        i++;
+    }
+    for (size_t i = first; i-- > 0;) {
+        if (query->best != window_best) window_best = cpl_pick_reach(query, samples, window);
+        if (line->vertices[i * 5] < window[0]) break;
+        size_t span = cpl_pick_skip_span(line->pick, window, i);
+        if (span) {
+            i = i / span * span;
+            continue;
+        }
+        cpl_pick_map(query, samples, i, ndc);
+        cpl_pick_sample(query, samples, i, ndc);
+    }
+}
+
+// Offset-space window of the current search radius, slightly widened so float
+// rounding in the inverse mapping never skips a sample in reach
+static float cpl_pick_reach(const CPLPickQuery* query, const CPLPickSamples* samples, float* window) {
+    float reach = sqrtf(query->best) * 1.001f + 1e-3f;
+    float reach_x = reach / query->scale[0];
+    float reach_y = reach / query->scale[1];
+    float rect[4] = { query->x - reach_x, query->y - reach_y, query->x + reach_x, query->y + reach_y };
+    cpl_view_window(&query->view, samples->origin, samples->bounds, rect, window);
+    return query->best;
+}
+
+static void cpl_pick_grid(CPLPickQuery* query, const CPLPickIndex* index, const CPLPickSamples* samples) {
+    float reach_x = sqrtf(query->best) / query->scale[0];
+    float reach_y = sqrtf(query->best) / query->scale[1];
+
+    // Cells within the initial radius
+    ptrdiff_t x0 = (ptrdiff_t)cpl_pick_cell(query->x - reach_x, index->origin[0], index->cells_per_unit[0], index->cols);
+    ptrdiff_t x1 = (ptrdiff_t)cpl_pick_cell(query->x + reach_x, index->origin[0], index->cells_per_unit[0], index->cols);
+    ptrdiff_t y0 = (ptrdiff_t)cpl_pick_cell(query->y - reach_y, index->origin[1], index->cells_per_unit[1], index->rows);
+    ptrdiff_t y1 = (ptrdiff_t)cpl_pick_cell(query->y + reach_y, index->origin[1], index->cells_per_unit[1], index->rows);
+    ptrdiff_t cx = (ptrdiff_t)cpl_pick_cell(query->x, index->origin[0], index->cells_per_unit[0], index->cols);
+    ptrdiff_t cy = (ptrdiff_t)cpl_pick_cell(query->y, index->origin[1], index->cells_per_unit[1], index->rows);
+
+    // Rings of cells around the query's cell: cells of ring r are at least r - 1
+    // cells away, so dense data stops after a ring or two
+    float cell_x = query->scale[0] / index->cells_per_unit[0];
+    float cell_y = query->scale[1] / index->cells_per_unit[1];
+    float cell_pixels = cell_x < cell_y ? cell_x : cell_y;
+
+    for (ptrdiff_t ring = 0; ; ring++) {
+        float gap = (float)(ring - 1) * cell_pixels;
+        if (ring > 0 && gap * gap >= query->best) break;
+        if (cx - ring < x0 && cx + ring > x1 && cy - ring < y0 && cy + ring > y1) break;
+
+        for (ptrdiff_t y = cy - ring; y <= cy + ring; y++) {
+            if (y < y0 || y > y1) continue;
+            bool edge_row = y == cy - ring || y == cy + ring;
+            ptrdiff_t step = edge_row || ring == 0 ? 1 : 2 * ring;
+            for (ptrdiff_t x = cx - ring; x <= cx + ring; x += step) {
+                if (x < x0 || x > x1) continue;
+                size_t cell = (size_t)y * index->cols + (size_t)x;
+                for (uint32_t k = index->cell_start[cell]; k < index->cell_start[cell + 1]; k++) {
+                    cpl_pick_sample(query, samples, index->samples[k], index->positions + (size_t)index->samples[k] * 2);
+                }
+            }
+        }
+    }
+}
+
+static void cpl_pick_linear(CPLPickQuery* query, const CPLPickSamples* samples) {
+    float ndc[2];
+    for (size_t i = 0; i < samples->count; i++) {
+        cpl_pick_map(query, samples, i, ndc);
+        cpl_pick_sample(query, samples, i, ndc);
+    }
+}
+
+static void cpl_pick_sample(CPLPickQuery* query, const CPLPickSamples* samples, size_t index, const float* ndc) {
+    // Samples clipped away by the plot box cannot be hovered (NaN fails too)
+    if (!(ndc[0] >= query->box[0] && ndc[0] <= query->box[1] &&
+          ndc[1] >= query->box[0] && ndc[1] <= query->box[1])) {
+        return;
+    }
+
+    float dx = (ndc[0] - query->x) * query->scale[0];
+    float dy = (ndc[1] - query->y) * query->scale[1];
+    float distance = dx * dx + dy * dy;
+    if (distance < query->best) {
+        query->best = distance;
+        query->found = true;
+        query->scatter = samples->scatter;
+        query->item = samples->item;
+        query->index = index;
+    }
+}
+
+static void cpl_pick_map(const CPLPickQuery* query, const CPLPickSamples* samples, size_t index, float* ndc) {
+    cpl_view_map(&query->view, samples->origin, samples->offsets + index * samples->stride,
+                 samples->low ? samples->low + index * 2 : NULL, ndc);
+}
+
+// Size of the largest aligned run of samples around `sample` whose y bounds miss
+// the window's y (0 when the sample itself has to be tested)
+static size_t cpl_pick_skip_span(const CPLPickIndex* index, const float* window, size_t sample) {
+    size_t span = 1;
+    for (int level = 0; level < CPL_PICK_LEVELS; level++) {
+        span *= CPL_PICK_BLOCK;
+    }
+
+    for (int level = CPL_PICK_LEVELS - 1; level >= 0; level--) {
+        const float* bounds = index->bounds[level] + (sample / span) * 2;
+        if (bounds[0] > window[3] || bounds[1] < window[1]) return span;
+        span /= CPL_PICK_BLOCK;
+    }
+    return 0;
+}
+
+static size_t cpl_pick_cell(float value, float origin, float cells_per_unit, size_t cells) {
+    float cell = (value - origin) * cells_per_unit;
+    if (!(cell > 0.0f)) return 0;
+    if (cell >= (float)cells) return cells - 1;
+    return (size_t)cell;
+}
+
+static void cpl_pick_error(const char* message) {
+    fprintf(stderr, "CPlotLib Error: %s\n", message);
+}
@@ -1,8 +1,8 @@
 #include "CPLPlot.h"
+#include "utils/CPLGeometry.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <GL/glew.h>
 
 // Internal function declarations
 static void cpl_plot_error(const char* message);
@@ -29,6 +29,57 @@ void cpl_set_y_range(CPLPlot* plot, double min, double max) {
     plot->y_range[1] = max;
 }
 
+void cpl_set_x_scale(CPLPlot* plot, CPLAxisScale scale) {
+    if (!plot || scale < CPL_SCALE_LINEAR || scale > CPL_SCALE_SYMLOG) {
+        cpl_plot_error("Invalid plot or axis scale");
+        return;
+    }
+    plot->x_scale = scale;
+}
+
+void cpl_set_y_scale(CPLPlot* plot, CPLAxisScale scale) {
+    if (!plot || scale < CPL_SCALE_LINEAR || scale > CPL_SCALE_SYMLOG) {
+        cpl_plot_error("Invalid plot or axis scale");
+        return;
+    }
+    plot->y_scale = scale;
+}
+
+void cpl_set_symlog_threshold(CPLPlot* plot, double x_threshold, double y_threshold) {
+    if (!plot || !(x_threshold > 0.0) || !(y_threshold > 0.0)) {
+        cpl_plot_error("Invalid plot or symlog threshold");
+        return;
+    }
+    plot->symlog_threshold[0] = x_threshold;
+    plot->symlog_threshold[1] = y_threshold;
+}
+
+void cpl_set_polar(CPLPlot* plot, bool polar) {
+    if (!plot) return;
+    plot->polar = polar;
+}
+
+void cpl_set_high_precision(CPLPlot* plot, bool enable) {
+    if (!plot) return;
+    plot->high_precision = enable;
+}
+
+void cpl_set_density(CPLPlot* plot, CPLDensityNorm norm) {
+    if (!plot || norm < CPL_DENSITY_OFF || norm > CPL_DENSITY_EQ_HIST) {
+        cpl_plot_error("Invalid plot or density normalization");
+        return;
+    }
+    plot->density = norm;
+}
+
+void cpl_set_colormap(CPLPlot* plot, CPLColormap colormap) {
+    if (!plot || colormap < CPL_COLORMAP_VIRIDIS || colormap >= CPL_COLORMAP_COUNT) {
+        cpl_plot_error("Invalid plot or colormap");
+        return;
+    }
+    plot->colormap = colormap;
+}
+
 void cpl_set_title(CPLPlot* plot, const char* title) {
     if (!plot || !title) return;
     strncpy(plot->title, title, CPL_MAX_STRING_LENGTH);
@@ -56,18 +107,10 @@ void cpl_show_axes(CPLPlot* plot, bool show) {
     if (!plot) return;
     plot->show_axes = show;
     
-    // If grid is already loaded, regenerate it to update axis colors
-    if (plot->data && plot->data->grid_loaded) {
-        // Free existing grid OpenGL objects
-        if (plot->data->grid_vbo) {
-            glDeleteBuffers(1, &plot->data->grid_vbo);
-            plot->data->grid_vbo = 0;
-        }
-        if (plot->data->grid_vao) {
-            glDeleteVertexArrays(1, &plot->data->grid_vao);
-            plot->data->grid_vao = 0;
-        }
-        plot->data->grid_loaded = false;
+    // If grid is already loaded, switch to the shared grid with the new axis colors
+    if (plot->data && plot->data->grid) {
+        cpl_release_geometry(plot->figure->geometry_cache, plot->data->grid);
+        plot->data->grid = NULL;
         
         // Regenerate grid with new axis settings
         if (plot->show_grid) {
@@ -1,5 +1,15 @@
 #include "CPLPlot.h"
 #include "utils/CPLShader.h"
+#include "utils/CPLGeometry.h"
+#include "utils/CPLRenderer.h"
+#include "utils/CPLTransform.h"
+#include "utils/CPLDensity.h"
+#include "utils/CPLMatrix.h"
+#include "utils/CPLHistogram.h"
+#include "utils/CPLContour.h"
+#include "utils/CPLQuiver.h"
+#include "utils/CPLCandles.h"
+#include "utils/CPLUtils.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -7,19 +17,35 @@
 #include <math.h>
 #include <GL/glew.h>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 // Internal function declarations
 static void cpl_setup_plot_box(CPLPlot* plot);
 void cpl_setup_grid(CPLPlot* plot);
 static void cpl_build_line_data(CPLPlot* plot, const double* x, const double* y, 
                                size_t n_points, Color color, 
                                CPLColorCallback color_fn, void* user_data);
-static float cpl_normalize_coordinate(double value, double min, double max, 
-                                     float plot_start, float plot_size);
+static void cpl_build_scatter_data(CPLPlot* plot, const double* x, const double* y, size_t n_points, Color color,
+                                   float size, const unsigned char* colors, const unsigned char* sizes);
+static void cpl_upload_scatter(CPLScatter* scatter);
+static void cpl_upload_trace_positions(CPLTraces* traces);
+static void cpl_upload_traces(CPLTraces* traces);
+static void cpl_drop_faded_traces(CPLTraces* traces);
+static void cpl_reset_trace_images(CPLTraces* traces);
+static double cpl_line_origin(const double* values, size_t count);
+static bool cpl_is_monotonic(const double* values, size_t count);
 static void cpl_plot_error(const char* message);
 
+// Internal functions used by other modules
+void cpl_free_traces(CPLTraces* traces);
+void cpl_free_waterfall(CPLWaterfall* waterfall);
+
 // Constants
 #define CPL_DEFAULT_MARGIN 0.1f
 #define CPL_INITIAL_CAPACITY 4
+#define CPL_TRACE_MIN_WEIGHT (1.0 / 4096.0)  // Faded traces below this weight are dropped
 
 // Data plotting
 void cpl_plot(CPLPlot* plot, const double* x, const double* y, size_t n_points, 
@@ -29,11 +55,14 @@ void cpl_plot(CPLPlot* plot, const double* x, const double* y, size_t n_points,
         return;
     }
     
+    // GL objects are created in the figure's own context
+    cpl_make_renderer_current(plot->figure->renderer);
+    
     // Setup plot box and grid if not already done
-    if (!plot->data->box_loaded) {
+    if (!plot->data->box) {
         cpl_setup_plot_box(plot);
     }
-    if (plot->show_grid && !plot->data->grid_loaded) {
+    if (plot->show_grid && !plot->data->grid) {
         cpl_setup_grid(plot);
     }
     
@@ -55,176 +84,564 @@ void cpl_plot_parametric(CPLPlot* plot, const double* t, const double* x,
     cpl_plot(plot, x, y, n_points, color, color_fn, user_data);
 }
 
-// Internal helper functions
-static void cpl_setup_plot_box(CPLPlot* plot) {
-    if (!plot || !plot->data) return;
+void cpl_scatter(CPLPlot* plot, const double* x, const double* y, size_t n_points, Color color, float size,
+                 const unsigned char* colors, const unsigned char* sizes) {
+    if (!plot || !plot->data || !x || !y || n_points == 0) {
+        cpl_plot_error("Invalid scatter data");
+        return;
+    }
+    if (!(size > 0.0f)) {
+        cpl_plot_error("Scatter point size must be positive");
+        return;
+    }
     
-    // Generate box vertices (plot border)
-    float vertices[20]; // 4 vertices * (2 coords + 3 color)
-    float margin = plot->data->margin;
-    
-    // Bottom-left
-    vertices[0] = -1.0f + margin;  // x
-    vertices[1] = -1.0f + margin;  // y
-    vertices[2] = 0.0f;            // r
-    vertices[3] = 0.0f;            // g
-    vertices[4] = 0.0f;            // b
-    
-    // Bottom-right
-    vertices[5] = 1.0f - margin;   // x
-    vertices[6] = -1.0f + margin;  // y
-    vertices[7] = 0.0f;            // r
-    vertices[8] = 0.0f;            // g
-    vertices[9] = 0.0f;            // b
-    
-    // Top-right
-    vertices[10] = 1.0f - margin;  // x
-    vertices[11] = 1.0f - margin;  // y
-    vertices[12] = 0.0f;           // r
-    vertices[13] = 0.0f;           // g
-    vertices[14] = 0.0f;           // b
-    
-    // Top-left
-    vertices[15] = -1.0f + margin; // x
-    vertices[16] = 1.0f - margin;  // y
-    vertices[17] = 0.0f;           // r
-    vertices[18] = 0.0f;           // g
-    vertices[19] = 0.0f;           // b
+    cpl_make_renderer_current(plot->figure->renderer);
     
-    // Create OpenGL objects
-    glGenVertexArrays(1, &plot->data->box_vao);
-    glGenBuffers(1, &plot->data->box_vbo);
+    if (!plot->data->box) {
+        cpl_setup_plot_box(plot);
+    }
+    if (plot->show_grid && !plot->data->grid) {
+        cpl_setup_grid(plot);
+    }
     
-    glBindVertexArray(plot->data->box_vao);
-    glBindBuffer(GL_ARRAY_BUFFER, plot->data->box_vbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+    cpl_build_scatter_data(plot, x, y, n_points, color, size, colors, sizes);
+}
+
+void cpl_set_persistence(CPLPlot* plot, const double* x, size_t samples, float decay, CPLDensityNorm norm) {
+    if (!plot || !plot->data || !x || samples < 2) {
+        cpl_plot_error("Invalid persistence traces");
+        return;
+    }
+    if (!(decay >= 0.0f && decay <= 1.0f)) {
+        cpl_plot_error("Persistence decay must be between 0 and 1");
+        return;
+    }
+    if (norm != CPL_DENSITY_LINEAR && norm != CPL_DENSITY_LOG && norm != CPL_DENSITY_EQ_HIST) {
+        cpl_plot_error("Invalid persistence normalization");
+        return;
+    }
     
-    // Position attribute
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
+    cpl_make_renderer_current(plot->figure->renderer);
     
-    // Color attribute
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(2 * sizeof(float)));
+    if (!plot->data->box) {
+        cpl_setup_plot_box(plot);
+    }
+    if (plot->show_grid && !plot->data->grid) {
+        cpl_setup_grid(plot);
+    }
     
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+    CPLTraces* traces = plot->data->traces;
+    if (traces && traces->samples != samples) {
+        cpl_free_traces(traces);
+        traces = plot->data->traces = NULL;
+    }
+    if (!traces) {
+        traces = (CPLTraces*)calloc(1, sizeof(CPLTraces));
+        if (traces) traces->x = (float*)malloc(samples * sizeof(float));
+        if (!traces || !traces->x) {
+            cpl_plot_error("Failed to allocate persistence traces");
+            free(traces);
+            return;
+        }
+        traces->samples = samples;
+        plot->data->traces = traces;
+    }
     
-    plot->data->box_loaded = true;
+    // The shared positions use the line offset scheme; y offsets are relative
+    // to an origin picked from the first traces
+    traces->origin[0] = cpl_line_origin(x, samples);
+    for (size_t i = 0; i < samples; i++) {
+        traces->x[i] = (float)(x[i] - traces->origin[0]);
+    }
+    traces->monotonic_x = cpl_is_monotonic(x, samples);
+    traces->decay = decay;
+    traces->norm = norm;
+    
+    // Accumulated images depend on the positions and the decay
+    cpl_reset_trace_images(traces);
+    if (cpl_renderer_has_gl(plot->figure->renderer)) {
+        cpl_upload_trace_positions(traces);
+    }
 }
 
-void cpl_setup_grid(CPLPlot* plot) {
-    if (!plot || !plot->data) return;
+void cpl_add_traces(CPLPlot* plot, const double* y, size_t n_traces) {
+    CPLTraces* traces = plot && plot->data ? plot->data->traces : NULL;
+    if (!traces) {
+        cpl_plot_error("Traces need cpl_set_persistence first");
+        return;
+    }
+    if (n_traces > 0 && !y) {
+        cpl_plot_error("Invalid trace data");
+        return;
+    }
+    
+    // Every call is a frame: earlier traces fade by one more step
+    traces->frame++;
+    cpl_drop_faded_traces(traces);
+    
+    if (traces->num_traces + n_traces > traces->capacity) {
+        size_t new_capacity = traces->capacity == 0 ? CPL_INITIAL_CAPACITY : traces->capacity * 2;
+        if (new_capacity < traces->num_traces + n_traces) new_capacity = traces->num_traces + n_traces;
+        float* new_y = (float*)realloc(traces->y, new_capacity * traces->samples * sizeof(float));
+        if (new_y) traces->y = new_y;
+        unsigned int* new_frames = (unsigned int*)realloc(traces->frames, new_capacity * sizeof(unsigned int));
+        if (new_frames) traces->frames = new_frames;
+        if (!new_y || !new_frames) {
+            cpl_plot_error("Failed to allocate memory for traces");
+            return;
+        }
+        traces->capacity = new_capacity;
+    }
+    
+    size_t values = n_traces * traces->samples;
+    if (traces->num_traces == 0) {
+        traces->origin[1] = cpl_line_origin(y, values);
+    }
+    float* out = traces->y + traces->num_traces * traces->samples;
+    for (size_t i = 0; i < values; i++) {
+        out[i] = (float)(y[i] - traces->origin[1]);
+    }
+    for (size_t t = 0; t < n_traces; t++) {
+        traces->frames[traces->num_traces + t] = traces->frame;
+    }
+    traces->num_traces += n_traces;
     
-    // Generate grid lines
-    const int grid_lines = 10;
-    const int total_vertices = (grid_lines * 2 + 2) * 2; // horizontal + vertical lines
-    float* vertices = (float*)malloc(total_vertices * 5 * sizeof(float)); // 5 floats per vertex
+    if (cpl_renderer_has_gl(plot->figure->renderer)) {
+        cpl_make_renderer_current(plot->figure->renderer);
+        cpl_upload_traces(traces);
+    }
+}
+
+void cpl_clear_traces(CPLPlot* plot) {
+    CPLTraces* traces = plot && plot->data ? plot->data->traces : NULL;
+    if (!traces) return;
     
-    if (!vertices) {
-        cpl_plot_error("Failed to allocate memory for grid");
+    cpl_make_renderer_current(plot->figure->renderer);
+    traces->num_traces = 0;
+    traces->uploaded = 0;
+    cpl_reset_trace_images(traces);
+}
+
+void cpl_free_traces(CPLTraces* traces) {
+    if (!traces) return;
+    
+    cpl_reset_trace_images(traces);
+    if (traces->vao) glDeleteVertexArrays(1, &traces->vao);
+    if (traces->vbo) glDeleteBuffers(1, &traces->vbo);
+    if (traces->x_texture) glDeleteTextures(1, &traces->x_texture);
+    if (traces->x_buffer) glDeleteBuffers(1, &traces->x_buffer);
+    if (traces->frames_texture) glDeleteTextures(1, &traces->frames_texture);
+    if (traces->frames_buffer) glDeleteBuffers(1, &traces->frames_buffer);
+    free(traces->x);
+    free(traces->y);
+    free(traces->frames);
+    free(traces);
+}
+
+void cpl_set_waterfall(CPLPlot* plot, size_t bins, size_t rows, double x_min, double x_max, double y_min,
+                       double y_max) {
+    if (!plot || !plot->data || bins == 0 || rows == 0) {
+        cpl_plot_error("Invalid waterfall");
+        return;
+    }
+    if (!(x_max > x_min) || !(y_max > y_min) || !cpl_is_finite(x_max - x_min) || !cpl_is_finite(y_max - y_min)) {
+        cpl_plot_error("Waterfall extent must be finite and non-empty");
         return;
     }
     
-    int vertex_index = 0;
-    float margin = plot->data->margin;
+    cpl_make_renderer_current(plot->figure->renderer);
     
-    // Note: Center lines (axes) are determined by checking if i == grid_lines / 2
+    // The ring is one texture: both sizes must fit the driver's limit
+    if (cpl_renderer_has_gl(plot->figure->renderer)) {
+        GLint max_size = 0;
+        glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_size);
+        if (bins > (size_t)max_size || rows > (size_t)max_size) {
+            cpl_plot_error("Waterfall is larger than the maximum texture size");
+            return;
+        }
+    }
     
-    // Horizontal grid lines
-    for (int i = 0; i <= grid_lines; i++) {
-        float y = -1.0f + margin + (2.0f - 2.0f * margin) * i / grid_lines;
-        
-        // Determine if this is the center line (axis)
-        bool is_axis = (i == grid_lines / 2);
-        
-        // Choose color: darker for axes, lighter for grid
-        float r, g, b;
-        if (is_axis && plot->show_axes) {
-            r = 0.2f;  // Dark gray for axes
-            g = 0.2f;
-            b = 0.2f;
-        } else {
-            r = 0.7f;  // Light gray for grid
-            g = 0.7f;
-            b = 0.7f;
+    if (!plot->data->box) {
+        cpl_setup_plot_box(plot);
+    }
+    if (plot->show_grid && !plot->data->grid) {
+        cpl_setup_grid(plot);
+    }
+    
+    CPLWaterfall* waterfall = plot->data->waterfall;
+    if (waterfall && (waterfall->bins != bins || waterfall->rows != rows)) {
+        cpl_free_waterfall(waterfall);
+        waterfall = plot->data->waterfall = NULL;
+    }
+    if (!waterfall) {
+        waterfall = (CPLWaterfall*)calloc(1, sizeof(CPLWaterfall));
+        if (waterfall) waterfall->values = (float*)malloc(bins * rows * sizeof(float));
+        if (!waterfall || !waterfall->values) {
+            cpl_plot_error("Failed to allocate waterfall");
+            free(waterfall);
+            return;
         }
-        
-        // Start vertex
-        vertices[vertex_index * 5 + 0] = -1.0f + margin;  // x
-        vertices[vertex_index * 5 + 1] = y;               // y
-        vertices[vertex_index * 5 + 2] = r;               // r
-        vertices[vertex_index * 5 + 3] = g;               // g
-        vertices[vertex_index * 5 + 4] = b;               // b
-        vertex_index++;
-        
-        // End vertex
-        vertices[vertex_index * 5 + 0] = 1.0f - margin;   // x
-        vertices[vertex_index * 5 + 1] = y;               // y
-        vertices[vertex_index * 5 + 2] = r;               // r
-        vertices[vertex_index * 5 + 3] = g;               // g
-        vertices[vertex_index * 5 + 4] = b;               // b
-        vertex_index++;
-    }
-    
-    // Vertical grid lines
-    for (int i = 0; i <= grid_lines; i++) {
-        float x = -1.0f + margin + (2.0f - 2.0f * margin) * i / grid_lines;
-        
-        // Determine if this is the center line (axis)
-        bool is_axis = (i == grid_lines / 2);
-        
-        // Choose color: darker for axes, lighter for grid
-        float r, g, b;
-        if (is_axis && plot->show_axes) {
-            r = 0.2f;  // Dark gray for axes
-            g = 0.2f;
-            b = 0.2f;
-        } else {
-            r = 0.7f;  // Light gray for grid
-            g = 0.7f;
-            b = 0.7f;
+        waterfall->bins = bins;
+        waterfall->rows = rows;
+        waterfall->levels[0] = 0.0f;
+        waterfall->levels[1] = 1.0f;
+        plot->data->waterfall = waterfall;
+    }
+    
+    waterfall->x_range[0] = x_min;
+    waterfall->x_range[1] = x_max;
+    waterfall->y_range[0] = y_min;
+    waterfall->y_range[1] = y_max;
+    waterfall->newest = rows - 1;
+    waterfall->filled = 0;
+    waterfall->pending = 0;
+}
+
+void cpl_set_waterfall_levels(CPLPlot* plot, float min, float max, bool decibels) {
+    CPLWaterfall* waterfall = plot && plot->data ? plot->data->waterfall : NULL;
+    if (!waterfall) {
+        cpl_plot_error("Waterfall levels need cpl_set_waterfall first");
+        return;
+    }
+    if (!(max > min) || !cpl_is_finite(max - min)) {
+        cpl_plot_error("Invalid waterfall levels");
+        return;
+    }
+    
+    waterfall->levels[0] = min;
+    waterfall->levels[1] = max;
+    waterfall->decibels = decibels;
+}
+
+void cpl_add_waterfall_rows(CPLPlot* plot, const float* values, size_t n_rows) {
+    CPLWaterfall* waterfall = plot && plot->data ? plot->data->waterfall : NULL;
+    if (!waterfall) {
+        cpl_plot_error("Waterfall rows need cpl_set_waterfall first");
+        return;
+    }
+    if (n_rows == 0) return;
+    if (!values) {
+        cpl_plot_error("Invalid waterfall rows");
+        return;
+    }
+    
+    // Rows scrolled out of the image before ever being drawn are skipped
+    if (n_rows > waterfall->rows) {
+        values += (n_rows - waterfall->rows) * waterfall->bins;
+        n_rows = waterfall->rows;
+    }
+    
+    // Copied into the ring; the texture takes the pending rows at the next draw
+    for (size_t i = 0; i < n_rows; i++) {
+        waterfall->newest = (waterfall->newest + 1) % waterfall->rows;
+        memcpy(waterfall->values + waterfall->newest * waterfall->bins, values + i * waterfall->bins,
+               waterfall->bins * sizeof(float));
+    }
+    waterfall->filled = waterfall->filled + n_rows < waterfall->rows ? waterfall->filled + n_rows : waterfall->rows;
+    waterfall->pending = waterfall->pending + n_rows < waterfall->rows ? waterfall->pending + n_rows : waterfall->rows;
+}
+
+void cpl_free_waterfall(CPLWaterfall* waterfall) {
+    if (!waterfall) return;
+    
+    if (waterfall->texture) glDeleteTextures(1, &waterfall->texture);
+    if (waterfall->vao) glDeleteVertexArrays(1, &waterfall->vao);
+    free(waterfall->values);
+    free(waterfall);
+}
+
+void cpl_imshow(CPLPlot* plot, const void* data, CPLMatrixFormat format, size_t width, size_t height,
+                const double* extent, CPLMatrixReduce reduce) {
+    if (!plot || !plot->data || !data || width == 0 || height == 0) {
+        cpl_plot_error("Invalid matrix");
+        return;
+    }
+    if (format != CPL_MATRIX_FLOAT32 && format != CPL_MATRIX_UINT16 && format != CPL_MATRIX_UINT8) {
+        cpl_plot_error("Invalid matrix format");
+        return;
+    }
+    if (reduce != CPL_MATRIX_MEAN && reduce != CPL_MATRIX_MIN && reduce != CPL_MATRIX_MAX) {
+        cpl_plot_error("Invalid matrix reduction");
+        return;
+    }
+    double edges[4] = { 0.0, (double)width, 0.0, (double)height };
+    if (extent) memcpy(edges, extent, sizeof(edges));
+    if (!(edges[1] > edges[0]) || !(edges[3] > edges[2]) || !cpl_is_finite(edges[1] - edges[0]) ||
+        !cpl_is_finite(edges[3] - edges[2])) {
+        cpl_plot_error("Matrix extent must be finite and non-empty");
+        return;
+    }
+    
+    cpl_make_renderer_current(plot->figure->renderer);
+    
+    if (!plot->data->box) {
+        cpl_setup_plot_box(plot);
+    }
+    if (plot->show_grid && !plot->data->grid) {
+        cpl_setup_grid(plot);
+    }
+    
+    cpl_free_matrix(plot->data->matrix);
+    plot->data->matrix = NULL;
+    
+    CPLMatrix* matrix = (CPLMatrix*)calloc(1, sizeof(CPLMatrix));
+    if (!matrix) {
+        cpl_plot_error("Failed to allocate matrix");
+        return;
+    }
+    matrix->format = format;
+    matrix->reduce = reduce;
+    matrix->width = width;
+    matrix->height = height;
+    memcpy(matrix->extent, edges, sizeof(edges));
+    
+    // Tile positions use the line offset scheme
+    matrix->origin[0] = cpl_line_origin(edges, 2);
+    matrix->origin[1] = cpl_line_origin(edges + 2, 2);
+    
+    if (!cpl_matrix_build(matrix, data)) {
+        cpl_free_matrix(matrix);
+        return;
+    }
+    plot->data->matrix = matrix;
+}
+
+void cpl_set_matrix_levels(CPLPlot* plot, float min, float max) {
+    CPLMatrix* matrix = plot && plot->data ? plot->data->matrix : NULL;
+    if (!matrix) {
+        cpl_plot_error("Matrix levels need cpl_imshow first");
+        return;
+    }
+    if (!(max > min) || !cpl_is_finite(max - min)) {
+        cpl_plot_error("Invalid matrix levels");
+        return;
+    }
+    
+    matrix->levels[0] = min;
+    matrix->levels[1] = max;
+}
+
+void cpl_hist(CPLPlot* plot, const double* data, size_t n, size_t bins, const double* range, Color color) {
+    if (!plot || !plot->data || (n > 0 && !data) || bins == 0) {
+        cpl_plot_error("Invalid histogram");
+        return;
+    }
+    
+    double edges[2];
+    if (range) {
+        edges[0] = range[0];
+        edges[1] = range[1];
+    } else if (!cpl_histogram_range(data, n, edges)) {
+        cpl_plot_error("Histogram data has no finite values");
+        return;
+    } else if (edges[1] == edges[0]) {
+        // A single value gets a unit-wide range around it
+        edges[0] -= 0.5;
+        edges[1] += 0.5;
+    }
+    if (!(edges[1] > edges[0]) || !cpl_is_finite(edges[1] - edges[0])) {
+        cpl_plot_error("Histogram range must be finite and non-empty");
+        return;
+    }
+    
+    cpl_make_renderer_current(plot->figure->renderer);
+    
+    if (!plot->data->box) {
+        cpl_setup_plot_box(plot);
+    }
+    if (plot->show_grid && !plot->data->grid) {
+        cpl_setup_grid(plot);
+    }
+    
+    CPLHistogram* histogram = plot->data->histogram;
+    if (histogram && histogram->bins != bins) {
+        cpl_free_histogram(histogram);
+        histogram = plot->data->histogram = NULL;
+    }
+    if (!histogram) {
+        histogram = (CPLHistogram*)calloc(1, sizeof(CPLHistogram));
+        if (histogram) histogram->counts = (uint64_t*)malloc(bins * sizeof(uint64_t));
+        if (!histogram || !histogram->counts) {
+            cpl_plot_error("Failed to allocate histogram");
+            free(histogram);
+            return;
         }
-        
-        // Start vertex
-        vertices[vertex_index * 5 + 0] = x;               // x
-        vertices[vertex_index * 5 + 1] = -1.0f + margin;  // y
-        vertices[vertex_index * 5 + 2] = r;               // r
-        vertices[vertex_index * 5 + 3] = g;               // g
-        vertices[vertex_index * 5 + 4] = b;               // b
-        vertex_index++;
-        
-        // End vertex
-        vertices[vertex_index * 5 + 0] = x;               // x
-        vertices[vertex_index * 5 + 1] = 1.0f - margin;   // y
-        vertices[vertex_index * 5 + 2] = r;               // r
-        vertices[vertex_index * 5 + 3] = g;               // g
-        vertices[vertex_index * 5 + 4] = b;               // b
-        vertex_index++;
+        histogram->bins = bins;
+        plot->data->histogram = histogram;
     }
     
-    // Create OpenGL objects
-    glGenVertexArrays(1, &plot->data->grid_vao);
-    glGenBuffers(1, &plot->data->grid_vbo);
+    // Bar positions use the line offset scheme
+    histogram->range[0] = edges[0];
+    histogram->range[1] = edges[1];
+    histogram->origin = cpl_line_origin(edges, 2);
+    histogram->color = color;
+    memset(histogram->counts, 0, bins * sizeof(uint64_t));
+    histogram->dirty = true;
     
-    glBindVertexArray(plot->data->grid_vao);
-    glBindBuffer(GL_ARRAY_BUFFER, plot->data->grid_vbo);
-    glBufferData(GL_ARRAY_BUFFER, total_vertices * 5 * sizeof(float), vertices, GL_STATIC_DRAW);
+    if (n > 0) cpl_histogram_count(data, n, bins, edges, histogram->counts);
+}
+
+void cpl_hist_add(CPLPlot* plot, const double* data, size_t n) {
+    CPLHistogram* histogram = plot && plot->data ? plot->data->histogram : NULL;
+    if (!histogram) {
+        cpl_plot_error("Histogram samples need cpl_hist first");
+        return;
+    }
+    if (n == 0) return;
+    if (!data) {
+        cpl_plot_error("Invalid histogram data");
+        return;
+    }
     
-    // Position attribute
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
+    if (cpl_histogram_count(data, n, histogram->bins, histogram->range, histogram->counts)) {
+        histogram->dirty = true;
+    }
+}
+
+void cpl_contour(CPLPlot* plot, const float* field, size_t nx, size_t ny, const double* extent, const double* levels,
+                 size_t nlevels) {
+    if (!plot || !plot->data || !field || nx < 2 || ny < 2 || !levels || nlevels == 0 || nlevels >= UINT32_MAX) {
+        cpl_plot_error("Invalid contour");
+        return;
+    }
+    for (size_t l = 0; l < nlevels; l++) {
+        if (!cpl_is_finite(levels[l])) {
+            cpl_plot_error("Contour levels must be finite");
+            return;
+        }
+    }
+    double edges[4] = { 0.0, (double)nx, 0.0, (double)ny };
+    if (extent) memcpy(edges, extent, sizeof(edges));
+    if (!(edges[1] > edges[0]) || !(edges[3] > edges[2]) || !cpl_is_finite(edges[1] - edges[0]) ||
+        !cpl_is_finite(edges[3] - edges[2])) {
+        cpl_plot_error("Contour extent must be finite and non-empty");
+        return;
+    }
     
-    // Color attribute
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(2 * sizeof(float)));
+    cpl_make_renderer_current(plot->figure->renderer);
     
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+    if (!plot->data->box) {
+        cpl_setup_plot_box(plot);
+    }
+    if (plot->show_grid && !plot->data->grid) {
+        cpl_setup_grid(plot);
+    }
+    
+    // Vertices, polylines and marching buffers carry over to the new field
+    CPLContour* contour = plot->data->contour;
+    if (!contour) {
+        contour = (CPLContour*)calloc(1, sizeof(CPLContour));
+        if (!contour) {
+            cpl_plot_error("Failed to allocate contour");
+            return;
+        }
+        plot->data->contour = contour;
+    }
+    contour->nx = nx;
+    contour->ny = ny;
+    memcpy(contour->extent, edges, sizeof(edges));
+    
+    // Vertex positions use the line offset scheme
+    contour->origin[0] = cpl_line_origin(edges, 2);
+    contour->origin[1] = cpl_line_origin(edges + 2, 2);
+    
+    cpl_contour_trace(contour, field, levels, nlevels, plot->colormap);
+}
+
+void cpl_quiver(CPLPlot* plot, const double* x, const double* y, const double* u, const double* v, size_t n,
+                float scale, Color color) {
+    if (!plot || !plot->data || !x || !y || !u || !v || n == 0) {
+        cpl_plot_error("Invalid quiver");
+        return;
+    }
+    
+    cpl_make_renderer_current(plot->figure->renderer);
+    
+    if (!plot->data->box) {
+        cpl_setup_plot_box(plot);
+    }
+    if (plot->show_grid && !plot->data->grid) {
+        cpl_setup_grid(plot);
+    }
+    
+    // The GL objects carry over; the records are rebuilt and re-uploaded at the next draw
+    CPLQuiver* quiver = plot->data->quiver;
+    if (!quiver) {
+        quiver = (CPLQuiver*)calloc(1, sizeof(CPLQuiver));
+        if (!quiver) {
+            cpl_plot_error("Failed to allocate quiver");
+            return;
+        }
+        plot->data->quiver = quiver;
+    }
+    quiver->color = color;
+    cpl_quiver_build(quiver, x, y, u, v, n, scale);
+}
+
+void cpl_set_candles(CPLPlot* plot, Color up, Color down) {
+    if (!plot || !plot->data) {
+        cpl_plot_error("Invalid candlestick chart");
+        return;
+    }
     
+    cpl_make_renderer_current(plot->figure->renderer);
+    
+    if (!plot->data->box) {
+        cpl_setup_plot_box(plot);
+    }
+    if (plot->show_grid && !plot->data->grid) {
+        cpl_setup_grid(plot);
+    }
+    
+    CPLCandles* candles = plot->data->candles;
+    if (!candles) {
+        candles = (CPLCandles*)calloc(1, sizeof(CPLCandles));
+        if (!candles) {
+            cpl_plot_error("Failed to allocate candlestick chart");
+            return;
+        }
+        cpl_candles_init(candles);
+        plot->data->candles = candles;
+    }
+    candles->up = up;
+    candles->down = down;
+}
+
+void cpl_add_ticks(CPLPlot* plot, const double* time, const double* price, const double* volume, size_t n) {
+    CPLCandles* candles = plot && plot->data ? plot->data->candles : NULL;
+    if (!candles) {
+        cpl_plot_error("Ticks need cpl_set_candles first");
+        return;
+    }
+    if (n > 0 && (!time || !price)) {
+        cpl_plot_error("Invalid tick data");
+        return;
+    }
+    
+    // Only the touched buckets change; their GPU records are re-uploaded at the next draw
+    cpl_candles_add(candles, time, price, volume, n);
+}
+
+// Internal helper functions
+static void cpl_setup_plot_box(CPLPlot* plot) {
+    if (!plot || !plot->data || !plot->figure) return;
+    
+    // Plot boxes depend only on the margin, so all plots share one buffer per margin
+    plot->data->box = cpl_acquire_box_geometry(plot->figure->geometry_cache, plot->data->margin);
+    if (!plot->data->box) {
+        cpl_plot_error("Failed to set up plot box");
+    }
+}
+
+void cpl_setup_grid(CPLPlot* plot) {
+    if (!plot || !plot->data || !plot->figure) return;
     
-    free(vertices);
-    plot->data->grid_loaded = true;
+    cpl_make_renderer_current(plot->figure->renderer);
+    plot->data->grid = cpl_acquire_grid_geometry(plot->figure->geometry_cache, plot->data->margin,
+                                                 plot->data->grid_lines, plot->show_axes);
+    if (!plot->data->grid) {
+        cpl_plot_error("Failed to set up grid");
+    }
 }
 
 static void cpl_build_line_data(CPLPlot* plot, const double* x, const double* y, 
@@ -251,32 +668,53 @@ static void cpl_build_line_data(CPLPlot* plot, const double* x, const double* y,
     line->vbo = 0;
     line->vao = 0;
     line->num_vertices = n_points;
+    line->pick = NULL;
+    line->low = NULL;
     line->is_loaded = false;
+    
+    // Sorted x (time series) lets draws binary-search the visible samples;
+    // every axis scale preserves the order
+    line->monotonic_x = cpl_is_monotonic(x, n_points);
     line->vertices = (float*)malloc(n_points * 5 * sizeof(float)); // 5 floats per vertex
+    if (plot->high_precision) {
+        line->low = (float*)malloc(n_points * 2 * sizeof(float));
+    }
     
-    if (!line->vertices) {
+    if (!line->vertices || (plot->high_precision && !line->low)) {
         cpl_plot_error("Failed to allocate memory for line vertices");
+        free(line->vertices);
+        free(line->low);
         plot->data->num_lines--;
         return;
     }
     
-    // Convert data to normalized coordinates
-    double x_min = plot->x_range[0];
-    double x_max = plot->x_range[1];
-    double y_min = plot->y_range[0];
-    double y_max = plot->y_range[1];
+    // Positions stay in data units, relative to a per-line origin; ranges and
+    // axis scales are applied when drawing
+    line->origin[0] = cpl_line_origin(x, n_points);
+    line->origin[1] = cpl_line_origin(y, n_points);
     
-    float plot_left = -1.0f + plot->data->margin;
-    float plot_right = 1.0f - plot->data->margin;
-    float plot_bottom = -1.0f + plot->data->margin;
-    float plot_top = 1.0f - plot->data->margin;
+    // Bounding box for culling; NaN points never widen it
+    line->bounds[0] = line->bounds[1] = INFINITY;
+    line->bounds[2] = line->bounds[3] = -INFINITY;
     
     for (size_t i = 0; i < n_points; i++) {
-        float x_norm = cpl_normalize_coordinate(x[i], x_min, x_max, plot_left, plot_right - plot_left);
-        float y_norm = cpl_normalize_coordinate(y[i], y_min, y_max, plot_bottom, plot_top - plot_bottom);
+        float x_offset, y_offset;
+        if (line->low) {
+            // High precision: the residuals restore ~48 bits of each offset
+            cpl_split_double(x[i] - line->origin[0], &x_offset, &line->low[i * 2 + 0]);
+            cpl_split_double(y[i] - line->origin[1], &y_offset, &line->low[i * 2 + 1]);
+        } else {
+            x_offset = (float)(x[i] - line->origin[0]);
+            y_offset = (float)(y[i] - line->origin[1]);
+        }
+        
+        line->vertices[i * 5 + 0] = x_offset;  // x
+        line->vertices[i * 5 + 1] = y_offset;  // y
         
-        line->vertices[i * 5 + 0] = x_norm;  // x
-        line->vertices[i * 5 + 1] = y_norm;  // y
+        if (x_offset < line->bounds[0]) line->bounds[0] = x_offset;
+        if (y_offset < line->bounds[1]) line->bounds[1] = y_offset;
+        if (x_offset > line->bounds[2]) line->bounds[2] = x_offset;
+        if (y_offset > line->bounds[3]) line->bounds[3] = y_offset;
         
         // Color
         if (color_fn) {
@@ -291,13 +729,29 @@ static void cpl_build_line_data(CPLPlot* plot, const double* x, const double* y,
         }
     }
     
+    // Software figures rasterize straight from the vertex array
+    if (!cpl_renderer_has_gl(plot->figure->renderer)) {
+        line->is_loaded = true;
+        return;
+    }
+    
     // Create OpenGL objects
     glGenVertexArrays(1, &line->vao);
     glGenBuffers(1, &line->vbo);
     
     glBindVertexArray(line->vao);
     glBindBuffer(GL_ARRAY_BUFFER, line->vbo);
-    glBufferData(GL_ARRAY_BUFFER, n_points * 5 * sizeof(float), line->vertices, GL_STATIC_DRAW);
+    
+    // High-precision residuals follow the interleaved vertices in the same buffer
+    size_t vertex_bytes = n_points * 5 * sizeof(float);
+    size_t low_bytes = line->low ? n_points * 2 * sizeof(float) : 0;
+    glBufferData(GL_ARRAY_BUFFER, vertex_bytes + low_bytes, NULL, GL_STATIC_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, vertex_bytes, line->vertices);
+    if (line->low) {
+        glBufferSubData(GL_ARRAY_BUFFER, vertex_bytes, low_bytes, line->low);
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)vertex_bytes);
+    }
     
     // Position attribute
     glEnableVertexAttribArray(0);
@@ -313,10 +767,278 @@ static void cpl_build_line_data(CPLPlot* plot, const double* x, const double* y,
     line->is_loaded = true;
 }
 
-static float cpl_normalize_coordinate(double value, double min, double max, 
-                                     float plot_start, float plot_size) {
-    if (max == min) return plot_start + plot_size / 2.0f;
-    return plot_start + (float)((value - min) / (max - min)) * plot_size;
+static void cpl_build_scatter_data(CPLPlot* plot, const double* x, const double* y, size_t n_points, Color color,
+                                   float size, const unsigned char* colors, const unsigned char* sizes) {
+    CPLPlotData* data = plot->data;
+    if (data->num_scatters >= data->scatter_capacity) {
+        size_t new_capacity = data->scatter_capacity == 0 ? CPL_INITIAL_CAPACITY : data->scatter_capacity * 2;
+        CPLScatter* new_scatters = (CPLScatter*)realloc(data->scatters, new_capacity * sizeof(CPLScatter));
+        if (!new_scatters) {
+            cpl_plot_error("Failed to allocate memory for scatters");
+            return;
+        }
+        data->scatters = new_scatters;
+        data->scatter_capacity = new_capacity;
+    }
+    
+    CPLScatter* scatter = &data->scatters[data->num_scatters];
+    memset(scatter, 0, sizeof(CPLScatter));
+    scatter->num_points = n_points;
+    scatter->color = color;
+    scatter->size = size;
+    
+    // Only the positions are stored as floats; the optional streams keep their
+    // compact caller formats all the way to the GPU
+    scatter->offsets = (float*)malloc(n_points * 2 * sizeof(float));
+    if (plot->high_precision) scatter->low = (float*)malloc(n_points * 2 * sizeof(float));
+    if (colors) scatter->colors = (unsigned char*)malloc(n_points * 4);
+    if (sizes) scatter->sizes = (unsigned char*)malloc(n_points);
+    
+    if (!scatter->offsets || (plot->high_precision && !scatter->low) || (colors && !scatter->colors) ||
+        (sizes && !scatter->sizes)) {
+        cpl_plot_error("Failed to allocate memory for scatter points");
+        free(scatter->offsets);
+        free(scatter->low);
+        free(scatter->colors);
+        free(scatter->sizes);
+        return;
+    }
+    data->num_scatters++;
+    
+    if (colors) memcpy(scatter->colors, colors, n_points * 4);
+    scatter->max_size = size;
+    if (sizes) {
+        memcpy(scatter->sizes, sizes, n_points);
+        unsigned char largest = 0;
+        for (size_t i = 0; i < n_points; i++) {
+            if (sizes[i] > largest) largest = sizes[i];
+        }
+        scatter->max_size = (float)largest;
+    }
+    
+    // Same origin and offset scheme as lines
+    scatter->origin[0] = cpl_line_origin(x, n_points);
+    scatter->origin[1] = cpl_line_origin(y, n_points);
+    scatter->bounds[0] = scatter->bounds[1] = INFINITY;
+    scatter->bounds[2] = scatter->bounds[3] = -INFINITY;
+    
+    for (size_t i = 0; i < n_points; i++) {
+        float x_offset, y_offset;
+        if (scatter->low) {
+            cpl_split_double(x[i] - scatter->origin[0], &x_offset, &scatter->low[i * 2 + 0]);
+            cpl_split_double(y[i] - scatter->origin[1], &y_offset, &scatter->low[i * 2 + 1]);
+        } else {
+            x_offset = (float)(x[i] - scatter->origin[0]);
+            y_offset = (float)(y[i] - scatter->origin[1]);
+        }
+        scatter->offsets[i * 2 + 0] = x_offset;
+        scatter->offsets[i * 2 + 1] = y_offset;
+        
+        if (x_offset < scatter->bounds[0]) scatter->bounds[0] = x_offset;
+        if (y_offset < scatter->bounds[1]) scatter->bounds[1] = y_offset;
+        if (x_offset > scatter->bounds[2]) scatter->bounds[2] = x_offset;
+        if (y_offset > scatter->bounds[3]) scatter->bounds[3] = y_offset;
+    }
+    
+    if (cpl_renderer_has_gl(plot->figure->renderer)) {
+        cpl_upload_scatter(scatter);
+    }
+    scatter->is_loaded = true;
+}
+
+// One buffer holding each stream as a block; every attribute advances once per
+// instance (one quad per point)
+static void cpl_upload_scatter(CPLScatter* scatter) {
+    size_t n_points = scatter->num_points;
+    size_t offset_bytes = n_points * 2 * sizeof(float);
+    size_t low_bytes = scatter->low ? n_points * 2 * sizeof(float) : 0;
+    size_t color_bytes = scatter->colors ? n_points * 4 : 0;
+    size_t size_bytes = scatter->sizes ? n_points : 0;
+    
+    glGenVertexArrays(1, &scatter->vao);
+    glGenBuffers(1, &scatter->vbo);
+    glBindVertexArray(scatter->vao);
+    glBindBuffer(GL_ARRAY_BUFFER, scatter->vbo);
+    glBufferData(GL_ARRAY_BUFFER, offset_bytes + low_bytes + color_bytes + size_bytes, NULL, GL_STATIC_DRAW);
+    
+    // Position attribute
+    size_t at = 0;
+    glBufferSubData(GL_ARRAY_BUFFER, at, offset_bytes, scatter->offsets);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)at);
+    glVertexAttribDivisor(0, 1);
+    at += offset_bytes;
+    
+    // Residuals, colors and sizes; absent streams are constant attributes set when drawing
+    if (scatter->low) {
+        glBufferSubData(GL_ARRAY_BUFFER, at, low_bytes, scatter->low);
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)at);
+        glVertexAttribDivisor(2, 1);
+        at += low_bytes;
+    }
+    if (scatter->colors) {
+        glBufferSubData(GL_ARRAY_BUFFER, at, color_bytes, scatter->colors);
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, 4, (void*)at);
+        glVertexAttribDivisor(1, 1);
+        at += color_bytes;
+    }
+    if (scatter->sizes) {
+        glBufferSubData(GL_ARRAY_BUFFER, at, size_bytes, scatter->sizes);
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 1, GL_UNSIGNED_BYTE, GL_FALSE, 1, (void*)at);
+        glVertexAttribDivisor(3, 1);
+    }
+    
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+}
+
+// Shared x offsets as a buffer texture (fetched per vertex by the traces shader)
+static void cpl_upload_trace_positions(CPLTraces* traces) {
+    GLint max_texels = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &max_texels);
+    if ((size_t)max_texels < traces->samples) {
+        cpl_plot_error("Too many samples per trace for this GPU");
+        return;
+    }
+    
+    if (!traces->x_buffer) {
+        glGenBuffers(1, &traces->x_buffer);
+        glGenTextures(1, &traces->x_texture);
+    }
+    glBindBuffer(GL_TEXTURE_BUFFER, traces->x_buffer);
+    glBufferData(GL_TEXTURE_BUFFER, traces->samples * sizeof(float), traces->x, GL_STATIC_DRAW);
+    glBindTexture(GL_TEXTURE_BUFFER, traces->x_texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_R32F, traces->x_buffer);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+// All traces share one vertex buffer (and one buffer of frames) sized like the
+// CPU arrays: new traces are appended in place, growth or compaction re-uploads
+static void cpl_upload_traces(CPLTraces* traces) {
+    if (!traces->vao) {
+        glGenVertexArrays(1, &traces->vao);
+        glGenBuffers(1, &traces->vbo);
+        glGenBuffers(1, &traces->frames_buffer);
+        glGenTextures(1, &traces->frames_texture);
+        
+        glBindVertexArray(traces->vao);
+        glBindBuffer(GL_ARRAY_BUFFER, traces->vbo);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 1, GL_FLOAT, GL_FALSE, sizeof(float), (void*)0);
+        glBindVertexArray(0);
+    }
+    
+    size_t samples = traces->samples;
+    if (traces->buffer_capacity < traces->capacity) {
+        GLint max_texels = 0;
+        glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &max_texels);
+        if ((size_t)max_texels < traces->capacity) {
+            cpl_plot_error("Too many traces for this GPU");
+            return;
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, traces->vbo);
+        glBufferData(GL_ARRAY_BUFFER, traces->capacity * samples * sizeof(float), NULL, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_TEXTURE_BUFFER, traces->frames_buffer);
+        glBufferData(GL_TEXTURE_BUFFER, traces->capacity * sizeof(unsigned int), NULL, GL_DYNAMIC_DRAW);
+        glBindTexture(GL_TEXTURE_BUFFER, traces->frames_texture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_R32UI, traces->frames_buffer);
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+        traces->buffer_capacity = traces->capacity;
+        traces->uploaded = 0;
+    }
+    
+    if (traces->uploaded < traces->num_traces) {
+        size_t first = traces->uploaded;
+        size_t count = traces->num_traces - first;
+        glBindBuffer(GL_ARRAY_BUFFER, traces->vbo);
+        glBufferSubData(GL_ARRAY_BUFFER, first * samples * sizeof(float), count * samples * sizeof(float),
+                        traces->y + first * samples);
+        glBindBuffer(GL_TEXTURE_BUFFER, traces->frames_buffer);
+        glBufferSubData(GL_TEXTURE_BUFFER, first * sizeof(unsigned int), count * sizeof(unsigned int),
+                        traces->frames + first);
+        traces->uploaded = traces->num_traces;
+    }
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+// Traces faded below CPL_TRACE_MIN_WEIGHT are removed once they make up half of
+// the stored ones, so live persistence runs in bounded memory
+static void cpl_drop_faded_traces(CPLTraces* traces) {
+    if (traces->decay >= 1.0f || traces->num_traces == 0) return;
+    
+    unsigned int max_age = 0;
+    if (traces->decay > 0.0f) {
+        max_age = (unsigned int)floor(log(CPL_TRACE_MIN_WEIGHT) / log((double)traces->decay));
+    }
+    size_t faded = 0;
+    while (faded < traces->num_traces && traces->frame - traces->frames[faded] > max_age) faded++;
+    if (faded == 0 || faded * 2 < traces->num_traces) return;
+    
+    size_t kept = traces->num_traces - faded;
+    memmove(traces->y, traces->y + faded * traces->samples, kept * traces->samples * sizeof(float));
+    memmove(traces->frames, traces->frames + faded, kept * sizeof(unsigned int));
+    traces->num_traces = kept;
+    traces->uploaded = 0;
+    
+    // The accumulated image still holds their weights: it is drawn again from
+    // the kept traces, which stay at least as many as the dropped ones
+    if (traces->accumulation) traces->accumulation->num_inputs = (size_t)-1;
+}
+
+static void cpl_reset_trace_images(CPLTraces* traces) {
+    cpl_free_density(traces->accumulation);
+    cpl_free_density(traces->grid);
+    traces->accumulation = NULL;
+    traces->grid = NULL;
+}
+
+static double cpl_line_origin(const double* values, size_t count) {
+    double min = INFINITY;
+    double max = -INFINITY;
+    for (size_t i = 0; i < count; i++) {
+        if (values[i] < min) min = values[i];
+        if (values[i] > max) max = values[i];
+    }
+    if (!cpl_is_finite(min) || !cpl_is_finite(max)) return 0.0;
+    
+    // Data far from zero (timestamps) is stored relative to its midpoint so the
+    // float offsets keep their resolution; anything else stays relative to zero,
+    // which log axes need for values spanning many decades
+    double mid = 0.5 * (min + max);
+    return fabs(mid) > max - min ? mid : 0.0;
+}
+
+static bool cpl_is_monotonic(const double* values, size_t count) {
+    // One pass without early exit. NaN is rejected on its bit pattern: under
+    // -ffast-math the compiler may assume comparisons with NaN succeed
+    size_t i = 0;
+    bool sorted = true;
+#ifdef __SSE2__
+    // |bits| + 0x000fffffffffffff carries into the sign bit exactly for NaN
+    const __m128i magnitude = _mm_set1_epi64x(0x7fffffffffffffffLL);
+    const __m128i nan_bias = _mm_set1_epi64x(0x000fffffffffffffLL);
+    __m128i nan = _mm_setzero_si128();
+    __m128d all = _mm_castsi128_pd(_mm_set1_epi32(-1));
+    for (; i + 3 <= count; i += 2) {
+        // Pairs (i, i + 1) and (i + 1, i + 2)
+        __m128d current = _mm_loadu_pd(values + i);
+        __m128d next = _mm_loadu_pd(values + i + 1);
+        all = _mm_and_pd(all, _mm_cmpge_pd(next, current));
+        nan = _mm_or_si128(nan, _mm_add_epi64(_mm_and_si128(_mm_castpd_si128(current), magnitude), nan_bias));
+        nan = _mm_or_si128(nan, _mm_add_epi64(_mm_and_si128(_mm_castpd_si128(next), magnitude), nan_bias));
+    }
+    if (_mm_movemask_pd(all) != 3 || _mm_movemask_pd(_mm_castsi128_pd(nan)) != 0) return false;
+#endif
+    if (i < count) sorted = !cpl_is_nan(values[i]);
+    for (; i + 1 < count; i++) {
+        sorted &= !cpl_is_nan(values[i + 1]) & (values[i + 1] >= values[i]);
+    }
+    return sorted;
 }
 
 static void cpl_plot_error(const char* message) {
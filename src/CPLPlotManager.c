@@ -1,5 +1,12 @@
 #include "CPLPlot.h"
 #include "utils/CPLRenderer.h"
+#include "utils/CPLGeometry.h"
+#include "utils/CPLDensity.h"
+#include "utils/CPLMatrix.h"
+#include "utils/CPLHistogram.h"
+#include "utils/CPLContour.h"
+#include "utils/CPLQuiver.h"
+#include "utils/CPLCandles.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -8,7 +15,7 @@
 
 // Internal function declarations
 static CPLPlotData* cpl_create_plot_data(void);
-static void cpl_free_plot_data(CPLPlotData* data);
+static void cpl_free_plot_data(CPLPlot* plot, CPLPlotData* data);
 static CPLSubplotLayout* cpl_create_subplot_layout(size_t rows, size_t cols, size_t index);
 static void cpl_free_subplot_layout(CPLSubplotLayout* layout);
 static void cpl_calculate_subplot_viewport(CPLSubplotLayout* layout, size_t rows, size_t cols, size_t index);
@@ -16,6 +23,12 @@ static void cpl_calculate_subplot_viewport_with_grid(CPLSubplotLayout* layout, s
 static void cpl_build_subplot_viewports(CPLFigure* fig, size_t rows, size_t cols);
 static void cpl_plot_error(const char* message);
 
+// External function declarations
+void cpl_free_small_multiples(CPLSmallMultiples* multiples);
+void cpl_free_traces(CPLTraces* traces);
+void cpl_free_waterfall(CPLWaterfall* waterfall);
+void cpl_free_pick_index(struct CPLPickIndex* index);
+
 // Constants
 #define CPL_DEFAULT_MARGIN 0.1f
 #define CPL_INITIAL_CAPACITY 4
@@ -53,6 +66,14 @@ CPLPlot* cpl_add_plot(CPLFigure* fig) {
     plot->x_range[1] = 1.0;
     plot->y_range[0] = 0.0;
     plot->y_range[1] = 1.0;
+    plot->x_scale = CPL_SCALE_LINEAR;
+    plot->y_scale = CPL_SCALE_LINEAR;
+    plot->symlog_threshold[0] = 1.0;
+    plot->symlog_threshold[1] = 1.0;
+    plot->polar = false;
+    plot->high_precision = false;
+    plot->density = CPL_DENSITY_OFF;
+    plot->colormap = CPL_COLORMAP_VIRIDIS;
     plot->show_grid = true;
     plot->show_axes = true;
     plot->show_ticks = true;
@@ -142,7 +163,7 @@ void cpl_free_plot(CPLPlot* plot) {
     if (!plot) return;
 
     if (plot->data) {
-        cpl_free_plot_data(plot->data);
+        cpl_free_plot_data(plot, plot->data);
     }
 
     if (plot->subplot_layout) {
@@ -209,18 +230,27 @@ static CPLPlotData* cpl_create_plot_data(void) {
     data->lines = NULL;
     data->num_lines = 0;
     data->capacity = 0;
-    data->box_vbo = 0;
-    data->box_vao = 0;
-    data->grid_vbo = 0;
-    data->grid_vao = 0;
-    data->grid_loaded = false;
-    data->box_loaded = false;
+    data->scatters = NULL;
+    data->num_scatters = 0;
+    data->scatter_capacity = 0;
+    data->box = NULL;
+    data->grid = NULL;
     data->margin = CPL_DEFAULT_MARGIN;
+    data->grid_lines = CPL_DEFAULT_GRID_LINES;
+    data->multiples = NULL;
+    data->density = NULL;
+    data->traces = NULL;
+    data->waterfall = NULL;
+    data->matrix = NULL;
+    data->histogram = NULL;
+    data->contour = NULL;
+    data->quiver = NULL;
+    data->candles = NULL;
     
     return data;
 }
 
-static void cpl_free_plot_data(CPLPlotData* data) {
+static void cpl_free_plot_data(CPLPlot* plot, CPLPlotData* data) {
     if (!data) return;
     
     // Free lines
@@ -229,6 +259,8 @@ static void cpl_free_plot_data(CPLPlotData* data) {
             if (data->lines[i].vertices) {
                 free(data->lines[i].vertices);
             }
+            free(data->lines[i].low);
+            cpl_free_pick_index(data->lines[i].pick);
             if (data->lines[i].vbo) {
                 glDeleteBuffers(1, &data->lines[i].vbo);
             }
@@ -239,11 +271,41 @@ static void cpl_free_plot_data(CPLPlotData* data) {
         free(data->lines);
     }
     
-    // Free OpenGL objects
-    if (data->box_vbo) glDeleteBuffers(1, &data->box_vbo);
-    if (data->box_vao) glDeleteVertexArrays(1, &data->box_vao);
-    if (data->grid_vbo) glDeleteBuffers(1, &data->grid_vbo);
-    if (data->grid_vao) glDeleteVertexArrays(1, &data->grid_vao);
+    // Free scatters
+    if (data->scatters) {
+        for (size_t i = 0; i < data->num_scatters; i++) {
+            CPLScatter* scatter = &data->scatters[i];
+            free(scatter->offsets);
+            free(scatter->low);
+            free(scatter->colors);
+            free(scatter->sizes);
+            cpl_free_pick_index(scatter->pick);
+            if (scatter->vbo) {
+                glDeleteBuffers(1, &scatter->vbo);
+            }
+            if (scatter->vao) {
+                glDeleteVertexArrays(1, &scatter->vao);
+            }
+        }
+        free(data->scatters);
+    }
+    
+    // Release shared box and grid geometry
+    CPLGeometryCache* cache = plot->figure ? plot->figure->geometry_cache : NULL;
+    cpl_release_geometry(cache, data->box);
+    cpl_release_geometry(cache, data->grid);
+    
+    if (data->multiples) {
+        cpl_free_small_multiples(data->multiples);
+    }
+    cpl_free_density(data->density);
+    cpl_free_traces(data->traces);
+    cpl_free_waterfall(data->waterfall);
+    cpl_free_matrix(data->matrix);
+    cpl_free_histogram(data->histogram);
+    cpl_free_contour(data->contour);
+    cpl_free_quiver(data->quiver);
+    cpl_free_candles(data->candles);
     
     free(data);
 }
@@ -1,12 +1,43 @@
 #include "CPLPlot.h"
 #include "utils/CPLRenderer.h"
+#include "utils/CPLTransform.h"
+#include "utils/CPLDensity.h"
+#include "utils/CPLMatrix.h"
+#include "utils/CPLHistogram.h"
+#include "utils/CPLContour.h"
+#include "utils/CPLQuiver.h"
+#include "utils/CPLCandles.h"
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <math.h>
 #include <GL/glew.h>
 
 // Internal function declarations
 static void cpl_render_plot_internal(CPLPlot* plot);
+static void cpl_render_lines(CPLPlot* plot);
+static void cpl_render_scatters(CPLPlot* plot);
+static void cpl_render_density(CPLPlot* plot);
+static void cpl_render_traces(CPLPlot* plot);
+static void cpl_render_waterfall(CPLPlot* plot);
+static void cpl_render_matrix(CPLPlot* plot);
+static void cpl_render_histogram(CPLPlot* plot);
+static void cpl_render_contour(CPLPlot* plot);
+static void cpl_render_quiver(CPLPlot* plot);
+static void cpl_render_candles(CPLPlot* plot);
+static bool cpl_accumulate_traces(CPLPlot* plot, CPLDensity* accumulation, const CPLViewTransform* view,
+                                  const int* box);
+static bool cpl_traces_target(CPLDensity* accumulation, int width, int height);
+static bool cpl_collect_traces(CPLDensity* accumulation, CPLDensityNorm norm, bool wait);
+static void cpl_draw_density_grid(CPLRenderer* renderer, CPLDensity* density, CPLDensityNorm norm,
+                                  CPLColormap colormap);
+static void cpl_set_view_uniforms(const GLint* uniforms, const CPLViewTransform* view);
+static void cpl_set_origin_uniforms(const GLint* uniforms, const CPLViewTransform* view, const double* origin);
+static size_t cpl_offset_search(const float* values, size_t stride, size_t count, float x, bool past_equal);
+
+// External function declarations
+void cpl_render_small_multiples(CPLPlot* plot);
 static void cpl_plot_error(const char* message);
 
 // Rendering functions
@@ -26,16 +57,22 @@ static void cpl_render_plot_internal(CPLPlot* plot) {
     // Note: Shader program and projection matrix are set once per frame in the render loop
     // This eliminates redundant OpenGL state changes
     
+    // Small multiples draw all their tiles in a few instanced calls
+    if (plot->data->multiples) {
+        cpl_render_small_multiples(plot);
+        return;
+    }
+    
     // Draw plot box
-    if (plot->data->box_loaded) {
+    if (plot->data->box) {
         glLineWidth(plot->box_line_width);
-        glBindVertexArray(plot->data->box_vao);
-        glDrawArrays(GL_LINE_LOOP, 0, 4);
+        glBindVertexArray(plot->data->box->vao);
+        glDrawArrays(GL_LINE_LOOP, 0, (GLsizei)plot->data->box->num_vertices);
         glBindVertexArray(0);
     }
     
     // Draw grid if enabled
-    if (plot->show_grid && plot->data->grid_loaded) {
+    if (plot->show_grid && plot->data->grid) {
         // Set grid line width uniform for shader-based thickness control
         GLint line_width_location = glGetUniformLocation(plot->figure->renderer->program_id, "lineWidth");
         if (line_width_location != -1) {
@@ -44,21 +81,935 @@ static void cpl_render_plot_internal(CPLPlot* plot) {
         
         // Use shader-based line thickness for grid lines
         // This allows for sub-pixel line thickness control
-        glBindVertexArray(plot->data->grid_vao);
-        glDrawArrays(GL_LINES, 0, 44); // 22 lines * 2 vertices each (11 horizontal + 11 vertical)
+        glBindVertexArray(plot->data->grid->vao);
+        glDrawArrays(GL_LINES, 0, (GLsizei)plot->data->grid->num_vertices);
         glBindVertexArray(0);
     }
     
-    // Draw all lines
+    // Data lines are clipped to the plot box; the box and grid keep their full width
+    CPLRenderer* renderer = plot->figure->renderer;
+    glScissor(renderer->clip[0], renderer->clip[1], renderer->clip[2], renderer->clip[3]);
+    cpl_render_matrix(plot);
+    cpl_render_waterfall(plot);
+    cpl_render_histogram(plot);
+    cpl_render_candles(plot);
+    cpl_render_contour(plot);
+    cpl_render_quiver(plot);
+    cpl_render_lines(plot);
+    cpl_render_traces(plot);
+    if (plot->density != CPL_DENSITY_OFF) {
+        cpl_render_density(plot);
+    } else {
+        cpl_render_scatters(plot);
+    }
+    glScissor(renderer->scissor[0], renderer->scissor[1], renderer->scissor[2], renderer->scissor[3]);
+}
+
+static void cpl_render_lines(CPLPlot* plot) {
+    if (plot->data->num_lines == 0) return;
+    
+    CPLRenderer* renderer = plot->figure->renderer;
+    GLuint program = cpl_get_shader_program(renderer->shaders, CPL_SHADER_DATA);
+    if (program == 0) return;
+    const GLint* uniforms = renderer->shaders->uniform_locations[CPL_SHADER_DATA];
+    
+    // Ranges, scales and the polar mapping are uniforms: changing them costs nothing here
+    CPLViewTransform view;
+    cpl_view_transform(plot, renderer->viewport, &view);
+    
+    glUseProgram(program);
+    glUniformMatrix4fv(renderer->shaders->proj_mat_locations[CPL_SHADER_DATA], 1, GL_FALSE, renderer->projection);
+    cpl_set_view_uniforms(uniforms, &view);
+    glLineWidth(plot->line_width);
+    
+    // Draw all lines, skipping those entirely outside the visible region
     for (size_t i = 0; i < plot->data->num_lines; i++) {
         CPLLine* line = &plot->data->lines[i];
-        if (line->is_loaded) {
-            glLineWidth(plot->line_width);
-            glBindVertexArray(line->vao);
-            glDrawArrays(GL_LINE_STRIP, 0, (GLsizei)line->num_vertices);
-            glBindVertexArray(0);
+        if (!line->is_loaded) continue;
+        
+        float window[4];
+        if (!cpl_view_window(&view, line->origin, line->bounds, renderer->visible, window)) continue;
+        
+        // Sorted x: draw only the samples in the visible x-range
+        size_t first, count;
+        cpl_line_visible_range(line, window[0], window[2], &first, &count);
+        if (count < 2) continue;
+        
+        cpl_set_origin_uniforms(uniforms, &view, line->origin);
+        glBindVertexArray(line->vao);
+        if (!line->low) {
+            // Standard lines have no residual array; the shader reads the constant value
+            glVertexAttrib2f(2, 0.0f, 0.0f);
+        }
+        glDrawArrays(GL_LINE_STRIP, (GLint)first, (GLsizei)count);
+    }
+    
+    glBindVertexArray(0);
+    glUseProgram(renderer->program_id);
+}
+
+static void cpl_render_scatters(CPLPlot* plot) {
+    if (plot->data->num_scatters == 0) return;
+    
+    CPLRenderer* renderer = plot->figure->renderer;
+    GLuint program = cpl_get_shader_program(renderer->shaders, CPL_SHADER_POINTS);
+    if (program == 0) return;
+    const GLint* uniforms = renderer->shaders->uniform_locations[CPL_SHADER_POINTS];
+    
+    CPLViewTransform view;
+    cpl_view_transform(plot, renderer->viewport, &view);
+    
+    glUseProgram(program);
+    glUniformMatrix4fv(renderer->shaders->proj_mat_locations[CPL_SHADER_POINTS], 1, GL_FALSE, renderer->projection);
+    cpl_set_view_uniforms(uniforms, &view);
+    
+    // Point sizes are in pixels of the plot's viewport
+    float pixel_x = 2.0f / (float)renderer->viewport[2];
+    float pixel_y = 2.0f / (float)renderer->viewport[3];
+    glUniform2f(uniforms[CPL_UNIFORM_PIXEL_SIZE], pixel_x, pixel_y);
+    
+    // Overlapping discs blend in drawing order, as in the software and vector
+    // backends; a depth test would let the first (AA-faded) edge win
+    glDisable(GL_DEPTH_TEST);
+    
+    for (size_t i = 0; i < plot->data->num_scatters; i++) {
+        CPLScatter* scatter = &plot->data->scatters[i];
+        if (!scatter->is_loaded || !scatter->vao) continue;
+        
+        // The visible rectangle is padded for lines; grow it by the largest disc
+        float radius = 0.5f * scatter->max_size + 1.0f;
+        float reach[4] = {
+            renderer->visible[0] - radius * pixel_x, renderer->visible[1] - radius * pixel_y,
+            renderer->visible[2] + radius * pixel_x, renderer->visible[3] + radius * pixel_y
+        };
+        float window[4];
+        if (!cpl_view_window(&view, scatter->origin, scatter->bounds, reach, window)) continue;
+        
+        cpl_set_origin_uniforms(uniforms, &view, scatter->origin);
+        glBindVertexArray(scatter->vao);
+        if (!scatter->colors) {
+            glVertexAttrib4f(1, scatter->color.r, scatter->color.g, scatter->color.b, scatter->color.a);
+        }
+        if (!scatter->low) glVertexAttrib2f(2, 0.0f, 0.0f);
+        if (!scatter->sizes) glVertexAttrib1f(3, scatter->size);
+        glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, (GLsizei)scatter->num_points);
+    }
+    
+    glEnable(GL_DEPTH_TEST);
+    glBindVertexArray(0);
+    glUseProgram(renderer->program_id);
+}
+
+// Density mode: the scatters' count grid (rebinned only when the view changed)
+// drawn as one textured quad over the plot box
+static void cpl_render_density(CPLPlot* plot) {
+    CPLRenderer* renderer = plot->figure->renderer;
+    GLuint program = cpl_get_shader_program(renderer->shaders, CPL_SHADER_DENSITY);
+    if (program == 0) return;
+    
+    CPLDensity* density = cpl_density_update(plot, renderer->viewport);
+    if (!density) return;
+    
+    if (!density->texture) {
+        glGenTextures(1, &density->texture);
+        glGenVertexArrays(1, &density->vao);
+    }
+    
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, density->texture);
+    if (density->texture_dirty) {
+        if (density->texture_size[0] != density->width || density->texture_size[1] != density->height) {
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, density->width, density->height, 0, GL_RED, GL_FLOAT,
+                         density->counts);
+            density->texture_size[0] = density->width;
+            density->texture_size[1] = density->height;
+        } else {
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, density->width, density->height, GL_RED, GL_FLOAT,
+                            density->counts);
+        }
+        density->texture_dirty = false;
+    }
+    
+    cpl_draw_density_grid(renderer, density, plot->density, plot->colormap);
+}
+
+// Persistence traces: new traces are added into a float accumulation target
+// (faded first when frames passed since the last draw), all of them only when
+// the view changed; the weights are then drawn like a density grid
+static void cpl_render_traces(CPLPlot* plot) {
+    CPLTraces* traces = plot->data->traces;
+    if (!traces || traces->num_traces == 0 || traces->uploaded < traces->num_traces || !traces->x_texture) return;
+    
+    CPLRenderer* renderer = plot->figure->renderer;
+    int box[4];
+    cpl_plot_box_rect(plot, renderer->viewport, box);
+    if (box[2] <= 0 || box[3] <= 0) return;
+    
+    // Zeroed first so views compare with memcmp against the accumulated one
+    CPLViewTransform view;
+    memset(&view, 0, sizeof(view));
+    cpl_view_transform(plot, renderer->viewport, &view);
+    
+    if (!traces->accumulation) {
+        traces->accumulation = (CPLDensity*)calloc(1, sizeof(CPLDensity));
+        if (!traces->accumulation) {
+            cpl_plot_error("Failed to allocate trace accumulation");
+            return;
+        }
+    }
+    CPLDensity* accumulation = traces->accumulation;
+    
+    if (!cpl_accumulate_traces(plot, accumulation, &view, box)) return;
+    
+    cpl_draw_density_grid(renderer, accumulation, traces->norm, plot->colormap);
+}
+
+// Brings the accumulation up to date with the traces and reads it back for the
+// normalization (maximum, equalization levels). The readback goes through a
+// pixel pack buffer and is picked up by a later frame, so interactive frames
+// normalize with the weights of the previous one; exported frames, and the
+// first one, wait for it.
+static bool cpl_accumulate_traces(CPLPlot* plot, CPLDensity* accumulation, const CPLViewTransform* view,
+                                  const int* box) {
+    CPLTraces* traces = plot->data->traces;
+    CPLRenderer* renderer = plot->figure->renderer;
+    const int* viewport = renderer->viewport;
+    
+    if (!cpl_collect_traces(accumulation, traces->norm, renderer->exporting)) {
+        accumulation->num_inputs = (size_t)-1;
+        return false;
+    }
+    
+    bool rebuild = !accumulation->framebuffer || memcmp(&accumulation->view, view, sizeof(*view)) != 0 ||
+                   accumulation->viewport_size[0] != viewport[2] || accumulation->viewport_size[1] != viewport[3] ||
+                   accumulation->num_inputs > traces->num_traces;
+    if (!rebuild && accumulation->num_inputs == traces->num_traces && accumulation->frame == traces->frame) {
+        if (accumulation->norm != traces->norm) {
+            if (traces->norm == CPL_DENSITY_EQ_HIST && !cpl_density_equalize(accumulation)) return false;
+            accumulation->norm = traces->norm;
+        }
+        return true;
+    }
+    
+    GLuint program = cpl_get_shader_program(renderer->shaders, CPL_SHADER_TRACES);
+    if (program == 0) return false;
+    const GLint* uniforms = renderer->shaders->uniform_locations[CPL_SHADER_TRACES];
+    if (rebuild && !cpl_traces_target(accumulation, box[2], box[3])) return false;
+    
+    // The target covers the plot box: the plot's whole viewport shifted by the
+    // box corner, drawn without the region projection of tiled exports
+    GLint draw_framebuffer, read_framebuffer;
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &draw_framebuffer);
+    glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &read_framebuffer);
+    GLint saved_viewport[4];
+    glGetIntegerv(GL_VIEWPORT, saved_viewport);
+    
+    glBindFramebuffer(GL_FRAMEBUFFER, accumulation->framebuffer);
+    glViewport(viewport[0] - box[0], viewport[1] - box[1], viewport[2], viewport[3]);
+    glScissor(0, 0, box[2], box[3]);
+    glDisable(GL_DEPTH_TEST);
+    glUseProgram(program);
+    static const float identity[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+    glUniformMatrix4fv(renderer->shaders->proj_mat_locations[CPL_SHADER_TRACES], 1, GL_FALSE, identity);
+    
+    if (rebuild) {
+        glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+        accumulation->num_inputs = 0;
+        accumulation->frame = traces->frame;
+    } else if (accumulation->frame != traces->frame) {
+        // Older weights fade by the frames that passed: destination * fade
+        glBlendFunc(GL_ZERO, GL_SRC_COLOR);
+        glUniform1i(uniforms[CPL_UNIFORM_MODE], 1);
+        glUniform1f(uniforms[CPL_UNIFORM_FADE],
+                    powf(traces->decay, (float)(traces->frame - accumulation->frame)));
+        glBindVertexArray(accumulation->vao);
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    }
+    
+    // Traces not in the target yet, as one draw over the shared buffer; sorted x
+    // limits every trace to the samples in the visible range
+    size_t first_trace = accumulation->num_inputs;
+    size_t count = traces->num_traces - first_trace;
+    const float everywhere[4] = { -INFINITY, -INFINITY, INFINITY, INFINITY };
+    float window[4];
+    size_t first_sample = 0, num_samples = traces->samples;
+    if (cpl_view_window(view, traces->origin, everywhere, renderer->visible, window)) {
+        cpl_traces_visible_range(traces, window[0], window[2], &first_sample, &num_samples);
+    }
+    GLint* firsts = (GLint*)malloc((count > 0 ? count : 1) * sizeof(GLint));
+    GLsizei* counts = (GLsizei*)malloc((count > 0 ? count : 1) * sizeof(GLsizei));
+    bool ok = firsts && counts;
+    if (!ok) {
+        cpl_plot_error("Failed to allocate trace draw ranges");
+    } else if (count > 0 && num_samples >= 2) {
+        for (size_t i = 0; i < count; i++) {
+            firsts[i] = (GLint)((first_trace + i) * traces->samples + first_sample);
+            counts[i] = (GLsizei)num_samples;
+        }
+        
+        cpl_set_view_uniforms(uniforms, view);
+        cpl_set_origin_uniforms(uniforms, view, traces->origin);
+        glUniform1i(uniforms[CPL_UNIFORM_MODE], 0);
+        glUniform1i(uniforms[CPL_UNIFORM_SAMPLES], (GLint)traces->samples);
+        glUniform1ui(uniforms[CPL_UNIFORM_FRAME], traces->frame);
+        glUniform1f(uniforms[CPL_UNIFORM_DECAY], traces->decay);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_BUFFER, traces->x_texture);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_BUFFER, traces->frames_texture);
+        glUniform1i(uniforms[CPL_UNIFORM_XS], 0);
+        glUniform1i(uniforms[CPL_UNIFORM_FRAMES], 1);
+        
+        glBlendFunc(GL_ONE, GL_ONE);
+        glLineWidth(1.0f);
+        glBindVertexArray(traces->vao);
+        glMultiDrawArrays(GL_LINE_STRIP, firsts, counts, (GLsizei)count);
+        
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+    }
+    free(firsts);
+    free(counts);
+    
+    // The normalization needs the accumulated weights on the CPU: queue their
+    // copy, replacing one not collected yet
+    if (ok) {
+        if (accumulation->readback_fence) glDeleteSync((GLsync)accumulation->readback_fence);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, accumulation->readback_buffer);
+        glReadPixels(0, 0, box[2], box[3], GL_RED, GL_FLOAT, (void*)0);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        accumulation->readback_fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        accumulation->weighted = traces->decay < 1.0f;
+        
+        if (renderer->exporting || accumulation->max_count <= 0.0f) {
+            ok = cpl_collect_traces(accumulation, traces->norm, true);
+        }
+    }
+    
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glEnable(GL_DEPTH_TEST);
+    glBindVertexArray(0);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, (GLuint)draw_framebuffer);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, (GLuint)read_framebuffer);
+    glViewport(saved_viewport[0], saved_viewport[1], saved_viewport[2], saved_viewport[3]);
+    glScissor(renderer->clip[0], renderer->clip[1], renderer->clip[2], renderer->clip[3]);
+    glUseProgram(renderer->program_id);
+    if (!ok) {
+        // Drawn again from scratch next frame
+        accumulation->num_inputs = (size_t)-1;
+        return false;
+    }
+    
+    cpl_density_place(accumulation, viewport, box);
+    accumulation->view = *view;
+    accumulation->viewport_size[0] = viewport[2];
+    accumulation->viewport_size[1] = viewport[3];
+    accumulation->norm = traces->norm;
+    accumulation->num_inputs = traces->num_traces;
+    accumulation->frame = traces->frame;
+    return true;
+}
+
+// R32F texture of the plot box size attached to the accumulation framebuffer,
+// plus the CPU copy of the weights
+static bool cpl_traces_target(CPLDensity* accumulation, int width, int height) {
+    if (!accumulation->framebuffer) {
+        glGenTextures(1, &accumulation->texture);
+        glGenFramebuffers(1, &accumulation->framebuffer);
+        glGenVertexArrays(1, &accumulation->vao);
+        glGenBuffers(1, &accumulation->readback_buffer);
+    }
+    if (accumulation->texture_size[0] == width && accumulation->texture_size[1] == height) return true;
+    
+    float* counts = (float*)realloc(accumulation->counts, (size_t)width * (size_t)height * sizeof(float));
+    if (!counts) {
+        cpl_plot_error("Failed to allocate trace accumulation");
+        return false;
+    }
+    accumulation->counts = counts;
+    accumulation->width = width;
+    accumulation->height = height;
+    
+    GLint framebuffer;
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &framebuffer);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, accumulation->texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, width, height, 0, GL_RED, GL_FLOAT, NULL);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    
+    glBindFramebuffer(GL_FRAMEBUFFER, accumulation->framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, accumulation->texture, 0);
+    bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    glBindFramebuffer(GL_FRAMEBUFFER, (GLuint)framebuffer);
+    if (!complete) {
+        cpl_plot_error("Float render targets are not supported");
+        accumulation->texture_size[0] = accumulation->texture_size[1] = 0;
+        return false;
+    }
+    
+    // A pending readback has the old size; the next one is waited for
+    if (accumulation->readback_fence) {
+        glDeleteSync((GLsync)accumulation->readback_fence);
+        accumulation->readback_fence = NULL;
+    }
+    accumulation->max_count = 0.0f;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, accumulation->readback_buffer);
+    glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)width * height * sizeof(float), NULL, GL_STREAM_READ);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    
+    accumulation->texture_size[0] = width;
+    accumulation->texture_size[1] = height;
+    return true;
+}
+
+// Copies a finished readback of the weights into the counts and updates the
+// normalization from it; without `wait`, a readback still running is left for
+// a later frame. False when the buffer cannot be mapped or equalization fails.
+static bool cpl_collect_traces(CPLDensity* accumulation, CPLDensityNorm norm, bool wait) {
+    if (!accumulation->readback_fence) return true;
+    
+    GLsync fence = (GLsync)accumulation->readback_fence;
+    GLenum status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, wait ? 1000000000ull : 0);
+    if (status == GL_TIMEOUT_EXPIRED && !wait) return true;
+    glDeleteSync(fence);
+    accumulation->readback_fence = NULL;
+    
+    size_t cells = (size_t)accumulation->width * (size_t)accumulation->height;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, accumulation->readback_buffer);
+    const float* mapped = (const float*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr)(cells * sizeof(float)),
+                                                         GL_MAP_READ_BIT);
+    if (mapped) {
+        memcpy(accumulation->counts, mapped, cells * sizeof(float));
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    if (!mapped) {
+        cpl_plot_error("Failed to map trace readback");
+        return false;
+    }
+    
+    float max = 0.0f;
+    for (size_t i = 0; i < cells; i++) {
+        if (accumulation->counts[i] > max) max = accumulation->counts[i];
+    }
+    accumulation->max_count = max;
+    return norm != CPL_DENSITY_EQ_HIST || cpl_density_equalize(accumulation);
+}
+
+// Waterfall: rows received since the last draw go into the ring texture (one
+// upload, two when they wrap), then one quad over the plot box looks every pixel
+// up in the ring, below the lines
+static void cpl_render_waterfall(CPLPlot* plot) {
+    CPLWaterfall* waterfall = plot->data->waterfall;
+    if (!waterfall || waterfall->filled == 0) return;
+    
+    CPLRenderer* renderer = plot->figure->renderer;
+    GLuint program = cpl_get_shader_program(renderer->shaders, CPL_SHADER_WATERFALL);
+    if (program == 0) return;
+    const GLint* uniforms = renderer->shaders->uniform_locations[CPL_SHADER_WATERFALL];
+    
+    glActiveTexture(GL_TEXTURE0);
+    if (!waterfall->texture) {
+        glGenTextures(1, &waterfall->texture);
+        glGenVertexArrays(1, &waterfall->vao);
+        glBindTexture(GL_TEXTURE_2D, waterfall->texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, (GLsizei)waterfall->bins, (GLsizei)waterfall->rows, 0, GL_RED,
+                     GL_FLOAT, NULL);
+        waterfall->pending = waterfall->filled;
+    } else {
+        glBindTexture(GL_TEXTURE_2D, waterfall->texture);
+    }
+    if (waterfall->pending > 0) {
+        // Pending rows end at the newest one; the part before the ring's end
+        // (if they wrap) and the part from its start
+        size_t first = (waterfall->newest + waterfall->rows + 1 - waterfall->pending) % waterfall->rows;
+        size_t head = first + waterfall->pending > waterfall->rows ? waterfall->rows - first : waterfall->pending;
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, (GLint)first, (GLsizei)waterfall->bins, (GLsizei)head, GL_RED, GL_FLOAT,
+                        waterfall->values + first * waterfall->bins);
+        if (head < waterfall->pending) {
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, (GLsizei)waterfall->bins, (GLsizei)(waterfall->pending - head),
+                            GL_RED, GL_FLOAT, waterfall->values);
+        }
+        waterfall->pending = 0;
+    }
+    
+    int box[4];
+    const int* viewport = renderer->viewport;
+    cpl_plot_box_rect(plot, viewport, box);
+    CPLViewTransform view;
+    cpl_view_transform(plot, viewport, &view);
+    
+    // Linear axes are relative to the axis minimum, taken in double precision
+    float image_min[2], image_size[2];
+    for (int axis = 0; axis < 2; axis++) {
+        const double* range = axis == 0 ? waterfall->x_range : waterfall->y_range;
+        bool relative = view.scale[axis] == CPL_SCALE_LINEAR && !(view.polar && axis == 0);
+        image_min[axis] = (float)(relative ? range[0] - view.min[axis] : range[0]);
+        image_size[axis] = (float)(range[1] - range[0]);
+    }
+    
+    float stops[CPL_COLORMAP_STOPS * 3];
+    cpl_colormap_stops(plot->colormap, stops);
+    
+    glUseProgram(program);
+    cpl_set_view_uniforms(uniforms, &view);
+    glUniformMatrix4fv(renderer->shaders->proj_mat_locations[CPL_SHADER_WATERFALL], 1, GL_FALSE,
+                       renderer->projection);
+    glUniform4f(uniforms[CPL_UNIFORM_RECT],
+                -1.0f + 2.0f * (float)(box[0] - viewport[0]) / (float)viewport[2],
+                -1.0f + 2.0f * (float)(box[1] - viewport[1]) / (float)viewport[3],
+                -1.0f + 2.0f * (float)(box[0] - viewport[0] + box[2]) / (float)viewport[2],
+                -1.0f + 2.0f * (float)(box[1] - viewport[1] + box[3]) / (float)viewport[3]);
+    glUniform1i(uniforms[CPL_UNIFORM_VALUES], 0);
+    glUniform2f(uniforms[CPL_UNIFORM_IMAGE_MIN], image_min[0], image_min[1]);
+    glUniform2f(uniforms[CPL_UNIFORM_IMAGE_SIZE], image_size[0], image_size[1]);
+    glUniform1i(uniforms[CPL_UNIFORM_NEWEST], (GLint)waterfall->newest);
+    glUniform1i(uniforms[CPL_UNIFORM_FILLED], (GLint)waterfall->filled);
+    glUniform2f(uniforms[CPL_UNIFORM_LEVELS], waterfall->levels[0], waterfall->levels[1]);
+    glUniform1i(uniforms[CPL_UNIFORM_DECIBELS], waterfall->decibels ? 1 : 0);
+    glUniform3fv(uniforms[CPL_UNIFORM_COLORMAP], CPL_COLORMAP_STOPS, stops);
+    
+    glDisable(GL_DEPTH_TEST);
+    glBindVertexArray(waterfall->vao);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    glEnable(GL_DEPTH_TEST);
+    
+    glBindVertexArray(0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glUseProgram(renderer->program_id);
+}
+
+// Matrix image: the tiles of the level matching the view's resolution that
+// reach the plot box, uploaded on first use and drawn one after another below
+// the lines
+static void cpl_render_matrix(CPLPlot* plot) {
+    CPLMatrix* matrix = plot->data->matrix;
+    if (!matrix || !matrix->mips) return;
+    
+    CPLRenderer* renderer = plot->figure->renderer;
+    GLuint program = cpl_get_shader_program(renderer->shaders, CPL_SHADER_MATRIX);
+    if (program == 0) return;
+    const GLint* uniforms = renderer->shaders->uniform_locations[CPL_SHADER_MATRIX];
+    
+    CPLViewTransform view;
+    cpl_view_transform(plot, renderer->viewport, &view);
+    int level = cpl_matrix_level(matrix, &view, renderer->viewport);
+    size_t range[4];
+    if (!cpl_matrix_visible_tiles(matrix, level, &view, renderer->visible, range)) return;
+    matrix->frame++;
+    
+    float stops[CPL_COLORMAP_STOPS * 3];
+    cpl_colormap_stops(plot->colormap, stops);
+    int cells = cpl_matrix_tile_cells(&view);
+    
+    glUseProgram(program);
+    cpl_set_view_uniforms(uniforms, &view);
+    cpl_set_origin_uniforms(uniforms, &view, matrix->origin);
+    glUniformMatrix4fv(renderer->shaders->proj_mat_locations[CPL_SHADER_MATRIX], 1, GL_FALSE, renderer->projection);
+    glUniform1i(uniforms[CPL_UNIFORM_TILE], 0);
+    glUniform1i(uniforms[CPL_UNIFORM_CELLS], cells);
+    glUniform1f(uniforms[CPL_UNIFORM_VALUE_SCALE], cpl_matrix_value_scale(matrix));
+    glUniform2f(uniforms[CPL_UNIFORM_LEVELS], matrix->levels[0], matrix->levels[1]);
+    glUniform3fv(uniforms[CPL_UNIFORM_COLORMAP], CPL_COLORMAP_STOPS, stops);
+    
+    if (!matrix->vao) glGenVertexArrays(1, &matrix->vao);
+    glBindVertexArray(matrix->vao);
+    glActiveTexture(GL_TEXTURE0);
+    glDisable(GL_DEPTH_TEST);
+    for (size_t tile_y = range[2]; tile_y < range[3]; tile_y++) {
+        for (size_t tile_x = range[0]; tile_x < range[1]; tile_x++) {
+            GLuint texture = cpl_matrix_tile_texture(matrix, level, tile_x, tile_y);
+            if (!texture) continue;
+            
+            float tile_min[2], tile_size[2], texture_max[2];
+            cpl_matrix_tile_rect(matrix, level, tile_x, tile_y, tile_min, tile_size, texture_max);
+            glBindTexture(GL_TEXTURE_2D, texture);
+            glUniform2f(uniforms[CPL_UNIFORM_TILE_MIN], tile_min[0], tile_min[1]);
+            glUniform2f(uniforms[CPL_UNIFORM_TILE_SIZE], tile_size[0], tile_size[1]);
+            glUniform2f(uniforms[CPL_UNIFORM_TEXTURE_MAX], texture_max[0], texture_max[1]);
+            glDrawArrays(GL_TRIANGLES, 0, cells * cells * 6);
+        }
+    }
+    glEnable(GL_DEPTH_TEST);
+    
+    glBindVertexArray(0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glUseProgram(renderer->program_id);
+}
+
+// Histogram bars: the counts are the only data on the GPU (one float per bin,
+// re-uploaded after counting) and each visible bin is an instance
+static void cpl_render_histogram(CPLPlot* plot) {
+    CPLHistogram* histogram = plot->data->histogram;
+    if (!histogram) return;
+    
+    CPLRenderer* renderer = plot->figure->renderer;
+    GLuint program = cpl_get_shader_program(renderer->shaders, CPL_SHADER_FILLED);
+    if (program == 0) return;
+    const GLint* uniforms = renderer->shaders->uniform_locations[CPL_SHADER_FILLED];
+    
+    if (!histogram->vao) {
+        glGenVertexArrays(1, &histogram->vao);
+        glGenBuffers(1, &histogram->vbo);
+        histogram->dirty = true;
+    }
+    if (histogram->dirty) {
+        float* heights = (float*)malloc(histogram->bins * sizeof(float));
+        if (!heights) {
+            cpl_plot_error("Failed to allocate histogram heights");
+            return;
+        }
+        for (size_t i = 0; i < histogram->bins; i++) heights[i] = (float)histogram->counts[i];
+        glBindBuffer(GL_ARRAY_BUFFER, histogram->vbo);
+        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(histogram->bins * sizeof(float)), heights, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        free(heights);
+        histogram->dirty = false;
+    }
+    
+    CPLViewTransform view;
+    cpl_view_transform(plot, renderer->viewport, &view);
+    size_t first, count;
+    if (!cpl_histogram_visible_bins(histogram, &view, renderer->visible, &first, &count)) return;
+    
+    // The first visible bin is instance 0: its height is the start of the attribute
+    double width = (histogram->range[1] - histogram->range[0]) / (double)histogram->bins;
+    double origin[2] = { histogram->origin, 0.0 };
+    int segments = cpl_histogram_segments(&view);
+    
+    glUseProgram(program);
+    cpl_set_view_uniforms(uniforms, &view);
+    cpl_set_origin_uniforms(uniforms, &view, origin);
+    glUniformMatrix4fv(renderer->shaders->proj_mat_locations[CPL_SHADER_FILLED], 1, GL_FALSE, renderer->projection);
+    glUniform1f(uniforms[CPL_UNIFORM_BIN_MIN],
+                (float)(histogram->range[0] + (double)first * width - histogram->origin));
+    glUniform1f(uniforms[CPL_UNIFORM_BIN_WIDTH], (float)width);
+    glUniform1i(uniforms[CPL_UNIFORM_SEGMENTS], segments);
+    glUniform4f(uniforms[CPL_UNIFORM_FILL_COLOR], histogram->color.r, histogram->color.g,
+                histogram->color.b, histogram->color.a);
+    
+    glBindVertexArray(histogram->vao);
+    glBindBuffer(GL_ARRAY_BUFFER, histogram->vbo);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 1, GL_FLOAT, GL_FALSE, sizeof(float), (void*)(first * sizeof(float)));
+    glVertexAttribDivisor(0, 1);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 2 * (segments + 1), (GLsizei)count);
+    
+    glBindVertexArray(0);
+    glUseProgram(renderer->program_id);
+}
+
+// Contour lines: all polylines of all levels sit in one buffer in the line
+// vertex format, drawn with a single multi-draw. The buffer only grows, so a
+// new field of the same grid is a sub-upload.
+static void cpl_render_contour(CPLPlot* plot) {
+    CPLContour* contour = plot->data->contour;
+    if (!contour) return;
+    
+    CPLRenderer* renderer = plot->figure->renderer;
+    GLuint program = cpl_get_shader_program(renderer->shaders, CPL_SHADER_DATA);
+    if (program == 0) return;
+    const GLint* uniforms = renderer->shaders->uniform_locations[CPL_SHADER_DATA];
+    
+    if (!contour->vao) {
+        glGenVertexArrays(1, &contour->vao);
+        glGenBuffers(1, &contour->vbo);
+        glBindVertexArray(contour->vao);
+        glBindBuffer(GL_ARRAY_BUFFER, contour->vbo);
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(2 * sizeof(float)));
+        glEnableVertexAttribArray(1);
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        contour->buffer_capacity = 0;
+        contour->dirty = true;
+    }
+    if (contour->dirty && contour->num_vertices > 0) {
+        GLsizeiptr size = (GLsizeiptr)(contour->num_vertices * 5 * sizeof(float));
+        glBindBuffer(GL_ARRAY_BUFFER, contour->vbo);
+        if (contour->num_vertices > contour->buffer_capacity) {
+            glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(contour->vertex_capacity * 5 * sizeof(float)), NULL,
+                         GL_DYNAMIC_DRAW);
+            contour->buffer_capacity = contour->vertex_capacity;
+        }
+        glBufferSubData(GL_ARRAY_BUFFER, 0, size, contour->vertices);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        contour->dirty = false;
+    }
+    
+    CPLViewTransform view;
+    cpl_view_transform(plot, renderer->viewport, &view);
+    if (!cpl_contour_visible(contour, &view, renderer->visible)) return;
+    
+    glUseProgram(program);
+    glUniformMatrix4fv(renderer->shaders->proj_mat_locations[CPL_SHADER_DATA], 1, GL_FALSE, renderer->projection);
+    cpl_set_view_uniforms(uniforms, &view);
+    cpl_set_origin_uniforms(uniforms, &view, contour->origin);
+    glLineWidth(plot->line_width);
+    
+    // Contour vertices carry no residuals
+    glBindVertexArray(contour->vao);
+    glVertexAttrib2f(2, 0.0f, 0.0f);
+    glMultiDrawArrays(GL_LINE_STRIP, contour->firsts, contour->counts, (GLsizei)contour->num_polylines);
+    glBindVertexArray(0);
+    glUseProgram(renderer->program_id);
+}
+
+// Quiver arrows: one 16-byte record per arrow, expanded into three segments
+// in the vertex shader. The records are stored coarse to fine, so thinning a
+// view is drawing fewer instances.
+static void cpl_render_quiver(CPLPlot* plot) {
+    CPLQuiver* quiver = plot->data->quiver;
+    if (!quiver) return;
+    
+    CPLRenderer* renderer = plot->figure->renderer;
+    GLuint program = cpl_get_shader_program(renderer->shaders, CPL_SHADER_QUIVER);
+    if (program == 0) return;
+    const GLint* uniforms = renderer->shaders->uniform_locations[CPL_SHADER_QUIVER];
+    
+    if (!quiver->vao) {
+        glGenVertexArrays(1, &quiver->vao);
+        glGenBuffers(1, &quiver->vbo);
+        glBindVertexArray(quiver->vao);
+        glBindBuffer(GL_ARRAY_BUFFER, quiver->vbo);
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(0);
+        glVertexAttribDivisor(0, 1);
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
+        glEnableVertexAttribArray(1);
+        glVertexAttribDivisor(1, 1);
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        quiver->dirty = true;
+    }
+    if (quiver->dirty) {
+        glBindBuffer(GL_ARRAY_BUFFER, quiver->vbo);
+        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(quiver->num_arrows * 4 * sizeof(float)), quiver->records,
+                     GL_STATIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        quiver->dirty = false;
+    }
+    
+    CPLViewTransform view;
+    cpl_view_transform(plot, renderer->viewport, &view);
+    size_t count = cpl_quiver_count(quiver, &view, renderer->viewport, renderer->visible);
+    if (count == 0) return;
+    
+    glUseProgram(program);
+    glUniformMatrix4fv(renderer->shaders->proj_mat_locations[CPL_SHADER_QUIVER], 1, GL_FALSE, renderer->projection);
+    cpl_set_view_uniforms(uniforms, &view);
+    cpl_set_origin_uniforms(uniforms, &view, quiver->origin);
+    glUniform2f(uniforms[CPL_UNIFORM_PIXEL_SIZE], 2.0f / (float)renderer->viewport[2],
+                2.0f / (float)renderer->viewport[3]);
+    glUniform2f(uniforms[CPL_UNIFORM_HEAD], CPL_QUIVER_HEAD, CPL_QUIVER_HEAD_WIDTH);
+    glUniform1f(uniforms[CPL_UNIFORM_STRETCH], cpl_quiver_stretch(quiver, count));
+    glUniform4f(uniforms[CPL_UNIFORM_FILL_COLOR], quiver->color.r, quiver->color.g, quiver->color.b, 1.0f);
+    glLineWidth(plot->line_width);
+    
+    glBindVertexArray(quiver->vao);
+    glDrawArraysInstanced(GL_LINES, 0, 6, (GLsizei)count);
+    glBindVertexArray(0);
+    glUseProgram(renderer->program_id);
+}
+
+// Candlesticks: the view picks one bucket level; its changed records are
+// uploaded from the first stale one, and the visible candles are instances of
+// a body and a wick
+static void cpl_render_candles(CPLPlot* plot) {
+    CPLCandles* candles = plot->data->candles;
+    if (!candles) return;
+    
+    CPLRenderer* renderer = plot->figure->renderer;
+    GLuint program = cpl_get_shader_program(renderer->shaders, CPL_SHADER_CANDLES);
+    if (program == 0) return;
+    const GLint* uniforms = renderer->shaders->uniform_locations[CPL_SHADER_CANDLES];
+    
+    CPLViewTransform view;
+    cpl_view_transform(plot, renderer->viewport, &view);
+    int index;
+    size_t first, count;
+    if (!cpl_candles_view(candles, &view, renderer->viewport, renderer->visible, &index, &first, &count)) return;
+    
+    CPLCandleLevel* level = &candles->levels[index];
+    if (!level->vao) {
+        glGenVertexArrays(1, &level->vao);
+        glGenBuffers(1, &level->vbo);
+        level->buffer_capacity = 0;
+    }
+    if (level->count > level->buffer_capacity) {
+        // The buffer grows with the level's allocation and is filled anew
+        glBindBuffer(GL_ARRAY_BUFFER, level->vbo);
+        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(level->capacity * 6 * sizeof(float)), NULL, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        level->buffer_capacity = level->capacity;
+        level->stale = 0;
+    }
+    if (level->stale < level->count) {
+        size_t changed = level->count - level->stale;
+        float* records = (float*)malloc(changed * 6 * sizeof(float));
+        if (!records) {
+            cpl_plot_error("Failed to allocate candle records");
+            return;
+        }
+        for (size_t i = 0; i < changed; i++) cpl_candles_record(candles, index, level->stale + i, records + i * 6);
+        glBindBuffer(GL_ARRAY_BUFFER, level->vbo);
+        glBufferSubData(GL_ARRAY_BUFFER, (GLintptr)(level->stale * 6 * sizeof(float)),
+                        (GLsizeiptr)(changed * 6 * sizeof(float)), records);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        free(records);
+        level->stale = level->count;
+    }
+    
+    glUseProgram(program);
+    glUniformMatrix4fv(renderer->shaders->proj_mat_locations[CPL_SHADER_CANDLES], 1, GL_FALSE, renderer->projection);
+    cpl_set_view_uniforms(uniforms, &view);
+    cpl_set_origin_uniforms(uniforms, &view, candles->origin);
+    glUniform2f(uniforms[CPL_UNIFORM_PIXEL_SIZE], 2.0f / (float)renderer->viewport[2],
+                2.0f / (float)renderer->viewport[3]);
+    glUniform1f(uniforms[CPL_UNIFORM_BUCKET], (float)level->size);
+    glUniform1f(uniforms[CPL_UNIFORM_GAP], CPL_CANDLE_GAP);
+    glUniform3f(uniforms[CPL_UNIFORM_UP_COLOR], candles->up.r, candles->up.g, candles->up.b);
+    glUniform3f(uniforms[CPL_UNIFORM_DOWN_COLOR], candles->down.r, candles->down.g, candles->down.b);
+    
+    // The first visible candle is instance 0: its record is the start of the attributes
+    glBindVertexArray(level->vao);
+    glBindBuffer(GL_ARRAY_BUFFER, level->vbo);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(first * 6 * sizeof(float)));
+    glEnableVertexAttribArray(0);
+    glVertexAttribDivisor(0, 1);
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)((first * 6 + 2) * sizeof(float)));
+    glEnableVertexAttribArray(1);
+    glVertexAttribDivisor(1, 1);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glDrawArraysInstanced(GL_TRIANGLES, 0, 12, (GLsizei)count);
+    
+    glBindVertexArray(0);
+    glUseProgram(renderer->program_id);
+}
+
+// Count or weight grid drawn as one quad over the plot box: normalized and
+// colormapped per pixel in the density shader
+static void cpl_draw_density_grid(CPLRenderer* renderer, CPLDensity* density, CPLDensityNorm norm,
+                                  CPLColormap colormap) {
+    GLuint program = cpl_get_shader_program(renderer->shaders, CPL_SHADER_DENSITY);
+    if (program == 0) return;
+    const GLint* uniforms = renderer->shaders->uniform_locations[CPL_SHADER_DENSITY];
+    
+    float stops[CPL_COLORMAP_STOPS * 3];
+    cpl_colormap_stops(colormap, stops);
+    
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, density->texture);
+    glUseProgram(program);
+    glUniformMatrix4fv(renderer->shaders->proj_mat_locations[CPL_SHADER_DENSITY], 1, GL_FALSE, renderer->projection);
+    glUniform4f(uniforms[CPL_UNIFORM_RECT], density->rect[0], density->rect[1], density->rect[2],
+                density->rect[3]);
+    glUniform1i(uniforms[CPL_UNIFORM_COUNTS], 0);
+    glUniform1i(uniforms[CPL_UNIFORM_NORM], (GLint)norm);
+    glUniform1f(uniforms[CPL_UNIFORM_MAX_COUNT], density->max_count);
+    glUniform1fv(uniforms[CPL_UNIFORM_LEVELS], CPL_DENSITY_LEVELS, density->levels);
+    glUniform1i(uniforms[CPL_UNIFORM_LEVEL_BASE], density->level_base);
+    glUniform3fv(uniforms[CPL_UNIFORM_COLORMAP], CPL_COLORMAP_STOPS, stops);
+    
+    // Drawn in order above the lines
+    glDisable(GL_DEPTH_TEST);
+    glBindVertexArray(density->vao);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    glEnable(GL_DEPTH_TEST);
+    
+    glBindVertexArray(0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glUseProgram(renderer->program_id);
+}
+
+// Ranges, scales and the polar mapping of the data transform, for the
+// current program's cached uniform locations
+static void cpl_set_view_uniforms(const GLint* uniforms, const CPLViewTransform* view) {
+    glUniform2i(uniforms[CPL_UNIFORM_SCALE], (GLint)view->scale[0], (GLint)view->scale[1]);
+    glUniform1i(uniforms[CPL_UNIFORM_POLAR], view->polar ? 1 : 0);
+    glUniform2f(uniforms[CPL_UNIFORM_AXIS_MIN], (float)view->min[0], (float)view->min[1]);
+    glUniform2f(uniforms[CPL_UNIFORM_THRESHOLD], (float)view->threshold[0], (float)view->threshold[1]);
+    glUniform2f(uniforms[CPL_UNIFORM_FACTOR], (float)view->factor[0], (float)view->factor[1]);
+    glUniform2f(uniforms[CPL_UNIFORM_BOX_MIN], view->box_min[0], view->box_min[1]);
+    glUniform2f(uniforms[CPL_UNIFORM_POLAR_RADIUS], view->radius[0], view->radius[1]);
+}
+
+static void cpl_set_origin_uniforms(const GLint* uniforms, const CPLViewTransform* view, const double* origin) {
+    // The origin's distance from a linear axis minimum is taken in double
+    // precision and passed as a hi/lo pair
+    float shift_high[2], shift_low[2];
+    cpl_split_double(origin[0] - view->min[0], &shift_high[0], &shift_low[0]);
+    cpl_split_double(origin[1] - view->min[1], &shift_high[1], &shift_low[1]);
+    glUniform2f(uniforms[CPL_UNIFORM_ORIGIN], (float)origin[0], (float)origin[1]);
+    glUniform2f(uniforms[CPL_UNIFORM_SHIFT_HIGH], shift_high[0], shift_high[1]);
+    glUniform2f(uniforms[CPL_UNIFORM_SHIFT_LOW], shift_low[0], shift_low[1]);
+}
+
+// Vertices [first, first + count) of a line that can reach the x-range
+// [min_x, max_x] (offsets from the line's origin, see cpl_view_window): the whole
+// line unless its x is monotonic, otherwise the samples inside plus one
+// neighbour on each side for the crossing segments
+void cpl_line_visible_range(const CPLLine* line, float min_x, float max_x, size_t* first, size_t* count) {
+    *first = 0;
+    *count = line->num_vertices;
+    if (!line->monotonic_x || line->num_vertices < 2) return;
+    
+    size_t begin = cpl_offset_search(line->vertices, 5, line->num_vertices, min_x, false);
+    size_t end = cpl_offset_search(line->vertices, 5, line->num_vertices, max_x, true);
+    
+    if (begin > 0) begin--;
+    if (end < line->num_vertices) end++;
+    *first = begin;
+    *count = end - begin;
+}
+
+// Samples [first, first + count) of persistence traces that can reach the
+// x-range [min_x, max_x], like cpl_line_visible_range for their shared x offsets
+void cpl_traces_visible_range(const CPLTraces* traces, float min_x, float max_x, size_t* first, size_t* count) {
+    *first = 0;
+    *count = traces->samples;
+    if (!traces->monotonic_x) return;
+    
+    size_t begin = cpl_offset_search(traces->x, 1, traces->samples, min_x, false);
+    size_t end = cpl_offset_search(traces->x, 1, traces->samples, max_x, true);
+    
+    if (begin > 0) begin--;
+    if (end < traces->samples) end++;
+    *first = begin;
+    *count = end - begin;
+}
+
+// First of `count` sorted x offsets (`stride` floats apart) that is at least
+// `x` (past_equal: greater than `x`)
+static size_t cpl_offset_search(const float* values, size_t stride, size_t count, float x, bool past_equal) {
+    size_t low = 0;
+    size_t high = count;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        float value = values[mid * stride];
+        if (value < x || (past_equal && value == x)) {
+            low = mid + 1;
+        } else {
+            high = mid;
         }
     }
+    return low;
 }
 
 static void cpl_plot_error(const char* message) {
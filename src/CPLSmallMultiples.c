@@ -0,0 +1,316 @@
+#include "CPLPlot.h"
+#include "utils/CPLRenderer.h"
+#include "utils/CPLShader.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <GL/glew.h>
+
+// Internal function declarations
+static CPLSmallMultiples* cpl_get_multiples(CPLPlot* plot, size_t index);
+static void cpl_layout_tiles(CPLSmallMultiples* multiples);
+static size_t cpl_resample_series(const double* y, size_t n_points, float* out, size_t samples);
+static void cpl_upload_small_multiples(CPLSmallMultiples* multiples);
+static void cpl_plot_error(const char* message);
+
+// Constants
+#define CPL_TILE_GAP 0.08f        // Gap between tiles as a fraction of the cell size
+
+// Internal functions used by other modules
+void cpl_render_small_multiples(CPLPlot* plot);
+void cpl_free_small_multiples(CPLSmallMultiples* multiples);
+size_t cpl_small_multiple_vertices(const CPLSmallMultiples* multiples, size_t index, bool frame, float* vertices);
+
+// Small multiples API
+CPLPlot* cpl_add_small_multiples(CPLFigure* fig, size_t rows, size_t cols, size_t samples) {
+    if (!fig || rows == 0 || cols == 0 || samples < 2) {
+        cpl_plot_error("Invalid small multiples dimensions");
+        return NULL;
+    }
+    
+    CPLSmallMultiples* multiples = (CPLSmallMultiples*)calloc(1, sizeof(CPLSmallMultiples));
+    if (!multiples) {
+        cpl_plot_error("Failed to allocate small multiples");
+        return NULL;
+    }
+    
+    size_t num_tiles = rows * cols;
+    multiples->rows = rows;
+    multiples->cols = cols;
+    multiples->samples = samples;
+    multiples->values = (float*)calloc(num_tiles * samples, sizeof(float));
+    multiples->tiles = (float*)calloc(num_tiles * CPL_TILE_FLOATS, sizeof(float));
+    multiples->auto_range = (bool*)malloc(num_tiles * sizeof(bool));
+    
+    if (!multiples->values || !multiples->tiles || !multiples->auto_range) {
+        cpl_plot_error("Failed to allocate small multiples storage");
+        cpl_free_small_multiples(multiples);
+        return NULL;
+    }
+    
+    // The plot is only added once its storage exists, so failures leave the figure untouched
+    CPLPlot* plot = cpl_add_plot(fig);
+    if (!plot) {
+        cpl_free_small_multiples(multiples);
+        return NULL;
+    }
+    
+    // Tiles draw their own frames; the regular box and grid are not used
+    plot->show_grid = false;
+    plot->show_axes = false;
+    plot->line_width = 1.0f;
+    
+    for (size_t i = 0; i < num_tiles; i++) {
+        multiples->auto_range[i] = true;
+        multiples->tiles[i * CPL_TILE_FLOATS + 5] = 1.0f;  // Default range [0, 1]
+    }
+    cpl_layout_tiles(multiples);
+    
+    // Buffer textures and the attributeless VAO, in the figure's context (CPU
+    // backends draw from the tile records)
+    if (cpl_renderer_has_gl(fig->renderer)) {
+        cpl_make_renderer_current(fig->renderer);
+        glGenVertexArrays(1, &multiples->vao);
+        glGenBuffers(1, &multiples->values_buffer);
+        glGenBuffers(1, &multiples->tiles_buffer);
+        glGenTextures(1, &multiples->values_texture);
+        glGenTextures(1, &multiples->tiles_texture);
+    }
+    multiples->dirty = true;
+    
+    plot->data->multiples = multiples;
+    return plot;
+}
+
+void cpl_set_small_multiple(CPLPlot* plot, size_t index, const double* y, size_t n_points, Color color) {
+    CPLSmallMultiples* multiples = cpl_get_multiples(plot, index);
+    if (!multiples) return;
+    
+    if (!y || n_points == 0) {
+        cpl_plot_error("Invalid small multiple data");
+        return;
+    }
+    
+    float* values = multiples->values + index * multiples->samples;
+    size_t count = cpl_resample_series(y, n_points, values, multiples->samples);
+    
+    float* tile = multiples->tiles + index * CPL_TILE_FLOATS;
+    if (multiples->auto_range[index]) {
+        float min = values[0], max = values[0];
+        for (size_t i = 1; i < count; i++) {
+            if (values[i] < min) min = values[i];
+            if (values[i] > max) max = values[i];
+        }
+        if (max <= min) {
+            min -= 0.5f;
+            max += 0.5f;
+        }
+        tile[4] = min;
+        tile[5] = max;
+    }
+    tile[6] = (float)count;
+    
+    tile[8] = color.r;
+    tile[9] = color.g;
+    tile[10] = color.b;
+    tile[11] = color.a;
+    
+    multiples->dirty = true;
+}
+
+void cpl_set_small_multiple_range(CPLPlot* plot, size_t index, double min, double max) {
+    CPLSmallMultiples* multiples = cpl_get_multiples(plot, index);
+    if (!multiples) return;
+    
+    if (min >= max) {
+        cpl_plot_error("Invalid small multiple range");
+        return;
+    }
+    
+    float* tile = multiples->tiles + index * CPL_TILE_FLOATS;
+    tile[4] = (float)min;
+    tile[5] = (float)max;
+    multiples->auto_range[index] = false;
+    multiples->dirty = true;
+}
+
+// Rendering (called from cpl_render_plot)
+void cpl_render_small_multiples(CPLPlot* plot) {
+    if (!plot || !plot->data || !plot->data->multiples) return;
+    
+    CPLSmallMultiples* multiples = plot->data->multiples;
+    CPLRenderer* renderer = plot->figure->renderer;
+    GLuint program = cpl_get_shader_program(renderer->shaders, CPL_SHADER_MULTIPLES);
+    if (program == 0) return;
+    const GLint* uniforms = renderer->shaders->uniform_locations[CPL_SHADER_MULTIPLES];
+    
+    if (multiples->dirty) {
+        cpl_upload_small_multiples(multiples);
+    }
+    
+    GLsizei num_tiles = (GLsizei)(multiples->rows * multiples->cols);
+    
+    // Same projection as the line program (a sub-rectangle for tiled exports)
+    glUseProgram(program);
+    glUniformMatrix4fv(renderer->shaders->proj_mat_locations[CPL_SHADER_MULTIPLES], 1, GL_FALSE, renderer->projection);
+    glUniform1i(uniforms[CPL_UNIFORM_VALUES], 0);
+    glUniform1i(uniforms[CPL_UNIFORM_TILES], 1);
+    glUniform1i(uniforms[CPL_UNIFORM_SAMPLES], (GLint)multiples->samples);
+    glUniform3f(uniforms[CPL_UNIFORM_FRAME_COLOR], 0.7f, 0.7f, 0.7f);
+    
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_BUFFER, multiples->values_texture);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_BUFFER, multiples->tiles_texture);
+    glBindVertexArray(multiples->vao);
+    
+    // Series: one line strip per instance
+    glLineWidth(plot->line_width);
+    glUniform1i(uniforms[CPL_UNIFORM_MODE], 0);
+    glDrawArraysInstanced(GL_LINE_STRIP, 0, (GLsizei)multiples->samples, num_tiles);
+    
+    // Tile frames
+    glLineWidth(plot->box_line_width);
+    glUniform1i(uniforms[CPL_UNIFORM_MODE], 1);
+    glDrawArraysInstanced(GL_LINE_LOOP, 0, 4, num_tiles);
+    
+    glBindVertexArray(0);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    
+    // Restore the basic program used by the rest of the frame
+    glUseProgram(renderer->program_id);
+}
+
+// Tile `index` as line vertices (plot NDC x, y, then r, g, b), placed exactly as
+// the vertex shader places them: the series (up to `samples` vertices) or, with
+// `frame`, the four corners of the tile frame. Returns the vertex count.
+size_t cpl_small_multiple_vertices(const CPLSmallMultiples* multiples, size_t index, bool frame, float* vertices) {
+    const float* tile = multiples->tiles + index * CPL_TILE_FLOATS;
+    if (frame) {
+        static const float corners[4][2] = { { 0.0f, 0.0f }, { 1.0f, 0.0f }, { 1.0f, 1.0f }, { 0.0f, 1.0f } };
+        for (size_t i = 0; i < 4; i++) {
+            float* vertex = vertices + i * 5;
+            vertex[0] = tile[0] + (tile[2] - tile[0]) * corners[i][0];
+            vertex[1] = tile[1] + (tile[3] - tile[1]) * corners[i][1];
+            vertex[2] = vertex[3] = vertex[4] = 0.7f;
+        }
+        return 4;
+    }
+    
+    size_t count = (size_t)tile[6];
+    const float* values = multiples->values + index * multiples->samples;
+    float span = tile[5] - tile[4] > 1e-30f ? tile[5] - tile[4] : 1e-30f;
+    for (size_t i = 0; i < count; i++) {
+        float t_x = count > 1 ? (float)i / (float)(count - 1) : 0.5f;
+        float t_y = (values[i] - tile[4]) / span;
+        t_y = t_y < 0.0f ? 0.0f : (t_y > 1.0f ? 1.0f : t_y);
+        float* vertex = vertices + i * 5;
+        vertex[0] = tile[0] + (tile[2] - tile[0]) * t_x;
+        vertex[1] = tile[1] + (tile[3] - tile[1]) * t_y;
+        vertex[2] = tile[8];
+        vertex[3] = tile[9];
+        vertex[4] = tile[10];
+    }
+    return count;
+}
+
+void cpl_free_small_multiples(CPLSmallMultiples* multiples) {
+    if (!multiples) return;
+    
+    if (multiples->values_texture) glDeleteTextures(1, &multiples->values_texture);
+    if (multiples->tiles_texture) glDeleteTextures(1, &multiples->tiles_texture);
+    if (multiples->values_buffer) glDeleteBuffers(1, &multiples->values_buffer);
+    if (multiples->tiles_buffer) glDeleteBuffers(1, &multiples->tiles_buffer);
+    if (multiples->vao) glDeleteVertexArrays(1, &multiples->vao);
+    
+    free(multiples->values);
+    free(multiples->tiles);
+    free(multiples->auto_range);
+    free(multiples);
+}
+
+// Internal helper functions
+static CPLSmallMultiples* cpl_get_multiples(CPLPlot* plot, size_t index) {
+    if (!plot || !plot->data || !plot->data->multiples) {
+        cpl_plot_error("Plot is not a small multiples plot");
+        return NULL;
+    }
+    
+    CPLSmallMultiples* multiples = plot->data->multiples;
+    if (index >= multiples->rows * multiples->cols) {
+        cpl_plot_error("Small multiple index out of range");
+        return NULL;
+    }
+    return multiples;
+}
+
+static void cpl_layout_tiles(CPLSmallMultiples* multiples) {
+    float cell_width = 2.0f / (float)multiples->cols;
+    float cell_height = 2.0f / (float)multiples->rows;
+    float gap_x = cell_width * CPL_TILE_GAP * 0.5f;
+    float gap_y = cell_height * CPL_TILE_GAP * 0.5f;
+    
+    // Row 0 is at the top, matching cpl_add_subplots
+    for (size_t row = 0; row < multiples->rows; row++) {
+        for (size_t col = 0; col < multiples->cols; col++) {
+            float* tile = multiples->tiles + (row * multiples->cols + col) * CPL_TILE_FLOATS;
+            tile[0] = -1.0f + col * cell_width + gap_x;
+            tile[1] = 1.0f - (row + 1) * cell_height + gap_y;
+            tile[2] = -1.0f + (col + 1) * cell_width - gap_x;
+            tile[3] = 1.0f - row * cell_height - gap_y;
+        }
+    }
+}
+
+static size_t cpl_resample_series(const double* y, size_t n_points, float* out, size_t samples) {
+    if (n_points <= samples) {
+        for (size_t i = 0; i < n_points; i++) {
+            out[i] = (float)y[i];
+        }
+        return n_points;
+    }
+    
+    // Min/max decimation keeps spikes visible: each bucket emits its extremes in order
+    size_t buckets = samples / 2;
+    for (size_t b = 0; b < buckets; b++) {
+        size_t start = b * n_points / buckets;
+        size_t end = (b + 1) * n_points / buckets;
+        size_t min_index = start, max_index = start;
+        
+        for (size_t i = start + 1; i < end; i++) {
+            if (y[i] < y[min_index]) min_index = i;
+            if (y[i] > y[max_index]) max_index = i;
+        }
+        
+        size_t first = min_index < max_index ? min_index : max_index;
+        size_t second = min_index < max_index ? max_index : min_index;
+        out[b * 2 + 0] = (float)y[first];
+        out[b * 2 + 1] = (float)y[second];
+    }
+    return buckets * 2;
+}
+
+static void cpl_upload_small_multiples(CPLSmallMultiples* multiples) {
+    size_t num_tiles = multiples->rows * multiples->cols;
+    
+    glBindBuffer(GL_TEXTURE_BUFFER, multiples->values_buffer);
+    glBufferData(GL_TEXTURE_BUFFER, num_tiles * multiples->samples * sizeof(float), multiples->values, GL_DYNAMIC_DRAW);
+    glBindTexture(GL_TEXTURE_BUFFER, multiples->values_texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_R32F, multiples->values_buffer);
+    
+    glBindBuffer(GL_TEXTURE_BUFFER, multiples->tiles_buffer);
+    glBufferData(GL_TEXTURE_BUFFER, num_tiles * CPL_TILE_FLOATS * sizeof(float), multiples->tiles, GL_DYNAMIC_DRAW);
+    glBindTexture(GL_TEXTURE_BUFFER, multiples->tiles_texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, multiples->tiles_buffer);
+    
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    multiples->dirty = false;
+}
+
+static void cpl_plot_error(const char* message) {
+    fprintf(stderr, "CPlotLib Error: %s\n", message);
+}
@@ -0,0 +1,304 @@
+#include "CPLCandles.h"
+#include "CPLUtils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <GL/glew.h>
+
+// Constants
+#define CPL_CANDLE_MIN_CAPACITY 64
+#define CPL_CANDLE_WEEK_ANCHOR (4.0 * 86400.0)  // 1970-01-05, a Monday
+
+static const double cpl_candle_sizes[CPL_CANDLE_LEVELS] = {
+    1.0, 5.0, 15.0, 60.0, 300.0, 900.0, 3600.0, 14400.0, 86400.0, 604800.0
+};
+
+static void cpl_candles_error(const char* message);
+
+// Start of the bucket of `level` holding `time`
+static double cpl_candle_start(int level, double time) {
+    double size = cpl_candle_sizes[level];
+    double anchor = level == CPL_CANDLE_LEVELS - 1 ? CPL_CANDLE_WEEK_ANCHOR : 0.0;
+    return floor((time - anchor) / size) * size + anchor;
+}
+
+// First candle of `level` starting at or after `time` (past_equal: after it)
+static size_t cpl_candle_search(const CPLCandleLevel* level, double time, bool past_equal) {
+    size_t low = 0, high = level->count;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        double start = level->candles[mid].time;
+        if (start < time || (past_equal && start == time)) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+static bool cpl_candle_reserve(CPLCandleLevel* level, size_t count) {
+    if (count <= level->capacity) return true;
+
+    size_t capacity = level->capacity < CPL_CANDLE_MIN_CAPACITY ? CPL_CANDLE_MIN_CAPACITY : level->capacity;
+    while (capacity < count) capacity *= 2;
+    CPLCandle* candles = (CPLCandle*)realloc(level->candles, capacity * sizeof(CPLCandle));
+    if (!candles) {
+        cpl_candles_error("Failed to allocate candles");
+        return false;
+    }
+    level->candles = candles;
+    level->capacity = capacity;
+    return true;
+}
+
+// Adds the ticks or finer bucket `part` to `candle`: open and close follow the
+// earliest and latest times
+static void cpl_candle_merge(CPLCandle* candle, const CPLCandle* part) {
+    if (part->high > candle->high) candle->high = part->high;
+    if (part->low < candle->low) candle->low = part->low;
+    candle->volume += part->volume;
+    if (part->first < candle->first) {
+        candle->first = part->first;
+        candle->open = part->open;
+    }
+    if (part->last >= candle->last) {
+        candle->last = part->last;
+        candle->close = part->close;
+    }
+}
+
+void cpl_candles_init(CPLCandles* candles) {
+    for (int k = 0; k < CPL_CANDLE_LEVELS; k++) {
+        candles->levels[k].size = cpl_candle_sizes[k];
+    }
+}
+
+bool cpl_candles_add(CPLCandles* candles, const double* time, const double* price, const double* volume, size_t n) {
+    CPLCandleLevel* base = &candles->levels[0];
+    double from = INFINITY;      // Earliest bucket the ticks touched
+    bool ok = true;
+
+    for (size_t i = 0; i < n; i++) {
+        if (!cpl_is_finite(time[i]) || !cpl_is_finite(price[i])) continue;
+
+        CPLCandle tick;
+        tick.time = cpl_candle_start(0, time[i]);
+        tick.open = tick.high = tick.low = tick.close = price[i];
+        tick.volume = volume && cpl_is_finite(volume[i]) ? volume[i] : 0.0;
+        tick.first = tick.last = time[i];
+
+        // Streaming ticks land in the last bucket or a new one after it
+        size_t index = base->count;
+        if (base->count > 0 && base->candles[base->count - 1].time >= tick.time) {
+            index = base->count - 1;
+            if (base->candles[index].time != tick.time) index = cpl_candle_search(base, tick.time, false);
+        }
+        if (index < base->count && base->candles[index].time == tick.time) {
+            cpl_candle_merge(&base->candles[index], &tick);
+        } else {
+            if (!cpl_candle_reserve(base, base->count + 1)) {
+                ok = false;
+                break;
+            }
+            memmove(base->candles + index + 1, base->candles + index, (base->count - index) * sizeof(CPLCandle));
+            base->candles[index] = tick;
+            base->count++;
+        }
+
+        if (index < base->stale) base->stale = index;
+        if (tick.time < from) from = tick.time;
+        if (!candles->has_origin) {
+            candles->origin[0] = tick.time;
+            candles->origin[1] = price[i];
+            candles->has_origin = true;
+        }
+    }
+    if (!cpl_is_finite(from)) return ok;
+
+    // Coarser buckets from the one holding `from` on are rebuilt from the level below
+    for (int k = 1; k < CPL_CANDLE_LEVELS; k++) {
+        CPLCandleLevel* level = &candles->levels[k];
+        const CPLCandleLevel* fine = &candles->levels[k - 1];
+        from = cpl_candle_start(k, from);
+
+        level->count = cpl_candle_search(level, from, false);
+        if (level->count < level->stale) level->stale = level->count;
+        for (size_t j = cpl_candle_search(fine, from, false); j < fine->count; j++) {
+            const CPLCandle* part = &fine->candles[j];
+            double start = cpl_candle_start(k, part->time);
+            if (level->count > 0 && level->candles[level->count - 1].time == start) {
+                cpl_candle_merge(&level->candles[level->count - 1], part);
+                continue;
+            }
+            if (!cpl_candle_reserve(level, level->count + 1)) return false;
+            CPLCandle* candle = &level->candles[level->count++];
+            *candle = *part;
+            candle->time = start;
+        }
+    }
+    return ok;
+}
+
+bool cpl_candles_view(const CPLCandles* candles, const CPLViewTransform* view, const int* viewport,
+                      const float* ndc_rect, int* level, size_t* first, size_t* count) {
+    const CPLCandleLevel* base = &candles->levels[0];
+    if (base->count == 0) return false;
+
+    // Visible time range; polar views and degenerate mappings see all candles
+    double range[2] = { base->candles[0].time, base->candles[base->count - 1].time + base->size };
+    bool all = view->polar;
+    if (!all) {
+        double edges[2][2];
+        for (int side = 0; side < 2; side++) {
+            double ndc[2] = { ndc_rect[2 * side], 0.5 * (ndc_rect[1] + ndc_rect[3]) };
+            cpl_view_unmap(view, ndc, edges[side]);
+        }
+        if (cpl_is_finite(edges[0][0]) && cpl_is_finite(edges[1][0]) && edges[1][0] > edges[0][0]) {
+            range[0] = edges[0][0];
+            range[1] = edges[1][0];
+        } else {
+            all = true;
+        }
+    }
+
+    // Finest buckets at least CPL_CANDLE_MIN_PIXELS wide on average
+    double pixels = (double)(ndc_rect[2] - ndc_rect[0]) * 0.5 * viewport[2] / (range[1] - range[0]);
+    int k = 0;
+    while (k < CPL_CANDLE_LEVELS - 1 && !(candles->levels[k].size * pixels >= CPL_CANDLE_MIN_PIXELS)) k++;
+    *level = k;
+
+    const CPLCandleLevel* chosen = &candles->levels[k];
+    if (all) {
+        *first = 0;
+        *count = chosen->count;
+    } else {
+        *first = cpl_candle_search(chosen, range[0] - chosen->size, true);
+        *count = cpl_candle_search(chosen, range[1], true) - *first;
+    }
+    return *count > 0;
+}
+
+void cpl_candles_record(const CPLCandles* candles, int level, size_t index, float* record) {
+    const CPLCandle* candle = &candles->levels[level].candles[index];
+    cpl_split_double(candle->time - candles->origin[0], &record[0], &record[1]);
+    record[2] = (float)(candle->open - candles->origin[1]);
+    record[3] = (float)(candle->high - candles->origin[1]);
+    record[4] = (float)(candle->low - candles->origin[1]);
+    record[5] = (float)(candle->close - candles->origin[1]);
+}
+
+bool cpl_candles_rects(const CPLCandles* candles, int level, size_t index, const CPLViewTransform* view,
+                       const int* viewport, float* rects) {
+    float record[6];
+    cpl_candles_record(candles, level, index, record);
+    float size = (float)candles->levels[level].size;
+    float pixel[2] = { 2.0f / (float)viewport[2], 2.0f / (float)viewport[3] };
+
+    // Body: open to close across the bucket less the gaps, at least a pixel each way
+    float vertex[2] = { record[0], record[2] };
+    float low[2] = { record[1] + CPL_CANDLE_GAP * size, 0.0f };
+    float a[2], b[2];
+    cpl_view_map(view, candles->origin, vertex, low, a);
+    vertex[1] = record[5];
+    low[0] = record[1] + (1.0f - CPL_CANDLE_GAP) * size;
+    cpl_view_map(view, candles->origin, vertex, low, b);
+    for (int axis = 0; axis < 2; axis++) {
+        float lo = fminf(a[axis], b[axis]);
+        float hi = fmaxf(a[axis], b[axis]);
+        float grow = fmaxf(pixel[axis] - (hi - lo), 0.0f) * 0.5f;
+        rects[axis] = lo - grow;
+        rects[2 + axis] = hi + grow;
+    }
+
+    // Wick: low to high through the bucket's middle, a pixel wide
+    vertex[1] = record[4];
+    low[0] = record[1] + 0.5f * size;
+    cpl_view_map(view, candles->origin, vertex, low, a);
+    vertex[1] = record[3];
+    cpl_view_map(view, candles->origin, vertex, low, b);
+    rects[4] = a[0] - 0.5f * pixel[0];
+    rects[5] = fminf(a[1], b[1]);
+    rects[6] = a[0] + 0.5f * pixel[0];
+    rects[7] = fmaxf(a[1], b[1]);
+
+    for (int k = 0; k < 8; k++) {
+        if (!cpl_is_finitef(rects[k])) return false;
+    }
+    return true;
+}
+
+bool cpl_candles_colors(const CPLPlot* plot, const int* viewport, const int* box, const int* cells,
+                        unsigned char* pixels, ptrdiff_t stride) {
+    const CPLCandles* candles = plot && plot->data ? plot->data->candles : NULL;
+    if (!candles || cells[2] <= 0 || cells[3] <= 0) return false;
+
+    for (int y = 0; y < cells[3]; y++) memset(pixels + (ptrdiff_t)y * stride, 0, (size_t)cells[2] * 4);
+
+    // The image's pixels in NDC of the viewport, a pixel wider on every side
+    float scale[2], shift[2], ndc_rect[4];
+    for (int axis = 0; axis < 2; axis++) {
+        scale[axis] = 0.5f * (float)viewport[2 + axis];
+        shift[axis] = (float)(viewport[axis] - box[axis] - cells[axis]);
+        ndc_rect[axis] = (float)(box[axis] + cells[axis] - 1 - viewport[axis]) / scale[axis] - 1.0f;
+        ndc_rect[2 + axis] = (float)(box[axis] + cells[axis] + cells[2 + axis] + 1 - viewport[axis]) / scale[axis] - 1.0f;
+    }
+
+    CPLViewTransform view;
+    cpl_view_transform(plot, viewport, &view);
+    int level;
+    size_t first, count;
+    if (!cpl_candles_view(candles, &view, viewport, ndc_rect, &level, &first, &count)) return true;
+
+    unsigned char rgba[2][4];
+    const Color* colors[2] = { &candles->up, &candles->down };
+    for (int c = 0; c < 2; c++) {
+        rgba[c][0] = (unsigned char)(fminf(fmaxf(colors[c]->r, 0.0f), 1.0f) * 255.0f + 0.5f);
+        rgba[c][1] = (unsigned char)(fminf(fmaxf(colors[c]->g, 0.0f), 1.0f) * 255.0f + 0.5f);
+        rgba[c][2] = (unsigned char)(fminf(fmaxf(colors[c]->b, 0.0f), 1.0f) * 255.0f + 0.5f);
+        rgba[c][3] = 255;
+    }
+
+    // Rectangles cover the pixels whose centres they contain, as GL fills them;
+    // later candles paint over earlier ones
+    const CPLCandleLevel* chosen = &candles->levels[level];
+    for (size_t i = first; i < first + count; i++) {
+        float rects[8];
+        if (!cpl_candles_rects(candles, level, i, &view, viewport, rects)) continue;
+        const CPLCandle* candle = &chosen->candles[i];
+        const unsigned char* color = rgba[candle->close >= candle->open ? 0 : 1];
+
+        for (int r = 0; r < 2; r++) {
+            const float* rect = rects + 4 * r;
+            int range[4];
+            for (int k = 0; k < 4; k++) {
+                float edge = (rect[k] + 1.0f) * scale[k % 2] + shift[k % 2] - 0.5f;
+                float limit = (float)cells[2 + k % 2];
+                range[k] = (int)ceilf(fminf(fmaxf(edge, 0.0f), limit));
+            }
+            for (int y = range[1]; y < range[3]; y++) {
+                unsigned char* out = pixels + (ptrdiff_t)y * stride + (ptrdiff_t)range[0] * 4;
+                for (int x = range[0]; x < range[2]; x++, out += 4) memcpy(out, color, 4);
+            }
+        }
+    }
+    return true;
+}
+
+void cpl_free_candles(CPLCandles* candles) {
+    if (!candles) return;
+
+    for (int k = 0; k < CPL_CANDLE_LEVELS; k++) {
+        CPLCandleLevel* level = &candles->levels[k];
+        if (level->vao) glDeleteVertexArrays(1, &level->vao);
+        if (level->vbo) glDeleteBuffers(1, &level->vbo);
+        free(level->candles);
+    }
+    free(candles);
+}
+
+static void cpl_candles_error(const char* message) {
+    fprintf(stderr, "CPlotLib Error: %s\n", message);
+}
@@ -0,0 +1,50 @@
+#ifndef CPL_CANDLES_H
+#define CPL_CANDLES_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include "CPLPlot.h"
+#include "CPLTransform.h"
+
+// Constants
+#define CPL_CANDLE_MIN_PIXELS 4.0f       // Views use the finest buckets at least this wide on screen
+#define CPL_CANDLE_GAP 0.1f              // Space on each side of a body, relative to its bucket
+
+// Ticks only go into the 1 s buckets; every coarser level is re-aggregated
+// from the level below it, from the first bucket the ticks touched on. The
+// sizes nest, so streaming ticks re-aggregate a few buckets per level. GPU
+// records are the bucket start as a hi/lo pair (timestamps need more than a
+// float) and the four prices, relative to the chart's origin.
+
+// Sets up the bucket sizes of empty candles
+void cpl_candles_init(CPLCandles* candles);
+
+// Aggregates `n` ticks into every level; false when the buckets cannot grow
+bool cpl_candles_add(CPLCandles* candles, const double* time, const double* price, const double* volume, size_t n);
+
+// Level drawn in a view of `viewport` (canvas pixels) and its candles
+// [*first, *first + *count) reaching the NDC rectangle (min x, min y, max x,
+// max y); all of them on polar views. False when there are none.
+bool cpl_candles_view(const CPLCandles* candles, const CPLViewTransform* view, const int* viewport,
+                      const float* ndc_rect, int* level, size_t* first, size_t* count);
+
+// GPU record of candle `index` of `level`: start high, start low, then open,
+// high, low and close offsets
+void cpl_candles_record(const CPLCandles* candles, int level, size_t index, float* record);
+
+// CPU backends: NDC rectangles (min x, min y, max x, max y) of the body and the
+// wick of candle `index` of `level`, as the vertex shader builds them. False
+// when they do not map to finite coordinates.
+bool cpl_candles_rects(const CPLCandles* candles, int level, size_t index, const CPLViewTransform* view,
+                       const int* viewport, float* rects);
+
+// CPU backends: RGBA8 colors of the candles of `plot` drawn into `viewport`
+// (canvas pixels) for the pixels `cells` (x, y, width, height, relative to the
+// plot box `box`), row y written at pixels + y * stride (bottom-up). Pixels
+// outside the candles are transparent.
+bool cpl_candles_colors(const CPLPlot* plot, const int* viewport, const int* box, const int* cells,
+                        unsigned char* pixels, ptrdiff_t stride);
+
+void cpl_free_candles(CPLCandles* candles);
+
+#endif // CPL_CANDLES_H
@@ -0,0 +1,680 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "CPLContour.h"
+#include "CPLUtils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <math.h>
+#include <GL/glew.h>
+
+// Constants
+#define CPL_CONTOUR_THREAD_CELLS (1u << 18)  // Cells per marching thread at least
+#define CPL_CONTOUR_MIN_CAPACITY 64
+#define CPL_CONTOUR_NAN_BIN UINT32_MAX       // Level bin of NaN samples
+#define CPL_CONTOUR_EMPTY_KEY UINT64_MAX
+#define CPL_CONTOUR_NO_END SIZE_MAX
+
+// Crossed edges are identified by keys: edge * nlevels + level, so lines of
+// different levels never meet. Edges are numbered horizontal ones first (row
+// j, column i: j * (nx - 1) + i), then vertical ones (ny * (nx - 1) + j * nx + i).
+// A segment has two ends, 2 * segment and 2 * segment + 1, one per crossed edge.
+
+// Segments per marching case: pairs of cell edges (0: row j, 1: column i + 1,
+// 2: row j + 1, 3: column i). Saddles 5 and 10 keep the high corners apart;
+// when the cell centre is high the case is flipped to join them.
+static const signed char cpl_contour_cases[16][4] = {
+    { -1, -1, -1, -1 }, { 3, 0, -1, -1 }, { 0, 1, -1, -1 }, { 3, 1, -1, -1 },
+    { 1, 2, -1, -1 },   { 3, 0, 1, 2 },   { 0, 2, -1, -1 }, { 3, 2, -1, -1 },
+    { 2, 3, -1, -1 },   { 0, 2, -1, -1 }, { 0, 1, 2, 3 },   { 1, 2, -1, -1 },
+    { 3, 1, -1, -1 },   { 0, 1, -1, -1 }, { 3, 0, -1, -1 }, { -1, -1, -1, -1 }
+};
+
+// Item of a chain, traversed from its end `reversed` to the other one
+typedef struct {
+    size_t item;
+    bool reversed;
+} CPLContourLink;
+
+// Chain: links [first, first + count)
+typedef struct {
+    size_t first, count;
+    bool closed;
+} CPLContourChain;
+
+// Chains of items with two ends each, every end linked to at most one other
+typedef struct {
+    unsigned char* visited;
+    size_t visited_capacity;
+    CPLContourLink* links;
+    size_t link_capacity;
+    CPLContourChain* chains;
+    size_t num_chains, chain_capacity;
+} CPLContourGraph;
+
+// One worker: cell rows [first_row, end_row), its segments (a key and the
+// linked end per end) and the polylines stitched from them (key lists, back to back)
+typedef struct {
+    const float* field;
+    size_t nx, ny;
+    const double* sorted;        // Levels in ascending order and their indices
+    const size_t* order;
+    size_t nlevels;
+    size_t first_row, end_row;
+
+    uint64_t* keys_of_ends;
+    size_t* partners;
+    size_t num_segments, end_capacity;   // Segments; entries of the per-end arrays
+
+    // Level bins of two sample rows; ends on the top edges of the previous row
+    // of cells (per column and level) and on the right edge of the previous cell
+    uint32_t* bins;
+    size_t bin_capacity;
+    size_t* tops;
+    size_t top_capacity;
+    size_t* rights;
+    size_t right_capacity;
+
+    CPLContourGraph graph;
+    uint64_t* keys;
+    size_t num_keys, key_capacity;
+    CPLContourChain* pieces;
+    size_t num_pieces, piece_capacity;
+    bool ok;
+} CPLContourBand;
+
+// Polyline piece of a band left open on a seam
+typedef struct {
+    size_t band, piece;
+} CPLContourOpen;
+
+// Hash slot of the seam join: a key and the (at most two) piece ends on it
+typedef struct {
+    uint64_t key;
+    size_t ends[2];
+} CPLContourSlot;
+
+struct CPLContourScratch {
+    CPLContourBand* bands;
+    size_t band_capacity;
+
+    // Seam joining: open pieces of all bands, their end keys and the chains they form
+    CPLContourOpen* open;
+    size_t num_open, open_capacity;
+    uint64_t* open_keys;
+    size_t* open_partners;
+    size_t open_end_capacity;
+    CPLContourSlot* slots;
+    size_t slot_capacity;
+    CPLContourGraph graph;
+
+    double* sorted;
+    size_t* order;
+    Color* colors;
+    size_t level_capacity;
+};
+
+// Internal function declarations
+static size_t cpl_contour_threads(size_t cells);
+static void* cpl_contour_band_main(void* arg);
+static bool cpl_contour_march(CPLContourBand* band);
+static void cpl_contour_bin_row(const CPLContourBand* band, const float* row, uint32_t* bins);
+static bool cpl_contour_stitch(CPLContourBand* band);
+static bool cpl_contour_join(struct CPLContourScratch* scratch);
+static bool cpl_contour_chain(CPLContourGraph* graph, const size_t* partners, size_t num_items);
+static bool cpl_contour_emit(CPLContour* contour, const float* field, const double* levels, size_t nlevels,
+                             const Color* colors, const uint64_t* keys, size_t count, bool reversed, bool skip_first);
+static bool cpl_contour_end_polyline(CPLContour* contour, size_t first);
+static void* cpl_contour_grow(void* array, size_t* capacity, size_t count, size_t size);
+static void cpl_contour_free_graph(CPLContourGraph* graph);
+static void cpl_contour_error(const char* message);
+
+bool cpl_contour_trace(CPLContour* contour, const float* field, const double* levels, size_t nlevels,
+                       CPLColormap colormap) {
+    if (!contour->scratch) {
+        contour->scratch = (struct CPLContourScratch*)calloc(1, sizeof(struct CPLContourScratch));
+        if (!contour->scratch) {
+            cpl_contour_error("Failed to allocate contour buffers");
+            return false;
+        }
+    }
+    struct CPLContourScratch* scratch = contour->scratch;
+    contour->num_vertices = 0;
+    contour->num_polylines = 0;
+    contour->bounds[0] = contour->bounds[1] = INFINITY;
+    contour->bounds[2] = contour->bounds[3] = -INFINITY;
+    contour->dirty = true;
+
+    // Level arrays share one capacity, which only moves once all have grown
+    if (nlevels > scratch->level_capacity) {
+        double* sorted = (double*)realloc(scratch->sorted, nlevels * sizeof(double));
+        if (sorted) scratch->sorted = sorted;
+        size_t* order = (size_t*)realloc(scratch->order, nlevels * sizeof(size_t));
+        if (order) scratch->order = order;
+        Color* colors = (Color*)realloc(scratch->colors, nlevels * sizeof(Color));
+        if (colors) scratch->colors = colors;
+        if (!sorted || !order || !colors) {
+            cpl_contour_error("Failed to allocate contour buffers");
+            return false;
+        }
+        scratch->level_capacity = nlevels;
+    }
+
+    // Levels are colored from the first to the last and marched in ascending order
+    for (size_t l = 0; l < nlevels; l++) {
+        float t = nlevels > 1 ? (float)l / (float)(nlevels - 1) : 0.5f;
+        scratch->colors[l] = cpl_colormap_color(colormap, t);
+
+        size_t p = l;
+        for (; p > 0 && scratch->sorted[p - 1] > levels[l]; p--) {
+            scratch->sorted[p] = scratch->sorted[p - 1];
+            scratch->order[p] = scratch->order[p - 1];
+        }
+        scratch->sorted[p] = levels[l];
+        scratch->order[p] = l;
+    }
+
+    // Bands keep their buffers between calls; only new ones start empty
+    size_t rows = contour->ny - 1;
+    size_t num_bands = cpl_contour_threads((contour->nx - 1) * rows);
+    if (num_bands > scratch->band_capacity) {
+        CPLContourBand* bands = (CPLContourBand*)realloc(scratch->bands, num_bands * sizeof(CPLContourBand));
+        if (!bands) {
+            cpl_contour_error("Failed to allocate contour buffers");
+            return false;
+        }
+        memset(bands + scratch->band_capacity, 0, (num_bands - scratch->band_capacity) * sizeof(CPLContourBand));
+        scratch->bands = bands;
+        scratch->band_capacity = num_bands;
+    }
+    CPLContourBand* bands = scratch->bands;
+    for (size_t i = 0; i < num_bands; i++) {
+        bands[i].field = field;
+        bands[i].nx = contour->nx;
+        bands[i].ny = contour->ny;
+        bands[i].sorted = scratch->sorted;
+        bands[i].order = scratch->order;
+        bands[i].nlevels = nlevels;
+        bands[i].first_row = i * rows / num_bands;
+        bands[i].end_row = (i + 1) * rows / num_bands;
+    }
+
+    cpl_run_workers(bands, sizeof(CPLContourBand), num_bands, cpl_contour_band_main);
+
+    bool ok = true;
+    for (size_t i = 0; i < num_bands; i++) ok = ok && bands[i].ok;
+    if (!ok) {
+        cpl_contour_error("Failed to allocate contour buffers");
+        return false;
+    }
+
+    // Closed pieces are complete; open ones are collected for the seams
+    scratch->num_open = 0;
+    for (size_t b = 0; ok && b < num_bands; b++) {
+        for (size_t p = 0; ok && p < bands[b].num_pieces; p++) {
+            const CPLContourChain* piece = &bands[b].pieces[p];
+            if (piece->closed || num_bands == 1) {
+                size_t first = contour->num_vertices;
+                ok = cpl_contour_emit(contour, field, levels, nlevels, scratch->colors, bands[b].keys + piece->first,
+                                      piece->count, false, false) &&
+                     cpl_contour_end_polyline(contour, first);
+                continue;
+            }
+            CPLContourOpen* open = (CPLContourOpen*)cpl_contour_grow(scratch->open, &scratch->open_capacity,
+                                                                     scratch->num_open + 1, sizeof(CPLContourOpen));
+            if (!open) {
+                ok = false;
+                break;
+            }
+            scratch->open = open;
+            open[scratch->num_open].band = b;
+            open[scratch->num_open].piece = p;
+            scratch->num_open++;
+        }
+    }
+
+    // Pieces meeting on a seam are joined, the shared crossing emitted once
+    if (ok && scratch->num_open > 0) {
+        ok = cpl_contour_join(scratch);
+
+        const CPLContourGraph* graph = &scratch->graph;
+        for (size_t c = 0; ok && c < graph->num_chains; c++) {
+            const CPLContourChain* chain = &graph->chains[c];
+            size_t first = contour->num_vertices;
+            for (size_t k = 0; ok && k < chain->count; k++) {
+                const CPLContourLink* link = &graph->links[chain->first + k];
+                const CPLContourBand* band = &bands[scratch->open[link->item].band];
+                const CPLContourChain* piece = &band->pieces[scratch->open[link->item].piece];
+                ok = cpl_contour_emit(contour, field, levels, nlevels, scratch->colors, band->keys + piece->first,
+                                      piece->count, link->reversed, k > 0);
+            }
+            ok = ok && cpl_contour_end_polyline(contour, first);
+        }
+    }
+
+    if (!ok) {
+        contour->num_vertices = 0;
+        contour->num_polylines = 0;
+        cpl_contour_error("Failed to allocate contour vertices");
+    }
+    return ok;
+}
+
+bool cpl_contour_visible(const CPLContour* contour, const CPLViewTransform* view, const float* ndc_rect) {
+    if (contour->num_polylines == 0) return false;
+    float window[4];
+    return cpl_view_window(view, contour->origin, contour->bounds, ndc_rect, window);
+}
+
+void cpl_free_contour(CPLContour* contour) {
+    if (!contour) return;
+
+    if (contour->vao) glDeleteVertexArrays(1, &contour->vao);
+    if (contour->vbo) glDeleteBuffers(1, &contour->vbo);
+    struct CPLContourScratch* scratch = contour->scratch;
+    if (scratch) {
+        for (size_t i = 0; i < scratch->band_capacity; i++) {
+            CPLContourBand* band = &scratch->bands[i];
+            free(band->keys_of_ends);
+            free(band->partners);
+            free(band->bins);
+            free(band->tops);
+            free(band->rights);
+            cpl_contour_free_graph(&band->graph);
+            free(band->keys);
+            free(band->pieces);
+        }
+        free(scratch->bands);
+        free(scratch->open);
+        free(scratch->open_keys);
+        free(scratch->open_partners);
+        free(scratch->slots);
+        cpl_contour_free_graph(&scratch->graph);
+        free(scratch->sorted);
+        free(scratch->order);
+        free(scratch->colors);
+        free(scratch);
+    }
+    free(contour->vertices);
+    free(contour->firsts);
+    free(contour->counts);
+    free(contour);
+}
+
+// Internal helper functions
+static size_t cpl_contour_threads(size_t cells) {
+    size_t num_threads = cpl_image_default_threads();
+    if (num_threads > cells / CPL_CONTOUR_THREAD_CELLS) num_threads = cells / CPL_CONTOUR_THREAD_CELLS;
+    return num_threads == 0 ? 1 : num_threads;
+}
+
+static void* cpl_contour_band_main(void* arg) {
+    CPLContourBand* band = (CPLContourBand*)arg;
+    band->ok = cpl_contour_march(band) && cpl_contour_stitch(band);
+    return NULL;
+}
+
+// Marching squares over the band's cells. Every sample is binned once (the
+// number of levels at or below it), so a cell is crossed by exactly the levels
+// between its lowest and highest bin. Each new segment end is linked right
+// away to the end on the same edge in the cell to the left or below, which
+// are the only earlier cells sharing its edges.
+static bool cpl_contour_march(CPLContourBand* band) {
+    const float* field = band->field;
+    size_t nx = band->nx;
+    size_t nlevels = band->nlevels;
+    uint64_t vertical_first = (uint64_t)band->ny * (uint64_t)(nx - 1);
+    band->num_segments = 0;
+
+    uint32_t* bins = (uint32_t*)cpl_contour_grow(band->bins, &band->bin_capacity, 2 * nx, sizeof(uint32_t));
+    if (bins) band->bins = bins;
+    size_t* tops = (size_t*)cpl_contour_grow(band->tops, &band->top_capacity, nx * nlevels, sizeof(size_t));
+    if (tops) band->tops = tops;
+    size_t* rights = (size_t*)cpl_contour_grow(band->rights, &band->right_capacity, nlevels, sizeof(size_t));
+    if (rights) band->rights = rights;
+    if (!bins || !tops || !rights) return false;
+    for (size_t i = 0; i < nx * nlevels; i++) tops[i] = CPL_CONTOUR_NO_END;
+    for (size_t l = 0; l < nlevels; l++) rights[l] = CPL_CONTOUR_NO_END;
+
+    uint32_t* lower = bins;
+    uint32_t* upper = bins + nx;
+    cpl_contour_bin_row(band, field + band->first_row * nx, lower);
+    for (size_t j = band->first_row; j < band->end_row; j++) {
+        const float* row = field + j * nx;
+        const float* next = row + nx;
+        cpl_contour_bin_row(band, next, upper);
+
+        for (size_t i = 0; i + 1 < nx; i++) {
+            uint32_t b00 = lower[i], b10 = lower[i + 1], b11 = upper[i + 1], b01 = upper[i];
+            uint32_t low = b00 < b10 ? b00 : b10;
+            uint32_t high = b00 < b10 ? b10 : b00;
+            if (b11 < low) low = b11;
+            if (b11 > high) high = b11;
+            if (b01 < low) low = b01;
+            if (b01 > high) high = b01;
+            if (low == high || high == CPL_CONTOUR_NAN_BIN) continue;
+
+            const uint64_t edges[4] = {
+                (uint64_t)j * (nx - 1) + i,
+                vertical_first + (uint64_t)j * nx + i + 1,
+                (uint64_t)(j + 1) * (nx - 1) + i,
+                vertical_first + (uint64_t)j * nx + i
+            };
+
+            // Levels at sorted positions [low, high) lie above some corners and not above others
+            for (uint32_t p = low; p < high; p++) {
+                size_t l = band->order[p];
+                int index = (b00 > p) | (b10 > p) << 1 | (b11 > p) << 2 | (b01 > p) << 3;
+                if ((index == 5 || index == 10) &&
+                    0.25 * ((double)row[i] + row[i + 1] + next[i + 1] + next[i]) >= band->sorted[p]) {
+                    index ^= 15;
+                }
+                const signed char* sides = cpl_contour_cases[index];
+                size_t count = sides[2] < 0 ? 2 : 4;
+
+                size_t capacity = band->end_capacity;
+                size_t ends = 2 * band->num_segments;
+                uint64_t* keys = (uint64_t*)cpl_contour_grow(band->keys_of_ends, &capacity, ends + count,
+                                                             sizeof(uint64_t));
+                if (!keys) return false;
+                band->keys_of_ends = keys;
+                if (capacity != band->end_capacity) {
+                    size_t* partners = (size_t*)realloc(band->partners, capacity * sizeof(size_t));
+                    if (!partners) return false;
+                    band->partners = partners;
+                    band->end_capacity = capacity;
+                }
+                size_t* partners = band->partners;
+
+                // Links first (the left and bottom edges), then the ends later cells link to
+                for (size_t k = 0; k < count; k++) {
+                    keys[ends + k] = edges[sides[k]] * nlevels + l;
+                    partners[ends + k] = CPL_CONTOUR_NO_END;
+                    size_t* slot = sides[k] == 0 ? &tops[i * nlevels + l] : sides[k] == 3 ? &rights[l] : NULL;
+                    if (slot && *slot != CPL_CONTOUR_NO_END && keys[*slot] == keys[ends + k]) {
+                        partners[ends + k] = *slot;
+                        partners[*slot] = ends + k;
+                    }
+                }
+                for (size_t k = 0; k < count; k++) {
+                    if (sides[k] == 1) rights[l] = ends + k;
+                    if (sides[k] == 2) tops[i * nlevels + l] = ends + k;
+                }
+                band->num_segments += count / 2;
+            }
+        }
+
+        uint32_t* swap = lower;
+        lower = upper;
+        upper = swap;
+    }
+    return true;
+}
+
+// Number of levels at or below each sample of a row
+static void cpl_contour_bin_row(const CPLContourBand* band, const float* row, uint32_t* bins) {
+    const double* sorted = band->sorted;
+    for (size_t i = 0; i < band->nx; i++) {
+        double value = row[i];
+        if (cpl_is_nanf(row[i])) {
+            bins[i] = CPL_CONTOUR_NAN_BIN;
+            continue;
+        }
+        size_t begin = 0, end = band->nlevels;
+        while (begin < end) {
+            size_t middle = begin + (end - begin) / 2;
+            if (sorted[middle] <= value) {
+                begin = middle + 1;
+            } else {
+                end = middle;
+            }
+        }
+        bins[i] = (uint32_t)begin;
+    }
+}
+
+static bool cpl_contour_stitch(CPLContourBand* band) {
+    band->num_keys = 0;
+    band->num_pieces = 0;
+    if (!cpl_contour_chain(&band->graph, band->partners, band->num_segments)) return false;
+
+    // A chain of n segments crosses n + 1 edges (the first again when closed)
+    const CPLContourGraph* graph = &band->graph;
+    uint64_t* keys = (uint64_t*)cpl_contour_grow(band->keys, &band->key_capacity,
+                                                 band->num_segments + graph->num_chains, sizeof(uint64_t));
+    if (keys) band->keys = keys;
+    CPLContourChain* pieces = (CPLContourChain*)cpl_contour_grow(band->pieces, &band->piece_capacity,
+                                                                 graph->num_chains, sizeof(CPLContourChain));
+    if (pieces) band->pieces = pieces;
+    if (!keys || !pieces) return false;
+
+    for (size_t c = 0; c < graph->num_chains; c++) {
+        const CPLContourChain* chain = &graph->chains[c];
+        const CPLContourLink* links = graph->links + chain->first;
+        pieces[c].first = band->num_keys;
+        pieces[c].count = chain->count + 1;
+        pieces[c].closed = chain->closed;
+        keys[band->num_keys++] = band->keys_of_ends[2 * links[0].item + links[0].reversed];
+        for (size_t k = 0; k < chain->count; k++) {
+            keys[band->num_keys++] = band->keys_of_ends[2 * links[k].item + !links[k].reversed];
+        }
+    }
+    band->num_pieces = graph->num_chains;
+    return true;
+}
+
+// Links the ends of the open pieces through a hash of their keys, then chains them
+static bool cpl_contour_join(struct CPLContourScratch* scratch) {
+    size_t num_ends = 2 * scratch->num_open;
+    size_t capacity = scratch->open_end_capacity;
+    uint64_t* keys = (uint64_t*)cpl_contour_grow(scratch->open_keys, &capacity, num_ends, sizeof(uint64_t));
+    if (!keys) return false;
+    scratch->open_keys = keys;
+    if (capacity != scratch->open_end_capacity || !scratch->open_partners) {
+        size_t* partners = (size_t*)realloc(scratch->open_partners, capacity * sizeof(size_t));
+        if (!partners) return false;
+        scratch->open_partners = partners;
+        scratch->open_end_capacity = capacity;
+    }
+    size_t* partners = scratch->open_partners;
+
+    // At most half full
+    size_t slot_count = CPL_CONTOUR_MIN_CAPACITY;
+    while (slot_count < 2 * num_ends) slot_count *= 2;
+    if (slot_count > scratch->slot_capacity) {
+        CPLContourSlot* slots = (CPLContourSlot*)realloc(scratch->slots, slot_count * sizeof(CPLContourSlot));
+        if (!slots) return false;
+        scratch->slots = slots;
+        scratch->slot_capacity = slot_count;
+    }
+    CPLContourSlot* slots = scratch->slots;
+    size_t mask = slot_count - 1;
+    for (size_t i = 0; i < slot_count; i++) slots[i].key = CPL_CONTOUR_EMPTY_KEY;
+
+    for (size_t end = 0; end < num_ends; end++) {
+        const CPLContourBand* band = &scratch->bands[scratch->open[end / 2].band];
+        const CPLContourChain* piece = &band->pieces[scratch->open[end / 2].piece];
+        keys[end] = band->keys[piece->first + (end % 2 ? piece->count - 1 : 0)];
+        partners[end] = CPL_CONTOUR_NO_END;
+
+        uint64_t hash = keys[end];
+        hash ^= hash >> 33;
+        hash *= 0xff51afd7ed558ccdULL;
+        hash ^= hash >> 33;
+        size_t index = (size_t)hash & mask;
+        while (slots[index].key != keys[end] && slots[index].key != CPL_CONTOUR_EMPTY_KEY) {
+            index = (index + 1) & mask;
+        }
+        CPLContourSlot* slot = &slots[index];
+        if (slot->key == CPL_CONTOUR_EMPTY_KEY) {
+            slot->key = keys[end];
+            slot->ends[0] = end;
+            slot->ends[1] = CPL_CONTOUR_NO_END;
+        } else if (slot->ends[1] == CPL_CONTOUR_NO_END) {
+            slot->ends[1] = end;
+            partners[end] = slot->ends[0];
+            partners[slot->ends[0]] = end;
+        }
+    }
+    return cpl_contour_chain(&scratch->graph, partners, scratch->num_open);
+}
+
+static bool cpl_contour_chain(CPLContourGraph* graph, const size_t* partners, size_t num_items) {
+    graph->num_chains = 0;
+    unsigned char* visited = (unsigned char*)cpl_contour_grow(graph->visited, &graph->visited_capacity, num_items,
+                                                              sizeof(unsigned char));
+    if (visited) graph->visited = visited;
+    CPLContourLink* links = (CPLContourLink*)cpl_contour_grow(graph->links, &graph->link_capacity, num_items,
+                                                              sizeof(CPLContourLink));
+    if (links) graph->links = links;
+    if (!visited || !links) return false;
+    memset(visited, 0, num_items);
+
+    size_t num_links = 0;
+    for (size_t seed = 0; seed < num_items; seed++) {
+        if (visited[seed]) continue;
+
+        // Walk back to the start of the chain, or around it when it is closed
+        size_t start = seed, entry = 0;
+        bool closed = false;
+        for (size_t steps = 0; steps < num_items; steps++) {
+            size_t partner = partners[2 * start + entry];
+            if (partner == CPL_CONTOUR_NO_END || visited[partner / 2]) break;
+            if (partner / 2 == seed) {
+                start = seed;
+                entry = 0;
+                closed = true;
+                break;
+            }
+            start = partner / 2;
+            entry = 1 - partner % 2;
+        }
+
+        CPLContourChain* chains = (CPLContourChain*)cpl_contour_grow(graph->chains, &graph->chain_capacity,
+                                                                     graph->num_chains + 1, sizeof(CPLContourChain));
+        if (!chains) return false;
+        graph->chains = chains;
+        CPLContourChain* chain = &chains[graph->num_chains++];
+        chain->first = num_links;
+        chain->closed = false;
+
+        // Then forward, each item leaving through the end opposite its entry
+        size_t item = start, side = entry;
+        for (;;) {
+            visited[item] = 1;
+            links[num_links].item = item;
+            links[num_links].reversed = side == 1;
+            num_links++;
+            size_t partner = partners[2 * item + 1 - side];
+            if (partner == CPL_CONTOUR_NO_END) break;
+            if (partner == 2 * start + entry) {
+                chain->closed = closed;
+                break;
+            }
+            if (visited[partner / 2]) break;
+            item = partner / 2;
+            side = partner % 2;
+        }
+        chain->count = num_links - chain->first;
+    }
+    return true;
+}
+
+// Appends the crossings of `keys` (backwards when `reversed`, without the first
+// one when `skip_first`) as line vertices
+static bool cpl_contour_emit(CPLContour* contour, const float* field, const double* levels, size_t nlevels,
+                             const Color* colors, const uint64_t* keys, size_t count, bool reversed, bool skip_first) {
+    size_t begin = skip_first ? 1 : 0;
+    if (count <= begin) return true;
+    float* vertices = (float*)cpl_contour_grow(contour->vertices, &contour->vertex_capacity,
+                                               contour->num_vertices + count - begin, 5 * sizeof(float));
+    if (!vertices) return false;
+    contour->vertices = vertices;
+
+    // Samples sit at element centres, row 0 at the top of the extent
+    size_t nx = contour->nx;
+    uint64_t vertical_first = (uint64_t)contour->ny * (uint64_t)(nx - 1);
+    double step[2] = {
+        (contour->extent[1] - contour->extent[0]) / (double)contour->nx,
+        (contour->extent[3] - contour->extent[2]) / (double)contour->ny
+    };
+    double start[2] = {
+        contour->extent[0] + 0.5 * step[0] - contour->origin[0],
+        contour->extent[3] - 0.5 * step[1] - contour->origin[1]
+    };
+
+    float* out = vertices + 5 * contour->num_vertices;
+    for (size_t k = begin; k < count; k++, out += 5) {
+        uint64_t key = keys[reversed ? count - 1 - k : k];
+        uint64_t edge = key / nlevels;
+        size_t level = (size_t)(key % nlevels);
+
+        // Crossing interpolated from the lower-index sample, so both cells of an edge agree
+        bool vertical = edge >= vertical_first;
+        size_t index = vertical ? (size_t)(edge - vertical_first)
+                                : (size_t)(edge / (nx - 1)) * nx + (size_t)(edge % (nx - 1));
+        double a = field[index];
+        double b = field[index + (vertical ? nx : 1)];
+        double t = (levels[level] - a) / (b - a);
+        double column = (double)(index % nx) + (vertical ? 0.0 : t);
+        double row = (double)(index / nx) + (vertical ? t : 0.0);
+
+        out[0] = (float)(start[0] + column * step[0]);
+        out[1] = (float)(start[1] - row * step[1]);
+        out[2] = colors[level].r;
+        out[3] = colors[level].g;
+        out[4] = colors[level].b;
+        contour->bounds[0] = fminf(contour->bounds[0], out[0]);
+        contour->bounds[1] = fminf(contour->bounds[1], out[1]);
+        contour->bounds[2] = fmaxf(contour->bounds[2], out[0]);
+        contour->bounds[3] = fmaxf(contour->bounds[3], out[1]);
+    }
+    contour->num_vertices += count - begin;
+    return true;
+}
+
+// Records the vertices from `first` on as one polyline
+static bool cpl_contour_end_polyline(CPLContour* contour, size_t first) {
+    if (contour->num_vertices > (size_t)INT_MAX) return false;
+    size_t capacity = contour->polyline_capacity;
+    int* firsts = (int*)cpl_contour_grow(contour->firsts, &capacity, contour->num_polylines + 1, sizeof(int));
+    if (!firsts) return false;
+    contour->firsts = firsts;
+
+    // The counts follow the firsts; the shared capacity only moves once both have grown
+    int* counts = contour->counts;
+    if (capacity != contour->polyline_capacity || !counts) {
+        counts = (int*)realloc(counts, capacity * sizeof(int));
+        if (!counts) return false;
+        contour->counts = counts;
+        contour->polyline_capacity = capacity;
+    }
+    firsts[contour->num_polylines] = (int)first;
+    counts[contour->num_polylines] = (int)(contour->num_vertices - first);
+    contour->num_polylines++;
+    return true;
+}
+
+// `array` with room for `count` elements of `size` bytes, grown by doubling
+// (`capacity` updated); NULL when it cannot grow, leaving `array` intact
+static void* cpl_contour_grow(void* array, size_t* capacity, size_t count, size_t size) {
+    if (count <= *capacity && array) return array;
+    size_t new_capacity = *capacity > CPL_CONTOUR_MIN_CAPACITY ? *capacity : CPL_CONTOUR_MIN_CAPACITY;
+    while (new_capacity < count) new_capacity *= 2;
+    void* grown = realloc(array, new_capacity * size);
+    if (grown) *capacity = new_capacity;
+    return grown;
+}
+
+static void cpl_contour_free_graph(CPLContourGraph* graph) {
+    free(graph->visited);
+    free(graph->links);
+    free(graph->chains);
+}
+
+static void cpl_contour_error(const char* message) {
+    fprintf(stderr, "CPlotLib Error: %s\n", message);
+}
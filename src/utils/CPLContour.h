@@ -0,0 +1,28 @@
+#ifndef CPL_CONTOUR_H
+#define CPL_CONTOUR_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include "CPLPlot.h"
+#include "CPLColors.h"
+#include "CPLTransform.h"
+
+// Contours are traced on the CPU: every thread marches the cells of a band of
+// rows for all levels and stitches its segments into polylines through a hash
+// of the crossed edges; the pieces ending on band seams are joined at the end.
+// The polylines of all levels go into one vertex array in the line format, so
+// the GPU draws them with a single multi-draw.
+
+// Traces `field` at `levels` into `contour` (sizes and extent set), colored
+// through `colormap`. Vertices, polylines and marching buffers are reused when
+// they are large enough. False when they cannot be allocated.
+bool cpl_contour_trace(CPLContour* contour, const float* field, const double* levels, size_t nlevels,
+                       CPLColormap colormap);
+
+// Whether the contour lines can reach the NDC rectangle (min x, min y, max x,
+// max y); always on polar views
+bool cpl_contour_visible(const CPLContour* contour, const CPLViewTransform* view, const float* ndc_rect);
+
+void cpl_free_contour(CPLContour* contour);
+
+#endif // CPL_CONTOUR_H
@@ -0,0 +1,768 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "CPLDensity.h"
+#include "CPLRenderer.h"
+#include "CPLUtils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <GL/glew.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Constants
+#define CPL_DENSITY_THREAD_POINTS (1u << 21)   // Points per binning thread (each needs a whole partial grid)
+#define CPL_DENSITY_HISTOGRAM_LIMIT (1u << 22) // Largest count equalized by counting; beyond it counts are sorted
+#define CPL_DENSITY_COLORMAP_ENTRIES 1024      // Colormap lookup table of the CPU backends
+#define CPL_TRACES_THREAD_SAMPLES (1u << 20)   // Trace samples per accumulation thread
+
+// Grid mapping shared by the binning workers: plot NDC -> cell coordinates is
+// ndc * scale + shift on each axis
+typedef struct {
+    const CPLPlotData* data;
+    const CPLViewTransform* view;
+    double scale[2];
+    double shift[2];
+    int width, height;
+    bool linear;                 // Linear axes, no polar mapping: cells follow from the offsets directly
+} CPLDensityBinning;
+
+// One binning worker: the same slice of every scatter, counted into its own grid
+typedef struct {
+    const CPLDensityBinning* binning;
+    size_t part, num_parts;
+    uint32_t* grid;
+} CPLDensityWorker;
+
+// One merge worker: cells [first, end) of the partial grids summed into the counts
+typedef struct {
+    uint32_t** grids;
+    size_t num_grids;
+    float* counts;
+    size_t first, end;
+    uint32_t max;
+} CPLDensityMerge;
+
+// Trace accumulation shared by the workers: samples [first, first + count) of
+// every trace, placed in box pixels (viewport pixels minus the box's first pixel)
+typedef struct {
+    const CPLTraces* traces;
+    const CPLViewTransform* view;
+    const float* columns;        // Non-polar views: box x of each sample, shared by all traces
+    size_t first, count;
+    double scale[2];             // Plot NDC -> box pixels: ndc * scale + shift
+    double shift[2];
+    double y_scale, y_shift;     // Linear y axes: box y = offset * y_scale + y_shift
+    bool linear_y;
+    int width, height;
+} CPLTracesBinning;
+
+// One accumulation worker: traces [first, end) added into its own grid
+typedef struct {
+    const CPLTracesBinning* binning;
+    size_t first, end;
+    float* grid;
+    float* points;               // Box x, y of the current trace's samples
+} CPLTracesWorker;
+
+// One merge worker: cells [first, end) of the other workers' grids added to the first
+typedef struct {
+    float** grids;
+    size_t num_grids;
+    size_t first, end;
+    float max;
+} CPLTracesMerge;
+
+// Internal function declarations
+static bool cpl_traces_accumulate(CPLDensity* grid, const CPLTraces* traces, const CPLViewTransform* view,
+                                  const int* viewport, const int* box);
+static void* cpl_traces_worker_main(void* arg);
+static void* cpl_traces_merge_main(void* arg);
+static void cpl_traces_segment(float* grid, int width, int height, double x0, double y0, double x1, double y1,
+                               float weight);
+static bool cpl_density_bin(CPLDensity* density, const CPLPlot* plot, const CPLViewTransform* view,
+                            const int* viewport, const int* box);
+static void* cpl_density_worker_main(void* arg);
+static void* cpl_density_merge_main(void* arg);
+static void cpl_density_bin_scatter(const CPLDensityBinning* binning, const CPLScatter* scatter, size_t first,
+                                    size_t end, uint32_t* grid);
+static int cpl_density_compare(const void* a, const void* b);
+static void cpl_density_error(const char* message);
+
+CPLDensity* cpl_density_update(CPLPlot* plot, const int* viewport) {
+    if (!plot || !plot->data || !viewport || plot->density == CPL_DENSITY_OFF || plot->data->num_scatters == 0) {
+        return NULL;
+    }
+
+    int box[4];
+    cpl_plot_box_rect(plot, viewport, box);
+    if (box[2] <= 0 || box[3] <= 0) return NULL;
+
+    // Zeroed first so views compare with memcmp against the cached one
+    CPLViewTransform view;
+    memset(&view, 0, sizeof(view));
+    cpl_view_transform(plot, viewport, &view);
+
+    CPLDensity* density = plot->data->density;
+    if (!density) {
+        density = (CPLDensity*)calloc(1, sizeof(CPLDensity));
+        if (!density) {
+            cpl_density_error("Failed to allocate density grid");
+            return NULL;
+        }
+        plot->data->density = density;
+    }
+
+    if (density->counts && memcmp(&density->view, &view, sizeof(view)) == 0 &&
+        density->viewport_size[0] == viewport[2] && density->viewport_size[1] == viewport[3] &&
+        density->num_inputs == plot->data->num_scatters) {
+        // Same counts; only equalization needs levels the other norms don't keep
+        if (density->norm != plot->density) {
+            if (plot->density == CPL_DENSITY_EQ_HIST && !cpl_density_equalize(density)) return NULL;
+            density->norm = plot->density;
+        }
+        return density;
+    }
+
+    if (!density->counts || density->width != box[2] || density->height != box[3]) {
+        free(density->counts);
+        density->counts = (float*)malloc((size_t)box[2] * (size_t)box[3] * sizeof(float));
+        if (!density->counts) {
+            cpl_density_error("Failed to allocate density grid");
+            return NULL;
+        }
+        density->width = box[2];
+        density->height = box[3];
+    }
+
+    if (!cpl_density_bin(density, plot, &view, viewport, box) ||
+        (plot->density == CPL_DENSITY_EQ_HIST && !cpl_density_equalize(density))) {
+        // No valid key: the next frame tries again
+        free(density->counts);
+        density->counts = NULL;
+        return NULL;
+    }
+
+    cpl_density_place(density, viewport, box);
+    density->view = view;
+    density->viewport_size[0] = viewport[2];
+    density->viewport_size[1] = viewport[3];
+    density->norm = plot->density;
+    density->num_inputs = plot->data->num_scatters;
+    density->texture_dirty = true;
+    return density;
+}
+
+CPLDensity* cpl_traces_grid(CPLPlot* plot, const int* viewport) {
+    CPLTraces* traces = plot && plot->data ? plot->data->traces : NULL;
+    if (!traces || !viewport || traces->num_traces == 0) return NULL;
+
+    int box[4];
+    cpl_plot_box_rect(plot, viewport, box);
+    if (box[2] <= 0 || box[3] <= 0) return NULL;
+
+    CPLViewTransform view;
+    memset(&view, 0, sizeof(view));
+    cpl_view_transform(plot, viewport, &view);
+
+    CPLDensity* grid = traces->grid;
+    if (!grid) {
+        grid = (CPLDensity*)calloc(1, sizeof(CPLDensity));
+        if (!grid) {
+            cpl_density_error("Failed to allocate trace grid");
+            return NULL;
+        }
+        traces->grid = grid;
+    }
+
+    if (grid->counts && memcmp(&grid->view, &view, sizeof(view)) == 0 && grid->viewport_size[0] == viewport[2] &&
+        grid->viewport_size[1] == viewport[3] && grid->num_inputs == traces->num_traces &&
+        grid->frame == traces->frame) {
+        if (grid->norm != traces->norm) {
+            if (traces->norm == CPL_DENSITY_EQ_HIST && !cpl_density_equalize(grid)) return NULL;
+            grid->norm = traces->norm;
+        }
+        return grid;
+    }
+
+    if (!grid->counts || grid->width != box[2] || grid->height != box[3]) {
+        free(grid->counts);
+        grid->counts = (float*)malloc((size_t)box[2] * (size_t)box[3] * sizeof(float));
+        if (!grid->counts) {
+            cpl_density_error("Failed to allocate trace grid");
+            return NULL;
+        }
+        grid->width = box[2];
+        grid->height = box[3];
+    }
+
+    grid->weighted = traces->decay < 1.0f;
+    cpl_density_place(grid, viewport, box);
+    if (!cpl_traces_accumulate(grid, traces, &view, viewport, box) ||
+        (traces->norm == CPL_DENSITY_EQ_HIST && !cpl_density_equalize(grid))) {
+        free(grid->counts);
+        grid->counts = NULL;
+        return NULL;
+    }
+
+    grid->view = view;
+    grid->viewport_size[0] = viewport[2];
+    grid->viewport_size[1] = viewport[3];
+    grid->norm = traces->norm;
+    grid->num_inputs = traces->num_traces;
+    grid->frame = traces->frame;
+    return grid;
+}
+
+void cpl_density_place(CPLDensity* density, const int* viewport, const int* box) {
+    // The grid's cells are the box pixels; its NDC rectangle is whole pixels of the viewport
+    density->rect[0] = -1.0f + 2.0f * (float)(box[0] - viewport[0]) / (float)viewport[2];
+    density->rect[1] = -1.0f + 2.0f * (float)(box[1] - viewport[1]) / (float)viewport[3];
+    density->rect[2] = -1.0f + 2.0f * (float)(box[0] - viewport[0] + box[2]) / (float)viewport[2];
+    density->rect[3] = -1.0f + 2.0f * (float)(box[1] - viewport[1] + box[3]) / (float)viewport[3];
+}
+
+float cpl_density_level(const CPLDensity* density, CPLDensityNorm norm, float count) {
+    float t;
+    switch (norm) {
+        case CPL_DENSITY_LOG:
+            t = log1pf(count) / log1pf(density->max_count);
+            break;
+        case CPL_DENSITY_EQ_HIST: {
+            // Interpolated position of the count among the levels (same search
+            // as the density shader)
+            int low = 0;
+            int high = CPL_DENSITY_LEVELS - 1;
+            while (low < high) {
+                int mid = (low + high + 1) / 2;
+                if (density->levels[mid] <= count) {
+                    low = mid;
+                } else {
+                    high = mid - 1;
+                }
+            }
+            float position = (float)low;
+            if (low < CPL_DENSITY_LEVELS - 1 && density->levels[low + 1] > density->levels[low]) {
+                position += (count - density->levels[low]) / (density->levels[low + 1] - density->levels[low]);
+            }
+            int span = CPL_DENSITY_LEVELS - 1 - density->level_base;
+            t = span > 0 ? (position - (float)density->level_base) / (float)span : 1.0f;
+            break;
+        }
+        default:
+            t = count / density->max_count;
+            break;
+    }
+    return t > 0.0f ? (t < 1.0f ? t : 1.0f) : 0.0f;
+}
+
+bool cpl_density_colors(const CPLDensity* density, CPLDensityNorm norm, CPLColormap colormap, const int* cells,
+                        unsigned char* pixels, ptrdiff_t stride) {
+    if (!density || !density->counts || cells[0] < 0 || cells[1] < 0 || cells[0] + cells[2] > density->width ||
+        cells[1] + cells[3] > density->height) {
+        return false;
+    }
+
+    unsigned char* lut = (unsigned char*)malloc(CPL_DENSITY_COLORMAP_ENTRIES * 3);
+    if (!lut) {
+        cpl_density_error("Failed to allocate colormap table");
+        return false;
+    }
+    for (int i = 0; i < CPL_DENSITY_COLORMAP_ENTRIES; i++) {
+        Color c = cpl_colormap_color(colormap, (float)i / (float)(CPL_DENSITY_COLORMAP_ENTRIES - 1));
+        lut[i * 3 + 0] = (unsigned char)(c.r * 255.0f + 0.5f);
+        lut[i * 3 + 1] = (unsigned char)(c.g * 255.0f + 0.5f);
+        lut[i * 3 + 2] = (unsigned char)(c.b * 255.0f + 0.5f);
+    }
+
+    for (int y = 0; y < cells[3]; y++) {
+        const float* counts = density->counts + (size_t)(cells[1] + y) * (size_t)density->width + (size_t)cells[0];
+        unsigned char* out = pixels + (ptrdiff_t)y * stride;
+        for (int x = 0; x < cells[2]; x++, out += 4) {
+            if (!(counts[x] > 0.0f)) {
+                memset(out, 0, 4);
+                continue;
+            }
+            float t = cpl_density_level(density, norm, counts[x]);
+            const unsigned char* rgb = lut + (int)(t * (float)(CPL_DENSITY_COLORMAP_ENTRIES - 1) + 0.5f) * 3;
+            out[0] = rgb[0];
+            out[1] = rgb[1];
+            out[2] = rgb[2];
+            out[3] = 255;
+        }
+    }
+
+    free(lut);
+    return true;
+}
+
+void cpl_free_density(CPLDensity* density) {
+    if (!density) return;
+
+    if (density->framebuffer) glDeleteFramebuffers(1, &density->framebuffer);
+    if (density->texture) glDeleteTextures(1, &density->texture);
+    if (density->vao) glDeleteVertexArrays(1, &density->vao);
+    if (density->readback_buffer) glDeleteBuffers(1, &density->readback_buffer);
+    if (density->readback_fence) glDeleteSync((GLsync)density->readback_fence);
+    free(density->counts);
+    free(density);
+}
+
+// Binning: every thread counts a slice of each scatter into a private grid (no
+// atomics), then the grids are summed in bands of cells on the same threads
+static bool cpl_density_bin(CPLDensity* density, const CPLPlot* plot, const CPLViewTransform* view,
+                            const int* viewport, const int* box) {
+    CPLDensityBinning binning;
+    binning.data = plot->data;
+    binning.view = view;
+    binning.width = box[2];
+    binning.height = box[3];
+    binning.linear = !view->polar && view->scale[0] == CPL_SCALE_LINEAR && view->scale[1] == CPL_SCALE_LINEAR;
+    for (int axis = 0; axis < 2; axis++) {
+        // NDC -> viewport pixels, minus the box's first pixel
+        binning.scale[axis] = 0.5 * (double)viewport[2 + axis];
+        binning.shift[axis] = binning.scale[axis] - (double)(box[axis] - viewport[axis]);
+    }
+
+    size_t total = 0;
+    for (size_t i = 0; i < plot->data->num_scatters; i++) {
+        if (plot->data->scatters[i].is_loaded) total += plot->data->scatters[i].num_points;
+    }
+
+    size_t cells = (size_t)box[2] * (size_t)box[3];
+    size_t num_threads = cpl_image_default_threads();
+    if (num_threads > total / CPL_DENSITY_THREAD_POINTS) num_threads = total / CPL_DENSITY_THREAD_POINTS;
+    if (num_threads == 0) num_threads = 1;
+
+    CPLDensityWorker* workers = (CPLDensityWorker*)calloc(num_threads, sizeof(CPLDensityWorker));
+    CPLDensityMerge* merges = (CPLDensityMerge*)calloc(num_threads, sizeof(CPLDensityMerge));
+    uint32_t** grids = (uint32_t**)calloc(num_threads, sizeof(uint32_t*));
+    bool ok = workers && merges && grids;
+    for (size_t i = 0; ok && i < num_threads; i++) {
+        grids[i] = (uint32_t*)calloc(cells, sizeof(uint32_t));
+        ok = grids[i] != NULL;
+    }
+
+    if (ok) {
+        for (size_t i = 0; i < num_threads; i++) {
+            workers[i].binning = &binning;
+            workers[i].part = i;
+            workers[i].num_parts = num_threads;
+            workers[i].grid = grids[i];
+        }
+        cpl_run_workers(workers, sizeof(CPLDensityWorker), num_threads, cpl_density_worker_main);
+
+        for (size_t i = 0; i < num_threads; i++) {
+            merges[i].grids = grids;
+            merges[i].num_grids = num_threads;
+            merges[i].counts = density->counts;
+            merges[i].first = i * cells / num_threads;
+            merges[i].end = (i + 1) * cells / num_threads;
+        }
+        cpl_run_workers(merges, sizeof(CPLDensityMerge), num_threads, cpl_density_merge_main);
+
+        uint32_t max = 0;
+        for (size_t i = 0; i < num_threads; i++) {
+            if (merges[i].max > max) max = merges[i].max;
+        }
+        density->max_count = (float)max;
+    } else {
+        cpl_density_error("Failed to allocate density binning grids");
+    }
+
+    for (size_t i = 0; grids && i < num_threads; i++) free(grids[i]);
+    free(workers);
+    free(merges);
+    free(grids);
+    return ok;
+}
+
+static void* cpl_density_worker_main(void* arg) {
+    CPLDensityWorker* worker = (CPLDensityWorker*)arg;
+    const CPLPlotData* data = worker->binning->data;
+
+    for (size_t i = 0; i < data->num_scatters; i++) {
+        const CPLScatter* scatter = &data->scatters[i];
+        if (!scatter->is_loaded || !scatter->offsets) continue;
+
+        size_t first = worker->part * scatter->num_points / worker->num_parts;
+        size_t end = (worker->part + 1) * scatter->num_points / worker->num_parts;
+        cpl_density_bin_scatter(worker->binning, scatter, first, end, worker->grid);
+    }
+    return NULL;
+}
+
+static void* cpl_density_merge_main(void* arg) {
+    CPLDensityMerge* merge = (CPLDensityMerge*)arg;
+    uint32_t max = 0;
+
+    for (size_t cell = merge->first; cell < merge->end; cell++) {
+        uint32_t sum = 0;
+        for (size_t g = 0; g < merge->num_grids; g++) sum += merge->grids[g][cell];
+        merge->counts[cell] = (float)sum;
+        if (sum > max) max = sum;
+    }
+    merge->max = max;
+    return NULL;
+}
+
+// Points [first, end) of a scatter counted into `grid`; points outside the box
+// (and non-finite ones) are dropped
+static void cpl_density_bin_scatter(const CPLDensityBinning* binning, const CPLScatter* scatter, size_t first,
+                                    size_t end, uint32_t* grid) {
+    const int width = binning->width;
+    const int height = binning->height;
+
+    if (!binning->linear) {
+        // Log, symlog and polar views go through the full transform
+        for (size_t i = first; i < end; i++) {
+            float ndc[2];
+            cpl_view_map(binning->view, scatter->origin, scatter->offsets + i * 2,
+                         scatter->low ? scatter->low + i * 2 : NULL, ndc);
+            double x = ndc[0] * binning->scale[0] + binning->shift[0];
+            double y = ndc[1] * binning->scale[1] + binning->shift[1];
+            if (x >= 0.0 && x < (double)width && y >= 0.0 && y < (double)height) {
+                grid[(size_t)y * (size_t)width + (size_t)x]++;
+            }
+        }
+        return;
+    }
+
+    // Linear axes: cell = offset * a + b per axis, with the origin's distance
+    // from the axis minimum folded into b in double precision (as cpl_view_map
+    // does), so deep zooms bin the offsets exactly
+    const CPLViewTransform* view = binning->view;
+    double a[2], b[2];
+    for (int axis = 0; axis < 2; axis++) {
+        a[axis] = view->factor[axis] * binning->scale[axis];
+        b[axis] = ((scatter->origin[axis] - view->min[axis]) * view->factor[axis] + view->box_min[axis]) *
+                  binning->scale[axis] + binning->shift[axis];
+    }
+    const float* offsets = scatter->offsets;
+    const float* low = scatter->low;
+    size_t i = first;
+
+#ifdef __SSE2__
+    // Two points per iteration; each point's x, y pair shares one register, so
+    // the scale, shift and box test are single vector operations
+    const __m128d scale = _mm_set_pd(a[1], a[0]);
+    const __m128d shift = _mm_set_pd(b[1], b[0]);
+    const __m128d zero = _mm_setzero_pd();
+    const __m128d limit = _mm_set_pd((double)height, (double)width);
+    for (; i + 2 <= end; i += 2) {
+        __m128 pair = _mm_loadu_ps(offsets + i * 2);
+        __m128d p0 = _mm_cvtps_pd(pair);
+        __m128d p1 = _mm_cvtps_pd(_mm_movehl_ps(pair, pair));
+        if (low) {
+            __m128 residuals = _mm_loadu_ps(low + i * 2);
+            p0 = _mm_add_pd(p0, _mm_cvtps_pd(residuals));
+            p1 = _mm_add_pd(p1, _mm_cvtps_pd(_mm_movehl_ps(residuals, residuals)));
+        }
+        p0 = _mm_add_pd(_mm_mul_pd(p0, scale), shift);
+        p1 = _mm_add_pd(_mm_mul_pd(p1, scale), shift);
+
+        // NaN fails both comparisons
+        int in0 = _mm_movemask_pd(_mm_and_pd(_mm_cmpge_pd(p0, zero), _mm_cmplt_pd(p0, limit)));
+        int in1 = _mm_movemask_pd(_mm_and_pd(_mm_cmpge_pd(p1, zero), _mm_cmplt_pd(p1, limit)));
+        if ((in0 & in1) == 3) {
+            __m128i cells = _mm_unpacklo_epi64(_mm_cvttpd_epi32(p0), _mm_cvttpd_epi32(p1));
+            int32_t xy[4];
+            _mm_storeu_si128((__m128i*)xy, cells);
+            grid[(size_t)xy[1] * (size_t)width + (size_t)xy[0]]++;
+            grid[(size_t)xy[3] * (size_t)width + (size_t)xy[2]]++;
+            continue;
+        }
+        if (in0 == 3) {
+            __m128i cell = _mm_cvttpd_epi32(p0);
+            int32_t x = _mm_cvtsi128_si32(cell);
+            int32_t y = _mm_cvtsi128_si32(_mm_srli_si128(cell, 4));
+            grid[(size_t)y * (size_t)width + (size_t)x]++;
+        }
+        if (in1 == 3) {
+            __m128i cell = _mm_cvttpd_epi32(p1);
+            int32_t x = _mm_cvtsi128_si32(cell);
+            int32_t y = _mm_cvtsi128_si32(_mm_srli_si128(cell, 4));
+            grid[(size_t)y * (size_t)width + (size_t)x]++;
+        }
+    }
+#endif
+
+    // Scalar path
+    for (; i < end; i++) {
+        double x = offsets[i * 2];
+        double y = offsets[i * 2 + 1];
+        if (low) {
+            x += low[i * 2];
+            y += low[i * 2 + 1];
+        }
+        x = x * a[0] + b[0];
+        y = y * a[1] + b[1];
+        if (x >= 0.0 && x < (double)width && y >= 0.0 && y < (double)height) {
+            grid[(size_t)y * (size_t)width + (size_t)x]++;
+        }
+    }
+}
+
+// Trace accumulation: every thread rasterizes a run of traces into a private
+// grid (the first one is the result), then the grids are summed in bands
+static bool cpl_traces_accumulate(CPLDensity* grid, const CPLTraces* traces, const CPLViewTransform* view,
+                                  const int* viewport, const int* box) {
+    CPLTracesBinning binning;
+    memset(&binning, 0, sizeof(binning));
+    binning.traces = traces;
+    binning.view = view;
+    binning.width = box[2];
+    binning.height = box[3];
+    binning.first = 0;
+    binning.count = traces->samples;
+    for (int axis = 0; axis < 2; axis++) {
+        binning.scale[axis] = 0.5 * (double)viewport[2 + axis];
+        binning.shift[axis] = binning.scale[axis] - (double)(box[axis] - viewport[axis]);
+    }
+
+    float* columns = NULL;
+    if (!view->polar) {
+        // Sorted x: only the samples in the box's x-range (plus the crossing
+        // segments) are rasterized
+        const float everywhere[4] = { -INFINITY, -INFINITY, INFINITY, INFINITY };
+        float window[4];
+        cpl_view_window(view, traces->origin, everywhere, grid->rect, window);
+        cpl_traces_visible_range(traces, window[0], window[2], &binning.first, &binning.count);
+
+        // Axes are independent: the columns of the shared x positions are mapped once
+        columns = (float*)malloc((binning.count > 0 ? binning.count : 1) * sizeof(float));
+        if (!columns) {
+            cpl_density_error("Failed to allocate trace columns");
+            return false;
+        }
+        for (size_t i = 0; i < binning.count; i++) {
+            const float vertex[2] = { traces->x[binning.first + i], 0.0f };
+            float ndc[2];
+            cpl_view_map(view, traces->origin, vertex, NULL, ndc);
+            columns[i] = (float)(ndc[0] * binning.scale[0] + binning.shift[0]);
+        }
+        binning.columns = columns;
+
+        // Linear y: the origin's distance from the axis minimum is folded into the shift
+        binning.linear_y = view->scale[1] == CPL_SCALE_LINEAR;
+        binning.y_scale = view->factor[1] * binning.scale[1];
+        binning.y_shift = ((traces->origin[1] - view->min[1]) * view->factor[1] + view->box_min[1]) *
+                          binning.scale[1] + binning.shift[1];
+    }
+
+    size_t cells = (size_t)box[2] * (size_t)box[3];
+    size_t total = traces->num_traces * binning.count;
+    size_t num_threads = cpl_image_default_threads();
+    if (num_threads > total / CPL_TRACES_THREAD_SAMPLES) num_threads = total / CPL_TRACES_THREAD_SAMPLES;
+    if (num_threads > traces->num_traces) num_threads = traces->num_traces;
+    if (num_threads == 0) num_threads = 1;
+
+    CPLTracesWorker* workers = (CPLTracesWorker*)calloc(num_threads, sizeof(CPLTracesWorker));
+    CPLTracesMerge* merges = (CPLTracesMerge*)calloc(num_threads, sizeof(CPLTracesMerge));
+    float** grids = (float**)calloc(num_threads, sizeof(float*));
+    bool ok = workers && merges && grids;
+    if (ok) {
+        memset(grid->counts, 0, cells * sizeof(float));
+        grids[0] = grid->counts;
+    }
+    for (size_t i = 1; ok && i < num_threads; i++) {
+        grids[i] = (float*)calloc(cells, sizeof(float));
+        ok = grids[i] != NULL;
+    }
+    for (size_t i = 0; ok && i < num_threads; i++) {
+        workers[i].points = (float*)malloc((binning.count > 0 ? binning.count : 1) * 2 * sizeof(float));
+        ok = workers[i].points != NULL;
+    }
+
+    if (ok) {
+        for (size_t i = 0; i < num_threads; i++) {
+            workers[i].binning = &binning;
+            workers[i].first = i * traces->num_traces / num_threads;
+            workers[i].end = (i + 1) * traces->num_traces / num_threads;
+            workers[i].grid = grids[i];
+        }
+        cpl_run_workers(workers, sizeof(CPLTracesWorker), num_threads, cpl_traces_worker_main);
+
+        for (size_t i = 0; i < num_threads; i++) {
+            merges[i].grids = grids;
+            merges[i].num_grids = num_threads;
+            merges[i].first = i * cells / num_threads;
+            merges[i].end = (i + 1) * cells / num_threads;
+        }
+        cpl_run_workers(merges, sizeof(CPLTracesMerge), num_threads, cpl_traces_merge_main);
+
+        float max = 0.0f;
+        for (size_t i = 0; i < num_threads; i++) {
+            if (merges[i].max > max) max = merges[i].max;
+        }
+        grid->max_count = max;
+    } else {
+        cpl_density_error("Failed to allocate trace accumulation grids");
+    }
+
+    for (size_t i = 0; workers && i < num_threads; i++) free(workers[i].points);
+    for (size_t i = 1; grids && i < num_threads; i++) free(grids[i]);
+    free(columns);
+    free(workers);
+    free(merges);
+    free(grids);
+    return ok;
+}
+
+static void* cpl_traces_worker_main(void* arg) {
+    CPLTracesWorker* worker = (CPLTracesWorker*)arg;
+    const CPLTracesBinning* binning = worker->binning;
+    const CPLTraces* traces = binning->traces;
+    if (binning->count < 2) return NULL;
+
+    for (size_t t = worker->first; t < worker->end; t++) {
+        // Faded weight of the trace's frame (as in the traces shader)
+        unsigned int age = traces->frame - traces->frames[t];
+        float weight = age == 0 ? 1.0f : powf(traces->decay, (float)age);
+        if (!(weight > 0.0f)) continue;
+
+        const float* y = traces->y + t * traces->samples + binning->first;
+        const float* x = traces->x + binning->first;
+        float* points = worker->points;
+        for (size_t i = 0; i < binning->count; i++) {
+            if (binning->columns && binning->linear_y) {
+                points[i * 2] = binning->columns[i];
+                points[i * 2 + 1] = (float)(y[i] * binning->y_scale + binning->y_shift);
+                continue;
+            }
+            const float vertex[2] = { x[i], y[i] };
+            float ndc[2];
+            cpl_view_map(binning->view, traces->origin, vertex, NULL, ndc);
+            points[i * 2] = binning->columns ? binning->columns[i]
+                                             : (float)(ndc[0] * binning->scale[0] + binning->shift[0]);
+            points[i * 2 + 1] = (float)(ndc[1] * binning->scale[1] + binning->shift[1]);
+        }
+
+        for (size_t i = 0; i + 1 < binning->count; i++) {
+            cpl_traces_segment(worker->grid, binning->width, binning->height, points[i * 2], points[i * 2 + 1],
+                               points[i * 2 + 2], points[i * 2 + 3], weight);
+        }
+    }
+    return NULL;
+}
+
+static void* cpl_traces_merge_main(void* arg) {
+    CPLTracesMerge* merge = (CPLTracesMerge*)arg;
+    float* counts = merge->grids[0];
+    float max = 0.0f;
+
+    for (size_t cell = merge->first; cell < merge->end; cell++) {
+        float sum = counts[cell];
+        for (size_t g = 1; g < merge->num_grids; g++) sum += merge->grids[g][cell];
+        counts[cell] = sum;
+        if (sum > max) max = sum;
+    }
+    merge->max = max;
+    return NULL;
+}
+
+// One-pixel line like GL's rasterization (diamond exit): the pixel on the
+// segment at each pixel center along the major axis, from the start point up
+// to but excluding the end point, so joined segments never count a pixel twice
+static void cpl_traces_segment(float* grid, int width, int height, double x0, double y0, double x1, double y1,
+                               float weight) {
+    double dx = x1 - x0;
+    double dy = y1 - y0;
+    if (!cpl_is_finite(dx) || !cpl_is_finite(dy)) return;
+
+    bool steep = fabs(dy) > fabs(dx);
+    double start = steep ? y0 : x0;
+    double end = steep ? y1 : x1;
+    double delta = end - start;
+    if (delta == 0.0) return;
+    double slope = (steep ? dx : dy) / delta;
+    double minor = steep ? x0 : y0;
+    int major_size = steep ? height : width;
+    int minor_size = steep ? width : height;
+
+    // Pixel centers c + 0.5 in [start, end), or in (end, start] going backwards
+    double low = delta > 0.0 ? ceil(start - 0.5) : floor(end - 0.5) + 1.0;
+    double high = delta > 0.0 ? ceil(end - 0.5) - 1.0 : floor(start - 0.5);
+    if (low < 0.0) low = 0.0;
+    if (high > (double)(major_size - 1)) high = (double)(major_size - 1);
+    if (low > high) return;
+
+    for (int c = (int)low; c <= (int)high; c++) {
+        double m = floor(minor + ((double)c + 0.5 - start) * slope);
+        if (m < 0.0 || m >= (double)minor_size) continue;
+        size_t cell = steep ? (size_t)c * (size_t)width + (size_t)m : (size_t)m * (size_t)width + (size_t)c;
+        grid[cell] += weight;
+    }
+}
+
+// Equalization levels: the counts at CPL_DENSITY_LEVELS evenly spaced ranks of
+// the non-empty cells
+bool cpl_density_equalize(CPLDensity* density) {
+    size_t cells = (size_t)density->width * (size_t)density->height;
+    size_t filled = 0;
+    for (size_t i = 0; i < cells; i++) filled += density->counts[i] > 0.0f;
+
+    if (filled == 0) {
+        for (int k = 0; k < CPL_DENSITY_LEVELS; k++) density->levels[k] = 1.0f;
+        density->level_base = CPL_DENSITY_LEVELS - 1;
+        return true;
+    }
+
+    if (!density->weighted && density->max_count <= (float)CPL_DENSITY_HISTOGRAM_LIMIT) {
+        // Counts are small integers: count them, then walk the cumulative counts
+        size_t values = (size_t)density->max_count + 1;
+        uint32_t* histogram = (uint32_t*)calloc(values, sizeof(uint32_t));
+        if (!histogram) {
+            cpl_density_error("Failed to allocate density histogram");
+            return false;
+        }
+        for (size_t i = 0; i < cells; i++) histogram[(size_t)density->counts[i]]++;
+
+        size_t value = 1;
+        size_t below = 0;    // Non-empty cells with counts under `value`
+        for (int k = 0; k < CPL_DENSITY_LEVELS; k++) {
+            size_t rank = (size_t)k * (filled - 1) / (CPL_DENSITY_LEVELS - 1);
+            while (below + histogram[value] <= rank) {
+                below += histogram[value];
+                value++;
+            }
+            density->levels[k] = (float)value;
+        }
+        free(histogram);
+    } else {
+        float* sorted = (float*)malloc(filled * sizeof(float));
+        if (!sorted) {
+            cpl_density_error("Failed to allocate density histogram");
+            return false;
+        }
+        size_t n = 0;
+        for (size_t i = 0; i < cells; i++) {
+            if (density->counts[i] > 0.0f) sorted[n++] = density->counts[i];
+        }
+        qsort(sorted, filled, sizeof(float), cpl_density_compare);
+        for (int k = 0; k < CPL_DENSITY_LEVELS; k++) {
+            density->levels[k] = sorted[(size_t)k * (filled - 1) / (CPL_DENSITY_LEVELS - 1)];
+        }
+        free(sorted);
+    }
+
+    int base = 0;
+    while (base + 1 < CPL_DENSITY_LEVELS && density->levels[base + 1] == density->levels[0]) base++;
+    density->level_base = base;
+    return true;
+}
+
+static int cpl_density_compare(const void* a, const void* b) {
+    float x = *(const float*)a;
+    float y = *(const float*)b;
+    return (x > y) - (x < y);
+}
+
+static void cpl_density_error(const char* message) {
+    fprintf(stderr, "CPlotLib Error: %s\n", message);
+}
@@ -0,0 +1,76 @@
+#ifndef CPL_DENSITY_H
+#define CPL_DENSITY_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include "CPLPlot.h"
+#include "CPLTransform.h"
+
+// Constants
+#define CPL_DENSITY_LEVELS 256           // Equalization quantiles (also a uniform array in the density shader)
+
+// Density mode grid: the points of all of a plot's scatters counted per pixel
+// of its plot box. Binning only reruns when the view, the viewport size or the
+// number of scatters changes (a new normalization at most re-equalizes the
+// counts); the GPU path keeps the counts in an R32F texture and normalizes them
+// in the fragment shader, the CPU backends call cpl_density_level.
+// Persistence traces use the same grid for their accumulated weights.
+typedef struct CPLDensity {
+    float* counts;               // width * height cells, bottom-up rows
+    int width, height;           // Plot box size in pixels
+    float rect[4];               // Plot NDC covered by the grid (min x, min y, max x, max y)
+    float max_count;
+    bool weighted;               // Counts are faded trace weights rather than whole numbers
+
+    // Equalization: counts at evenly spaced ranks of the non-empty cells, and
+    // the last level equal to the smallest count (those cells map to 0)
+    float levels[CPL_DENSITY_LEVELS];
+    int level_base;
+
+    // Cache key
+    CPLViewTransform view;
+    int viewport_size[2];
+    CPLDensityNorm norm;
+    size_t num_inputs;           // Scatters binned, or traces accumulated
+    unsigned int frame;          // Traces: frame the weights were taken at
+
+    // OpenGL texture (created by the first GL draw); traces render into it
+    // through the framebuffer
+    unsigned int texture, vao;
+    unsigned int framebuffer;
+    int texture_size[2];
+    bool texture_dirty;          // Counts changed since the last upload
+    
+    // Traces: pixel pack buffer the weights are copied into, and the fence
+    // (a GLsync) of a copy not collected yet
+    unsigned int readback_buffer;
+    void* readback_fence;
+} CPLDensity;
+
+// Grid of `plot` drawn into `viewport` (canvas pixels), rebinned if the cached one
+// is stale; NULL when density mode is off, there are no points or allocation fails
+CPLDensity* cpl_density_update(CPLPlot* plot, const int* viewport);
+
+// Weighted hits of the persistence traces of `plot` per pixel of its plot box,
+// rasterized on the CPU; reaccumulated only when the view, the viewport size,
+// the traces or the frame changed. NULL without traces or on failure.
+CPLDensity* cpl_traces_grid(CPLPlot* plot, const int* viewport);
+
+// Sets the NDC rectangle of a grid covering `box` (canvas pixels) of `viewport`
+void cpl_density_place(CPLDensity* density, const int* viewport, const int* box);
+
+// Equalization levels of the current counts (after max_count is set)
+bool cpl_density_equalize(CPLDensity* density);
+
+// Position of `count` on the colormap, in [0, 1] (counts must be non-zero)
+float cpl_density_level(const CPLDensity* density, CPLDensityNorm norm, float count);
+
+// CPU backends: RGBA8 colors of the cells (x, y, width, height) of the grid,
+// row y written at pixels + y * stride (bottom-up like the counts; pass the
+// last row and a negative stride for top-down). Empty cells are transparent.
+bool cpl_density_colors(const CPLDensity* density, CPLDensityNorm norm, CPLColormap colormap, const int* cells,
+                        unsigned char* pixels, ptrdiff_t stride);
+
+void cpl_free_density(CPLDensity* density);
+
+#endif // CPL_DENSITY_H
@@ -0,0 +1,229 @@
+#include "CPLGeometry.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <GL/glew.h>
+
+// Internal function declarations
+static CPLGeometry* cpl_find_geometry(CPLGeometryCache* cache, float margin, int grid_lines, bool show_axes);
+static CPLGeometry* cpl_insert_geometry(CPLGeometryCache* cache, float margin, int grid_lines, bool show_axes,
+                                        const float* vertices, size_t num_vertices);
+static void cpl_delete_geometry(CPLGeometry* geometry);
+static void cpl_geometry_error(const char* message);
+
+// Cache management
+CPLGeometryCache* cpl_create_geometry_cache(bool use_gl) {
+    CPLGeometryCache* cache = (CPLGeometryCache*)calloc(1, sizeof(CPLGeometryCache));
+    if (!cache) {
+        cpl_geometry_error("Failed to allocate geometry cache");
+        return NULL;
+    }
+    cache->use_gl = use_gl;
+    return cache;
+}
+
+void cpl_destroy_geometry_cache(CPLGeometryCache* cache) {
+    if (!cache) return;
+    
+    // Any entries left here are leaked references; the GL objects go anyway
+    for (size_t i = 0; i < cache->num_entries; i++) {
+        cpl_delete_geometry(cache->entries[i]);
+    }
+    
+    free(cache->entries);
+    free(cache);
+}
+
+// Shared geometry access
+CPLGeometry* cpl_acquire_box_geometry(CPLGeometryCache* cache, float margin) {
+    if (!cache) return NULL;
+    
+    // Boxes are keyed with grid_lines == 0; the axis flag does not affect them
+    CPLGeometry* geometry = cpl_find_geometry(cache, margin, 0, false);
+    if (geometry) {
+        geometry->ref_count++;
+        return geometry;
+    }
+    
+    float vertices[20]; // 4 vertices * (2 coords + 3 color)
+    cpl_build_box_vertices(margin, vertices);
+    return cpl_insert_geometry(cache, margin, 0, false, vertices, cpl_box_vertex_count());
+}
+
+CPLGeometry* cpl_acquire_grid_geometry(CPLGeometryCache* cache, float margin, int grid_lines, bool show_axes) {
+    if (!cache || grid_lines <= 0) return NULL;
+    
+    CPLGeometry* geometry = cpl_find_geometry(cache, margin, grid_lines, show_axes);
+    if (geometry) {
+        geometry->ref_count++;
+        return geometry;
+    }
+    
+    size_t num_vertices = cpl_grid_vertex_count(grid_lines);
+    float* vertices = (float*)malloc(num_vertices * 5 * sizeof(float)); // 5 floats per vertex
+    if (!vertices) {
+        cpl_geometry_error("Failed to allocate memory for grid");
+        return NULL;
+    }
+    
+    cpl_build_grid_vertices(margin, grid_lines, show_axes, vertices);
+    geometry = cpl_insert_geometry(cache, margin, grid_lines, show_axes, vertices, num_vertices);
+    
+    free(vertices);
+    return geometry;
+}
+
+void cpl_release_geometry(CPLGeometryCache* cache, CPLGeometry* geometry) {
+    if (!cache || !geometry) return;
+    
+    if (geometry->ref_count > 1) {
+        geometry->ref_count--;
+        return;
+    }
+    
+    // Last reference: drop the entry from the cache (order is irrelevant)
+    for (size_t i = 0; i < cache->num_entries; i++) {
+        if (cache->entries[i] == geometry) {
+            cache->entries[i] = cache->entries[cache->num_entries - 1];
+            cache->num_entries--;
+            break;
+        }
+    }
+    
+    cpl_delete_geometry(geometry);
+}
+
+// CPU-side vertex generation
+size_t cpl_box_vertex_count(void) {
+    return 4;
+}
+
+size_t cpl_grid_vertex_count(int grid_lines) {
+    return (size_t)(grid_lines + 1) * 2 * 2; // (horizontal + vertical lines) * 2 vertices
+}
+
+void cpl_build_box_vertices(float margin, float* vertices) {
+    if (!vertices) return;
+    
+    const float corners[4][2] = {
+        { -1.0f + margin, -1.0f + margin },  // Bottom-left
+        {  1.0f - margin, -1.0f + margin },  // Bottom-right
+        {  1.0f - margin,  1.0f - margin },  // Top-right
+        { -1.0f + margin,  1.0f - margin }   // Top-left
+    };
+    
+    for (int i = 0; i < 4; i++) {
+        vertices[i * 5 + 0] = corners[i][0];  // x
+        vertices[i * 5 + 1] = corners[i][1];  // y
+        vertices[i * 5 + 2] = 0.0f;           // r
+        vertices[i * 5 + 3] = 0.0f;           // g
+        vertices[i * 5 + 4] = 0.0f;           // b
+    }
+}
+
+void cpl_build_grid_vertices(float margin, int grid_lines, bool show_axes, float* vertices) {
+    if (!vertices || grid_lines <= 0) return;
+    
+    int vertex_index = 0;
+    
+    // Note: Center lines (axes) are determined by checking if i == grid_lines / 2
+    
+    // Pass 0 emits horizontal grid lines, pass 1 vertical ones
+    for (int pass = 0; pass < 2; pass++) {
+        for (int i = 0; i <= grid_lines; i++) {
+            float pos = -1.0f + margin + (2.0f - 2.0f * margin) * i / grid_lines;
+            
+            // Choose color: darker for axes, lighter for grid
+            bool is_axis = (i == grid_lines / 2);
+            float shade = (is_axis && show_axes) ? 0.2f : 0.7f;
+            
+            for (int end = 0; end < 2; end++) {
+                float extent = end == 0 ? -1.0f + margin : 1.0f - margin;
+                vertices[vertex_index * 5 + 0] = pass == 0 ? extent : pos;  // x
+                vertices[vertex_index * 5 + 1] = pass == 0 ? pos : extent;  // y
+                vertices[vertex_index * 5 + 2] = shade;                     // r
+                vertices[vertex_index * 5 + 3] = shade;                     // g
+                vertices[vertex_index * 5 + 4] = shade;                     // b
+                vertex_index++;
+            }
+        }
+    }
+}
+
+// Internal helper functions
+static CPLGeometry* cpl_find_geometry(CPLGeometryCache* cache, float margin, int grid_lines, bool show_axes) {
+    for (size_t i = 0; i < cache->num_entries; i++) {
+        CPLGeometry* geometry = cache->entries[i];
+        if (geometry->margin == margin && geometry->grid_lines == grid_lines &&
+            geometry->show_axes == show_axes) {
+            return geometry;
+        }
+    }
+    return NULL;
+}
+
+static CPLGeometry* cpl_insert_geometry(CPLGeometryCache* cache, float margin, int grid_lines, bool show_axes,
+                                        const float* vertices, size_t num_vertices) {
+    // Expand entry array if needed
+    if (cache->num_entries >= cache->capacity) {
+        size_t new_capacity = cache->capacity == 0 ? CPL_INITIAL_CAPACITY : cache->capacity * 2;
+        CPLGeometry** new_entries = (CPLGeometry**)realloc(cache->entries, new_capacity * sizeof(CPLGeometry*));
+        if (!new_entries) {
+            cpl_geometry_error("Failed to grow geometry cache");
+            return NULL;
+        }
+        cache->entries = new_entries;
+        cache->capacity = new_capacity;
+    }
+    
+    CPLGeometry* geometry = (CPLGeometry*)calloc(1, sizeof(CPLGeometry));
+    if (!geometry) {
+        cpl_geometry_error("Failed to allocate geometry");
+        return NULL;
+    }
+    
+    geometry->margin = margin;
+    geometry->grid_lines = grid_lines;
+    geometry->show_axes = show_axes;
+    geometry->num_vertices = num_vertices;
+    geometry->ref_count = 1;
+    
+    if (!cache->use_gl) {
+        cache->entries[cache->num_entries++] = geometry;
+        return geometry;
+    }
+    
+    // Create OpenGL objects
+    glGenVertexArrays(1, &geometry->vao);
+    glGenBuffers(1, &geometry->vbo);
+    
+    glBindVertexArray(geometry->vao);
+    glBindBuffer(GL_ARRAY_BUFFER, geometry->vbo);
+    glBufferData(GL_ARRAY_BUFFER, num_vertices * 5 * sizeof(float), vertices, GL_STATIC_DRAW);
+    
+    // Position attribute
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
+    
+    // Color attribute
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(2 * sizeof(float)));
+    
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+    
+    cache->entries[cache->num_entries++] = geometry;
+    return geometry;
+}
+
+static void cpl_delete_geometry(CPLGeometry* geometry) {
+    if (!geometry) return;
+    
+    if (geometry->vbo) glDeleteBuffers(1, &geometry->vbo);
+    if (geometry->vao) glDeleteVertexArrays(1, &geometry->vao);
+    free(geometry);
+}
+
+static void cpl_geometry_error(const char* message) {
+    fprintf(stderr, "CPlotLib Error: %s\n", message);
+}
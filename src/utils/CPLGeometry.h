@@ -0,0 +1,34 @@
+#ifndef CPL_GEOMETRY_H
+#define CPL_GEOMETRY_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include "CPLPlot.h"
+
+// Figure-level cache of static plot geometry (plot boxes and grids).
+// Every plot with the same margin, grid density and axis flag shares one
+// VAO/VBO pair; entries are reference counted and freed with their last user.
+// Caches of GL-less (software) figures only track the parameters.
+typedef struct CPLGeometryCache {
+    CPLGeometry** entries;
+    size_t num_entries;
+    size_t capacity;
+    bool use_gl;
+} CPLGeometryCache;
+
+// Cache management
+CPLGeometryCache* cpl_create_geometry_cache(bool use_gl);
+void cpl_destroy_geometry_cache(CPLGeometryCache* cache);
+
+// Shared geometry access (each acquire must be paired with a release)
+CPLGeometry* cpl_acquire_box_geometry(CPLGeometryCache* cache, float margin);
+CPLGeometry* cpl_acquire_grid_geometry(CPLGeometryCache* cache, float margin, int grid_lines, bool show_axes);
+void cpl_release_geometry(CPLGeometryCache* cache, CPLGeometry* geometry);
+
+// CPU-side vertex generation (5 floats per vertex: x, y, r, g, b)
+size_t cpl_box_vertex_count(void);
+size_t cpl_grid_vertex_count(int grid_lines);
+void cpl_build_box_vertices(float margin, float* vertices);
+void cpl_build_grid_vertices(float margin, int grid_lines, bool show_axes, float* vertices);
+
+#endif // CPL_GEOMETRY_H
@@ -0,0 +1,307 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "CPLHistogram.h"
+#include "CPLUtils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <GL/glew.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Constants
+#define CPL_HISTOGRAM_THREAD_SAMPLES (1u << 20)  // Samples per counting thread at least
+#define CPL_HISTOGRAM_POLAR_SEGMENTS 16          // Steps along a bar's arcs on polar plots
+#define CPL_TWO_PI 6.283185307179586
+
+// One worker: samples [first, end), counted into `counts` (its own scratch
+// except for thread 0, which counts into the result) or scanned for the range
+typedef struct {
+    const double* data;
+    size_t first, end;
+    size_t bins;
+    double range[2];
+    uint64_t* counts;
+    double min, max;
+} CPLHistogramWorker;
+
+// Internal function declarations
+static size_t cpl_histogram_threads(size_t n);
+static void* cpl_histogram_range_main(void* arg);
+static void* cpl_histogram_count_main(void* arg);
+static bool cpl_histogram_bin_at(const CPLHistogram* histogram, const CPLViewTransform* view, double x, size_t* bin);
+static void cpl_histogram_error(const char* message);
+
+bool cpl_histogram_range(const double* data, size_t n, double* range) {
+    size_t num_threads = cpl_histogram_threads(n);
+    CPLHistogramWorker* workers = (CPLHistogramWorker*)calloc(num_threads, sizeof(CPLHistogramWorker));
+    if (!workers) {
+        cpl_histogram_error("Failed to allocate histogram workers");
+        return false;
+    }
+    for (size_t i = 0; i < num_threads; i++) {
+        workers[i].data = data;
+        workers[i].first = i * n / num_threads;
+        workers[i].end = (i + 1) * n / num_threads;
+    }
+    cpl_run_workers(workers, sizeof(CPLHistogramWorker), num_threads, cpl_histogram_range_main);
+
+    range[0] = INFINITY;
+    range[1] = -INFINITY;
+    for (size_t i = 0; i < num_threads; i++) {
+        if (workers[i].min < range[0]) range[0] = workers[i].min;
+        if (workers[i].max > range[1]) range[1] = workers[i].max;
+    }
+    free(workers);
+    return range[0] <= range[1];
+}
+
+bool cpl_histogram_count(const double* data, size_t n, size_t bins, const double* range, uint64_t* counts) {
+    size_t num_threads = cpl_histogram_threads(n);
+    CPLHistogramWorker* workers = (CPLHistogramWorker*)calloc(num_threads, sizeof(CPLHistogramWorker));
+    bool ok = workers != NULL;
+    for (size_t i = 1; ok && i < num_threads; i++) {
+        workers[i].counts = (uint64_t*)calloc(bins, sizeof(uint64_t));
+        ok = workers[i].counts != NULL;
+    }
+
+    if (ok) {
+        for (size_t i = 0; i < num_threads; i++) {
+            workers[i].data = data;
+            workers[i].first = i * n / num_threads;
+            workers[i].end = (i + 1) * n / num_threads;
+            workers[i].bins = bins;
+            workers[i].range[0] = range[0];
+            workers[i].range[1] = range[1];
+        }
+        workers[0].counts = counts;
+        cpl_run_workers(workers, sizeof(CPLHistogramWorker), num_threads, cpl_histogram_count_main);
+
+        // Per-thread counts are merged once, so the hot loop never shares a cache line
+        for (size_t i = 1; i < num_threads; i++) {
+            for (size_t bin = 0; bin < bins; bin++) counts[bin] += workers[i].counts[bin];
+        }
+    } else {
+        cpl_histogram_error("Failed to allocate histogram counts");
+    }
+
+    for (size_t i = 1; workers && i < num_threads; i++) free(workers[i].counts);
+    free(workers);
+    return ok;
+}
+
+bool cpl_histogram_visible_bins(const CPLHistogram* histogram, const CPLViewTransform* view, const float* ndc_rect,
+                                size_t* first, size_t* count) {
+    *first = 0;
+    *count = histogram->bins;
+    if (view->polar) return true;
+
+    // Bar offsets from the origin span the range in x and start at 0 in y
+    const double origin[2] = { histogram->origin, 0.0 };
+    const float bounds[4] = {
+        (float)(histogram->range[0] - histogram->origin), 0.0f,
+        (float)(histogram->range[1] - histogram->origin), INFINITY
+    };
+    float window[4];
+    if (!cpl_view_window(view, origin, bounds, ndc_rect, window)) return false;
+
+    double width = (histogram->range[1] - histogram->range[0]) / (double)histogram->bins;
+    double left = (histogram->origin + window[0] - histogram->range[0]) / width;
+    double right = (histogram->origin + window[2] - histogram->range[0]) / width;
+    size_t begin = left > 0.0 ? (size_t)fmin(floor(left), (double)histogram->bins) : 0;
+    size_t end = right > 0.0 ? (size_t)fmin(ceil(right), (double)histogram->bins) : 0;
+    if (end <= begin) return false;
+    *first = begin;
+    *count = end - begin;
+    return true;
+}
+
+int cpl_histogram_segments(const CPLViewTransform* view) {
+    return view->polar ? CPL_HISTOGRAM_POLAR_SEGMENTS : 1;
+}
+
+bool cpl_histogram_colors(const CPLPlot* plot, const int* viewport, const int* box, const int* cells,
+                          unsigned char* pixels, ptrdiff_t stride) {
+    const CPLHistogram* histogram = plot && plot->data ? plot->data->histogram : NULL;
+    if (!histogram || cells[2] <= 0 || cells[3] <= 0) return false;
+
+    CPLViewTransform view;
+    cpl_view_transform(plot, viewport, &view);
+
+    size_t* columns = (size_t*)malloc((size_t)cells[2] * sizeof(size_t));
+    double* heights = (double*)malloc((size_t)cells[3] * sizeof(double));
+    if (!columns || !heights) {
+        cpl_histogram_error("Failed to allocate histogram image");
+        free(columns);
+        free(heights);
+        return false;
+    }
+
+    const unsigned char rgba[4] = {
+        (unsigned char)(fminf(fmaxf(histogram->color.r, 0.0f), 1.0f) * 255.0f + 0.5f),
+        (unsigned char)(fminf(fmaxf(histogram->color.g, 0.0f), 1.0f) * 255.0f + 0.5f),
+        (unsigned char)(fminf(fmaxf(histogram->color.b, 0.0f), 1.0f) * 255.0f + 0.5f),
+        (unsigned char)(fminf(fmaxf(histogram->color.a, 0.0f), 1.0f) * 255.0f + 0.5f)
+    };
+
+    // Pixel centres in NDC of the viewport
+    double ndc_scale[2], ndc_shift[2];
+    for (int axis = 0; axis < 2; axis++) {
+        ndc_scale[axis] = 2.0 / (double)viewport[2 + axis];
+        ndc_shift[axis] = (double)(box[axis] + cells[axis] - viewport[axis]) + 0.5;
+    }
+
+    // Cartesian axes are independent: bins per column and data y per row of pixels
+    if (!view.polar) {
+        for (int x = 0; x < cells[2]; x++) {
+            double ndc[2] = { (ndc_shift[0] + x) * ndc_scale[0] - 1.0, 0.0 };
+            double data[2];
+            cpl_view_unmap(&view, ndc, data);
+            if (!cpl_histogram_bin_at(histogram, &view, data[0], &columns[x])) columns[x] = SIZE_MAX;
+        }
+        for (int y = 0; y < cells[3]; y++) {
+            double ndc[2] = { 0.0, (ndc_shift[1] + y) * ndc_scale[1] - 1.0 };
+            double data[2];
+            cpl_view_unmap(&view, ndc, data);
+            heights[y] = data[1];
+        }
+    }
+
+    for (int y = 0; y < cells[3]; y++) {
+        unsigned char* out = pixels + (ptrdiff_t)y * stride;
+        for (int x = 0; x < cells[2]; x++, out += 4) {
+            size_t bin;
+            double height;
+            if (view.polar) {
+                double ndc[2] = { (ndc_shift[0] + x) * ndc_scale[0] - 1.0, (ndc_shift[1] + y) * ndc_scale[1] - 1.0 };
+                double data[2];
+                cpl_view_unmap(&view, ndc, data);
+                if (!cpl_histogram_bin_at(histogram, &view, data[0], &bin)) bin = SIZE_MAX;
+                height = data[1];
+            } else {
+                bin = columns[x];
+                height = heights[y];
+            }
+
+            // Bars run from 0 up to their count, as the vertex shader draws them
+            if (bin != SIZE_MAX && height >= 0.0 && height <= (double)histogram->counts[bin]) {
+                memcpy(out, rgba, 4);
+            } else {
+                memset(out, 0, 4);
+            }
+        }
+    }
+
+    free(columns);
+    free(heights);
+    return true;
+}
+
+void cpl_free_histogram(CPLHistogram* histogram) {
+    if (!histogram) return;
+
+    if (histogram->vao) glDeleteVertexArrays(1, &histogram->vao);
+    if (histogram->vbo) glDeleteBuffers(1, &histogram->vbo);
+    free(histogram->counts);
+    free(histogram);
+}
+
+// Internal helper functions
+static size_t cpl_histogram_threads(size_t n) {
+    size_t num_threads = cpl_image_default_threads();
+    if (num_threads > n / CPL_HISTOGRAM_THREAD_SAMPLES) num_threads = n / CPL_HISTOGRAM_THREAD_SAMPLES;
+    return num_threads == 0 ? 1 : num_threads;
+}
+
+static void* cpl_histogram_range_main(void* arg) {
+    CPLHistogramWorker* worker = (CPLHistogramWorker*)arg;
+    double min = INFINITY, max = -INFINITY;
+    for (size_t i = worker->first; i < worker->end; i++) {
+        double value = worker->data[i];
+        if (!cpl_is_finite(value)) continue;
+        if (value < min) min = value;
+        if (value > max) max = value;
+    }
+    worker->min = min;
+    worker->max = max;
+    return NULL;
+}
+
+// Bin = (x - min) * bins / (max - min), clamped so that x == max lands in the
+// last bin; samples outside [min, max] (and NaNs) fail the range test
+static void* cpl_histogram_count_main(void* arg) {
+    CPLHistogramWorker* worker = (CPLHistogramWorker*)arg;
+    const double* data = worker->data;
+    uint64_t* counts = worker->counts;
+    const double min = worker->range[0];
+    const double max = worker->range[1];
+    const double scale = (double)worker->bins / (max - min);
+    const double last = (double)(worker->bins - 1);
+    size_t i = worker->first;
+
+#ifdef __SSE2__
+    // Four samples per iteration in two registers; the common all-inside case
+    // costs two compares, a multiply-add, a clamp and a truncation per pair.
+    // Bin indices are converted as 32-bit integers, so larger histograms stay scalar.
+    if (worker->bins <= (size_t)INT32_MAX) {
+        const __m128d low = _mm_set1_pd(min);
+        const __m128d high = _mm_set1_pd(max);
+        const __m128d factor = _mm_set1_pd(scale);
+        const __m128d top = _mm_set1_pd(last);
+        for (; i + 4 <= worker->end; i += 4) {
+            __m128d x0 = _mm_loadu_pd(data + i);
+            __m128d x1 = _mm_loadu_pd(data + i + 2);
+
+            // NaN fails both comparisons
+            int in0 = _mm_movemask_pd(_mm_and_pd(_mm_cmpge_pd(x0, low), _mm_cmple_pd(x0, high)));
+            int in1 = _mm_movemask_pd(_mm_and_pd(_mm_cmpge_pd(x1, low), _mm_cmple_pd(x1, high)));
+            __m128i b0 = _mm_cvttpd_epi32(_mm_min_pd(_mm_mul_pd(_mm_sub_pd(x0, low), factor), top));
+            __m128i b1 = _mm_cvttpd_epi32(_mm_min_pd(_mm_mul_pd(_mm_sub_pd(x1, low), factor), top));
+            int32_t bin[4];
+            _mm_storeu_si128((__m128i*)bin, _mm_unpacklo_epi64(b0, b1));
+
+            if ((in0 & in1) == 3) {
+                counts[bin[0]]++;
+                counts[bin[1]]++;
+                counts[bin[2]]++;
+                counts[bin[3]]++;
+                continue;
+            }
+            if (in0 & 1) counts[bin[0]]++;
+            if (in0 & 2) counts[bin[1]]++;
+            if (in1 & 1) counts[bin[2]]++;
+            if (in1 & 2) counts[bin[3]]++;
+        }
+    }
+#endif
+
+    // Scalar path
+    for (; i < worker->end; i++) {
+        double x = data[i];
+        if (cpl_is_nan(x) || !(x >= min && x <= max)) continue;
+        double bin = (x - min) * scale;
+        counts[(size_t)(bin < last ? bin : last)]++;
+    }
+    return NULL;
+}
+
+// Bin under data x (polar: an angle, taken modulo 2 pi from the range minimum)
+static bool cpl_histogram_bin_at(const CPLHistogram* histogram, const CPLViewTransform* view, double x, size_t* bin) {
+    const double* range = histogram->range;
+    if (view->polar) {
+        x = range[0] + fmod(fmod(x - range[0], CPL_TWO_PI) + CPL_TWO_PI, CPL_TWO_PI);
+    }
+    if (!(x >= range[0] && x <= range[1])) return false;
+
+    double position = (x - range[0]) * (double)histogram->bins / (range[1] - range[0]);
+    *bin = position < (double)(histogram->bins - 1) ? (size_t)position : histogram->bins - 1;
+    return true;
+}
+
+static void cpl_histogram_error(const char* message) {
+    fprintf(stderr, "CPlotLib Error: %s\n", message);
+}
@@ -0,0 +1,39 @@
+#ifndef CPL_HISTOGRAM_H
+#define CPL_HISTOGRAM_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "CPLPlot.h"
+#include "CPLTransform.h"
+
+// Histograms are counted on the CPU: every thread bins a slice of the samples
+// into its own counts (two samples per SSE2 iteration), and the per-thread
+// counts are summed at the end. The GPU draws one instanced bar per bin from
+// the counts alone; the CPU backends fill the same bars per pixel.
+
+// Finite minimum and maximum of `n` samples; false when there are none
+bool cpl_histogram_range(const double* data, size_t n, double* range);
+
+// Adds the samples inside `range` (the last bin includes its right edge) to
+// `counts`; false when the thread scratch counts cannot be allocated
+bool cpl_histogram_count(const double* data, size_t n, size_t bins, const double* range, uint64_t* counts);
+
+// Bins [*first, *first + *count) reaching the NDC rectangle (min x, min y,
+// max x, max y); all of them on polar views. False when none do.
+bool cpl_histogram_visible_bins(const CPLHistogram* histogram, const CPLViewTransform* view, const float* ndc_rect,
+                                size_t* first, size_t* count);
+
+// Steps along the bar edges: one on cartesian plots, more to follow polar arcs
+int cpl_histogram_segments(const CPLViewTransform* view);
+
+// CPU backends: RGBA8 colors of the histogram of `plot` drawn into `viewport`
+// (canvas pixels) for the pixels `cells` (x, y, width, height, relative to the
+// plot box `box`), row y written at pixels + y * stride (bottom-up). Pixels
+// outside the bars are transparent.
+bool cpl_histogram_colors(const CPLPlot* plot, const int* viewport, const int* box, const int* cells,
+                          unsigned char* pixels, ptrdiff_t stride);
+
+void cpl_free_histogram(CPLHistogram* histogram);
+
+#endif // CPL_HISTOGRAM_H
@@ -0,0 +1,571 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "CPLImage.h"
+#include "CPLUtils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+
+// Output sink: a file or a growing memory buffer
+typedef struct {
+    FILE* file;
+    unsigned char* data;
+    size_t size, capacity;
+    bool failed;
+} CPLImageSink;
+
+// One horizontal band of a PNG, filtered and deflated independently
+typedef struct {
+    const unsigned char* pixels;
+    size_t width;
+    ptrdiff_t stride;
+    size_t row_start, row_end;
+    const unsigned char* prior;     // Row above row_start (NULL for the first image row)
+    bool last;                      // Final band terminates the deflate stream
+    
+    unsigned char* out;             // Raw deflate data (no zlib header)
+    size_t out_size;
+    unsigned long adler;            // Adler-32 of this band's filtered bytes
+    size_t filtered_size;
+    bool ok;
+} CPLPngBand;
+
+// Incremental PNG writer: row bands are compressed and written as they arrive
+struct CPLPngStream {
+    CPLImageSink sink;
+    size_t width, height;
+    size_t rows_written;
+    size_t threads;
+    unsigned long adler;            // Running Adler-32 of all filtered rows
+    unsigned char* prior;           // Copy of the last row written (filter reference for the next band)
+};
+
+// Internal function declarations
+static bool cpl_png_encode(CPLImageSink* sink, const unsigned char* pixels, size_t width, size_t height,
+                           ptrdiff_t stride, size_t threads);
+static void cpl_png_write_header(CPLImageSink* sink, size_t width, size_t height);
+static bool cpl_png_write_bands(CPLImageSink* sink, const unsigned char* pixels, size_t width, size_t height,
+                                ptrdiff_t stride, const unsigned char* prior, bool last, size_t threads,
+                                unsigned long* adler);
+static void* cpl_png_band_main(void* arg);
+static const unsigned char* cpl_png_filter_row(const unsigned char* row, const unsigned char* prior,
+                                               size_t row_bytes, unsigned char* scratch);
+static void cpl_png_write_chunk(CPLImageSink* sink, const char* type, const unsigned char* data, size_t length);
+static bool cpl_qoi_encode(CPLImageSink* sink, const unsigned char* pixels, size_t width, size_t height, ptrdiff_t stride);
+static void cpl_put_u32(unsigned char* out, unsigned long value);
+static void cpl_sink_write(CPLImageSink* sink, const void* data, size_t length);
+static bool cpl_write_file(const char* filename, const unsigned char* pixels, size_t width, size_t height,
+                           ptrdiff_t stride, bool qoi);
+static void cpl_image_error(const char* message);
+
+// Constants
+#define CPL_PNG_MIN_BAND_ROWS 32        // Bands smaller than this are not worth a thread
+#define CPL_PNG_LEVEL 6                 // zlib's default speed/size trade-off
+
+// File output
+bool cpl_write_png(const char* filename, const unsigned char* pixels, size_t width, size_t height, ptrdiff_t stride) {
+    return cpl_write_file(filename, pixels, width, height, stride, false);
+}
+
+bool cpl_write_qoi(const char* filename, const unsigned char* pixels, size_t width, size_t height, ptrdiff_t stride) {
+    return cpl_write_file(filename, pixels, width, height, stride, true);
+}
+
+// In-memory encoding
+size_t cpl_encode_png(const unsigned char* pixels, size_t width, size_t height, ptrdiff_t stride,
+                      size_t threads, unsigned char** out) {
+    if (!out) return 0;
+    *out = NULL;
+    
+    CPLImageSink sink = { 0 };
+    if (!cpl_png_encode(&sink, pixels, width, height, stride, threads) || sink.failed) {
+        free(sink.data);
+        return 0;
+    }
+    *out = sink.data;
+    return sink.size;
+}
+
+size_t cpl_encode_qoi(const unsigned char* pixels, size_t width, size_t height, ptrdiff_t stride,
+                      unsigned char** out) {
+    if (!out) return 0;
+    *out = NULL;
+    
+    CPLImageSink sink = { 0 };
+    if (!cpl_qoi_encode(&sink, pixels, width, height, stride) || sink.failed) {
+        free(sink.data);
+        return 0;
+    }
+    *out = sink.data;
+    return sink.size;
+}
+
+// Streaming PNG output
+CPLPngStream* cpl_png_stream_open(const char* filename, size_t width, size_t height, size_t threads) {
+    if (!filename || width == 0 || height == 0) {
+        cpl_image_error("Invalid PNG parameters");
+        return NULL;
+    }
+    
+    CPLPngStream* stream = (CPLPngStream*)calloc(1, sizeof(CPLPngStream));
+    unsigned char* prior = (unsigned char*)malloc(width * 4);
+    if (!stream || !prior) {
+        cpl_image_error("Failed to allocate PNG encoder state");
+        free(stream);
+        free(prior);
+        return NULL;
+    }
+    
+    stream->sink.file = fopen(filename, "wb");
+    if (!stream->sink.file) {
+        cpl_image_error("Failed to open image file for writing");
+        free(stream);
+        free(prior);
+        return NULL;
+    }
+    
+    stream->width = width;
+    stream->height = height;
+    stream->threads = threads;
+    stream->adler = adler32(0L, Z_NULL, 0);
+    stream->prior = prior;
+    
+    // zlib stream: header now, one IDAT per band as rows arrive, trailer on close
+    static const unsigned char zlib_header[2] = { 0x78, 0x9C };
+    cpl_png_write_header(&stream->sink, width, height);
+    cpl_png_write_chunk(&stream->sink, "IDAT", zlib_header, sizeof(zlib_header));
+    return stream;
+}
+
+bool cpl_png_stream_write(CPLPngStream* stream, const unsigned char* rows, size_t num_rows, ptrdiff_t stride) {
+    if (!stream || !rows || num_rows == 0) return false;
+    if (stream->sink.failed) return false;
+    
+    if (num_rows > stream->height - stream->rows_written) {
+        cpl_image_error("Too many rows written to PNG stream");
+        stream->sink.failed = true;
+        return false;
+    }
+    
+    // Every band ends with a sync flush; the stream is terminated on close
+    const unsigned char* prior = stream->rows_written > 0 ? stream->prior : NULL;
+    if (!cpl_png_write_bands(&stream->sink, rows, stream->width, num_rows, stride, prior, false,
+                             stream->threads, &stream->adler)) {
+        stream->sink.failed = true;
+        return false;
+    }
+    
+    // The caller may reuse its buffer, so keep the last row for the next Up/Paeth filters
+    memcpy(stream->prior, rows + (ptrdiff_t)(num_rows - 1) * stride, stream->width * 4);
+    stream->rows_written += num_rows;
+    return !stream->sink.failed;
+}
+
+bool cpl_png_stream_close(CPLPngStream* stream) {
+    if (!stream) return false;
+    
+    bool ok = !stream->sink.failed;
+    if (ok && stream->rows_written != stream->height) {
+        cpl_image_error("PNG stream closed before all rows were written");
+        ok = false;
+    }
+    
+    if (ok) {
+        // Empty final block (fixed Huffman, end-of-block only), then the Adler-32 trailer
+        static const unsigned char final_block[2] = { 0x03, 0x00 };
+        unsigned char trailer[4];
+        cpl_put_u32(trailer, stream->adler);
+        cpl_png_write_chunk(&stream->sink, "IDAT", final_block, sizeof(final_block));
+        cpl_png_write_chunk(&stream->sink, "IDAT", trailer, sizeof(trailer));
+        cpl_png_write_chunk(&stream->sink, "IEND", NULL, 0);
+    }
+    
+    if (fclose(stream->sink.file) != 0) stream->sink.failed = true;
+    if (ok && stream->sink.failed) {
+        cpl_image_error("Failed to write image file");
+        ok = false;
+    }
+    
+    free(stream->prior);
+    free(stream);
+    return ok;
+}
+
+// PNG encoding
+static bool cpl_png_encode(CPLImageSink* sink, const unsigned char* pixels, size_t width, size_t height,
+                           ptrdiff_t stride, size_t threads) {
+    if (!pixels || width == 0 || height == 0) {
+        cpl_image_error("Invalid PNG parameters");
+        return false;
+    }
+    
+    // zlib stream: header, one IDAT per band, Adler-32 trailer
+    static const unsigned char zlib_header[2] = { 0x78, 0x9C };
+    cpl_png_write_header(sink, width, height);
+    cpl_png_write_chunk(sink, "IDAT", zlib_header, sizeof(zlib_header));
+    
+    unsigned long adler = adler32(0L, Z_NULL, 0);
+    if (!cpl_png_write_bands(sink, pixels, width, height, stride, NULL, true, threads, &adler)) {
+        return false;
+    }
+    
+    unsigned char trailer[4];
+    cpl_put_u32(trailer, adler);
+    cpl_png_write_chunk(sink, "IDAT", trailer, sizeof(trailer));
+    cpl_png_write_chunk(sink, "IEND", NULL, 0);
+    return true;
+}
+
+static void cpl_png_write_header(CPLImageSink* sink, size_t width, size_t height) {
+    // Signature and header: 8-bit RGBA, no interlacing
+    static const unsigned char signature[8] = { 137, 'P', 'N', 'G', '\r', '\n', 26, '\n' };
+    unsigned char header[13];
+    cpl_put_u32(header, (unsigned long)width);
+    cpl_put_u32(header + 4, (unsigned long)height);
+    header[8] = 8;   // Bit depth
+    header[9] = 6;   // Color type RGBA
+    header[10] = 0;  // Compression
+    header[11] = 0;  // Filter method
+    header[12] = 0;  // Interlace
+    
+    cpl_sink_write(sink, signature, sizeof(signature));
+    cpl_png_write_chunk(sink, "IHDR", header, sizeof(header));
+}
+
+// Compresses `height` rows and writes them as IDAT chunks, folding their
+// Adler-32 into *adler. `prior` is the row above the first one (NULL at the
+// top of the image); `last` terminates the deflate stream.
+static bool cpl_png_write_bands(CPLImageSink* sink, const unsigned char* pixels, size_t width, size_t height,
+                                ptrdiff_t stride, const unsigned char* prior, bool last, size_t threads,
+                                unsigned long* adler) {
+    // Split rows into bands; each band is deflated on its own thread and ends on a
+    // byte boundary (sync flush) so the raw streams can simply be concatenated
+    size_t num_bands = threads == 0 ? 1 : threads;
+    if (num_bands > height / CPL_PNG_MIN_BAND_ROWS) num_bands = height / CPL_PNG_MIN_BAND_ROWS;
+    if (num_bands == 0) num_bands = 1;
+    
+    CPLPngBand* bands = (CPLPngBand*)calloc(num_bands, sizeof(CPLPngBand));
+    if (!bands) {
+        cpl_image_error("Failed to allocate PNG encoder state");
+        return false;
+    }
+    
+    for (size_t i = 0; i < num_bands; i++) {
+        bands[i].pixels = pixels;
+        bands[i].width = width;
+        bands[i].stride = stride;
+        bands[i].row_start = i * height / num_bands;
+        bands[i].row_end = (i + 1) * height / num_bands;
+        bands[i].prior = bands[i].row_start > 0 ? pixels + (ptrdiff_t)(bands[i].row_start - 1) * stride : prior;
+        bands[i].last = last && (i == num_bands - 1);
+    }
+    
+    cpl_run_workers(bands, sizeof(CPLPngBand), num_bands, cpl_png_band_main);
+    
+    bool ok = true;
+    for (size_t i = 0; i < num_bands; i++) {
+        ok = ok && bands[i].ok;
+        *adler = adler32_combine(*adler, bands[i].adler, (z_off_t)bands[i].filtered_size);
+    }
+    
+    if (ok) {
+        for (size_t i = 0; i < num_bands; i++) {
+            cpl_png_write_chunk(sink, "IDAT", bands[i].out, bands[i].out_size);
+        }
+    } else {
+        cpl_image_error("Failed to compress PNG data");
+    }
+    
+    for (size_t i = 0; i < num_bands; i++) {
+        free(bands[i].out);
+    }
+    free(bands);
+    return ok;
+}
+
+static void* cpl_png_band_main(void* arg) {
+    CPLPngBand* band = (CPLPngBand*)arg;
+    size_t row_bytes = band->width * 4;
+    size_t rows = band->row_end - band->row_start;
+    
+    band->ok = false;
+    band->adler = adler32(0L, Z_NULL, 0);
+    band->filtered_size = rows * (row_bytes + 1);
+    
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    if (deflateInit2(&stream, CPL_PNG_LEVEL, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return NULL;
+    }
+    
+    // Four candidate filter rows (None, Sub, Up, Paeth)
+    unsigned char* scratch = (unsigned char*)malloc((row_bytes + 1) * 4);
+    size_t capacity = deflateBound(&stream, (uLong)band->filtered_size) + 64;
+    band->out = (unsigned char*)malloc(capacity);
+    if (!scratch || !band->out) {
+        free(scratch);
+        deflateEnd(&stream);
+        return NULL;
+    }
+    
+    stream.next_out = band->out;
+    stream.avail_out = (uInt)capacity;
+    
+    bool ok = true;
+    for (size_t y = band->row_start; ok && y <= band->row_end; y++) {
+        int flush = Z_NO_FLUSH;
+        if (y < band->row_end) {
+            const unsigned char* row = band->pixels + (ptrdiff_t)y * band->stride;
+            const unsigned char* prior = y > band->row_start ? row - band->stride : band->prior;
+            const unsigned char* filtered = cpl_png_filter_row(row, prior, row_bytes, scratch);
+            band->adler = adler32(band->adler, filtered, (uInt)(row_bytes + 1));
+            stream.next_in = (Bytef*)filtered;
+            stream.avail_in = (uInt)(row_bytes + 1);
+        } else {
+            flush = band->last ? Z_FINISH : Z_SYNC_FLUSH;
+        }
+        
+        for (;;) {
+            int status = deflate(&stream, flush);
+            if (status == Z_STREAM_ERROR) {
+                ok = false;
+                break;
+            }
+            bool done = flush == Z_FINISH ? status == Z_STREAM_END
+                                          : (stream.avail_in == 0 && stream.avail_out > 0);
+            if (done) break;
+            
+            // Output bound exceeded (only possible for sync flush markers): grow
+            size_t used = capacity - stream.avail_out;
+            size_t new_capacity = capacity * 2;
+            unsigned char* grown = (unsigned char*)realloc(band->out, new_capacity);
+            if (!grown) {
+                ok = false;
+                break;
+            }
+            band->out = grown;
+            capacity = new_capacity;
+            stream.next_out = band->out + used;
+            stream.avail_out = (uInt)(capacity - used);
+        }
+    }
+    
+    band->out_size = capacity - stream.avail_out;
+    band->ok = ok;
+    deflateEnd(&stream);
+    free(scratch);
+    return NULL;
+}
+
+static const unsigned char* cpl_png_filter_row(const unsigned char* row, const unsigned char* prior,
+                                               size_t row_bytes, unsigned char* scratch) {
+    unsigned char* none = scratch;
+    unsigned char* sub = scratch + (row_bytes + 1);
+    unsigned char* up = scratch + (row_bytes + 1) * 2;
+    unsigned char* paeth = scratch + (row_bytes + 1) * 3;
+    none[0] = 0;
+    sub[0] = 1;
+    up[0] = 2;
+    paeth[0] = 4;
+    
+    // Minimum sum of absolute differences picks the filter (libpng's heuristic)
+    unsigned long sums[4] = { 0, 0, 0, 0 };
+    for (size_t i = 0; i < row_bytes; i++) {
+        int a = i >= 4 ? row[i - 4] : 0;
+        int b = prior ? prior[i] : 0;
+        int c = (prior && i >= 4) ? prior[i - 4] : 0;
+        
+        int p = a + b - c;
+        int pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+        int predictor = (pa <= pb && pa <= pc) ? a : (pb <= pc ? b : c);
+        
+        none[i + 1] = row[i];
+        sub[i + 1] = (unsigned char)(row[i] - a);
+        up[i + 1] = (unsigned char)(row[i] - b);
+        paeth[i + 1] = (unsigned char)(row[i] - predictor);
+        
+        sums[0] += (unsigned long)abs((signed char)none[i + 1]);
+        sums[1] += (unsigned long)abs((signed char)sub[i + 1]);
+        sums[2] += (unsigned long)abs((signed char)up[i + 1]);
+        sums[3] += (unsigned long)abs((signed char)paeth[i + 1]);
+    }
+    
+    int best = 0;
+    for (int f = 1; f < 4; f++) {
+        if (sums[f] < sums[best]) best = f;
+    }
+    return scratch + (row_bytes + 1) * (size_t)best;
+}
+
+static void cpl_png_write_chunk(CPLImageSink* sink, const char* type, const unsigned char* data, size_t length) {
+    unsigned char prefix[8];
+    cpl_put_u32(prefix, (unsigned long)length);
+    memcpy(prefix + 4, type, 4);
+    
+    unsigned long crc = crc32(0L, (const Bytef*)type, 4);
+    if (length > 0) {
+        crc = crc32(crc, data, (uInt)length);
+    }
+    
+    unsigned char suffix[4];
+    cpl_put_u32(suffix, crc);
+    
+    cpl_sink_write(sink, prefix, sizeof(prefix));
+    cpl_sink_write(sink, data, length);
+    cpl_sink_write(sink, suffix, sizeof(suffix));
+}
+
+// QOI encoding (https://qoiformat.org): fast lossless format for intermediate artifacts
+static bool cpl_qoi_encode(CPLImageSink* sink, const unsigned char* pixels, size_t width, size_t height, ptrdiff_t stride) {
+    if (!pixels || width == 0 || height == 0) {
+        cpl_image_error("Invalid QOI parameters");
+        return false;
+    }
+    
+    // Worst case is 5 bytes per pixel; encode a row at a time into a bounded buffer
+    unsigned char* buffer = (unsigned char*)malloc(width * 5 + 16);
+    if (!buffer) {
+        cpl_image_error("Failed to allocate QOI buffer");
+        return false;
+    }
+    
+    unsigned char header[14] = { 'q', 'o', 'i', 'f' };
+    cpl_put_u32(header + 4, (unsigned long)width);
+    cpl_put_u32(header + 8, (unsigned long)height);
+    header[12] = 4;  // Channels
+    header[13] = 0;  // sRGB with linear alpha
+    cpl_sink_write(sink, header, sizeof(header));
+    
+    unsigned char index[64][4];
+    memset(index, 0, sizeof(index));
+    unsigned char prev[4] = { 0, 0, 0, 255 };
+    size_t run = 0;
+    size_t total = width * height;
+    size_t count = 0;
+    
+    for (size_t y = 0; y < height; y++) {
+        const unsigned char* row = pixels + (ptrdiff_t)y * stride;
+        size_t n = 0;
+        
+        for (size_t x = 0; x < width; x++, count++) {
+            const unsigned char* px = row + x * 4;
+            
+            if (memcmp(px, prev, 4) == 0) {
+                run++;
+                if (run == 62 || count == total - 1) {
+                    buffer[n++] = (unsigned char)(0xC0 | (run - 1));  // QOI_OP_RUN
+                    run = 0;
+                }
+                continue;
+            }
+            
+            if (run > 0) {
+                buffer[n++] = (unsigned char)(0xC0 | (run - 1));
+                run = 0;
+            }
+            
+            int hash = (px[0] * 3 + px[1] * 5 + px[2] * 7 + px[3] * 11) % 64;
+            if (memcmp(index[hash], px, 4) == 0) {
+                buffer[n++] = (unsigned char)hash;                  // QOI_OP_INDEX
+            } else {
+                memcpy(index[hash], px, 4);
+                
+                if (px[3] == prev[3]) {
+                    signed char vr = (signed char)(px[0] - prev[0]);
+                    signed char vg = (signed char)(px[1] - prev[1]);
+                    signed char vb = (signed char)(px[2] - prev[2]);
+                    signed char vg_r = (signed char)(vr - vg);
+                    signed char vg_b = (signed char)(vb - vg);
+                    
+                    if (vr > -3 && vr < 2 && vg > -3 && vg < 2 && vb > -3 && vb < 2) {
+                        buffer[n++] = (unsigned char)(0x40 | (vr + 2) << 4 | (vg + 2) << 2 | (vb + 2));  // QOI_OP_DIFF
+                    } else if (vg_r > -9 && vg_r < 8 && vg > -33 && vg < 32 && vg_b > -9 && vg_b < 8) {
+                        buffer[n++] = (unsigned char)(0x80 | (vg + 32));                                 // QOI_OP_LUMA
+                        buffer[n++] = (unsigned char)((vg_r + 8) << 4 | (vg_b + 8));
+                    } else {
+                        buffer[n++] = 0xFE;                                                              // QOI_OP_RGB
+                        buffer[n++] = px[0];
+                        buffer[n++] = px[1];
+                        buffer[n++] = px[2];
+                    }
+                } else {
+                    buffer[n++] = 0xFF;                                                                  // QOI_OP_RGBA
+                    memcpy(buffer + n, px, 4);
+                    n += 4;
+                }
+            }
+            memcpy(prev, px, 4);
+        }
+        
+        cpl_sink_write(sink, buffer, n);
+    }
+    
+    static const unsigned char end_marker[8] = { 0, 0, 0, 0, 0, 0, 0, 1 };
+    cpl_sink_write(sink, end_marker, sizeof(end_marker));
+    
+    free(buffer);
+    return true;
+}
+
+// Internal helper functions
+static void cpl_put_u32(unsigned char* out, unsigned long value) {
+    out[0] = (unsigned char)(value >> 24);
+    out[1] = (unsigned char)(value >> 16);
+    out[2] = (unsigned char)(value >> 8);
+    out[3] = (unsigned char)value;
+}
+
+static void cpl_sink_write(CPLImageSink* sink, const void* data, size_t length) {
+    if (sink->failed || length == 0) return;
+    
+    if (sink->file) {
+        if (fwrite(data, 1, length, sink->file) != length) {
+            sink->failed = true;
+        }
+        return;
+    }
+    
+    if (sink->size + length > sink->capacity) {
+        size_t new_capacity = sink->capacity == 0 ? 64 * 1024 : sink->capacity;
+        while (new_capacity < sink->size + length) new_capacity *= 2;
+        unsigned char* grown = (unsigned char*)realloc(sink->data, new_capacity);
+        if (!grown) {
+            sink->failed = true;
+            return;
+        }
+        sink->data = grown;
+        sink->capacity = new_capacity;
+    }
+    memcpy(sink->data + sink->size, data, length);
+    sink->size += length;
+}
+
+static bool cpl_write_file(const char* filename, const unsigned char* pixels, size_t width, size_t height,
+                           ptrdiff_t stride, bool qoi) {
+    if (!filename) {
+        cpl_image_error("Invalid image filename");
+        return false;
+    }
+    
+    CPLImageSink sink = { 0 };
+    sink.file = fopen(filename, "wb");
+    if (!sink.file) {
+        cpl_image_error("Failed to open image file for writing");
+        return false;
+    }
+    
+    bool ok = qoi ? cpl_qoi_encode(&sink, pixels, width, height, stride)
+                  : cpl_png_encode(&sink, pixels, width, height, stride, cpl_image_default_threads());
+    
+    if (fclose(sink.file) != 0) sink.failed = true;
+    if (ok && sink.failed) {
+        cpl_image_error("Failed to write image file");
+    }
+    return ok && !sink.failed;
+}
+
+static void cpl_image_error(const char* message) {
+    fprintf(stderr, "CPlotLib Error: %s\n", message);
+}
@@ -0,0 +1,27 @@
+#ifndef CPL_IMAGE_H
+#define CPL_IMAGE_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include "CPLPlot.h"
+
+// Image writers for 8-bit RGBA pixel data.
+// Rows are addressed as pixels + y * stride, so a bottom-up framebuffer
+// readback is written top-down by passing its last row and a negative stride;
+// the encoders read the readback buffer in place without a flip copy.
+
+// File output (PNG uses cpl_image_default_threads() deflate workers, see CPLUtils.h)
+bool cpl_write_png(const char* filename, const unsigned char* pixels, size_t width, size_t height, ptrdiff_t stride);
+bool cpl_write_qoi(const char* filename, const unsigned char* pixels, size_t width, size_t height, ptrdiff_t stride);
+
+// In-memory encoding (cpl_encode_png, cpl_encode_qoi) is part of the public API in CPLPlot.h
+
+// Streaming PNG output for images too large to hold in memory: rows are passed
+// top-down in bands of any height (same stride convention as above), each band is
+// compressed on `threads` workers and written before the call returns
+typedef struct CPLPngStream CPLPngStream;
+CPLPngStream* cpl_png_stream_open(const char* filename, size_t width, size_t height, size_t threads);
+bool cpl_png_stream_write(CPLPngStream* stream, const unsigned char* rows, size_t num_rows, ptrdiff_t stride);
+bool cpl_png_stream_close(CPLPngStream* stream);  // Fails (file incomplete) unless all rows were written
+
+#endif // CPL_IMAGE_H
@@ -0,0 +1,547 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "CPLMatrix.h"
+#include "CPLUtils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <GL/glew.h>
+
+// Constants
+#define CPL_MATRIX_THREAD_ROWS_ELEMENTS (1u << 18)  // Elements per build thread at least
+#define CPL_MATRIX_TILE_BUDGET 128                 // Resident tile textures kept beyond the current frame
+#define CPL_MATRIX_POLAR_CELLS 64                  // Quads per tile side on polar plots
+#define CPL_MATRIX_COLORMAP_ENTRIES 1024
+
+// One build worker: rows [first, end) of a level, copied from the matrix
+// (level 0, also finding the value range) or reduced from the level below
+typedef struct {
+    const CPLMatrix* matrix;
+    const void* source;          // Level 0: the caller's data
+    int level;
+    size_t first, end;
+    double min, max;
+} CPLMatrixWorker;
+
+// Internal function declarations
+static void* cpl_matrix_copy_main(void* arg);
+static void* cpl_matrix_reduce_main(void* arg);
+static size_t cpl_matrix_element_size(CPLMatrixFormat format);
+static double cpl_matrix_element(const CPLMatrix* matrix, int level, size_t column, size_t row);
+static double cpl_matrix_texel(const CPLMatrix* matrix, int level, int axis);
+static void cpl_matrix_evict(CPLMatrix* matrix);
+static float cpl_mean4f(float a, float b, float c, float d);
+static void cpl_matrix_error(const char* message);
+
+bool cpl_matrix_build(CPLMatrix* matrix, const void* data) {
+    // Levels halve (rounding up) until one tile holds the whole level
+    int num_levels = 1;
+    for (size_t w = matrix->width, h = matrix->height; w > CPL_MATRIX_TILE || h > CPL_MATRIX_TILE; num_levels++) {
+        w = (w + 1) / 2;
+        h = (h + 1) / 2;
+    }
+
+    matrix->mips = (CPLMatrixLevel*)calloc((size_t)num_levels, sizeof(CPLMatrixLevel));
+    if (!matrix->mips) {
+        cpl_matrix_error("Failed to allocate matrix levels");
+        return false;
+    }
+    matrix->num_levels = num_levels;
+
+    size_t element = cpl_matrix_element_size(matrix->format);
+    for (int level = 0; level < num_levels; level++) {
+        CPLMatrixLevel* mip = &matrix->mips[level];
+        mip->width = level == 0 ? matrix->width : (matrix->mips[level - 1].width + 1) / 2;
+        mip->height = level == 0 ? matrix->height : (matrix->mips[level - 1].height + 1) / 2;
+        mip->tiles_x = (mip->width + CPL_MATRIX_TILE - 1) / CPL_MATRIX_TILE;
+        mip->tiles_y = (mip->height + CPL_MATRIX_TILE - 1) / CPL_MATRIX_TILE;
+        mip->values = malloc(mip->width * mip->height * element);
+        mip->textures = (unsigned int*)calloc(mip->tiles_x * mip->tiles_y, sizeof(unsigned int));
+        mip->last_used = (unsigned int*)calloc(mip->tiles_x * mip->tiles_y, sizeof(unsigned int));
+        if (!mip->values || !mip->textures || !mip->last_used) {
+            cpl_matrix_error("Failed to allocate matrix levels");
+            return false;
+        }
+    }
+
+    size_t num_threads = cpl_image_default_threads();
+    CPLMatrixWorker* workers = (CPLMatrixWorker*)calloc(num_threads, sizeof(CPLMatrixWorker));
+    if (!workers) {
+        cpl_matrix_error("Failed to allocate matrix workers");
+        return false;
+    }
+
+    for (int level = 0; level < num_levels; level++) {
+        // Small levels run on fewer threads
+        const CPLMatrixLevel* mip = &matrix->mips[level];
+        size_t threads = mip->width * mip->height / CPL_MATRIX_THREAD_ROWS_ELEMENTS;
+        if (threads > num_threads) threads = num_threads;
+        if (threads > mip->height) threads = mip->height;
+        if (threads == 0) threads = 1;
+        for (size_t i = 0; i < threads; i++) {
+            workers[i].matrix = matrix;
+            workers[i].source = data;
+            workers[i].level = level;
+            workers[i].first = i * mip->height / threads;
+            workers[i].end = (i + 1) * mip->height / threads;
+            workers[i].min = INFINITY;
+            workers[i].max = -INFINITY;
+        }
+        cpl_run_workers(workers, sizeof(CPLMatrixWorker), threads,
+                        level == 0 ? cpl_matrix_copy_main : cpl_matrix_reduce_main);
+
+        if (level == 0) {
+            double min = INFINITY, max = -INFINITY;
+            for (size_t i = 0; i < threads; i++) {
+                if (workers[i].min < min) min = workers[i].min;
+                if (workers[i].max > max) max = workers[i].max;
+            }
+            // All NaN or constant data still gets a usable range
+            if (!(min <= max)) min = max = 0.0;
+            if (max == min) max = min + 1.0;
+            matrix->levels[0] = (float)min;
+            matrix->levels[1] = (float)max;
+        }
+    }
+
+    free(workers);
+    return true;
+}
+
+int cpl_matrix_level(const CPLMatrix* matrix, const CPLViewTransform* view, const int* viewport) {
+    // Pixels covered by the matrix extent along each axis
+    double pixels[2];
+    if (view->polar) {
+        // Radius along the rows, the outer arc along the columns
+        double inner = cpl_axis_transform(view->scale[1], matrix->extent[2], view->threshold[1]) - view->min[1];
+        double outer = cpl_axis_transform(view->scale[1], matrix->extent[3], view->threshold[1]) - view->min[1];
+        double radius = 0.5 * (double)viewport[2] * (double)view->radius[0] * view->factor[1];
+        pixels[1] = fabs(outer - inner) * radius;
+        pixels[0] = fmax(inner, outer) * radius * fabs(matrix->extent[1] - matrix->extent[0]);
+    } else {
+        for (int axis = 0; axis < 2; axis++) {
+            double low = cpl_axis_transform(view->scale[axis], matrix->extent[2 * axis], view->threshold[axis]);
+            double high = cpl_axis_transform(view->scale[axis], matrix->extent[2 * axis + 1], view->threshold[axis]);
+            pixels[axis] = fabs(high - low) * view->factor[axis] * 0.5 * (double)viewport[2 + axis];
+        }
+    }
+
+    // Coarsest level with at most one element per pixel
+    double per_pixel = fmax((double)matrix->width / pixels[0], (double)matrix->height / pixels[1]);
+    if (!(per_pixel > 1.0)) return 0;
+    int level = (int)ceil(log2(per_pixel) - 1e-9);
+    return level < matrix->num_levels - 1 ? level : matrix->num_levels - 1;
+}
+
+bool cpl_matrix_visible_tiles(const CPLMatrix* matrix, int level, const CPLViewTransform* view,
+                              const float* ndc_rect, size_t* range) {
+    const CPLMatrixLevel* mip = &matrix->mips[level];
+    range[0] = 0;
+    range[1] = mip->tiles_x;
+    range[2] = 0;
+    range[3] = mip->tiles_y;
+    if (view->polar) return true;
+
+    const float bounds[4] = {
+        (float)(matrix->extent[0] - matrix->origin[0]), (float)(matrix->extent[2] - matrix->origin[1]),
+        (float)(matrix->extent[1] - matrix->origin[0]), (float)(matrix->extent[3] - matrix->origin[1])
+    };
+    float window[4];
+    if (!cpl_view_window(view, matrix->origin, bounds, ndc_rect, window)) return false;
+
+    // Columns from the left edge, rows from the top edge
+    double tile_width = cpl_matrix_texel(matrix, level, 0) * CPL_MATRIX_TILE;
+    double tile_height = cpl_matrix_texel(matrix, level, 1) * CPL_MATRIX_TILE;
+    double left = (matrix->origin[0] + window[0] - matrix->extent[0]) / tile_width;
+    double right = (matrix->origin[0] + window[2] - matrix->extent[0]) / tile_width;
+    double top = (matrix->extent[3] - matrix->origin[1] - window[3]) / tile_height;
+    double bottom = (matrix->extent[3] - matrix->origin[1] - window[1]) / tile_height;
+    if (left > 0.0) range[0] = left < (double)mip->tiles_x ? (size_t)left : mip->tiles_x;
+    if (right < (double)mip->tiles_x) range[1] = right > 0.0 ? (size_t)right + 1 : 0;
+    if (top > 0.0) range[2] = top < (double)mip->tiles_y ? (size_t)top : mip->tiles_y;
+    if (bottom < (double)mip->tiles_y) range[3] = bottom > 0.0 ? (size_t)bottom + 1 : 0;
+    return range[0] < range[1] && range[2] < range[3];
+}
+
+void cpl_matrix_tile_rect(const CPLMatrix* matrix, int level, size_t tile_x, size_t tile_y, float* tile_min,
+                          float* tile_size, float* texture_max) {
+    const CPLMatrixLevel* mip = &matrix->mips[level];
+    double texel_width = cpl_matrix_texel(matrix, level, 0);
+    double texel_height = cpl_matrix_texel(matrix, level, 1);
+    size_t columns = mip->width - tile_x * CPL_MATRIX_TILE;
+    size_t rows = mip->height - tile_y * CPL_MATRIX_TILE;
+    if (columns > CPL_MATRIX_TILE) columns = CPL_MATRIX_TILE;
+    if (rows > CPL_MATRIX_TILE) rows = CPL_MATRIX_TILE;
+
+    // Coarse levels can overhang the extent by less than one of their elements
+    double left = matrix->extent[0] + (double)(tile_x * CPL_MATRIX_TILE) * texel_width;
+    double right = fmin(left + (double)columns * texel_width, matrix->extent[1]);
+    double top = matrix->extent[3] - (double)(tile_y * CPL_MATRIX_TILE) * texel_height;
+    double bottom = fmax(top - (double)rows * texel_height, matrix->extent[2]);
+
+    tile_min[0] = (float)(left - matrix->origin[0]);
+    tile_min[1] = (float)(bottom - matrix->origin[1]);
+    tile_size[0] = (float)(right - left);
+    tile_size[1] = (float)(top - bottom);
+    texture_max[0] = (float)((right - left) / ((double)columns * texel_width));
+    texture_max[1] = (float)((top - bottom) / ((double)rows * texel_height));
+}
+
+unsigned int cpl_matrix_tile_texture(CPLMatrix* matrix, int level, size_t tile_x, size_t tile_y) {
+    CPLMatrixLevel* mip = &matrix->mips[level];
+    size_t index = tile_y * mip->tiles_x + tile_x;
+    if (mip->textures[index]) {
+        mip->last_used[index] = matrix->frame;
+        return mip->textures[index];
+    }
+
+    if (matrix->resident >= CPL_MATRIX_TILE_BUDGET) cpl_matrix_evict(matrix);
+
+    static const GLenum internal_formats[] = { GL_R32F, GL_R16, GL_R8 };
+    static const GLenum types[] = { GL_FLOAT, GL_UNSIGNED_SHORT, GL_UNSIGNED_BYTE };
+    size_t columns = mip->width - tile_x * CPL_MATRIX_TILE;
+    size_t rows = mip->height - tile_y * CPL_MATRIX_TILE;
+    if (columns > CPL_MATRIX_TILE) columns = CPL_MATRIX_TILE;
+    if (rows > CPL_MATRIX_TILE) rows = CPL_MATRIX_TILE;
+    const unsigned char* first = (const unsigned char*)mip->values +
+                                 (tile_y * CPL_MATRIX_TILE * mip->width + tile_x * CPL_MATRIX_TILE) *
+                                 cpl_matrix_element_size(matrix->format);
+
+    // The tile is read straight out of the level's rows in client memory; the
+    // unpack state this needs is set around the upload and then put back
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    GLint unpack_buffer, alignment, row_length;
+    glGetIntegerv(GL_PIXEL_UNPACK_BUFFER_BINDING, &unpack_buffer);
+    glGetIntegerv(GL_UNPACK_ALIGNMENT, &alignment);
+    glGetIntegerv(GL_UNPACK_ROW_LENGTH, &row_length);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, (GLint)mip->width);
+    glTexImage2D(GL_TEXTURE_2D, 0, (GLint)internal_formats[matrix->format], (GLsizei)columns, (GLsizei)rows, 0,
+                 GL_RED, types[matrix->format], first);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, row_length);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, alignment);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, (GLuint)unpack_buffer);
+
+    mip->textures[index] = texture;
+    mip->last_used[index] = matrix->frame;
+    matrix->resident++;
+    return texture;
+}
+
+int cpl_matrix_tile_cells(const CPLViewTransform* view) {
+    return view->polar ? CPL_MATRIX_POLAR_CELLS : 1;
+}
+
+float cpl_matrix_value_scale(const CPLMatrix* matrix) {
+    switch (matrix->format) {
+        case CPL_MATRIX_UINT16:
+            return 65535.0f;
+        case CPL_MATRIX_UINT8:
+            return 255.0f;
+        default:
+            return 1.0f;
+    }
+}
+
+bool cpl_matrix_colors(const CPLPlot* plot, const int* viewport, const int* box, const int* cells,
+                       unsigned char* pixels, ptrdiff_t stride) {
+    const CPLMatrix* matrix = plot && plot->data ? plot->data->matrix : NULL;
+    if (!matrix || !matrix->mips || cells[2] <= 0 || cells[3] <= 0) return false;
+
+    CPLViewTransform view;
+    cpl_view_transform(plot, viewport, &view);
+    int level = cpl_matrix_level(matrix, &view, viewport);
+    const CPLMatrixLevel* mip = &matrix->mips[level];
+    double texel_width = cpl_matrix_texel(matrix, level, 0);
+    double texel_height = cpl_matrix_texel(matrix, level, 1);
+
+    unsigned char* lut = (unsigned char*)malloc(CPL_MATRIX_COLORMAP_ENTRIES * 3);
+    size_t* columns = (size_t*)malloc((size_t)cells[2] * sizeof(size_t));
+    size_t* rows = (size_t*)malloc((size_t)cells[3] * sizeof(size_t));
+    if (!lut || !columns || !rows) {
+        cpl_matrix_error("Failed to allocate matrix image");
+        free(lut);
+        free(columns);
+        free(rows);
+        return false;
+    }
+    for (int i = 0; i < CPL_MATRIX_COLORMAP_ENTRIES; i++) {
+        Color c = cpl_colormap_color(plot->colormap, (float)i / (float)(CPL_MATRIX_COLORMAP_ENTRIES - 1));
+        lut[i * 3 + 0] = (unsigned char)(c.r * 255.0f + 0.5f);
+        lut[i * 3 + 1] = (unsigned char)(c.g * 255.0f + 0.5f);
+        lut[i * 3 + 2] = (unsigned char)(c.b * 255.0f + 0.5f);
+    }
+
+    // Pixel centres in NDC of the viewport
+    double ndc_scale[2], ndc_shift[2];
+    for (int axis = 0; axis < 2; axis++) {
+        ndc_scale[axis] = 2.0 / (double)viewport[2 + axis];
+        ndc_shift[axis] = (double)(box[axis] + cells[axis] - viewport[axis]) + 0.5;
+    }
+
+    // Element column and row (from the top) of a data position; SIZE_MAX outside
+    #define CPL_MATRIX_COLUMN(x) \
+        ((x) >= matrix->extent[0] && (x) < matrix->extent[1] \
+             ? (size_t)fmin(((x) - matrix->extent[0]) / texel_width, (double)(mip->width - 1)) : SIZE_MAX)
+    #define CPL_MATRIX_ROW(y) \
+        ((y) > matrix->extent[2] && (y) <= matrix->extent[3] \
+             ? (size_t)fmin((matrix->extent[3] - (y)) / texel_height, (double)(mip->height - 1)) : SIZE_MAX)
+
+    // Cartesian axes are independent: columns per column and rows per row of pixels
+    if (!view.polar) {
+        for (int x = 0; x < cells[2]; x++) {
+            double ndc[2] = { (ndc_shift[0] + x) * ndc_scale[0] - 1.0, 0.0 };
+            double data[2];
+            cpl_view_unmap(&view, ndc, data);
+            columns[x] = CPL_MATRIX_COLUMN(data[0]);
+        }
+        for (int y = 0; y < cells[3]; y++) {
+            double ndc[2] = { 0.0, (ndc_shift[1] + y) * ndc_scale[1] - 1.0 };
+            double data[2];
+            cpl_view_unmap(&view, ndc, data);
+            rows[y] = CPL_MATRIX_ROW(data[1]);
+        }
+    }
+
+    float span = matrix->levels[1] - matrix->levels[0];
+    for (int y = 0; y < cells[3]; y++) {
+        unsigned char* out = pixels + (ptrdiff_t)y * stride;
+        for (int x = 0; x < cells[2]; x++, out += 4) {
+            size_t column = SIZE_MAX, row = SIZE_MAX;
+            if (view.polar) {
+                double ndc[2] = { (ndc_shift[0] + x) * ndc_scale[0] - 1.0, (ndc_shift[1] + y) * ndc_scale[1] - 1.0 };
+                double data[2];
+                cpl_view_unmap(&view, ndc, data);
+                // Angles are taken in the turn starting at the left edge
+                double turn = fmod(data[0] - matrix->extent[0], 6.283185307179586);
+                if (turn < 0.0) turn += 6.283185307179586;
+                column = CPL_MATRIX_COLUMN(matrix->extent[0] + turn);
+                row = CPL_MATRIX_ROW(data[1]);
+            } else {
+                column = columns[x];
+                row = rows[y];
+            }
+
+            float t = column == SIZE_MAX || row == SIZE_MAX
+                          ? NAN
+                          : ((float)cpl_matrix_element(matrix, level, column, row) - matrix->levels[0]) / span;
+            if (cpl_is_nanf(t)) {
+                memset(out, 0, 4);
+                continue;
+            }
+            t = t > 0.0f ? (t < 1.0f ? t : 1.0f) : 0.0f;
+            const unsigned char* rgb = lut + (int)(t * (float)(CPL_MATRIX_COLORMAP_ENTRIES - 1) + 0.5f) * 3;
+            out[0] = rgb[0];
+            out[1] = rgb[1];
+            out[2] = rgb[2];
+            out[3] = 255;
+        }
+    }
+    #undef CPL_MATRIX_COLUMN
+    #undef CPL_MATRIX_ROW
+
+    free(lut);
+    free(columns);
+    free(rows);
+    return true;
+}
+
+void cpl_free_matrix(CPLMatrix* matrix) {
+    if (!matrix) return;
+
+    for (int level = 0; matrix->mips && level < matrix->num_levels; level++) {
+        CPLMatrixLevel* mip = &matrix->mips[level];
+        for (size_t i = 0; mip->textures && i < mip->tiles_x * mip->tiles_y; i++) {
+            if (mip->textures[i]) glDeleteTextures(1, &mip->textures[i]);
+        }
+        free(mip->values);
+        free(mip->textures);
+        free(mip->last_used);
+    }
+    if (matrix->vao) glDeleteVertexArrays(1, &matrix->vao);
+    free(matrix->mips);
+    free(matrix);
+}
+
+// Internal helper functions
+static void* cpl_matrix_copy_main(void* arg) {
+    CPLMatrixWorker* worker = (CPLMatrixWorker*)arg;
+    const CPLMatrix* matrix = worker->matrix;
+    size_t element = cpl_matrix_element_size(matrix->format);
+    size_t row_bytes = matrix->width * element;
+    const unsigned char* source = (const unsigned char*)worker->source;
+    unsigned char* values = (unsigned char*)matrix->mips[0].values;
+    memcpy(values + worker->first * row_bytes, source + worker->first * row_bytes,
+           (worker->end - worker->first) * row_bytes);
+
+    // Value range for the default levels (NaN elements are skipped)
+    size_t count = (worker->end - worker->first) * matrix->width;
+    size_t first = worker->first * matrix->width;
+    double min = INFINITY, max = -INFINITY;
+    if (matrix->format == CPL_MATRIX_FLOAT32) {
+        const float* v = (const float*)matrix->mips[0].values + first;
+        float low = INFINITY, high = -INFINITY;
+        for (size_t i = 0; i < count; i++) {
+            if (!cpl_is_finitef(v[i])) continue;
+            if (v[i] < low) low = v[i];
+            if (v[i] > high) high = v[i];
+        }
+        min = low;
+        max = high;
+    } else if (matrix->format == CPL_MATRIX_UINT16) {
+        const uint16_t* v = (const uint16_t*)matrix->mips[0].values + first;
+        uint16_t low = UINT16_MAX, high = 0;
+        for (size_t i = 0; i < count; i++) {
+            if (v[i] < low) low = v[i];
+            if (v[i] > high) high = v[i];
+        }
+        if (count > 0) {
+            min = low;
+            max = high;
+        }
+    } else {
+        const uint8_t* v = (const uint8_t*)matrix->mips[0].values + first;
+        uint8_t low = UINT8_MAX, high = 0;
+        for (size_t i = 0; i < count; i++) {
+            if (v[i] < low) low = v[i];
+            if (v[i] > high) high = v[i];
+        }
+        if (count > 0) {
+            min = low;
+            max = high;
+        }
+    }
+    worker->min = min;
+    worker->max = max;
+    return NULL;
+}
+
+// Each element of the level combines up to 2x2 elements of the level below (the
+// last column and row of an odd size repeat, which leaves means unbiased)
+#define CPL_MATRIX_REDUCE_ROWS(TYPE, MEAN, MIN, MAX)                                                       \
+    do {                                                                                                 \
+        const TYPE* below = (const TYPE*)source->values;                                                 \
+        TYPE* out = (TYPE*)mip->values;                                                                  \
+        for (size_t y = worker->first; y < worker->end; y++) {                                           \
+            const TYPE* top = below + 2 * y * source->width;                                             \
+            const TYPE* bottom = 2 * y + 1 < source->height ? top + source->width : top;                 \
+            TYPE* row = out + y * mip->width;                                                            \
+            for (size_t x = 0; x < mip->width; x++) {                                                    \
+                size_t x0 = 2 * x;                                                                       \
+                size_t x1 = x0 + 1 < source->width ? x0 + 1 : x0;                                        \
+                TYPE a = top[x0], b = top[x1], c = bottom[x0], d = bottom[x1];                           \
+                row[x] = reduce == CPL_MATRIX_MIN ? (MIN) : reduce == CPL_MATRIX_MAX ? (MAX) : (MEAN);   \
+            }                                                                                            \
+        }                                                                                                \
+    } while (0)
+
+#define CPL_MIN2(a, b) ((b) < (a) ? (b) : (a))
+#define CPL_MAX2(a, b) ((b) > (a) ? (b) : (a))
+
+static void* cpl_matrix_reduce_main(void* arg) {
+    CPLMatrixWorker* worker = (CPLMatrixWorker*)arg;
+    const CPLMatrix* matrix = worker->matrix;
+    const CPLMatrixLevel* source = &matrix->mips[worker->level - 1];
+    const CPLMatrixLevel* mip = &matrix->mips[worker->level];
+    CPLMatrixReduce reduce = matrix->reduce;
+
+    switch (matrix->format) {
+        case CPL_MATRIX_FLOAT32:
+            // fminf/fmaxf skip NaN elements
+            CPL_MATRIX_REDUCE_ROWS(float, cpl_mean4f(a, b, c, d), fminf(fminf(a, b), fminf(c, d)),
+                                   fmaxf(fmaxf(a, b), fmaxf(c, d)));
+            break;
+        case CPL_MATRIX_UINT16:
+            CPL_MATRIX_REDUCE_ROWS(uint16_t, (uint16_t)(((uint32_t)a + b + c + d + 2) >> 2),
+                                   CPL_MIN2(CPL_MIN2(a, b), CPL_MIN2(c, d)),
+                                   CPL_MAX2(CPL_MAX2(a, b), CPL_MAX2(c, d)));
+            break;
+        default:
+            CPL_MATRIX_REDUCE_ROWS(uint8_t, (uint8_t)(((uint32_t)a + b + c + d + 2) >> 2),
+                                   CPL_MIN2(CPL_MIN2(a, b), CPL_MIN2(c, d)),
+                                   CPL_MAX2(CPL_MAX2(a, b), CPL_MAX2(c, d)));
+            break;
+    }
+    return NULL;
+}
+
+static size_t cpl_matrix_element_size(CPLMatrixFormat format) {
+    switch (format) {
+        case CPL_MATRIX_UINT16:
+            return sizeof(uint16_t);
+        case CPL_MATRIX_UINT8:
+            return sizeof(uint8_t);
+        default:
+            return sizeof(float);
+    }
+}
+
+static double cpl_matrix_element(const CPLMatrix* matrix, int level, size_t column, size_t row) {
+    const CPLMatrixLevel* mip = &matrix->mips[level];
+    size_t index = row * mip->width + column;
+    switch (matrix->format) {
+        case CPL_MATRIX_UINT16:
+            return ((const uint16_t*)mip->values)[index];
+        case CPL_MATRIX_UINT8:
+            return ((const uint8_t*)mip->values)[index];
+        default:
+            return ((const float*)mip->values)[index];
+    }
+}
+
+// Data size of one element of a level along an axis (0: x, 1: y)
+static double cpl_matrix_texel(const CPLMatrix* matrix, int level, int axis) {
+    double span = matrix->extent[2 * axis + 1] - matrix->extent[2 * axis];
+    return ldexp(span / (double)(axis == 0 ? matrix->width : matrix->height), level);
+}
+
+// Deletes the least recently drawn tiles, never those of the current frame
+static void cpl_matrix_evict(CPLMatrix* matrix) {
+    while (matrix->resident >= CPL_MATRIX_TILE_BUDGET) {
+        CPLMatrixLevel* oldest_level = NULL;
+        size_t oldest = 0;
+        unsigned int oldest_age = 0;
+        for (int level = 0; level < matrix->num_levels; level++) {
+            CPLMatrixLevel* mip = &matrix->mips[level];
+            for (size_t i = 0; i < mip->tiles_x * mip->tiles_y; i++) {
+                unsigned int age = matrix->frame - mip->last_used[i];
+                if (mip->textures[i] && age > oldest_age) {
+                    oldest_level = mip;
+                    oldest = i;
+                    oldest_age = age;
+                }
+            }
+        }
+        if (!oldest_level) return;
+
+        glDeleteTextures(1, &oldest_level->textures[oldest]);
+        oldest_level->textures[oldest] = 0;
+        matrix->resident--;
+    }
+}
+
+static float cpl_mean4f(float a, float b, float c, float d) {
+    float values[4] = { a, b, c, d };
+    float sum = 0.0f;
+    int count = 0;
+    for (int i = 0; i < 4; i++) {
+        if (cpl_is_nanf(values[i])) continue;
+        sum += values[i];
+        count++;
+    }
+    return count > 0 ? sum / (float)count : NAN;
+}
+
+static void cpl_matrix_error(const char* message) {
+    fprintf(stderr, "CPlotLib Error: %s\n", message);
+}
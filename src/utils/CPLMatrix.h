@@ -0,0 +1,56 @@
+#ifndef CPL_MATRIX_H
+#define CPL_MATRIX_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include "CPLPlot.h"
+#include "CPLTransform.h"
+
+// Constants
+#define CPL_MATRIX_TILE 512              // Tile size in elements (tiles on the right and bottom edges may be smaller)
+
+// Matrix pyramids: cpl_imshow copies the matrix into level 0 and reduces each
+// further level from the one below, rows split over all cores. A view draws
+// one level, picked so that an element is at most a pixel wide, and only the
+// tiles of that level it can see; the GPU keeps recently drawn tiles as
+// textures and the CPU backends read the levels directly.
+
+// Builds the pyramid of `matrix` (format, sizes and extent set) from `data`
+bool cpl_matrix_build(CPLMatrix* matrix, const void* data);
+
+// Level to draw in a view of `viewport` (canvas pixels)
+int cpl_matrix_level(const CPLMatrix* matrix, const CPLViewTransform* view, const int* viewport);
+
+// Tiles of `level` reaching the NDC rectangle (min x, min y, max x, max y):
+// columns [range[0], range[1]) and rows [range[2], range[3]). Polar views
+// do not cull. False when none do.
+bool cpl_matrix_visible_tiles(const CPLMatrix* matrix, int level, const CPLViewTransform* view,
+                              const float* ndc_rect, size_t* range);
+
+// Offsets from the matrix origin of a tile's lower-left corner and its size, and
+// the texture coordinates its far edges reach (below 1 where the last elements
+// of a level overhang the extent)
+void cpl_matrix_tile_rect(const CPLMatrix* matrix, int level, size_t tile_x, size_t tile_y, float* tile_min,
+                          float* tile_size, float* texture_max);
+
+// Texture of a tile, uploaded (evicting the least recently drawn tiles past the
+// cache budget) when not resident; 0 on failure. Needs the figure's GL context.
+unsigned int cpl_matrix_tile_texture(CPLMatrix* matrix, int level, size_t tile_x, size_t tile_y);
+
+// Quads per tile side: one on cartesian plots (any scale maps a tile to a
+// rectangle), a grid following the arcs on polar plots
+int cpl_matrix_tile_cells(const CPLViewTransform* view);
+
+// Factor from a sampled texel to the element value (normalized integer textures)
+float cpl_matrix_value_scale(const CPLMatrix* matrix);
+
+// CPU backends: RGBA8 colors of the matrix of `plot` drawn into `viewport`
+// (canvas pixels) for the pixels `cells` (x, y, width, height, relative to the
+// plot box `box`), row y written at pixels + y * stride (bottom-up). Pixels
+// outside the matrix or on NaN elements are transparent.
+bool cpl_matrix_colors(const CPLPlot* plot, const int* viewport, const int* box, const int* cells,
+                       unsigned char* pixels, ptrdiff_t stride);
+
+void cpl_free_matrix(CPLMatrix* matrix);
+
+#endif // CPL_MATRIX_H
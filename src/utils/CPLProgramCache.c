@@ -0,0 +1,200 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "CPLProgramCache.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+// Cache entry header (host byte order: entries never leave the machine)
+typedef struct {
+    char magic[4];              // "CPLB"
+    uint32_t version;           // CPL_CACHE_VERSION
+    uint64_t key;               // Hash of the driver strings and shader sources
+    uint32_t format;            // Binary format reported by the driver
+    uint32_t length;            // Binary size in bytes
+} CPLProgramCacheHeader;
+
+// Internal function declarations
+static uint64_t cpl_cache_key(const char* vertex_source, const char* fragment_source);
+static uint64_t cpl_cache_hash(uint64_t hash, const char* text);
+static bool cpl_cache_dir(char* path, size_t size);
+static bool cpl_cache_file(uint64_t key, char* path, size_t size, bool create);
+static bool cpl_cache_make_dirs(char* path);
+
+// Constants
+#define CPL_CACHE_VERSION 1
+#define CPL_CACHE_MAX_BINARY (16u * 1024u * 1024u)
+#define CPL_CACHE_PATH_MAX 4096
+
+bool cpl_program_cache_supported(void) {
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+
+    // Contexts without ARB_get_program_binary reject the query
+    while (glGetError() != GL_NO_ERROR) {}
+    return formats > 0;
+}
+
+GLuint cpl_program_cache_load(const char* vertex_source, const char* fragment_source) {
+    if (!cpl_program_cache_supported()) return 0;
+
+    uint64_t key = cpl_cache_key(vertex_source, fragment_source);
+    char path[CPL_CACHE_PATH_MAX];
+    if (!cpl_cache_file(key, path, sizeof(path), false)) return 0;
+
+    FILE* file = fopen(path, "rb");
+    if (!file) return 0;
+
+    CPLProgramCacheHeader header;
+    void* binary = NULL;
+    bool ok = fread(&header, sizeof(header), 1, file) == 1 &&
+              memcmp(header.magic, "CPLB", 4) == 0 &&
+              header.version == CPL_CACHE_VERSION &&
+              header.key == key &&
+              header.length > 0 && header.length <= CPL_CACHE_MAX_BINARY;
+    if (ok) {
+        binary = malloc(header.length);
+        ok = binary && fread(binary, 1, header.length, file) == header.length;
+    }
+    fclose(file);
+
+    if (!ok) {
+        free(binary);
+        return 0;
+    }
+
+    GLuint program = glCreateProgram();
+    glProgramBinary(program, (GLenum)header.format, binary, (GLsizei)header.length);
+    free(binary);
+
+    // Drivers may reject binaries from other builds; drop the entry and recompile
+    GLint linked = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (!linked) {
+        glDeleteProgram(program);
+        while (glGetError() != GL_NO_ERROR) {}
+        remove(path);
+        return 0;
+    }
+
+    return program;
+}
+
+void cpl_program_cache_store(GLuint program, const char* vertex_source, const char* fragment_source) {
+    if (!program || !cpl_program_cache_supported()) return;
+
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0 || (GLuint)length > CPL_CACHE_MAX_BINARY) return;
+
+    void* binary = malloc((size_t)length);
+    if (!binary) return;
+
+    GLsizei written = 0;
+    GLenum format = 0;
+    glGetProgramBinary(program, length, &written, &format, binary);
+
+    CPLProgramCacheHeader header;
+    memcpy(header.magic, "CPLB", 4);
+    header.version = CPL_CACHE_VERSION;
+    header.key = cpl_cache_key(vertex_source, fragment_source);
+    header.format = (uint32_t)format;
+    header.length = (uint32_t)written;
+
+    char path[CPL_CACHE_PATH_MAX];
+    char temp[CPL_CACHE_PATH_MAX + 32];
+    if (written <= 0 || !cpl_cache_file(header.key, path, sizeof(path), true)) {
+        free(binary);
+        return;
+    }
+
+    // Write under a unique temporary name and rename, so other processes and
+    // threads never read or clobber a partial entry
+    snprintf(temp, sizeof(temp), "%s.XXXXXX", path);
+    int fd = mkstemp(temp);
+    FILE* file = fd >= 0 ? fdopen(fd, "wb") : NULL;
+    if (!file && fd >= 0) {
+        close(fd);
+        remove(temp);
+    }
+    if (file) {
+        bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                  fwrite(binary, 1, (size_t)written, file) == (size_t)written;
+        ok = fclose(file) == 0 && ok;
+        if (!ok || rename(temp, path) != 0) {
+            remove(temp);
+        }
+    }
+
+    free(binary);
+}
+
+// Internal helper functions
+static uint64_t cpl_cache_key(const char* vertex_source, const char* fragment_source) {
+    // FNV-1a over everything that changes the compiled result
+    uint64_t hash = 14695981039346656037ULL;
+    hash = cpl_cache_hash(hash, (const char*)glGetString(GL_VENDOR));
+    hash = cpl_cache_hash(hash, (const char*)glGetString(GL_RENDERER));
+    hash = cpl_cache_hash(hash, (const char*)glGetString(GL_VERSION));
+    hash = cpl_cache_hash(hash, vertex_source);
+    hash = cpl_cache_hash(hash, fragment_source);
+    return hash;
+}
+
+static uint64_t cpl_cache_hash(uint64_t hash, const char* text) {
+    // The terminator is hashed too, so field boundaries matter
+    const unsigned char* bytes = (const unsigned char*)(text ? text : "");
+    do {
+        hash ^= *bytes;
+        hash *= 1099511628211ULL;
+    } while (*bytes++);
+    return hash;
+}
+
+static bool cpl_cache_dir(char* path, size_t size) {
+    const char* override = getenv("CPL_SHADER_CACHE_DIR");
+    const char* xdg = getenv("XDG_CACHE_HOME");
+    const char* home = getenv("HOME");
+
+    int written;
+    if (override) {
+        if (override[0] == '\0') return false; // Explicitly disabled
+        written = snprintf(path, size, "%s", override);
+    } else if (xdg && xdg[0] == '/') {
+        written = snprintf(path, size, "%s/cplotlib", xdg);
+    } else if (home && home[0] != '\0') {
+        written = snprintf(path, size, "%s/.cache/cplotlib", home);
+    } else {
+        return false;
+    }
+
+    return written > 0 && (size_t)written < size;
+}
+
+static bool cpl_cache_file(uint64_t key, char* path, size_t size, bool create) {
+    if (!cpl_cache_dir(path, size)) return false;
+    if (create && !cpl_cache_make_dirs(path)) return false;
+
+    size_t used = strlen(path);
+    int written = snprintf(path + used, size - used, "/%016llx.bin", (unsigned long long)key);
+    return written > 0 && (size_t)written < size - used;
+}
+
+static bool cpl_cache_make_dirs(char* path) {
+    // mkdir -p: create each missing component in turn
+    for (char* p = path + 1; ; p++) {
+        if (*p != '/' && *p != '\0') continue;
+
+        char saved = *p;
+        *p = '\0';
+        bool ok = mkdir(path, 0755) == 0 || errno == EEXIST;
+        *p = saved;
+        if (!ok) return false;
+        if (saved == '\0') return true;
+    }
+}
@@ -0,0 +1,24 @@
+#ifndef CPL_PROGRAM_CACHE_H
+#define CPL_PROGRAM_CACHE_H
+
+#include <GL/glew.h>
+#include <stdbool.h>
+
+// On-disk cache of linked program binaries (glGetProgramBinary).
+// Entries are keyed by the driver's vendor, renderer and version strings and by
+// the shader sources, so driver updates and shader edits simply miss. The cache
+// lives in $CPL_SHADER_CACHE_DIR, else $XDG_CACHE_HOME/cplotlib, else
+// ~/.cache/cplotlib; setting CPL_SHADER_CACHE_DIR to an empty string disables it.
+// Every failure (no binary formats, unreadable or rejected entry) falls back to
+// compiling from source.
+
+// True when the current context can save and load program binaries
+bool cpl_program_cache_supported(void);
+
+// Returns a linked program from the cache, or 0 on a miss
+GLuint cpl_program_cache_load(const char* vertex_source, const char* fragment_source);
+
+// Stores a linked program (linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT set)
+void cpl_program_cache_store(GLuint program, const char* vertex_source, const char* fragment_source);
+
+#endif // CPL_PROGRAM_CACHE_H
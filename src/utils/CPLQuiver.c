@@ -0,0 +1,341 @@
+#include "CPLQuiver.h"
+#include "CPLUtils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <GL/glew.h>
+
+// Constants
+#define CPL_QUIVER_DEPTH 16              // Morton bits per axis: grid levels 0..16
+#define CPL_QUIVER_DUPLICATE (CPL_QUIVER_DEPTH + 1)  // Level of tails equal to the previous one
+#define CPL_QUIVER_LATTICE_TOLERANCE 1e-3  // Steps a lattice coordinate may be off an integer
+
+// Cell coordinates of one axis. Tails on a regular lattice (gridded data) use
+// their lattice index scaled to a power of two, so every level keeps every
+// 2^j-th row or column; others use their position over the range.
+typedef struct {
+    double min, max;
+    double step;                 // Lattice step (0: not a lattice)
+    int shift;                   // Lattice index -> cell coordinate
+} CPLQuiverAxis;
+
+static void cpl_quiver_error(const char* message);
+
+// Interleaves the low 16 bits of x (even bits) and y (odd bits)
+static uint32_t cpl_quiver_morton(uint32_t x, uint32_t y) {
+    x = (x | (x << 8)) & 0x00FF00FFu;
+    x = (x | (x << 4)) & 0x0F0F0F0Fu;
+    x = (x | (x << 2)) & 0x33333333u;
+    x = (x | (x << 1)) & 0x55555555u;
+    y = (y | (y << 8)) & 0x00FF00FFu;
+    y = (y | (y << 4)) & 0x0F0F0F0Fu;
+    y = (y | (y << 2)) & 0x33333333u;
+    y = (y | (y << 1)) & 0x55555555u;
+    return x | (y << 1);
+}
+
+// Cell coordinate of a tail along one axis: 0..65535
+static uint32_t cpl_quiver_cell(const CPLQuiverAxis* axis, double value) {
+    if (!(axis->max > axis->min)) return 0;
+    if (axis->step > 0.0) return (uint32_t)rint((value - axis->min) / axis->step) << axis->shift;
+    double t = (value - axis->min) / (axis->max - axis->min) * 65535.0;
+    return t <= 0.0 ? 0u : t >= 65535.0 ? 65535u : (uint32_t)t;
+}
+
+// Keeps the candidate lattice step of an axis (the smallest difference of
+// consecutive tails) when it fits 16-bit indices, and sets its shift
+static void cpl_quiver_lattice(CPLQuiverAxis* axis) {
+    double steps = axis->step > 0.0 ? rint((axis->max - axis->min) / axis->step) : INFINITY;
+    if (!(steps < 65536.0)) {
+        axis->step = 0.0;
+        return;
+    }
+    int bits = 0;
+    while (bits < CPL_QUIVER_DEPTH && (1u << bits) <= (uint32_t)steps) bits++;
+    axis->shift = CPL_QUIVER_DEPTH - bits;
+}
+
+static bool cpl_quiver_on_lattice(const CPLQuiverAxis* axis, double value) {
+    double t = (value - axis->min) / axis->step;
+    return fabs(t - rint(t)) <= CPL_QUIVER_LATTICE_TOLERANCE;
+}
+
+// As the line origins: the midpoint for data far from zero, zero otherwise
+static double cpl_quiver_origin(double min, double max) {
+    double mid = 0.5 * (min + max);
+    return fabs(mid) > max - min ? mid : 0.0;
+}
+
+// Level of sorted key `i` (codes in the high halves)
+static int cpl_quiver_level(const uint64_t* keys, size_t i) {
+    if (i == 0) return 0;
+    uint32_t change = (uint32_t)(keys[i] >> 32) ^ (uint32_t)(keys[i - 1] >> 32);
+    if (change == 0) return CPL_QUIVER_DUPLICATE;
+    int bit = 31;
+    while (!(change >> bit)) bit--;
+    return CPL_QUIVER_DEPTH - bit / 2;
+}
+
+// Thinning level of a view. Level k splits each axis with spread tails into
+// 2^k cells: keep a cell per CPL_QUIVER_SPACING pixels square, or along the
+// line when the tails only spread along one axis.
+static int cpl_quiver_view_level(const CPLQuiver* quiver, const CPLViewTransform* view, const int* viewport) {
+    bool spread_x = quiver->tails[2] > quiver->tails[0];
+    bool spread_y = quiver->tails[3] > quiver->tails[1];
+    if (!spread_x && !spread_y) return 0;
+
+    // Pixel extent of the tails, sampled on a 5 x 5 grid so log mappings and
+    // full polar turns are followed roughly
+    float lo[2] = { INFINITY, INFINITY };
+    float hi[2] = { -INFINITY, -INFINITY };
+    for (int j = 0; j <= 4; j++) {
+        for (int i = 0; i <= 4; i++) {
+            float vertex[2] = {
+                quiver->tails[0] + 0.25f * (float)i * (quiver->tails[2] - quiver->tails[0]),
+                quiver->tails[1] + 0.25f * (float)j * (quiver->tails[3] - quiver->tails[1])
+            };
+            float ndc[2];
+            cpl_view_map(view, quiver->origin, vertex, NULL, ndc);
+            for (int axis = 0; axis < 2; axis++) {
+                lo[axis] = fminf(lo[axis], ndc[axis]);
+                hi[axis] = fmaxf(hi[axis], ndc[axis]);
+            }
+        }
+    }
+    double width = (double)(hi[0] - lo[0]) * 0.5 * viewport[2];
+    double height = (double)(hi[1] - lo[1]) * 0.5 * viewport[3];
+    double cells = spread_x && spread_y ? sqrt(width * height) : fmax(width, height);
+    cells /= CPL_QUIVER_SPACING;
+    if (!(cells >= 1.0)) return 0;
+    if (cells >= (double)(1u << (CPL_QUIVER_LEVELS - 1))) return CPL_QUIVER_LEVELS - 1;
+    return (int)floor(log2(cells));
+}
+
+static bool cpl_quiver_finite(double x, double y, double u, double v) {
+    return cpl_is_finite(x) && cpl_is_finite(y) && cpl_is_finite(u) && cpl_is_finite(v);
+}
+
+bool cpl_quiver_build(CPLQuiver* quiver, const double* x, const double* y, const double* u, const double* v, size_t n,
+                      float scale) {
+    CPLQuiverAxis axes[2] = { { INFINITY, -INFINITY, INFINITY, 0 }, { INFINITY, -INFINITY, INFINITY, 0 } };
+    double last[2] = { NAN, NAN };
+    double longest = 0.0;
+    size_t count = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (!cpl_quiver_finite(x[i], y[i], u[i], v[i])) continue;
+        double tail[2] = { x[i], y[i] };
+        for (int k = 0; k < 2; k++) {
+            CPLQuiverAxis* axis = &axes[k];
+            if (tail[k] < axis->min) axis->min = tail[k];
+            if (tail[k] > axis->max) axis->max = tail[k];
+            double step = fabs(tail[k] - last[k]);
+            if (step > 0.0 && step < axis->step) axis->step = step;
+            last[k] = tail[k];
+        }
+        double length = u[i] * u[i] + v[i] * v[i];
+        if (length > longest) longest = length;
+        count++;
+    }
+
+    free(quiver->records);
+    quiver->records = NULL;
+    quiver->num_arrows = 0;
+    memset(quiver->level_ends, 0, sizeof(quiver->level_ends));
+    memset(quiver->bounds, 0, sizeof(quiver->bounds));
+    memset(quiver->tails, 0, sizeof(quiver->tails));
+    quiver->origin[0] = quiver->origin[1] = 0.0;
+    quiver->auto_scale = !(scale > 0.0f);
+    quiver->dirty = true;
+    if (count == 0) return true;
+
+    // Lattice axes need every tail on the lattice
+    cpl_quiver_lattice(&axes[0]);
+    cpl_quiver_lattice(&axes[1]);
+    for (size_t i = 0; i < n && (axes[0].step > 0.0 || axes[1].step > 0.0); i++) {
+        if (!cpl_quiver_finite(x[i], y[i], u[i], v[i])) continue;
+        if (axes[0].step > 0.0 && !cpl_quiver_on_lattice(&axes[0], x[i])) axes[0].step = 0.0;
+        if (axes[1].step > 0.0 && !cpl_quiver_on_lattice(&axes[1], y[i])) axes[1].step = 0.0;
+    }
+
+    // Auto scale: the mean spacing is the side of the area per tail (or the
+    // length per tail when they lie on a line)
+    double factor = scale;
+    if (quiver->auto_scale) {
+        double width = axes[0].max - axes[0].min;
+        double height = axes[1].max - axes[1].min;
+        double spacing = width > 0.0 && height > 0.0 ? sqrt(width * height / (double)count)
+                       : fmax(width, height) / (double)(count > 1 ? count - 1 : 1);
+        if (!(spacing > 0.0)) spacing = 1.0;
+        longest = sqrt(longest);
+        factor = longest > 0.0 ? spacing / longest : 1.0;
+    }
+
+    if (count > UINT32_MAX) {
+        cpl_quiver_error("Too many quiver arrows");
+        return false;
+    }
+    float* records = (float*)malloc(count * 4 * sizeof(float));
+    float* unsorted = (float*)malloc(count * 4 * sizeof(float));
+    uint64_t* keys = (uint64_t*)malloc(count * 2 * sizeof(uint64_t));
+    if (!records || !unsorted || !keys) {
+        free(records);
+        free(unsorted);
+        free(keys);
+        cpl_quiver_error("Failed to allocate quiver records");
+        return false;
+    }
+
+    // Records in input order, keyed by the Morton code of the tail over the
+    // tail's cells (high half) and their index (low half)
+    quiver->origin[0] = cpl_quiver_origin(axes[0].min, axes[0].max);
+    quiver->origin[1] = cpl_quiver_origin(axes[1].min, axes[1].max);
+    float bounds[4] = { INFINITY, INFINITY, -INFINITY, -INFINITY };
+    float tails[4] = { INFINITY, INFINITY, -INFINITY, -INFINITY };
+    size_t m = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (!cpl_quiver_finite(x[i], y[i], u[i], v[i])) continue;
+        uint32_t code = cpl_quiver_morton(cpl_quiver_cell(&axes[0], x[i]), cpl_quiver_cell(&axes[1], y[i]));
+        keys[m] = (uint64_t)code << 32 | m;
+        float* record = unsorted + m * 4;
+        record[0] = (float)(x[i] - quiver->origin[0]);
+        record[1] = (float)(y[i] - quiver->origin[1]);
+        record[2] = (float)(u[i] * factor);
+        record[3] = (float)(v[i] * factor);
+        for (int axis = 0; axis < 2; axis++) {
+            float tail = record[axis];
+            float tip = tail + record[2 + axis];
+            tails[axis] = fminf(tails[axis], tail);
+            tails[2 + axis] = fmaxf(tails[2 + axis], tail);
+            bounds[axis] = fminf(bounds[axis], fminf(tail, tip));
+            bounds[2 + axis] = fmaxf(bounds[2 + axis], fmaxf(tail, tip));
+        }
+        m++;
+    }
+
+    // LSD radix sort by code, 8 bits per pass; four passes end in the first half
+    uint64_t* in = keys;
+    uint64_t* out = keys + count;
+    for (int shift = 32; shift < 64; shift += 8) {
+        size_t offsets[256] = { 0 };
+        for (size_t i = 0; i < count; i++) offsets[(in[i] >> shift) & 0xFFu]++;
+        size_t sum = 0;
+        for (int b = 0; b < 256; b++) {
+            size_t c = offsets[b];
+            offsets[b] = sum;
+            sum += c;
+        }
+        for (size_t i = 0; i < count; i++) out[offsets[(in[i] >> shift) & 0xFFu]++] = in[i];
+        uint64_t* swap = in;
+        in = out;
+        out = swap;
+    }
+
+    // Level of every arrow: the coarsest grid (2^k cells per axis, the top 2k
+    // code bits) where it is the first tail of its cell. A stable counting sort
+    // by level gives the final order.
+    size_t ends[CPL_QUIVER_LEVELS] = { 0 };
+    for (size_t i = 0; i < count; i++) ends[cpl_quiver_level(in, i)]++;
+    size_t sum = 0;
+    for (int k = 0; k < CPL_QUIVER_LEVELS; k++) {
+        size_t c = ends[k];
+        ends[k] = sum;
+        sum += c;
+        quiver->level_ends[k] = sum;
+    }
+    for (size_t i = 0; i < count; i++) {
+        size_t slot = ends[cpl_quiver_level(in, i)]++;
+        memcpy(records + slot * 4, unsorted + (size_t)(uint32_t)in[i] * 4, 4 * sizeof(float));
+    }
+
+    memcpy(quiver->bounds, bounds, sizeof(bounds));
+    memcpy(quiver->tails, tails, sizeof(tails));
+    quiver->records = records;
+    quiver->num_arrows = count;
+
+    free(unsorted);
+    free(keys);
+    return true;
+}
+
+size_t cpl_quiver_count(const CPLQuiver* quiver, const CPLViewTransform* view, const int* viewport,
+                        const float* ndc_rect) {
+    if (quiver->num_arrows == 0) return 0;
+
+    size_t count = quiver->level_ends[cpl_quiver_view_level(quiver, view, viewport)];
+
+    // The tips of stretched arrows reach further from the tails
+    float stretch = cpl_quiver_stretch(quiver, count);
+    float bounds[4];
+    for (int k = 0; k < 4; k++) bounds[k] = quiver->tails[k] + (quiver->bounds[k] - quiver->tails[k]) * stretch;
+    float window[4];
+    return cpl_view_window(view, quiver->origin, bounds, ndc_rect, window) ? count : 0;
+}
+
+float cpl_quiver_stretch(const CPLQuiver* quiver, size_t count) {
+    if (!quiver->auto_scale || count == 0) return 1.0f;
+    return (float)sqrt((double)quiver->num_arrows / (double)count);
+}
+
+bool cpl_quiver_arrow(const CPLQuiver* quiver, size_t index, const CPLViewTransform* view, const int* viewport,
+                      float stretch, const float* ndc_rect, float* ndc) {
+    const float* record = quiver->records + index * 4;
+    float tip_offset[2] = { record[0] + record[2] * stretch, record[1] + record[3] * stretch };
+    float tail[2], tip[2];
+    cpl_view_map(view, quiver->origin, record, NULL, tail);
+    cpl_view_map(view, quiver->origin, tip_offset, NULL, tip);
+    if (!cpl_is_finitef(tail[0]) || !cpl_is_finitef(tail[1]) || !cpl_is_finitef(tip[0]) || !cpl_is_finitef(tip[1])) {
+        return false;
+    }
+
+    // Head in pixels, as the vertex shader: barbs back from the tip along the
+    // arrow, spread to both sides
+    float pixel[2] = { 2.0f / (float)viewport[2], 2.0f / (float)viewport[3] };
+    float dx = (tip[0] - tail[0]) / pixel[0];
+    float dy = (tip[1] - tail[1]) / pixel[1];
+    float length = sqrtf(dx * dx + dy * dy);
+    float head = CPL_QUIVER_HEAD * length;
+    float dir[2] = { 0.0f, 0.0f };
+    if (length > 0.0f) {
+        dir[0] = dx / length;
+        dir[1] = dy / length;
+    }
+    float spread = CPL_QUIVER_HEAD_WIDTH;
+    ndc[0] = tail[0];
+    ndc[1] = tail[1];
+    ndc[2] = tip[0];
+    ndc[3] = tip[1];
+    ndc[4] = tip[0];
+    ndc[5] = tip[1];
+    ndc[6] = tip[0] - head * (dir[0] - spread * dir[1]) * pixel[0];
+    ndc[7] = tip[1] - head * (dir[1] + spread * dir[0]) * pixel[1];
+    ndc[8] = tip[0];
+    ndc[9] = tip[1];
+    ndc[10] = tip[0] - head * (dir[0] + spread * dir[1]) * pixel[0];
+    ndc[11] = tip[1] - head * (dir[1] - spread * dir[0]) * pixel[1];
+
+    float lo[2] = { ndc[0], ndc[1] };
+    float hi[2] = { ndc[0], ndc[1] };
+    for (int k = 2; k < 12; k += 2) {
+        lo[0] = fminf(lo[0], ndc[k]);
+        lo[1] = fminf(lo[1], ndc[k + 1]);
+        hi[0] = fmaxf(hi[0], ndc[k]);
+        hi[1] = fmaxf(hi[1], ndc[k + 1]);
+    }
+    return hi[0] >= ndc_rect[0] && lo[0] <= ndc_rect[2] && hi[1] >= ndc_rect[1] && lo[1] <= ndc_rect[3];
+}
+
+void cpl_free_quiver(CPLQuiver* quiver) {
+    if (!quiver) return;
+
+    if (quiver->vao) glDeleteVertexArrays(1, &quiver->vao);
+    if (quiver->vbo) glDeleteBuffers(1, &quiver->vbo);
+    free(quiver->records);
+    free(quiver);
+}
+
+static void cpl_quiver_error(const char* message) {
+    fprintf(stderr, "CPlotLib Error: %s\n", message);
+}
@@ -0,0 +1,47 @@
+#ifndef CPL_QUIVER_H
+#define CPL_QUIVER_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include "CPLPlot.h"
+#include "CPLTransform.h"
+
+// Constants
+#define CPL_QUIVER_SPACING 12.0f         // On-screen arrows are thinned to about one per square of this many pixels
+#define CPL_QUIVER_HEAD 0.3f             // Arrow head length relative to the arrow
+#define CPL_QUIVER_HEAD_WIDTH 0.4f       // Half-spread of the head barbs relative to the head length
+
+// Quivers are drawn as line arrows (shaft and two head barbs), expanded from
+// one record per arrow in the vertex shader. The records are stored coarse to
+// fine: sorting the tails along a Morton curve makes the first tail in every
+// cell of a 2^k x 2^k grid over them a representative of that cell, and
+// ordering by the level where an arrow first represents a cell turns every
+// prefix into an evenly spread subset. A view draws the prefix whose cells are
+// about CPL_QUIVER_SPACING pixels across.
+
+// Fills the records, levels, origin and bounds of `quiver` from `n` arrows;
+// `scale` multiplies u and v (<= 0: the longest arrow spans the mean spacing
+// of the tails, and auto_scale is set). False when the records cannot be allocated.
+bool cpl_quiver_build(CPLQuiver* quiver, const double* x, const double* y, const double* u, const double* v, size_t n,
+                      float scale);
+
+// Arrows to draw (a prefix of the records) in a view of `viewport` (canvas
+// pixels); 0 when none can reach the NDC rectangle (min x, min y, max x, max y)
+size_t cpl_quiver_count(const CPLQuiver* quiver, const CPLViewTransform* view, const int* viewport,
+                        const float* ndc_rect);
+
+// Factor on the stored vectors when `count` arrows are drawn: auto-scaled
+// arrows keep spanning the mean spacing of the drawn ones, which grows as the
+// square root of the thinning
+float cpl_quiver_stretch(const CPLQuiver* quiver, size_t count);
+
+// CPU backends: NDC line segments of arrow `index` (tail-tip, tip-barb,
+// tip-barb: 6 points as x, y pairs) with its vector times `stretch`, as the
+// vertex shader builds them. False when the arrow does not map to finite
+// coordinates or misses the NDC rectangle.
+bool cpl_quiver_arrow(const CPLQuiver* quiver, size_t index, const CPLViewTransform* view, const int* viewport,
+                      float stretch, const float* ndc_rect, float* ndc);
+
+void cpl_free_quiver(CPLQuiver* quiver);
+
+#endif // CPL_QUIVER_H
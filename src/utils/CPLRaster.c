@@ -0,0 +1,1000 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "CPLRaster.h"
+#include "CPLRenderer.h"
+#include "CPLGeometry.h"
+#include "CPLTransform.h"
+#include "CPLDensity.h"
+#include "CPLWaterfall.h"
+#include "CPLMatrix.h"
+#include "CPLHistogram.h"
+#include "CPLContour.h"
+#include "CPLQuiver.h"
+#include "CPLCandles.h"
+#include "CPLUtils.h"
+#include "CPLPlot.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <pthread.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Vertex in pixel coordinates (origin bottom-left, pixel centres at +0.5 like GL)
+typedef struct {
+    float x, y;
+    float r, g, b;
+} CPLRasterVertex;
+
+typedef enum {
+    CPL_RASTER_STRIP,       // Consecutive vertices are joined (GL_LINE_STRIP)
+    CPL_RASTER_SEGMENTS,    // Vertex pairs are independent segments (GL_LINES)
+    CPL_RASTER_POINTS,      // Vertex pairs are discs: centre and color, then radius and opacity in x, y
+    CPL_RASTER_IMAGE        // One vertex pair: lower-left and upper-right corner of the draw's image
+} CPLRasterMode;
+
+// One draw call: a run of vertices sharing a width and a viewport
+typedef struct {
+    size_t first;
+    size_t count;
+    CPLRasterMode mode;
+    float radius;           // Half the line width plus the half-pixel AA ramp (lines only)
+    int clip[4];            // Viewport as x0, y0, x1, y1 (x1/y1 exclusive)
+    unsigned char* image;   // Images: RGBA8 pixels covering `clip`, bottom-up (owned by the scene)
+} CPLRasterDraw;
+
+// Draw list of a whole figure and its binning into screen tiles
+typedef struct {
+    CPLRasterVertex* vertices;
+    size_t num_vertices, vertex_capacity;
+    CPLRasterDraw* draws;
+    size_t num_draws, draw_capacity;
+
+    int width, height;          // Rendered region
+    size_t row_pixels;          // Output row stride in pixels
+    int tiles_x, tiles_y;
+    size_t* tile_offsets;       // Prefix sums into tile_segments (num_tiles + 1 entries)
+    uint32_t* tile_segments;    // First vertex of every segment touching a tile, in draw order
+
+    Color background;
+    unsigned char* pixels;
+
+    pthread_mutex_t lock;       // Guards next_tile and ok
+    size_t next_tile;
+    bool ok;
+} CPLRasterScene;
+
+// Segment set up for span filling
+typedef struct {
+    float ax, ay;           // Start point
+    float dx, dy;           // End - start
+    float inv_length2;      // 1 / |d|^2 (0 for degenerate segments)
+    float radius;
+    float alpha;            // Opacity (1 for lines)
+    float r, g, b;          // Start color
+    float dr, dg, db;       // End color - start color
+} CPLRasterSegment;
+
+// Internal function declarations
+static bool cpl_raster_build_scene(CPLRasterScene* scene, struct CPLFigure* fig, int canvas_width, int canvas_height,
+                                   const int* region);
+static bool cpl_raster_push_draw(CPLRasterScene* scene, const float* vertices, size_t count, CPLRasterMode mode,
+                                 float line_width, const int* viewport, const int* clip_rect, bool closed,
+                                 const CPLViewTransform* view, const double* origin, const float* low);
+static bool cpl_raster_push_points(CPLRasterScene* scene, const CPLScatter* scatter, const int* viewport,
+                                   const int* clip_rect, const CPLViewTransform* view);
+static bool cpl_raster_push_density(CPLRasterScene* scene, CPLDensity* density, CPLDensityNorm norm,
+                                    CPLColormap colormap, const int* box);
+static bool cpl_raster_push_waterfall(CPLRasterScene* scene, const CPLPlot* plot, const int* viewport,
+                                      const int* box);
+static bool cpl_raster_push_matrix(CPLRasterScene* scene, const CPLPlot* plot, const int* viewport, const int* box);
+static bool cpl_raster_push_histogram(CPLRasterScene* scene, const CPLPlot* plot, const int* viewport,
+                                      const int* box);
+static bool cpl_raster_push_candles(CPLRasterScene* scene, const CPLPlot* plot, const int* viewport,
+                                    const int* box);
+static bool cpl_raster_push_quiver(CPLRasterScene* scene, const CPLPlot* plot, const int* viewport, const int* box,
+                                   const CPLViewTransform* view, const float* ndc_rect);
+static bool cpl_raster_push_multiples(CPLRasterScene* scene, const CPLPlot* plot, const int* viewport);
+static bool cpl_raster_push_image(CPLRasterScene* scene, const int* box, CPLRasterDraw** image_draw, int* cells);
+static bool cpl_raster_reserve(CPLRasterScene* scene, size_t vertices);
+static CPLRasterDraw* cpl_raster_begin_draw(CPLRasterScene* scene, CPLRasterMode mode, const int* clip_rect);
+static size_t cpl_raster_merge_subpixel(CPLRasterVertex* vertices, size_t count, const int* clip, float radius);
+static bool cpl_raster_same_pixel(const CPLRasterVertex* a, const CPLRasterVertex* b);
+static int cpl_raster_outcode(const CPLRasterVertex* v, const int* clip, float radius);
+static bool cpl_raster_bin(CPLRasterScene* scene);
+static bool cpl_raster_bounds(const CPLRasterScene* scene, const CPLRasterDraw* draw, size_t index, int* bounds);
+static void* cpl_raster_worker_main(void* arg);
+static void cpl_raster_tile(CPLRasterScene* scene, size_t tile, float* planes);
+static void cpl_raster_segment(float* planes, int tile_x, int tile_y, const CPLRasterSegment* segment,
+                               const int* bounds);
+static void cpl_raster_span(float* row_planes, int tile_x, int x_start, int x_end, float ry,
+                            const CPLRasterSegment* segment);
+static void cpl_raster_image(float* planes, int tile_x, int tile_y, const CPLRasterDraw* draw, const int* bounds);
+static void cpl_raster_free_scene(CPLRasterScene* scene);
+static void cpl_raster_error(const char* message);
+
+// External function declarations
+size_t cpl_small_multiple_vertices(const CPLSmallMultiples* multiples, size_t index, bool frame, float* vertices);
+
+// Constants
+#define CPL_RASTER_TILE 64                  // Tile edge in pixels (4 float planes stay in L2)
+#define CPL_RASTER_PLANE (CPL_RASTER_TILE * CPL_RASTER_TILE)
+#define CPL_RASTER_PADDING 4                // Masked SIMD groups may touch 3 floats past a row
+#define CPL_RASTER_MIN_HALF_WIDTH 0.5f      // GL never draws lines thinner than a pixel
+#define CPL_RASTER_INITIAL_CAPACITY 64
+
+// Public entry points
+bool cpl_raster_figure(struct CPLFigure* fig, unsigned char* pixels, size_t threads) {
+    if (!fig) return false;
+
+    const int region[4] = { 0, 0, (int)fig->width, (int)fig->height };
+    return cpl_raster_region(fig, (int)fig->width, (int)fig->height, region, pixels, fig->width, threads);
+}
+
+bool cpl_raster_region(struct CPLFigure* fig, int canvas_width, int canvas_height, const int* region,
+                       unsigned char* pixels, size_t row_pixels, size_t threads) {
+    if (!fig || !region || !pixels || region[2] <= 0 || region[3] <= 0) return false;
+    if (row_pixels < (size_t)region[2]) return false;
+
+    CPLRasterScene scene;
+    memset(&scene, 0, sizeof(scene));
+    scene.width = region[2];
+    scene.height = region[3];
+    scene.row_pixels = row_pixels;
+    scene.tiles_x = (scene.width + CPL_RASTER_TILE - 1) / CPL_RASTER_TILE;
+    scene.tiles_y = (scene.height + CPL_RASTER_TILE - 1) / CPL_RASTER_TILE;
+    scene.background = fig->bg_color;
+    scene.pixels = pixels;
+    scene.ok = true;
+
+    if (!cpl_raster_build_scene(&scene, fig, canvas_width, canvas_height, region) || !cpl_raster_bin(&scene)) {
+        cpl_raster_free_scene(&scene);
+        return false;
+    }
+
+    // Tiles are handed out one at a time; the calling thread works as well
+    size_t num_tiles = (size_t)scene.tiles_x * (size_t)scene.tiles_y;
+    size_t num_workers = threads == 0 ? 1 : threads;
+    if (num_workers > num_tiles) num_workers = num_tiles;
+
+    if (pthread_mutex_init(&scene.lock, NULL) != 0) {
+        cpl_raster_error("Failed to set up raster workers");
+        cpl_raster_free_scene(&scene);
+        return false;
+    }
+    cpl_run_workers(&scene, 0, num_workers, cpl_raster_worker_main);
+    pthread_mutex_destroy(&scene.lock);
+
+    bool ok = scene.ok;
+    cpl_raster_free_scene(&scene);
+    return ok;
+}
+
+// Scene construction
+static bool cpl_raster_build_scene(CPLRasterScene* scene, struct CPLFigure* fig, int canvas_width, int canvas_height,
+                                   const int* region) {
+    float box_vertices[20]; // 4 vertices * (2 coords + 3 color)
+
+    for (size_t p = 0; p < fig->num_plots; p++) {
+        CPLPlot* plot = fig->plots[p];
+        if (!plot || !plot->data) continue;
+
+        // Viewport on the canvas, moved so the region starts at the origin
+        int canvas_viewport[4], viewport[4];
+        cpl_plot_viewport(plot, canvas_width, canvas_height, canvas_viewport);
+        memcpy(viewport, canvas_viewport, sizeof(viewport));
+        viewport[0] -= region[0];
+        viewport[1] -= region[1];
+        if (viewport[2] <= 0 || viewport[3] <= 0 ||
+            viewport[0] >= scene->width || viewport[0] + viewport[2] <= 0 ||
+            viewport[1] >= scene->height || viewport[1] + viewport[3] <= 0) {
+            continue;
+        }
+
+        // Small multiples draw only their tiles, as in GL
+        if (plot->data->multiples) {
+            if (!cpl_raster_push_multiples(scene, plot, viewport)) return false;
+            continue;
+        }
+
+        // Grid first so the box edges stay dark (the GL depth test keeps the
+        // first-drawn box on top), then the data above both
+        if (plot->show_grid && plot->data->grid) {
+            CPLGeometry* grid = plot->data->grid;
+            size_t count = cpl_grid_vertex_count(grid->grid_lines);
+            float* grid_vertices = (float*)malloc(count * 5 * sizeof(float));
+            if (!grid_vertices) {
+                cpl_raster_error("Failed to allocate grid vertices");
+                return false;
+            }
+
+            cpl_build_grid_vertices(grid->margin, grid->grid_lines, grid->show_axes, grid_vertices);
+            bool pushed = cpl_raster_push_draw(scene, grid_vertices, count, CPL_RASTER_SEGMENTS,
+                                               plot->grid_line_width, viewport, viewport, false, NULL, NULL, NULL);
+            free(grid_vertices);
+            if (!pushed) return false;
+        }
+
+        if (plot->data->box) {
+            cpl_build_box_vertices(plot->data->box->margin, box_vertices);
+            if (!cpl_raster_push_draw(scene, box_vertices, cpl_box_vertex_count(), CPL_RASTER_STRIP,
+                                      plot->box_line_width, viewport, viewport, true, NULL, NULL, NULL)) {
+                return false;
+            }
+        }
+
+        // Data is clipped to the plot box, and lines only contribute when they
+        // reach the rendered part of it (sorted lines: only the samples that do)
+        int box[4];
+        cpl_plot_box_rect(plot, viewport, box);
+        float pad = 0.5f * plot->line_width + 1.0f;
+        float reach[4] = {
+            (float)(box[0] > 0 ? box[0] : 0) - pad,
+            (float)(box[1] > 0 ? box[1] : 0) - pad,
+            (float)(box[0] + box[2] < scene->width ? box[0] + box[2] : scene->width) + pad,
+            (float)(box[1] + box[3] < scene->height ? box[1] + box[3] : scene->height) + pad
+        };
+        float ndc_rect[4];
+        for (int k = 0; k < 4; k++) {
+            ndc_rect[k] = (reach[k] - (float)viewport[k % 2]) * 2.0f / (float)viewport[2 + k % 2] - 1.0f;
+        }
+
+        // Images lie below the lines, the matrix lowest
+        if (plot->data->matrix) {
+            if (!cpl_raster_push_matrix(scene, plot, viewport, box)) return false;
+        }
+        if (plot->data->waterfall && plot->data->waterfall->filled > 0) {
+            if (!cpl_raster_push_waterfall(scene, plot, viewport, box)) return false;
+        }
+
+        // Histogram bars below the lines
+        if (plot->data->histogram) {
+            if (!cpl_raster_push_histogram(scene, plot, viewport, box)) return false;
+        }
+        if (plot->data->candles) {
+            if (!cpl_raster_push_candles(scene, plot, viewport, box)) return false;
+        }
+
+        CPLViewTransform view;
+        cpl_view_transform(plot, viewport, &view);
+
+        // Contour lines below the plotted lines, polyline by polyline
+        const CPLContour* contour = plot->data->contour;
+        if (contour && cpl_contour_visible(contour, &view, ndc_rect)) {
+            for (size_t i = 0; i < contour->num_polylines; i++) {
+                if (!cpl_raster_push_draw(scene, contour->vertices + (size_t)contour->firsts[i] * 5,
+                                          (size_t)contour->counts[i], CPL_RASTER_STRIP, plot->line_width, viewport,
+                                          box, false, &view, contour->origin, NULL)) {
+                    return false;
+                }
+            }
+        }
+        if (plot->data->quiver) {
+            if (!cpl_raster_push_quiver(scene, plot, viewport, box, &view, ndc_rect)) return false;
+        }
+
+        for (size_t i = 0; i < plot->data->num_lines; i++) {
+            CPLLine* line = &plot->data->lines[i];
+            if (!line->is_loaded || !line->vertices) continue;
+
+            float window[4];
+            if (!cpl_view_window(&view, line->origin, line->bounds, ndc_rect, window)) continue;
+
+            size_t first, count;
+            cpl_line_visible_range(line, window[0], window[2], &first, &count);
+            if (!cpl_raster_push_draw(scene, line->vertices + first * 5, count, CPL_RASTER_STRIP,
+                                      plot->line_width, viewport, box, false, &view, line->origin,
+                                      line->low ? line->low + first * 2 : NULL)) {
+                return false;
+            }
+        }
+
+        // Persistence traces above the lines, binned at canvas resolution
+        if (plot->data->traces && plot->data->traces->num_traces > 0) {
+            CPLTraces* traces = plot->data->traces;
+            CPLDensity* grid = cpl_traces_grid(plot, canvas_viewport);
+            if (grid && !cpl_raster_push_density(scene, grid, traces->norm, plot->colormap, box)) return false;
+        }
+
+        // Scatters above the lines, as one density image or point by point (only
+        // the points near the region are kept)
+        if (plot->density != CPL_DENSITY_OFF) {
+            CPLDensity* density = cpl_density_update(plot, canvas_viewport);
+            if (density && !cpl_raster_push_density(scene, density, plot->density, plot->colormap, box)) {
+                return false;
+            }
+            continue;
+        }
+        for (size_t i = 0; i < plot->data->num_scatters; i++) {
+            const CPLScatter* scatter = &plot->data->scatters[i];
+            if (!scatter->is_loaded) continue;
+
+            float radius = 0.5f * scatter->max_size + 1.0f;
+            float scatter_rect[4] = {
+                ndc_rect[0] - radius * 2.0f / (float)viewport[2], ndc_rect[1] - radius * 2.0f / (float)viewport[3],
+                ndc_rect[2] + radius * 2.0f / (float)viewport[2], ndc_rect[3] + radius * 2.0f / (float)viewport[3]
+            };
+            float window[4];
+            if (!cpl_view_window(&view, scatter->origin, scatter->bounds, scatter_rect, window)) continue;
+            if (!cpl_raster_push_points(scene, scatter, viewport, box, &view)) return false;
+        }
+    }
+
+    return true;
+}
+
+// Vertices are NDC, or data offsets from `origin` (plus residuals in `low`, if
+// any) mapped through `view` when given
+static bool cpl_raster_push_draw(CPLRasterScene* scene, const float* vertices, size_t count, CPLRasterMode mode,
+                                 float line_width, const int* viewport, const int* clip_rect, bool closed,
+                                 const CPLViewTransform* view, const double* origin, const float* low) {
+    if (count < 2) return true; // Nothing to draw, as in GL
+
+    // Line loops are stored as strips that repeat their first vertex
+    size_t stored = closed ? count + 1 : count;
+    if (!cpl_raster_reserve(scene, stored)) return false;
+
+    // NDC -> window coordinates, exactly as glViewport maps them
+    float scale_x = 0.5f * (float)viewport[2];
+    float scale_y = 0.5f * (float)viewport[3];
+    CPLRasterVertex* out = scene->vertices + scene->num_vertices;
+    for (size_t i = 0; i < stored; i++) {
+        const float* in = vertices + (i % count) * 5;
+        float ndc[2] = { in[0], in[1] };
+        if (view) {
+            cpl_view_map(view, origin, in, low ? low + (i % count) * 2 : NULL, ndc);
+        }
+        out[i].x = (float)viewport[0] + (ndc[0] + 1.0f) * scale_x;
+        out[i].y = (float)viewport[1] + (ndc[1] + 1.0f) * scale_y;
+        out[i].r = in[2];
+        out[i].g = in[3];
+        out[i].b = in[4];
+    }
+    
+    CPLRasterDraw* draw = cpl_raster_begin_draw(scene, mode, clip_rect);
+    float half_width = 0.5f * line_width;
+    if (half_width < CPL_RASTER_MIN_HALF_WIDTH) half_width = CPL_RASTER_MIN_HALF_WIDTH;
+    draw->radius = half_width + 0.5f;
+
+    // Dense strips put hundreds of vertices into each pixel, and tiled exports
+    // leave most of a strip off-screen; neither run needs its inner vertices
+    if (mode == CPL_RASTER_STRIP) {
+        stored = cpl_raster_merge_subpixel(out, stored, draw->clip, draw->radius);
+    }
+    draw->count = stored;
+
+    scene->num_vertices += stored;
+    return true;
+}
+
+// Discs of a scatter, mapped through `view`; points whose disc misses the clip
+// rectangle or that are fully transparent are dropped
+static bool cpl_raster_push_points(CPLRasterScene* scene, const CPLScatter* scatter, const int* viewport,
+                                   const int* clip_rect, const CPLViewTransform* view) {
+    if (!cpl_raster_reserve(scene, scatter->num_points * 2)) return false;
+
+    CPLRasterDraw* draw = cpl_raster_begin_draw(scene, CPL_RASTER_POINTS, clip_rect);
+    draw->radius = 0.0f;
+
+    float scale_x = 0.5f * (float)viewport[2];
+    float scale_y = 0.5f * (float)viewport[3];
+    CPLRasterVertex* out = scene->vertices + scene->num_vertices;
+    size_t stored = 0;
+    for (size_t i = 0; i < scatter->num_points; i++) {
+        float ndc[2];
+        cpl_view_map(view, scatter->origin, scatter->offsets + i * 2, scatter->low ? scatter->low + i * 2 : NULL, ndc);
+        float x = (float)viewport[0] + (ndc[0] + 1.0f) * scale_x;
+        float y = (float)viewport[1] + (ndc[1] + 1.0f) * scale_y;
+
+        // Radius plus the AA ramp, as in the points shader
+        float size = scatter->sizes ? (float)scatter->sizes[i] : scatter->size;
+        float radius = (0.5f * size > CPL_RASTER_MIN_HALF_WIDTH ? 0.5f * size : CPL_RASTER_MIN_HALF_WIDTH) + 0.5f;
+        if (!(x + radius > (float)draw->clip[0] && x - radius < (float)draw->clip[2] &&
+              y + radius > (float)draw->clip[1] && y - radius < (float)draw->clip[3])) {
+            continue;
+        }
+
+        const unsigned char* rgba = scatter->colors ? scatter->colors + i * 4 : NULL;
+        float alpha = rgba ? (float)rgba[3] / 255.0f : scatter->color.a;
+        if (!(alpha > 0.0f)) continue;
+
+        CPLRasterVertex* centre = &out[stored++];
+        centre->x = x;
+        centre->y = y;
+        centre->r = rgba ? (float)rgba[0] / 255.0f : scatter->color.r;
+        centre->g = rgba ? (float)rgba[1] / 255.0f : scatter->color.g;
+        centre->b = rgba ? (float)rgba[2] / 255.0f : scatter->color.b;
+
+        CPLRasterVertex* shape = &out[stored++];
+        shape->x = radius;
+        shape->y = alpha < 1.0f ? alpha : 1.0f;
+        shape->r = shape->g = shape->b = 0.0f;
+    }
+    draw->count = stored;
+
+    scene->num_vertices += stored;
+    return true;
+}
+
+// Density grid (scatter counts or trace weights) under the region's part of the
+// plot box, colored into an image (grids are binned at canvas resolution and
+// cached, so tiles of an export share them)
+static bool cpl_raster_push_density(CPLRasterScene* scene, CPLDensity* density, CPLDensityNorm norm,
+                                    CPLColormap colormap, const int* box) {
+    if (density->width != box[2] || density->height != box[3]) return true;
+
+    CPLRasterDraw* draw;
+    int cells[4];
+    if (!cpl_raster_push_image(scene, box, &draw, cells)) return false;
+    if (draw) cpl_density_colors(density, norm, colormap, cells, draw->image, (ptrdiff_t)cells[2] * 4);
+    return true;
+}
+
+// Waterfall colors of the region's part of the plot box, looked up per pixel
+// like the waterfall shader does
+static bool cpl_raster_push_waterfall(CPLRasterScene* scene, const CPLPlot* plot, const int* viewport,
+                                      const int* box) {
+    CPLRasterDraw* draw;
+    int cells[4];
+    if (!cpl_raster_push_image(scene, box, &draw, cells)) return false;
+    if (draw) cpl_waterfall_colors(plot, viewport, box, cells, draw->image, (ptrdiff_t)cells[2] * 4);
+    return true;
+}
+
+// Matrix colors of the region's part of the plot box, sampled from the level
+// the matrix shader would draw
+static bool cpl_raster_push_matrix(CPLRasterScene* scene, const CPLPlot* plot, const int* viewport, const int* box) {
+    CPLRasterDraw* draw;
+    int cells[4];
+    if (!cpl_raster_push_image(scene, box, &draw, cells)) return false;
+    if (draw) cpl_matrix_colors(plot, viewport, box, cells, draw->image, (ptrdiff_t)cells[2] * 4);
+    return true;
+}
+
+// Every series as a strip clipped to its tile (values are clamped into it),
+// then every frame, like the two instanced GL draws
+static bool cpl_raster_push_multiples(CPLRasterScene* scene, const CPLPlot* plot, const int* viewport) {
+    const CPLSmallMultiples* multiples = plot->data->multiples;
+    size_t num_tiles = multiples->rows * multiples->cols;
+    size_t capacity = multiples->samples > 4 ? multiples->samples : 4;
+    float* vertices = (float*)malloc(capacity * 5 * sizeof(float));
+    if (!vertices) {
+        cpl_raster_error("Failed to allocate small multiple vertices");
+        return false;
+    }
+
+    bool ok = true;
+    int pad = (int)ceilf(0.5f * plot->line_width) + 1;
+    for (size_t i = 0; i < num_tiles && ok; i++) {
+        const float* rect = multiples->tiles + i * CPL_TILE_FLOATS;
+        int x0 = (int)floorf((float)viewport[0] + (rect[0] + 1.0f) * 0.5f * (float)viewport[2]) - pad;
+        int y0 = (int)floorf((float)viewport[1] + (rect[1] + 1.0f) * 0.5f * (float)viewport[3]) - pad;
+        int x1 = (int)ceilf((float)viewport[0] + (rect[2] + 1.0f) * 0.5f * (float)viewport[2]) + pad;
+        int y1 = (int)ceilf((float)viewport[1] + (rect[3] + 1.0f) * 0.5f * (float)viewport[3]) + pad;
+        int clip[4] = { x0, y0, x1 - x0, y1 - y0 };
+        size_t count = cpl_small_multiple_vertices(multiples, i, false, vertices);
+        ok = cpl_raster_push_draw(scene, vertices, count, CPL_RASTER_STRIP, plot->line_width, viewport, clip, false,
+                                  NULL, NULL, NULL);
+    }
+    for (size_t i = 0; i < num_tiles && ok; i++) {
+        size_t count = cpl_small_multiple_vertices(multiples, i, true, vertices);
+        ok = cpl_raster_push_draw(scene, vertices, count, CPL_RASTER_STRIP, plot->box_line_width, viewport, viewport,
+                                  true, NULL, NULL, NULL);
+    }
+    free(vertices);
+    return ok;
+}
+
+// Histogram bars over the region's part of the plot box, filled per pixel
+// centre as GL rasterizes the instanced bars
+static bool cpl_raster_push_histogram(CPLRasterScene* scene, const CPLPlot* plot, const int* viewport,
+                                      const int* box) {
+    CPLRasterDraw* draw;
+    int cells[4];
+    if (!cpl_raster_push_image(scene, box, &draw, cells)) return false;
+    if (draw) cpl_histogram_colors(plot, viewport, box, cells, draw->image, (ptrdiff_t)cells[2] * 4);
+    return true;
+}
+
+// Candlesticks: bodies and wicks filled per pixel as an image, like histogram bars
+static bool cpl_raster_push_candles(CPLRasterScene* scene, const CPLPlot* plot, const int* viewport,
+                                    const int* box) {
+    CPLRasterDraw* draw;
+    int cells[4];
+    if (!cpl_raster_push_image(scene, box, &draw, cells)) return false;
+    if (draw) cpl_candles_colors(plot, viewport, box, cells, draw->image, (ptrdiff_t)cells[2] * 4);
+    return true;
+}
+
+// Quiver arrows: the segments of the arrows the view keeps that reach the NDC
+// rectangle, built in NDC as the vertex shader builds them
+static bool cpl_raster_push_quiver(CPLRasterScene* scene, const CPLPlot* plot, const int* viewport, const int* box,
+                                   const CPLViewTransform* view, const float* ndc_rect) {
+    const CPLQuiver* quiver = plot->data->quiver;
+    size_t count = cpl_quiver_count(quiver, view, viewport, ndc_rect);
+    if (count == 0) return true;
+
+    float stretch = cpl_quiver_stretch(quiver, count);
+    float* vertices = (float*)malloc(count * 6 * 5 * sizeof(float));
+    if (!vertices) {
+        cpl_raster_error("Failed to allocate quiver vertices");
+        return false;
+    }
+    size_t num_vertices = 0;
+    for (size_t i = 0; i < count; i++) {
+        float ndc[12];
+        if (!cpl_quiver_arrow(quiver, i, view, viewport, stretch, ndc_rect, ndc)) continue;
+
+        for (int k = 0; k < 6; k++) {
+            float* out = vertices + (num_vertices + (size_t)k) * 5;
+            out[0] = ndc[2 * k];
+            out[1] = ndc[2 * k + 1];
+            out[2] = quiver->color.r;
+            out[3] = quiver->color.g;
+            out[4] = quiver->color.b;
+        }
+        num_vertices += 6;
+    }
+
+    bool pushed = cpl_raster_push_draw(scene, vertices, num_vertices, CPL_RASTER_SEGMENTS, plot->line_width, viewport,
+                                       box, false, NULL, NULL, NULL);
+    free(vertices);
+    return pushed;
+}
+
+// Image draw over the region's part of `box`: `draw` gets an uninitialized RGBA
+// image of the `cells` (relative to the box) to fill, NULL when nothing of the
+// box is in the region
+static bool cpl_raster_push_image(CPLRasterScene* scene, const int* box, CPLRasterDraw** image_draw, int* cells) {
+    *image_draw = NULL;
+    if (!cpl_raster_reserve(scene, 2)) return false;
+
+    CPLRasterDraw* draw = cpl_raster_begin_draw(scene, CPL_RASTER_IMAGE, box);
+    draw->radius = 0.0f;
+    draw->count = 0;
+    int width = draw->clip[2] - draw->clip[0];
+    int height = draw->clip[3] - draw->clip[1];
+    if (width <= 0 || height <= 0) return true;
+
+    draw->image = (unsigned char*)malloc((size_t)width * (size_t)height * 4);
+    if (!draw->image) {
+        cpl_raster_error("Failed to allocate image");
+        return false;
+    }
+    cells[0] = draw->clip[0] - box[0];
+    cells[1] = draw->clip[1] - box[1];
+    cells[2] = width;
+    cells[3] = height;
+
+    CPLRasterVertex* corners = scene->vertices + scene->num_vertices;
+    memset(corners, 0, 2 * sizeof(CPLRasterVertex));
+    corners[0].x = (float)draw->clip[0];
+    corners[0].y = (float)draw->clip[1];
+    corners[1].x = (float)draw->clip[2];
+    corners[1].y = (float)draw->clip[3];
+    draw->count = 2;
+    scene->num_vertices += 2;
+    *image_draw = draw;
+    return true;
+}
+
+// Room for `vertices` more vertices and one more draw
+static bool cpl_raster_reserve(CPLRasterScene* scene, size_t vertices) {
+    if (scene->num_vertices + vertices > UINT32_MAX) {
+        cpl_raster_error("Figure has too many vertices for the software renderer");
+        return false;
+    }
+
+    if (scene->num_vertices + vertices > scene->vertex_capacity) {
+        size_t new_capacity = scene->vertex_capacity == 0 ? CPL_RASTER_INITIAL_CAPACITY : scene->vertex_capacity;
+        while (new_capacity < scene->num_vertices + vertices) new_capacity *= 2;
+        CPLRasterVertex* new_vertices = (CPLRasterVertex*)realloc(scene->vertices,
+                                                                  new_capacity * sizeof(CPLRasterVertex));
+        if (!new_vertices) {
+            cpl_raster_error("Failed to allocate raster vertices");
+            return false;
+        }
+        scene->vertices = new_vertices;
+        scene->vertex_capacity = new_capacity;
+    }
+
+    if (scene->num_draws >= scene->draw_capacity) {
+        size_t new_capacity = scene->draw_capacity == 0 ? CPL_RASTER_INITIAL_CAPACITY : scene->draw_capacity * 2;
+        CPLRasterDraw* new_draws = (CPLRasterDraw*)realloc(scene->draws, new_capacity * sizeof(CPLRasterDraw));
+        if (!new_draws) {
+            cpl_raster_error("Failed to allocate raster draws");
+            return false;
+        }
+        scene->draws = new_draws;
+        scene->draw_capacity = new_capacity;
+    }
+
+    return true;
+}
+
+// Next draw, starting at the current end of the vertex array; space was reserved
+static CPLRasterDraw* cpl_raster_begin_draw(CPLRasterScene* scene, CPLRasterMode mode, const int* clip_rect) {
+    CPLRasterDraw* draw = &scene->draws[scene->num_draws++];
+    draw->first = scene->num_vertices;
+    draw->mode = mode;
+    draw->image = NULL;
+
+    // Clip to the viewport (the plot box for data) and the framebuffer
+    draw->clip[0] = clip_rect[0] < 0 ? 0 : clip_rect[0];
+    draw->clip[1] = clip_rect[1] < 0 ? 0 : clip_rect[1];
+    draw->clip[2] = clip_rect[0] + clip_rect[2] > scene->width ? scene->width : clip_rect[0] + clip_rect[2];
+    draw->clip[3] = clip_rect[1] + clip_rect[3] > scene->height ? scene->height : clip_rect[1] + clip_rect[3];
+    return draw;
+}
+
+static size_t cpl_raster_merge_subpixel(CPLRasterVertex* vertices, size_t count, const int* clip, float radius) {
+    if (count < 3) return count;
+    
+    // A vertex is dropped when both its kept predecessor and its successor share
+    // its pixel, or all three lie beyond the same edge of the clip rectangle;
+    // either way the shortcut covers exactly the pixels the two segments did
+    size_t kept = 1;
+    for (size_t i = 1; i + 1 < count; i++) {
+        if (cpl_raster_same_pixel(&vertices[kept - 1], &vertices[i]) &&
+            cpl_raster_same_pixel(&vertices[i], &vertices[i + 1])) {
+            continue;
+        }
+        if (cpl_raster_outcode(&vertices[kept - 1], clip, radius) & cpl_raster_outcode(&vertices[i], clip, radius) &
+            cpl_raster_outcode(&vertices[i + 1], clip, radius)) {
+            continue;
+        }
+        vertices[kept++] = vertices[i];
+    }
+    vertices[kept++] = vertices[count - 1];
+    return kept;
+}
+
+static bool cpl_raster_same_pixel(const CPLRasterVertex* a, const CPLRasterVertex* b) {
+    // Cheap reject before the floors; NaN coordinates never compare equal
+    if (fabsf(a->x - b->x) >= 1.0f || fabsf(a->y - b->y) >= 1.0f) return false;
+    if (!(fabsf(a->x) < 1e6f && fabsf(a->y) < 1e6f)) return false;
+    return floorf(a->x) == floorf(b->x) && floorf(a->y) == floorf(b->y);
+}
+
+// Edges of the clip rectangle (grown by the line radius) a vertex lies beyond
+static int cpl_raster_outcode(const CPLRasterVertex* v, const int* clip, float radius) {
+    return (v->x < (float)clip[0] - radius) | ((v->x > (float)clip[2] + radius) << 1) |
+           ((v->y < (float)clip[1] - radius) << 2) | ((v->y > (float)clip[3] + radius) << 3);
+}
+
+// Binning: every segment is listed in each tile its expanded bounding box touches
+static bool cpl_raster_bin(CPLRasterScene* scene) {
+    size_t num_tiles = (size_t)scene->tiles_x * (size_t)scene->tiles_y;
+    scene->tile_offsets = (size_t*)calloc(num_tiles + 1, sizeof(size_t));
+    if (!scene->tile_offsets) {
+        cpl_raster_error("Failed to allocate raster tiles");
+        return false;
+    }
+
+    // Pass 1: count segments per tile
+    int bounds[4];
+    for (size_t d = 0; d < scene->num_draws; d++) {
+        const CPLRasterDraw* draw = &scene->draws[d];
+        size_t step = draw->mode == CPL_RASTER_STRIP ? 1 : 2;
+        for (size_t i = draw->first; i + 1 < draw->first + draw->count; i += step) {
+            if (!cpl_raster_bounds(scene, draw, i, bounds)) continue;
+            for (int ty = bounds[1] / CPL_RASTER_TILE; ty <= (bounds[3] - 1) / CPL_RASTER_TILE; ty++) {
+                for (int tx = bounds[0] / CPL_RASTER_TILE; tx <= (bounds[2] - 1) / CPL_RASTER_TILE; tx++) {
+                    scene->tile_offsets[(size_t)ty * scene->tiles_x + tx + 1]++;
+                }
+            }
+        }
+    }
+
+    for (size_t t = 0; t < num_tiles; t++) {
+        scene->tile_offsets[t + 1] += scene->tile_offsets[t];
+    }
+
+    size_t total = scene->tile_offsets[num_tiles];
+    scene->tile_segments = (uint32_t*)malloc((total > 0 ? total : 1) * sizeof(uint32_t));
+    size_t* cursor = (size_t*)malloc(num_tiles * sizeof(size_t));
+    if (!scene->tile_segments || !cursor) {
+        cpl_raster_error("Failed to allocate raster tile lists");
+        free(cursor);
+        return false;
+    }
+    memcpy(cursor, scene->tile_offsets, num_tiles * sizeof(size_t));
+
+    // Pass 2: fill the lists; segments stay in draw order within each tile
+    for (size_t d = 0; d < scene->num_draws; d++) {
+        const CPLRasterDraw* draw = &scene->draws[d];
+        size_t step = draw->mode == CPL_RASTER_STRIP ? 1 : 2;
+        for (size_t i = draw->first; i + 1 < draw->first + draw->count; i += step) {
+            if (!cpl_raster_bounds(scene, draw, i, bounds)) continue;
+            for (int ty = bounds[1] / CPL_RASTER_TILE; ty <= (bounds[3] - 1) / CPL_RASTER_TILE; ty++) {
+                for (int tx = bounds[0] / CPL_RASTER_TILE; tx <= (bounds[2] - 1) / CPL_RASTER_TILE; tx++) {
+                    scene->tile_segments[cursor[(size_t)ty * scene->tiles_x + tx]++] = (uint32_t)i;
+                }
+            }
+        }
+    }
+
+    free(cursor);
+    return true;
+}
+
+// Pixel bounds (x0, y0, x1, y1; exclusive ends) of a segment's coverage within its viewport
+static bool cpl_raster_bounds(const CPLRasterScene* scene, const CPLRasterDraw* draw, size_t index, int* bounds) {
+    const CPLRasterVertex* a = &scene->vertices[index];
+    const CPLRasterVertex* b = &scene->vertices[index + 1];
+    float radius = draw->radius;
+    if (draw->mode == CPL_RASTER_POINTS) {
+        radius = b->x;
+        b = a;
+    }
+    if (!cpl_is_finitef(a->x) || !cpl_is_finitef(a->y) || !cpl_is_finitef(b->x) || !cpl_is_finitef(b->y)) return false;
+
+    float min_x = fminf(a->x, b->x) - radius;
+    float max_x = fmaxf(a->x, b->x) + radius;
+    float min_y = fminf(a->y, b->y) - radius;
+    float max_y = fmaxf(a->y, b->y) + radius;
+
+    // Clamp in float first so far off-screen data cannot overflow the int conversion;
+    // the clip rectangle is non-negative, so truncation is floor
+    min_x = fmaxf(min_x, (float)draw->clip[0]);
+    min_y = fmaxf(min_y, (float)draw->clip[1]);
+    max_x = fminf(max_x, (float)draw->clip[2]);
+    max_y = fminf(max_y, (float)draw->clip[3]);
+    if (min_x >= max_x || min_y >= max_y) return false;
+
+    bounds[0] = (int)min_x;
+    bounds[1] = (int)min_y;
+    bounds[2] = (int)max_x + ((float)(int)max_x < max_x);
+    bounds[3] = (int)max_y + ((float)(int)max_y < max_y);
+
+    return bounds[0] < bounds[2] && bounds[1] < bounds[3];
+}
+
+// Tile rendering
+static void* cpl_raster_worker_main(void* arg) {
+    CPLRasterScene* scene = (CPLRasterScene*)arg;
+    size_t num_tiles = (size_t)scene->tiles_x * (size_t)scene->tiles_y;
+
+    // Planar R, G, B, A float accumulators for one tile
+    float* planes = (float*)malloc((4 * CPL_RASTER_PLANE + CPL_RASTER_PADDING) * sizeof(float));
+    if (!planes) {
+        pthread_mutex_lock(&scene->lock);
+        scene->ok = false;
+        pthread_mutex_unlock(&scene->lock);
+        return NULL;
+    }
+
+    for (;;) {
+        pthread_mutex_lock(&scene->lock);
+        size_t tile = scene->next_tile++;
+        pthread_mutex_unlock(&scene->lock);
+        if (tile >= num_tiles) break;
+
+        cpl_raster_tile(scene, tile, planes);
+    }
+
+    free(planes);
+    return NULL;
+}
+
+static void cpl_raster_tile(CPLRasterScene* scene, size_t tile, float* planes) {
+    int tile_x = (int)(tile % (size_t)scene->tiles_x) * CPL_RASTER_TILE;
+    int tile_y = (int)(tile / (size_t)scene->tiles_x) * CPL_RASTER_TILE;
+    int tile_w = scene->width - tile_x < CPL_RASTER_TILE ? scene->width - tile_x : CPL_RASTER_TILE;
+    int tile_h = scene->height - tile_y < CPL_RASTER_TILE ? scene->height - tile_y : CPL_RASTER_TILE;
+
+    const float clear[4] = { scene->background.r, scene->background.g, scene->background.b, scene->background.a };
+    for (int c = 0; c < 4; c++) {
+        float* plane = planes + c * CPL_RASTER_PLANE;
+        for (int i = 0; i < CPL_RASTER_PLANE; i++) plane[i] = clear[c];
+    }
+
+    // Segment indices grow monotonically, so the owning draw only ever advances
+    size_t d = 0;
+    int bounds[4];
+    for (size_t k = scene->tile_offsets[tile]; k < scene->tile_offsets[tile + 1]; k++) {
+        size_t index = scene->tile_segments[k];
+        while (index >= scene->draws[d].first + scene->draws[d].count) d++;
+
+        const CPLRasterDraw* draw = &scene->draws[d];
+        if (!cpl_raster_bounds(scene, draw, index, bounds)) continue;
+        if (bounds[0] < tile_x) bounds[0] = tile_x;
+        if (bounds[1] < tile_y) bounds[1] = tile_y;
+        if (bounds[2] > tile_x + tile_w) bounds[2] = tile_x + tile_w;
+        if (bounds[3] > tile_y + tile_h) bounds[3] = tile_y + tile_h;
+
+        if (draw->mode == CPL_RASTER_IMAGE) {
+            cpl_raster_image(planes, tile_x, tile_y, draw, bounds);
+            continue;
+        }
+
+        const CPLRasterVertex* a = &scene->vertices[index];
+        const CPLRasterVertex* b = &scene->vertices[index + 1];
+        CPLRasterSegment segment;
+        segment.radius = draw->radius;
+        segment.alpha = 1.0f;
+        if (draw->mode == CPL_RASTER_POINTS) {
+            // A disc is a zero-length segment
+            segment.radius = b->x;
+            segment.alpha = b->y;
+            b = a;
+        }
+        segment.ax = a->x;
+        segment.ay = a->y;
+        segment.dx = b->x - a->x;
+        segment.dy = b->y - a->y;
+        float length2 = segment.dx * segment.dx + segment.dy * segment.dy;
+        segment.inv_length2 = length2 > 1e-12f ? 1.0f / length2 : 0.0f;
+        segment.r = a->r;
+        segment.g = a->g;
+        segment.b = a->b;
+        segment.dr = b->r - a->r;
+        segment.dg = b->g - a->g;
+        segment.db = b->b - a->b;
+
+        cpl_raster_segment(planes, tile_x, tile_y, &segment, bounds);
+    }
+
+    // Resolve to 8-bit RGBA in the shared (bottom-up) output buffer
+    for (int y = 0; y < tile_h; y++) {
+        unsigned char* out = scene->pixels + ((size_t)(tile_y + y) * scene->row_pixels + tile_x) * 4;
+        const float* in = planes + y * CPL_RASTER_TILE;
+        for (int x = 0; x < tile_w; x++) {
+            for (int c = 0; c < 4; c++) {
+                float value = in[c * CPL_RASTER_PLANE + x];
+                value = value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value);
+                out[x * 4 + c] = (unsigned char)(value * 255.0f + 0.5f);
+            }
+        }
+    }
+}
+
+static void cpl_raster_segment(float* planes, int tile_x, int tile_y, const CPLRasterSegment* segment,
+                               const int* bounds) {
+    // Rows only need the span where the distance to the infinite line is within
+    // the radius; steep and diagonal segments would otherwise scan their whole box
+    float abs_dy = fabsf(segment->dy);
+    float span_half = 0.0f;
+    float x_per_y = 0.0f;
+    bool narrow = abs_dy > 1e-3f;
+    if (narrow) {
+        float length = sqrtf(segment->dx * segment->dx + segment->dy * segment->dy);
+        span_half = segment->radius * length / abs_dy;
+        x_per_y = segment->dx / segment->dy;
+    }
+
+    for (int y = bounds[1]; y < bounds[3]; y++) {
+        float ry = (float)y + 0.5f - segment->ay;
+        int x_start = bounds[0];
+        int x_end = bounds[2];
+
+        if (narrow) {
+            float center = segment->ax + ry * x_per_y;
+            float left = floorf(center - span_half - 0.5f);
+            float right = ceilf(center + span_half - 0.5f) + 1.0f;
+            if (left > (float)x_start) x_start = (int)left;
+            if (right < (float)x_end) x_end = (int)right;
+            if (x_start >= x_end) continue;
+        }
+
+        cpl_raster_span(planes + (y - tile_y) * CPL_RASTER_TILE, tile_x, x_start, x_end, ry, segment);
+    }
+}
+
+// Blend one row of a segment; x_start/x_end are absolute, row_planes starts at tile_x
+static void cpl_raster_span(float* row_planes, int tile_x, int x_start, int x_end, float ry,
+                            const CPLRasterSegment* segment) {
+    float* plane_r = row_planes;
+    float* plane_g = row_planes + CPL_RASTER_PLANE;
+    float* plane_b = row_planes + 2 * CPL_RASTER_PLANE;
+    float* plane_a = row_planes + 3 * CPL_RASTER_PLANE;
+    int x = x_start;
+
+#ifdef __SSE2__
+    // Four pixels per iteration: distance to the segment, coverage, blend
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 lanes = _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f);
+    const __m128 centers = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+    const __m128 dx = _mm_set1_ps(segment->dx);
+    const __m128 dy = _mm_set1_ps(segment->dy);
+    const __m128 inv_length2 = _mm_set1_ps(segment->inv_length2);
+    const __m128 radius = _mm_set1_ps(segment->radius);
+    const __m128 alpha = _mm_set1_ps(segment->alpha);
+    const __m128 rel_y = _mm_set1_ps(ry);
+    const __m128 rel_y_dy = _mm_set1_ps(ry * segment->dy);
+    const __m128 r = _mm_set1_ps(segment->r), dr = _mm_set1_ps(segment->dr);
+    const __m128 g = _mm_set1_ps(segment->g), dg = _mm_set1_ps(segment->dg);
+    const __m128 b = _mm_set1_ps(segment->b), db = _mm_set1_ps(segment->db);
+
+    // The last group is masked instead of falling back to scalar code; lanes past
+    // x_end blend with zero coverage (the planes carry padding for the overrun)
+    for (; x < x_end; x += 4) {
+        __m128 rel_x = _mm_add_ps(_mm_set1_ps((float)x - segment->ax), centers);
+        __m128 t = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(rel_x, dx), rel_y_dy), inv_length2);
+        t = _mm_min_ps(_mm_max_ps(t, zero), one);
+
+        __m128 ex = _mm_sub_ps(rel_x, _mm_mul_ps(t, dx));
+        __m128 ey = _mm_sub_ps(rel_y, _mm_mul_ps(t, dy));
+        __m128 distance = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(ex, ex), _mm_mul_ps(ey, ey)));
+        __m128 coverage = _mm_min_ps(_mm_max_ps(_mm_sub_ps(radius, distance), zero), one);
+        coverage = _mm_mul_ps(coverage, alpha);
+        coverage = _mm_and_ps(coverage, _mm_cmplt_ps(lanes, _mm_set1_ps((float)(x_end - x))));
+        if (_mm_movemask_ps(_mm_cmpgt_ps(coverage, zero)) == 0) continue;
+
+        __m128 dst = _mm_loadu_ps(plane_r + (x - tile_x));
+        __m128 src = _mm_add_ps(r, _mm_mul_ps(t, dr));
+        _mm_storeu_ps(plane_r + (x - tile_x), _mm_add_ps(dst, _mm_mul_ps(coverage, _mm_sub_ps(src, dst))));
+
+        dst = _mm_loadu_ps(plane_g + (x - tile_x));
+        src = _mm_add_ps(g, _mm_mul_ps(t, dg));
+        _mm_storeu_ps(plane_g + (x - tile_x), _mm_add_ps(dst, _mm_mul_ps(coverage, _mm_sub_ps(src, dst))));
+
+        dst = _mm_loadu_ps(plane_b + (x - tile_x));
+        src = _mm_add_ps(b, _mm_mul_ps(t, db));
+        _mm_storeu_ps(plane_b + (x - tile_x), _mm_add_ps(dst, _mm_mul_ps(coverage, _mm_sub_ps(src, dst))));
+
+        dst = _mm_loadu_ps(plane_a + (x - tile_x));
+        _mm_storeu_ps(plane_a + (x - tile_x), _mm_add_ps(dst, _mm_mul_ps(coverage, _mm_sub_ps(one, dst))));
+    }
+#endif
+
+    // Scalar path
+    for (; x < x_end; x++) {
+        float rel_x = (float)x + 0.5f - segment->ax;
+        float t = (rel_x * segment->dx + ry * segment->dy) * segment->inv_length2;
+        t = t < 0.0f ? 0.0f : (t > 1.0f ? 1.0f : t);
+
+        float ex = rel_x - t * segment->dx;
+        float ey = ry - t * segment->dy;
+        float coverage = segment->radius - sqrtf(ex * ex + ey * ey);
+        if (coverage <= 0.0f) continue;
+        if (coverage > 1.0f) coverage = 1.0f;
+        coverage *= segment->alpha;
+
+        int i = x - tile_x;
+        plane_r[i] += coverage * (segment->r + t * segment->dr - plane_r[i]);
+        plane_g[i] += coverage * (segment->g + t * segment->dg - plane_g[i]);
+        plane_b[i] += coverage * (segment->b + t * segment->db - plane_b[i]);
+        plane_a[i] += coverage * (1.0f - plane_a[i]);
+    }
+}
+
+// Blend the part of a draw's image inside `bounds` (absolute pixels) over the tile
+static void cpl_raster_image(float* planes, int tile_x, int tile_y, const CPLRasterDraw* draw, const int* bounds) {
+    int stride = draw->clip[2] - draw->clip[0];
+    for (int y = bounds[1]; y < bounds[3]; y++) {
+        const unsigned char* in = draw->image + ((size_t)(y - draw->clip[1]) * (size_t)stride +
+                                                 (size_t)(bounds[0] - draw->clip[0])) * 4;
+        float* plane_r = planes + (y - tile_y) * CPL_RASTER_TILE;
+        float* plane_g = plane_r + CPL_RASTER_PLANE;
+        float* plane_b = plane_r + 2 * CPL_RASTER_PLANE;
+        float* plane_a = plane_r + 3 * CPL_RASTER_PLANE;
+        for (int x = bounds[0]; x < bounds[2]; x++, in += 4) {
+            if (in[3] == 0) continue;
+            int i = x - tile_x;
+            float alpha = (float)in[3] / 255.0f;
+            plane_r[i] += alpha * ((float)in[0] / 255.0f - plane_r[i]);
+            plane_g[i] += alpha * ((float)in[1] / 255.0f - plane_g[i]);
+            plane_b[i] += alpha * ((float)in[2] / 255.0f - plane_b[i]);
+            plane_a[i] += alpha * (1.0f - plane_a[i]);
+        }
+    }
+}
+
+static void cpl_raster_free_scene(CPLRasterScene* scene) {
+    for (size_t d = 0; d < scene->num_draws; d++) free(scene->draws[d].image);
+    free(scene->vertices);
+    free(scene->draws);
+    free(scene->tile_offsets);
+    free(scene->tile_segments);
+}
+
+static void cpl_raster_error(const char* message) {
+    fprintf(stderr, "CPlotLib Error: %s\n", message);
+}
@@ -0,0 +1,23 @@
+#ifndef CPL_RASTER_H
+#define CPL_RASTER_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+// Forward declaration
+struct CPLFigure;
+
+// CPU rasterizer for the software backend.
+// Draws the same plot boxes, grids and line strips as the GL path into an
+// 8-bit RGBA buffer with the GL row order (bottom-up, width * 4 bytes per row).
+// Lines are anti-aliased by distance to the segment and honour the plot's line
+// widths; the screen is split into tiles that are filled on `threads` workers.
+bool cpl_raster_figure(struct CPLFigure* fig, unsigned char* pixels, size_t threads);
+
+// Renders only `region` (x, y, width, height, bottom-up) of the figure laid out
+// on a canvas_width x canvas_height canvas. Rows are written `row_pixels` apart,
+// so a region can land directly inside a wider band buffer.
+bool cpl_raster_region(struct CPLFigure* fig, int canvas_width, int canvas_height, const int* region,
+                       unsigned char* pixels, size_t row_pixels, size_t threads);
+
+#endif // CPL_RASTER_H
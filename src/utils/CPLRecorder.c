@@ -0,0 +1,343 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "CPLRecorder.h"
+#include "CPLImage.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+// Constants
+#define CPL_RECORD_PBO_COUNT 3      // Frames in flight on the GPU
+#define CPL_RECORD_QUEUE_SIZE 8     // Frames buffered for the writer thread
+#define CPL_RECORD_PATH_LENGTH 1024
+
+struct CPLRecorder {
+    CPLRecordFormat format;
+    int width, height, fps;
+    size_t frame_bytes;
+    
+    // GPU side: PBO ring with one fence per in-flight readback
+    GLuint pbos[CPL_RECORD_PBO_COUNT];
+    GLsync fences[CPL_RECORD_PBO_COUNT];
+    size_t pbo_head;                // Next PBO to read into
+    size_t pbo_pending;             // Readbacks in flight
+    
+    // CPU side: bounded frame queue consumed by the writer thread
+    unsigned char* frames[CPL_RECORD_QUEUE_SIZE];
+    size_t queue_head, queue_tail, queue_count;
+    bool stopping;
+    pthread_mutex_t mutex;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    pthread_t writer;
+    
+    // Output
+    FILE* output;                   // Raw / Y4M stream (NULL for PNG sequences)
+    bool is_pipe;
+    char path[CPL_RECORD_PATH_LENGTH];
+    size_t frames_written;
+    size_t frames_captured;
+};
+
+// Internal function declarations
+static bool cpl_recorder_open_output(CPLRecorder* recorder, const char* path);
+static void cpl_recorder_close_output(CPLRecorder* recorder);
+static void cpl_recorder_collect(CPLRecorder* recorder, bool wait);
+static void* cpl_recorder_writer_main(void* arg);
+static void cpl_recorder_write_frame(CPLRecorder* recorder, const unsigned char* rgba, unsigned char* scratch);
+static void cpl_recorder_error(const char* message);
+
+// Recorder management
+CPLRecorder* cpl_create_recorder(const char* path, CPLRecordFormat format, int width, int height, int fps) {
+    if (!path || width <= 0 || height <= 0 || fps <= 0) {
+        cpl_recorder_error("Invalid recording parameters");
+        return NULL;
+    }
+    
+    CPLRecorder* recorder = (CPLRecorder*)calloc(1, sizeof(CPLRecorder));
+    if (!recorder) {
+        cpl_recorder_error("Failed to allocate recorder");
+        return NULL;
+    }
+    
+    recorder->format = format;
+    recorder->width = width;
+    recorder->height = height;
+    recorder->fps = fps;
+    recorder->frame_bytes = (size_t)width * (size_t)height * 4;
+    
+    for (size_t i = 0; i < CPL_RECORD_QUEUE_SIZE; i++) {
+        recorder->frames[i] = (unsigned char*)malloc(recorder->frame_bytes);
+        if (!recorder->frames[i]) {
+            cpl_recorder_error("Failed to allocate recording frames");
+            for (size_t j = 0; j < i; j++) free(recorder->frames[j]);
+            free(recorder);
+            return NULL;
+        }
+    }
+    
+    if (!cpl_recorder_open_output(recorder, path)) {
+        for (size_t i = 0; i < CPL_RECORD_QUEUE_SIZE; i++) free(recorder->frames[i]);
+        free(recorder);
+        return NULL;
+    }
+    
+    // Pixel-buffer ring for asynchronous readback
+    glGenBuffers(CPL_RECORD_PBO_COUNT, recorder->pbos);
+    for (size_t i = 0; i < CPL_RECORD_PBO_COUNT; i++) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, recorder->pbos[i]);
+        glBufferData(GL_PIXEL_PACK_BUFFER, recorder->frame_bytes, NULL, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    
+    pthread_mutex_init(&recorder->mutex, NULL);
+    pthread_cond_init(&recorder->not_empty, NULL);
+    pthread_cond_init(&recorder->not_full, NULL);
+    
+    if (pthread_create(&recorder->writer, NULL, cpl_recorder_writer_main, recorder) != 0) {
+        cpl_recorder_error("Failed to start recording writer thread");
+        glDeleteBuffers(CPL_RECORD_PBO_COUNT, recorder->pbos);
+        cpl_recorder_close_output(recorder);
+        pthread_mutex_destroy(&recorder->mutex);
+        pthread_cond_destroy(&recorder->not_empty);
+        pthread_cond_destroy(&recorder->not_full);
+        for (size_t i = 0; i < CPL_RECORD_QUEUE_SIZE; i++) free(recorder->frames[i]);
+        free(recorder);
+        return NULL;
+    }
+    
+    return recorder;
+}
+
+void cpl_destroy_recorder(CPLRecorder* recorder) {
+    if (!recorder) return;
+    
+    // Hand over every frame still in flight, then let the writer drain the queue
+    while (recorder->pbo_pending > 0) {
+        cpl_recorder_collect(recorder, true);
+    }
+    
+    pthread_mutex_lock(&recorder->mutex);
+    recorder->stopping = true;
+    pthread_cond_signal(&recorder->not_empty);
+    pthread_mutex_unlock(&recorder->mutex);
+    pthread_join(recorder->writer, NULL);
+    
+    glDeleteBuffers(CPL_RECORD_PBO_COUNT, recorder->pbos);
+    cpl_recorder_close_output(recorder);
+    
+    pthread_mutex_destroy(&recorder->mutex);
+    pthread_cond_destroy(&recorder->not_empty);
+    pthread_cond_destroy(&recorder->not_full);
+    
+    for (size_t i = 0; i < CPL_RECORD_QUEUE_SIZE; i++) {
+        free(recorder->frames[i]);
+    }
+    free(recorder);
+}
+
+// Capture the currently bound read framebuffer
+void cpl_recorder_capture(CPLRecorder* recorder, int width, int height) {
+    if (!recorder) return;
+    
+    if (width != recorder->width || height != recorder->height) {
+        cpl_recorder_error("Framebuffer size changed while recording; frame skipped");
+        return;
+    }
+    
+    // Free a PBO: collect finished readbacks, blocking only when the ring is full
+    cpl_recorder_collect(recorder, recorder->pbo_pending == CPL_RECORD_PBO_COUNT);
+    if (recorder->pbo_pending == CPL_RECORD_PBO_COUNT) {
+        // The oldest readback outlived the wait; its PBO and fence are still in use
+        cpl_recorder_error("Recording readback timed out; frame skipped");
+        return;
+    }
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, recorder->pbos[recorder->pbo_head]);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, (void*)0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    
+    recorder->fences[recorder->pbo_head] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    recorder->pbo_head = (recorder->pbo_head + 1) % CPL_RECORD_PBO_COUNT;
+    recorder->pbo_pending++;
+    recorder->frames_captured++;
+}
+
+size_t cpl_recorder_frame_count(const CPLRecorder* recorder) {
+    return recorder ? recorder->frames_captured : 0;
+}
+
+// Internal helper functions
+static bool cpl_recorder_open_output(CPLRecorder* recorder, const char* path) {
+    if (strlen(path) >= CPL_RECORD_PATH_LENGTH) {
+        cpl_recorder_error("Recording path too long");
+        return false;
+    }
+    strcpy(recorder->path, path);
+    
+    // PNG sequences format the path per frame (e.g. "frame_%05d.png")
+    if (recorder->format == CPL_RECORD_PNG_SEQUENCE) {
+        return true;
+    }
+    
+    if (strcmp(path, "-") == 0) {
+        recorder->output = stdout;
+    } else if (path[0] == '|') {
+        // "|command" streams into a pipe, e.g. "|ffmpeg -i - out.mp4"
+        recorder->output = popen(path + 1, "w");
+        recorder->is_pipe = true;
+    } else {
+        recorder->output = fopen(path, "wb");
+    }
+    
+    if (!recorder->output) {
+        cpl_recorder_error("Failed to open recording output");
+        return false;
+    }
+    
+    if (recorder->format == CPL_RECORD_Y4M) {
+        fprintf(recorder->output, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C444\n",
+                recorder->width, recorder->height, recorder->fps);
+    }
+    return true;
+}
+
+static void cpl_recorder_close_output(CPLRecorder* recorder) {
+    if (!recorder->output) return;
+    
+    if (recorder->is_pipe) {
+        pclose(recorder->output);
+    } else if (recorder->output == stdout) {
+        fflush(stdout);
+    } else {
+        fclose(recorder->output);
+    }
+    recorder->output = NULL;
+}
+
+static void cpl_recorder_collect(CPLRecorder* recorder, bool wait) {
+    while (recorder->pbo_pending > 0) {
+        size_t slot = (recorder->pbo_head + CPL_RECORD_PBO_COUNT - recorder->pbo_pending) % CPL_RECORD_PBO_COUNT;
+        
+        GLuint64 timeout = wait ? 1000000000ull : 0;
+        GLenum status = glClientWaitSync(recorder->fences[slot], GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
+        if (status == GL_TIMEOUT_EXPIRED) {
+            return;  // Oldest readback still running; try again next frame
+        }
+        glDeleteSync(recorder->fences[slot]);
+        recorder->fences[slot] = NULL;
+        recorder->pbo_pending--;
+        wait = false;
+        
+        // Reserve a queue slot (back-pressure if the writer falls behind)
+        pthread_mutex_lock(&recorder->mutex);
+        while (recorder->queue_count == CPL_RECORD_QUEUE_SIZE) {
+            pthread_cond_wait(&recorder->not_full, &recorder->mutex);
+        }
+        unsigned char* frame = recorder->frames[recorder->queue_head];
+        pthread_mutex_unlock(&recorder->mutex);
+        
+        // The only copy: out of the mapped PBO, flipping GL's bottom-up rows
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, recorder->pbos[slot]);
+        const unsigned char* mapped = (const unsigned char*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0,
+                                                                              recorder->frame_bytes, GL_MAP_READ_BIT);
+        if (mapped) {
+            size_t row_bytes = (size_t)recorder->width * 4;
+            for (int y = 0; y < recorder->height; y++) {
+                memcpy(frame + (size_t)y * row_bytes, mapped + (size_t)(recorder->height - 1 - y) * row_bytes, row_bytes);
+            }
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        
+        if (!mapped) {
+            cpl_recorder_error("Failed to map recording buffer; frame dropped");
+            continue;
+        }
+        
+        pthread_mutex_lock(&recorder->mutex);
+        recorder->queue_head = (recorder->queue_head + 1) % CPL_RECORD_QUEUE_SIZE;
+        recorder->queue_count++;
+        pthread_cond_signal(&recorder->not_empty);
+        pthread_mutex_unlock(&recorder->mutex);
+    }
+}
+
+static void* cpl_recorder_writer_main(void* arg) {
+    CPLRecorder* recorder = (CPLRecorder*)arg;
+    
+    // Y4M conversion scratch (planar 4:4:4)
+    unsigned char* scratch = NULL;
+    if (recorder->format == CPL_RECORD_Y4M) {
+        scratch = (unsigned char*)malloc((size_t)recorder->width * recorder->height * 3);
+    }
+    
+    for (;;) {
+        pthread_mutex_lock(&recorder->mutex);
+        while (recorder->queue_count == 0 && !recorder->stopping) {
+            pthread_cond_wait(&recorder->not_empty, &recorder->mutex);
+        }
+        if (recorder->queue_count == 0) {
+            pthread_mutex_unlock(&recorder->mutex);
+            break;
+        }
+        unsigned char* frame = recorder->frames[recorder->queue_tail];
+        pthread_mutex_unlock(&recorder->mutex);
+        
+        cpl_recorder_write_frame(recorder, frame, scratch);
+        
+        pthread_mutex_lock(&recorder->mutex);
+        recorder->queue_tail = (recorder->queue_tail + 1) % CPL_RECORD_QUEUE_SIZE;
+        recorder->queue_count--;
+        pthread_cond_signal(&recorder->not_full);
+        pthread_mutex_unlock(&recorder->mutex);
+    }
+    
+    free(scratch);
+    return NULL;
+}
+
+static void cpl_recorder_write_frame(CPLRecorder* recorder, const unsigned char* rgba, unsigned char* scratch) {
+    size_t pixels = (size_t)recorder->width * recorder->height;
+    
+    switch (recorder->format) {
+        case CPL_RECORD_RGBA:
+            fwrite(rgba, 1, recorder->frame_bytes, recorder->output);
+            break;
+            
+        case CPL_RECORD_Y4M: {
+            if (!scratch) break;
+            
+            // BT.601 studio-range RGB -> Y'CbCr, fixed point
+            unsigned char* y_plane = scratch;
+            unsigned char* u_plane = scratch + pixels;
+            unsigned char* v_plane = scratch + pixels * 2;
+            for (size_t i = 0; i < pixels; i++) {
+                int r = rgba[i * 4 + 0], g = rgba[i * 4 + 1], b = rgba[i * 4 + 2];
+                y_plane[i] = (unsigned char)(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+                u_plane[i] = (unsigned char)(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+                v_plane[i] = (unsigned char)(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+            }
+            fputs("FRAME\n", recorder->output);
+            fwrite(scratch, 1, pixels * 3, recorder->output);
+            break;
+        }
+            
+        case CPL_RECORD_PNG_SEQUENCE: {
+            char filename[CPL_RECORD_PATH_LENGTH + 32];
+            snprintf(filename, sizeof(filename), recorder->path, (int)recorder->frames_written);
+            cpl_write_png(filename, rgba, (size_t)recorder->width, (size_t)recorder->height,
+                          (ptrdiff_t)recorder->width * 4);
+            break;
+        }
+    }
+    
+    recorder->frames_written++;
+}
+
+static void cpl_recorder_error(const char* message) {
+    fprintf(stderr, "CPlotLib Error: %s\n", message);
+}
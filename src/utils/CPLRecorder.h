@@ -0,0 +1,25 @@
+#ifndef CPL_RECORDER_H
+#define CPL_RECORDER_H
+
+#include <GL/glew.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "CPLPlot.h"
+
+// Frame recorder: asynchronous readback through a ring of pixel-buffer objects.
+// The render thread only issues glReadPixels into a PBO and a fence; frames are
+// mapped once their fence has signaled (a few frames later) and handed to a
+// background writer thread that formats and writes them.
+typedef struct CPLRecorder CPLRecorder;
+
+// Recorder management (a GL context must be current)
+CPLRecorder* cpl_create_recorder(const char* path, CPLRecordFormat format, int width, int height, int fps);
+void cpl_destroy_recorder(CPLRecorder* recorder);
+
+// Capture the currently bound read framebuffer
+void cpl_recorder_capture(CPLRecorder* recorder, int width, int height);
+
+// Statistics
+size_t cpl_recorder_frame_count(const CPLRecorder* recorder);
+
+#endif // CPL_RECORDER_H
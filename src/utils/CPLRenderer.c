@@ -3,88 +3,262 @@
 #include "CPLUtils.h"
 #include "CPLColors.h"
 #include "CPLPlot.h"
+#include "CPLRecorder.h"
+#include "CPLRaster.h"
+#include "CPLImage.h"
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#include <pthread.h>
+
+#ifdef CPL_ENABLE_EGL
+#include <EGL/eglext.h>
+#endif
+
+// Constants
+#define CPL_OFFSCREEN_SAMPLES 4
+#define CPL_CULL_PADDING 8.0f    // Pixels kept around a region when culling lines
+#define CPL_POOL_MAX_IDLE 32     // Parked renderers kept per context kind (one per batch export worker)
+#define CPL_POOL_TARGET_PIXELS (4096 * 1024) // Parked offscreen target area per kind (~150 MB at 4x MSAA)
+
+// Process-wide renderer pool.
+// Renderers of one context kind share objects with a hidden root context that
+// owns the compiled programs (surfaceless EGL renderers, which batch exports
+// drive from several threads at once, link their own), and destroyed renderers
+// are parked (context, window and, within a budget, offscreen target intact)
+// for the next figure. GLFW is reference counted, so destroying one figure
+// never terminates it under another.
+typedef struct {
+    CPLRenderer* root;
+    CPLRenderer* idle[CPL_POOL_MAX_IDLE];
+    size_t num_idle;
+    size_t live;                // Renderers handed out and not yet destroyed
+    size_t target_pixels;       // Offscreen target area held by parked renderers
+} CPLRendererGroup;
+
+static CPLRendererGroup cpl_window_group;   // GLFW windows (visible, or hidden without EGL)
+#ifdef CPL_ENABLE_EGL
+static CPLRendererGroup cpl_egl_group;      // Surfaceless EGL contexts
+#endif
+static size_t cpl_glfw_users;               // Live GLFW windows, root included
+static pthread_mutex_t cpl_pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t cpl_glew_lock = PTHREAD_MUTEX_INITIALIZER; // glewInit writes process-wide entry points
+
+// Host context state touched by a frame, saved around embedded draws
+typedef struct {
+    GLint draw_fbo, read_fbo;
+    GLint viewport[4];
+    GLint scissor_box[4];
+    GLboolean scissor_test;
+    GLint program, vertex_array, array_buffer;
+    GLfloat vertex_attribs[3][4];   // Current values of attributes 1-3 (constant colors, residuals, sizes)
+    GLint active_texture;
+    GLint texture_buffers[2];   // GL_TEXTURE_BUFFER bindings of units 0 and 1
+    GLint textures_2d[2];       // GL_TEXTURE_2D bindings of units 0 and 1 (images, colormap LUTs)
+    GLint unpack_buffer, unpack_alignment, unpack_row_length;  // Texture upload state
+    GLint pack_buffer, pack_alignment, pack_row_length;        // Readback state (persistence traces)
+    GLfloat line_width;
+    GLboolean depth_test, depth_mask;
+    GLint depth_func;
+    GLboolean blend;
+    GLint blend_src_rgb, blend_dst_rgb, blend_src_alpha, blend_dst_alpha;
+    GLint blend_equation_rgb, blend_equation_alpha;
+    GLboolean stencil_test, cull_face;
+    GLboolean color_mask[4];
+    GLfloat clear_color[4];
+    GLfloat clear_depth;
+} CPLGLState;
+
+// Internal function declarations
+static CPLRenderer* cpl_pool_root(CPLRendererGroup* group);
+static CPLRenderer* cpl_pool_take(CPLRendererGroup* group, bool headless);
+static CPLRendererGroup* cpl_renderer_group(const CPLRenderer* renderer);
+static bool cpl_pool_park(CPLRenderer* renderer);
+static void cpl_pool_clear(CPLRendererGroup* group);
+static void cpl_share_programs(CPLRenderer* renderer, const CPLRenderer* root);
+static void cpl_free_renderer(CPLRenderer* renderer);
+static void cpl_set_context_hints(bool visible);
+static bool cpl_init_glew(CPLRenderer* renderer);
+static bool cpl_init_renderer_gl(CPLRenderer* renderer, size_t width, size_t height);
+static bool cpl_create_programs(CPLRenderer* renderer);
+static bool cpl_create_window_context(CPLRenderer* renderer, bool visible, size_t width, size_t height,
+                                      GLFWwindow* share);
+static void cpl_release_glfw(void);
+static void cpl_release_context(CPLRenderer* renderer);
+static bool cpl_ensure_offscreen_target(CPLRenderer* renderer, int width, int height);
+static void cpl_delete_offscreen_target(CPLRenderer* renderer);
+static bool cpl_render_offscreen_target(struct CPLFigure* fig, int canvas_width, int canvas_height, const int* region);
+static void cpl_render_region_at(struct CPLFigure* fig, int canvas_width, int canvas_height, const int* region,
+                                 int origin_x, int origin_y);
+static void cpl_save_gl_state(CPLGLState* state);
+static void cpl_restore_gl_state(const CPLGLState* state);
+#ifdef CPL_ENABLE_EGL
+static bool cpl_create_egl_context(CPLRenderer* renderer, EGLContext share);
+#endif
+
 
 CPLRenderer* cpl_create_renderer(size_t width, size_t height) {
-    CPLRenderer* renderer = (CPLRenderer*)malloc(sizeof(CPLRenderer));
-    if (!renderer) {
-        fprintf(stderr, "Failed to allocate renderer\n");
-        return NULL;
+    pthread_mutex_lock(&cpl_pool_lock);
+    
+    // A parked window only needs resizing and showing again
+    CPLRenderer* renderer = cpl_pool_take(&cpl_window_group, false);
+    if (renderer) {
+        glfwSetWindowSizeLimits(renderer->window, GLFW_DONT_CARE, GLFW_DONT_CARE, GLFW_DONT_CARE, GLFW_DONT_CARE);
+        glfwSetWindowSize(renderer->window, (int)width, (int)height);
+        glfwSetWindowSizeLimits(renderer->window, width, height, width, height);
+        glfwSetWindowShouldClose(renderer->window, GLFW_FALSE);
+        glfwShowWindow(renderer->window);
+        glfwMakeContextCurrent(renderer->window);
+        glViewport(0, 0, width, height);
+        cpl_window_group.live++;
+        pthread_mutex_unlock(&cpl_pool_lock);
+        return renderer;
     }
     
-    // Initialize GLFW
-    if (!glfwInit()) {
-        fprintf(stderr, "Failed to initialize GLFW\n");
-        free(renderer);
+    CPLRenderer* root = cpl_pool_root(&cpl_window_group);
+    if (!root) {
+        pthread_mutex_unlock(&cpl_pool_lock);
         return NULL;
     }
     
-    // Set OpenGL version and profile
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-    glfwWindowHint(GLFW_SAMPLES, 4);
+    renderer = (CPLRenderer*)calloc(1, sizeof(CPLRenderer));
+    if (!renderer) {
+        fprintf(stderr, "Failed to allocate renderer\n");
+        pthread_mutex_unlock(&cpl_pool_lock);
+        return NULL;
+    }
     
-    // Create window
-    renderer->window = glfwCreateWindow(width, height, "CPlotLib", NULL, NULL);
-    if (!renderer->window) {
-        fprintf(stderr, "Failed to create window\n");
-        glfwTerminate();
+    // Create window, sharing objects with the root context
+    if (!cpl_create_window_context(renderer, true, width, height, root->window)) {
         free(renderer);
+        pthread_mutex_unlock(&cpl_pool_lock);
         return NULL;
     }
     
     // Set window properties
     glfwSetWindowSizeLimits(renderer->window, width, height, width, height);
-    glfwMakeContextCurrent(renderer->window);
     
-    // Initialize GLEW
-    glewExperimental = GL_TRUE;
-    if (glewInit() != GLEW_OK) {
-        fprintf(stderr, "Failed to initialize GLEW\n");
-        glfwDestroyWindow(renderer->window);
-        glfwTerminate();
+    bool ok = cpl_init_renderer_gl(renderer, width, height);
+    if (ok) {
+        cpl_share_programs(renderer, root);
+        cpl_window_group.live++;
+    }
+    pthread_mutex_unlock(&cpl_pool_lock);
+    
+    if (!ok) {
+        cpl_release_context(renderer);
         free(renderer);
         return NULL;
     }
     
-    // Get OpenGL info
-    renderer->renderer_name = glGetString(GL_RENDERER);
-    renderer->version = glGetString(GL_VERSION);
+    return renderer;
+}
+
+CPLRenderer* cpl_create_headless_renderer(size_t width, size_t height) {
+#ifdef CPL_ENABLE_EGL
+    // Surfaceless EGL context: works without a display server (e.g. Mesa llvmpipe)
+    CPLRendererGroup* group = &cpl_egl_group;
+#else
+    // Without EGL a hidden GLFW window provides the context
+    CPLRendererGroup* group = &cpl_window_group;
+#endif
     
-    // Create shader program
-    renderer->program_id = cpl_create_shader_program();
-    if (renderer->program_id == 0) {
-        fprintf(stderr, "Failed to create shader program\n");
-        glfwDestroyWindow(renderer->window);
-        glfwTerminate();
-        free(renderer);
+    // Counted as live from here so a concurrent shutdown keeps the programs
+    pthread_mutex_lock(&cpl_pool_lock);
+    CPLRenderer* renderer = cpl_pool_take(group, true);
+    CPLRenderer* root = renderer ? NULL : cpl_pool_root(group);
+    if (renderer || root) group->live++;
+    pthread_mutex_unlock(&cpl_pool_lock);
+    
+    if (renderer) {
+        // Parked renderers keep their context and programs
+        cpl_make_renderer_current(renderer);
+        if (!cpl_ensure_offscreen_target(renderer, (int)width, (int)height)) {
+            cpl_destroy_renderer(renderer);
+            return NULL;
+        }
+        return renderer;
+    }
+    if (!root) return NULL;
+    
+    renderer = (CPLRenderer*)calloc(1, sizeof(CPLRenderer));
+    if (!renderer) {
+        fprintf(stderr, "Failed to allocate renderer\n");
+        pthread_mutex_lock(&cpl_pool_lock);
+        group->live--;
+        pthread_mutex_unlock(&cpl_pool_lock);
         return NULL;
     }
+    renderer->headless = true;
     
-    // Get uniform locations
-    renderer->proj_mat_location = glGetUniformLocation(renderer->program_id, "proj_mat");
+#ifdef CPL_ENABLE_EGL
+    bool created = cpl_create_egl_context(renderer, root->egl_context);
+#else
+    pthread_mutex_lock(&cpl_pool_lock);
+    bool created = cpl_create_window_context(renderer, false, width, height, root->window);
+    pthread_mutex_unlock(&cpl_pool_lock);
+#endif
+    if (!created) {
+        free(renderer);
+        pthread_mutex_lock(&cpl_pool_lock);
+        group->live--;
+        pthread_mutex_unlock(&cpl_pool_lock);
+        return NULL;
+    }
     
-    // Enable OpenGL features
-    glEnable(GL_DEPTH_TEST);
-    glDepthFunc(GL_LESS);
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+#ifdef CPL_ENABLE_EGL
+    // Uniform values live in the program objects, so contexts drawing on
+    // different threads cannot share them: each links its own programs (from
+    // the program binary cache once the root has stored them)
+    renderer->own_programs = true;
+    bool ready = cpl_init_renderer_gl(renderer, width, height) && cpl_create_programs(renderer);
+#else
+    cpl_share_programs(renderer, root);
+    bool ready = cpl_init_renderer_gl(renderer, width, height);
+#endif
+    if (!ready || !cpl_ensure_offscreen_target(renderer, (int)width, (int)height)) {
+        if (renderer->own_programs && renderer->program_id) glDeleteProgram(renderer->program_id);
+        renderer->program_id = 0; // Not worth parking
+        cpl_destroy_renderer(renderer);
+        return NULL;
+    }
     
-    // Performance optimizations
-    glEnable(GL_MULTISAMPLE);  // Enable anti-aliasing
-    glHint(GL_LINE_SMOOTH_HINT, GL_NICEST);
-    glHint(GL_POLYGON_SMOOTH_HINT, GL_NICEST);
+    return renderer;
+}
+
+CPLRenderer* cpl_create_software_renderer(void) {
+    CPLRenderer* renderer = (CPLRenderer*)calloc(1, sizeof(CPLRenderer));
+    if (!renderer) {
+        fprintf(stderr, "Failed to allocate renderer\n");
+        return NULL;
+    }
     
-    // Disable unnecessary features for 2D plotting
-    glDisable(GL_CULL_FACE);
-    glDisable(GL_LIGHTING);
+    // No context to create: figures are rasterized on the CPU when saved
+    renderer->backend = CPL_BACKEND_SOFTWARE;
+    renderer->headless = true;
+    renderer->raster_threads = cpl_image_default_threads();
+    renderer->renderer_name = (const GLubyte*)"CPlotLib software rasterizer";
+    return renderer;
+}
+
+CPLRenderer* cpl_create_external_renderer(void) {
+    CPLRenderer* renderer = (CPLRenderer*)calloc(1, sizeof(CPLRenderer));
+    if (!renderer) {
+        fprintf(stderr, "Failed to allocate renderer\n");
+        return NULL;
+    }
+    renderer->external = true;
     
-    // Set initial viewport
-    glViewport(0, 0, width, height);
+    // The host's context shares nothing with the pool root, so the programs are
+    // compiled here (the program binary cache keeps this cheap). No other host
+    // state is changed: frames set up and restore their own state.
+    if (!cpl_init_glew(renderer) || !cpl_create_programs(renderer)) {
+        cpl_destroy_renderer(renderer);
+        return NULL;
+    }
     
     return renderer;
 }
@@ -92,66 +266,94 @@ CPLRenderer* cpl_create_renderer(size_t width, size_t height) {
 void cpl_destroy_renderer(CPLRenderer* renderer) {
     if (!renderer) return;
     
-    if (renderer->program_id) {
-        glDeleteProgram(renderer->program_id);
+    if (renderer->backend == CPL_BACKEND_SOFTWARE) {
+        free(renderer);
+        return;
     }
     
-    if (renderer->window) {
-        glfwDestroyWindow(renderer->window);
+    // Embedded renderers own their programs and offscreen target, never the
+    // context (the host's must be current)
+    if (renderer->external) {
+        cpl_delete_offscreen_target(renderer);
+        if (renderer->program_id) glDeleteProgram(renderer->program_id);
+        if (renderer->shaders) cpl_destroy_shader_manager(renderer->shaders);
+        free(renderer);
+        return;
     }
     
-    glfwTerminate();
-    free(renderer);
+    // Healthy renderers are parked for the next figure instead
+    pthread_mutex_lock(&cpl_pool_lock);
+    CPLRendererGroup* group = cpl_renderer_group(renderer);
+    if (group->live > 0) group->live--;
+    bool parked = cpl_pool_park(renderer);
+    pthread_mutex_unlock(&cpl_pool_lock);
+    if (parked) return;
+    
+    cpl_free_renderer(renderer);
+}
+
+void cpl_shutdown_renderers(void) {
+    pthread_mutex_lock(&cpl_pool_lock);
+    cpl_pool_clear(&cpl_window_group);
+#ifdef CPL_ENABLE_EGL
+    cpl_pool_clear(&cpl_egl_group);
+#endif
+    pthread_mutex_unlock(&cpl_pool_lock);
+}
+
+void cpl_make_renderer_current(CPLRenderer* renderer) {
+    if (!renderer || renderer->backend == CPL_BACKEND_SOFTWARE) return;
+    
+#ifdef CPL_ENABLE_EGL
+    if (renderer->egl_context != EGL_NO_CONTEXT && renderer->egl_context) {
+        if (eglGetCurrentContext() != renderer->egl_context) {
+            // The bound API is per thread; batch export workers start with OpenGL ES
+            eglBindAPI(EGL_OPENGL_API);
+            eglMakeCurrent(renderer->egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, renderer->egl_context);
+        }
+        return;
+    }
+#endif
+    
+    if (renderer->window && glfwGetCurrentContext() != renderer->window) {
+        glfwMakeContextCurrent(renderer->window);
+    }
+}
+
+bool cpl_renderer_has_gl(const CPLRenderer* renderer) {
+    return renderer && renderer->backend == CPL_BACKEND_OPENGL;
 }
 
 void cpl_run_render_loop(struct CPLFigure* fig) {
     if (!fig || !fig->renderer) return;
     
-    // Pre-calculate projection matrix (it's the same for all plots)
-    float proj[16];
-    cpl_make_ortho_matrix(-1.0f, 1.0f, -1.0f, 1.0f, proj);
+    if (fig->renderer->external) {
+        fprintf(stderr, "Embedded figures are drawn by the host; use cpl_render_figure_to\n");
+        return;
+    }
     
-    // Cache shader program and uniform location
-    GLuint program_id = fig->renderer->program_id;
-    GLint proj_mat_location = fig->renderer->proj_mat_location;
+    if (!fig->renderer->window || fig->renderer->headless) {
+        fprintf(stderr, "Headless figures cannot be shown; use cpl_save_figure\n");
+        return;
+    }
     
+    size_t frame = 0;
     while (!glfwWindowShouldClose(fig->renderer->window)) {
-        // Clear screen
-        cpl_clear_screen(fig->bg_color);
+        // Let animated figures update their data
+        if (fig->frame_callback) {
+            fig->frame_callback(fig, frame, fig->frame_user_data);
+        }
         
         // Get framebuffer size
         int fb_width, fb_height;
         glfwGetFramebufferSize(fig->renderer->window, &fb_width, &fb_height);
         
-        // Set up OpenGL state once per frame
-        glUseProgram(program_id);
-        glUniformMatrix4fv(proj_mat_location, 1, GL_FALSE, proj);
-        
-        // Set resolution uniform for shader-based line thickness
-        GLint resolution_location = glGetUniformLocation(program_id, "resolution");
-        if (resolution_location != -1) {
-            glUniform2f(resolution_location, (float)fb_width, (float)fb_height);
-        }
+        cpl_render_frame(fig, fb_width, fb_height);
         
-        // Render all plots
-        for (size_t i = 0; i < fig->num_plots; i++) {
-            if (fig->plots[i]) {
-                // Set viewport based on subplot layout
-                if (fig->plots[i]->is_subplot && fig->plots[i]->subplot_layout) {
-                    // Calculate viewport for this subplot
-                    int viewport_x = (int)(fig->plots[i]->subplot_layout->left * fb_width);
-                    int viewport_y = (int)(fig->plots[i]->subplot_layout->bottom * fb_height);
-                    int viewport_w = (int)((fig->plots[i]->subplot_layout->right - fig->plots[i]->subplot_layout->left) * fb_width);
-                    int viewport_h = (int)((fig->plots[i]->subplot_layout->top - fig->plots[i]->subplot_layout->bottom) * fb_height);
-                    
-                    glViewport(viewport_x, viewport_y, viewport_w, viewport_h);
-                } else {
-                    // Full screen for regular plots
-                    glViewport(0, 0, fb_width, fb_height);
-                }
-                
-                cpl_render_plot(fig->plots[i]);
-            }
+        // Queue an asynchronous readback of the back buffer
+        if (fig->recorder) {
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+            cpl_recorder_capture(fig->recorder, fb_width, fb_height);
         }
         
         // Check for ESC key
@@ -161,7 +363,228 @@ void cpl_run_render_loop(struct CPLFigure* fig) {
         
         cpl_poll_events();
         cpl_swap_buffers(fig->renderer);
+        frame++;
+    }
+}
+
+// Frame rendering
+void cpl_render_frame(struct CPLFigure* fig, int fb_width, int fb_height) {
+    const int region[4] = { 0, 0, fb_width, fb_height };
+    cpl_render_region(fig, fb_width, fb_height, region);
+}
+
+void cpl_render_region(struct CPLFigure* fig, int canvas_width, int canvas_height, const int* region) {
+    cpl_render_region_at(fig, canvas_width, canvas_height, region, 0, 0);
+}
+
+static void cpl_render_region_at(struct CPLFigure* fig, int canvas_width, int canvas_height, const int* region,
+                                 int origin_x, int origin_y) {
+    if (!fig || !fig->renderer) return;
+    
+    CPLRenderer* renderer = fig->renderer;
+    
+    // Cache shader program and uniform location
+    GLuint program_id = renderer->program_id;
+    GLint proj_mat_location = renderer->proj_mat_location;
+    
+    // Clear the target; the region's corner maps to the framebuffer origin
+    // (offset by origin_x/origin_y for embedded draws, where the scissor keeps
+    // the clear inside the host's rectangle)
+    renderer->scissor[0] = origin_x;
+    renderer->scissor[1] = origin_y;
+    renderer->scissor[2] = region[2];
+    renderer->scissor[3] = region[3];
+    glEnable(GL_SCISSOR_TEST);
+    glScissor(origin_x, origin_y, region[2], region[3]);
+    glViewport(origin_x, origin_y, region[2], region[3]);
+    cpl_clear_screen(fig->bg_color);
+    
+    // Set up OpenGL state once per frame
+    glUseProgram(program_id);
+    
+    // Line thickness is relative to the whole canvas, not the region
+    GLint resolution_location = glGetUniformLocation(program_id, "resolution");
+    if (resolution_location != -1) {
+        glUniform2f(resolution_location, (float)canvas_width, (float)canvas_height);
+    }
+    
+    // Render all plots that overlap the region
+    for (size_t i = 0; i < fig->num_plots; i++) {
+        if (!fig->plots[i]) continue;
+        
+        int viewport[4];
+        cpl_plot_viewport(fig->plots[i], canvas_width, canvas_height, viewport);
+        if (viewport[2] <= 0 || viewport[3] <= 0) continue;
+        memcpy(renderer->viewport, viewport, sizeof(viewport));
+        
+        int x0 = viewport[0] > region[0] ? viewport[0] : region[0];
+        int y0 = viewport[1] > region[1] ? viewport[1] : region[1];
+        int x1 = viewport[0] + viewport[2] < region[0] + region[2] ? viewport[0] + viewport[2] : region[0] + region[2];
+        int y1 = viewport[1] + viewport[3] < region[1] + region[3] ? viewport[1] + viewport[3] : region[1] + region[3];
+        if (x0 >= x1 || y0 >= y1) continue;
+        
+        glViewport(origin_x + x0 - region[0], origin_y + y0 - region[1], x1 - x0, y1 - y0);
+        
+        // Project only the visible part of the plot's [-1, 1] square
+        float left = -1.0f + 2.0f * (float)(x0 - viewport[0]) / (float)viewport[2];
+        float right = -1.0f + 2.0f * (float)(x1 - viewport[0]) / (float)viewport[2];
+        float bottom = -1.0f + 2.0f * (float)(y0 - viewport[1]) / (float)viewport[3];
+        float top = -1.0f + 2.0f * (float)(y1 - viewport[1]) / (float)viewport[3];
+        cpl_make_ortho_matrix(left, right, bottom, top, renderer->projection);
+        glUniformMatrix4fv(proj_mat_location, 1, GL_FALSE, renderer->projection);
+        
+        // Data is scissored to the plot box, so nothing spills into the margins
+        // or neighbouring subplots
+        int box[4];
+        cpl_plot_box_rect(fig->plots[i], viewport, box);
+        int bx0 = box[0] > x0 ? box[0] : x0;
+        int by0 = box[1] > y0 ? box[1] : y0;
+        int bx1 = box[0] + box[2] < x1 ? box[0] + box[2] : x1;
+        int by1 = box[1] + box[3] < y1 ? box[1] + box[3] : y1;
+        renderer->clip[0] = origin_x + bx0 - region[0];
+        renderer->clip[1] = origin_y + by0 - region[1];
+        renderer->clip[2] = bx1 > bx0 ? bx1 - bx0 : 0;
+        renderer->clip[3] = by1 > by0 ? by1 - by0 : 0;
+        
+        // Culling rectangle: the visible part of the plot box, padded so wide
+        // lines just outside still reach in
+        float margin = fig->plots[i]->data ? fig->plots[i]->data->margin : 0.0f;
+        float pad_x = 2.0f * CPL_CULL_PADDING / (float)viewport[2];
+        float pad_y = 2.0f * CPL_CULL_PADDING / (float)viewport[3];
+        renderer->visible[0] = (left > -1.0f + margin ? left : -1.0f + margin) - pad_x;
+        renderer->visible[1] = (bottom > -1.0f + margin ? bottom : -1.0f + margin) - pad_y;
+        renderer->visible[2] = (right < 1.0f - margin ? right : 1.0f - margin) + pad_x;
+        renderer->visible[3] = (top < 1.0f - margin ? top : 1.0f - margin) + pad_y;
+        
+        cpl_render_plot(fig->plots[i]);
+    }
+    
+    glDisable(GL_SCISSOR_TEST);
+}
+
+void cpl_plot_viewport(const struct CPLPlot* plot, int fb_width, int fb_height, int* viewport) {
+    if (plot->is_subplot && plot->subplot_layout) {
+        // Calculate viewport for this subplot
+        viewport[0] = (int)(plot->subplot_layout->left * fb_width);
+        viewport[1] = (int)(plot->subplot_layout->bottom * fb_height);
+        viewport[2] = (int)((plot->subplot_layout->right - plot->subplot_layout->left) * fb_width);
+        viewport[3] = (int)((plot->subplot_layout->top - plot->subplot_layout->bottom) * fb_height);
+    } else {
+        // Full screen for regular plots
+        viewport[0] = 0;
+        viewport[1] = 0;
+        viewport[2] = fb_width;
+        viewport[3] = fb_height;
+    }
+}
+
+void cpl_plot_box_rect(const struct CPLPlot* plot, const int* viewport, int* rect) {
+    // The box spans [-1 + margin, 1 - margin] of the viewport; partly covered
+    // edge pixels are kept
+    float margin = plot->data ? plot->data->margin : 0.0f;
+    int inset_x = (int)floorf(0.5f * margin * (float)viewport[2]);
+    int inset_y = (int)floorf(0.5f * margin * (float)viewport[3]);
+    rect[0] = viewport[0] + inset_x;
+    rect[1] = viewport[1] + inset_y;
+    rect[2] = viewport[2] - 2 * inset_x;
+    rect[3] = viewport[3] - 2 * inset_y;
+}
+
+bool cpl_render_offscreen_frame(struct CPLFigure* fig) {
+    if (!fig) return false;
+    
+    const int region[4] = { 0, 0, (int)fig->width, (int)fig->height };
+    return cpl_render_offscreen_target(fig, (int)fig->width, (int)fig->height, region);
+}
+
+bool cpl_render_offscreen(struct CPLFigure* fig, unsigned char* pixels) {
+    if (!fig) return false;
+    
+    const int region[4] = { 0, 0, (int)fig->width, (int)fig->height };
+    return cpl_render_offscreen_region(fig, (int)fig->width, (int)fig->height, region, pixels, fig->width);
+}
+
+bool cpl_render_offscreen_region(struct CPLFigure* fig, int canvas_width, int canvas_height, const int* region,
+                                 unsigned char* pixels, size_t row_pixels) {
+    if (!fig || !fig->renderer || !region || !pixels) return false;
+    if (region[2] <= 0 || region[3] <= 0 || row_pixels < (size_t)region[2]) return false;
+    
+    if (fig->renderer->backend == CPL_BACKEND_SOFTWARE) {
+        return cpl_raster_region(fig, canvas_width, canvas_height, region, pixels, row_pixels,
+                                 fig->renderer->raster_threads);
     }
+    
+    fig->renderer->exporting = true;
+    bool rendered = cpl_render_offscreen_target(fig, canvas_width, canvas_height, region);
+    fig->renderer->exporting = false;
+    if (!rendered) return false;
+    
+    // Synchronous readback (rows are bottom-up), strided into the caller's rows
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glPixelStorei(GL_PACK_ROW_LENGTH, (GLint)row_pixels);
+    glReadPixels(0, 0, region[2], region[3], GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+    glPixelStorei(GL_PACK_ROW_LENGTH, 0);
+    
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    return true;
+}
+
+bool cpl_max_offscreen_size(struct CPLFigure* fig, int* max_width, int* max_height) {
+    if (!fig || !fig->renderer || !max_width || !max_height) return false;
+    
+    // The rasterizer has no size limit of its own
+    if (fig->renderer->backend == CPL_BACKEND_SOFTWARE) {
+        *max_width = INT_MAX;
+        *max_height = INT_MAX;
+        return true;
+    }
+    
+    cpl_make_renderer_current(fig->renderer);
+    
+    GLint renderbuffer_size = 0;
+    GLint viewport_dims[2] = { 0, 0 };
+    glGetIntegerv(GL_MAX_RENDERBUFFER_SIZE, &renderbuffer_size);
+    glGetIntegerv(GL_MAX_VIEWPORT_DIMS, viewport_dims);
+    if (renderbuffer_size <= 0 || viewport_dims[0] <= 0 || viewport_dims[1] <= 0) return false;
+    
+    *max_width = renderbuffer_size < viewport_dims[0] ? renderbuffer_size : viewport_dims[0];
+    *max_height = renderbuffer_size < viewport_dims[1] ? renderbuffer_size : viewport_dims[1];
+    return true;
+}
+
+bool cpl_render_to_framebuffer(struct CPLFigure* fig, GLuint fbo, int x, int y, int width, int height) {
+    if (!fig || !cpl_renderer_has_gl(fig->renderer) || width <= 0 || height <= 0) return false;
+    
+    cpl_make_renderer_current(fig->renderer);
+    
+    CPLGLState saved;
+    cpl_save_gl_state(&saved);
+    
+    // The frame owns the rectangle (its clear is scissored to it), and the
+    // state it depends on is set explicitly rather than inherited from the host
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_LESS);
+    glDepthMask(GL_TRUE);
+    glEnable(GL_BLEND);
+    glBlendEquation(GL_FUNC_ADD);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glDisable(GL_STENCIL_TEST);
+    glDisable(GL_CULL_FACE);
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    glClearDepth(1.0);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glPixelStorei(GL_PACK_ROW_LENGTH, 0);
+    
+    const int region[4] = { 0, 0, width, height };
+    cpl_render_region_at(fig, width, height, region, x, y);
+    
+    cpl_restore_gl_state(&saved);
+    return true;
 }
 
 void cpl_clear_screen(Color color) {
@@ -178,3 +601,485 @@ void cpl_swap_buffers(CPLRenderer* renderer) {
 void cpl_poll_events(void) {
     glfwPollEvents();
 }
+
+// Renderer pool
+static CPLRenderer* cpl_pool_root(CPLRendererGroup* group) {
+    if (group->root) return group->root;
+    
+    CPLRenderer* root = (CPLRenderer*)calloc(1, sizeof(CPLRenderer));
+    if (!root) {
+        fprintf(stderr, "Failed to allocate renderer\n");
+        return NULL;
+    }
+    root->headless = true;
+    
+    // The root is a tiny hidden context that only owns the shared programs (for
+    // EGL, linking them first fills the program binary cache for the renderers)
+#ifdef CPL_ENABLE_EGL
+    bool created = group == &cpl_egl_group ? cpl_create_egl_context(root, EGL_NO_CONTEXT)
+                                           : cpl_create_window_context(root, false, 1, 1, NULL);
+#else
+    bool created = cpl_create_window_context(root, false, 1, 1, NULL);
+#endif
+    if (!created) {
+        free(root);
+        return NULL;
+    }
+    
+    if (!cpl_init_renderer_gl(root, 1, 1) || !cpl_create_programs(root)) {
+        cpl_free_renderer(root);
+        return NULL;
+    }
+    
+    group->root = root;
+    return root;
+}
+
+static CPLRenderer* cpl_pool_take(CPLRendererGroup* group, bool headless) {
+    // Most recently parked first: its context is the likeliest to be warm
+    for (size_t i = group->num_idle; i-- > 0;) {
+        CPLRenderer* renderer = group->idle[i];
+        if (renderer->headless != headless) continue;
+        
+        group->idle[i] = group->idle[--group->num_idle];
+        group->target_pixels -= (size_t)renderer->offscreen_width * (size_t)renderer->offscreen_height;
+        return renderer;
+    }
+    return NULL;
+}
+
+static CPLRendererGroup* cpl_renderer_group(const CPLRenderer* renderer) {
+#ifdef CPL_ENABLE_EGL
+    return renderer->window ? &cpl_window_group : &cpl_egl_group;
+#else
+    (void)renderer;
+    return &cpl_window_group;
+#endif
+}
+
+static bool cpl_pool_park(CPLRenderer* renderer) {
+    CPLRendererGroup* group = cpl_renderer_group(renderer);
+    if (renderer->program_id == 0 || group->num_idle >= CPL_POOL_MAX_IDLE) return false;
+    
+    // Multisampled targets are large: only a few stay parked with their context
+    size_t pixels = (size_t)renderer->offscreen_width * (size_t)renderer->offscreen_height;
+    if (group->target_pixels + pixels > CPL_POOL_TARGET_PIXELS) {
+        cpl_make_renderer_current(renderer);
+        cpl_delete_offscreen_target(renderer);
+        pixels = 0;
+    }
+    group->target_pixels += pixels;
+    
+    if (renderer->window) {
+        glfwHideWindow(renderer->window);
+    }
+#ifdef CPL_ENABLE_EGL
+    // A context can only be current on one thread: release it so a figure
+    // created on another thread can take it
+    if (renderer->egl_context != EGL_NO_CONTEXT && eglGetCurrentContext() == renderer->egl_context) {
+        eglMakeCurrent(renderer->egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    }
+#endif
+    group->idle[group->num_idle++] = renderer;
+    return true;
+}
+
+static void cpl_pool_clear(CPLRendererGroup* group) {
+    for (size_t i = 0; i < group->num_idle; i++) {
+        cpl_free_renderer(group->idle[i]);
+    }
+    group->num_idle = 0;
+    group->target_pixels = 0;
+    
+    // Live renderers still draw with the shared programs
+    if (group->root && group->live == 0) {
+        CPLRenderer* root = group->root;
+        cpl_make_renderer_current(root);
+        if (root->program_id) glDeleteProgram(root->program_id);
+        if (root->shaders) cpl_destroy_shader_manager(root->shaders);
+        root->program_id = 0;
+        root->shaders = NULL;
+        cpl_free_renderer(root);
+        group->root = NULL;
+    }
+}
+
+static void cpl_share_programs(CPLRenderer* renderer, const CPLRenderer* root) {
+    renderer->program_id = root->program_id;
+    renderer->proj_mat_location = root->proj_mat_location;
+    renderer->shaders = root->shaders;
+}
+
+static void cpl_free_renderer(CPLRenderer* renderer) {
+    // Shared programs belong to the group root; only the per-context objects go here
+    cpl_make_renderer_current(renderer);
+    if (renderer->own_programs) {
+        if (renderer->program_id) glDeleteProgram(renderer->program_id);
+        if (renderer->shaders) cpl_destroy_shader_manager(renderer->shaders);
+    }
+    cpl_delete_offscreen_target(renderer);
+    cpl_release_context(renderer);
+    free(renderer);
+}
+
+// Internal helper functions
+static void cpl_set_context_hints(bool visible) {
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_SAMPLES, 4);
+    glfwWindowHint(GLFW_VISIBLE, visible ? GLFW_TRUE : GLFW_FALSE);
+}
+
+static bool cpl_init_glew(CPLRenderer* renderer) {
+    // Initialize GLEW (a GLX-less headless context reports a missing GLX display,
+    // which only affects the GLX extension entry points)
+    pthread_mutex_lock(&cpl_glew_lock);
+    glewExperimental = GL_TRUE;
+    GLenum glew_status = glewInit();
+    pthread_mutex_unlock(&cpl_glew_lock);
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+    if (glew_status == GLEW_ERROR_NO_GLX_DISPLAY && renderer->headless) {
+        glew_status = GLEW_OK;
+    }
+#endif
+    if (glew_status != GLEW_OK) {
+        fprintf(stderr, "Failed to initialize GLEW\n");
+        return false;
+    }
+    
+    // Get OpenGL info
+    renderer->renderer_name = glGetString(GL_RENDERER);
+    renderer->version = glGetString(GL_VERSION);
+    return true;
+}
+
+static bool cpl_init_renderer_gl(CPLRenderer* renderer, size_t width, size_t height) {
+    if (!cpl_init_glew(renderer)) return false;
+    
+    // Enable OpenGL features (per-context state)
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_LESS);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    
+    // Performance optimizations
+    glEnable(GL_MULTISAMPLE);  // Enable anti-aliasing
+    glHint(GL_LINE_SMOOTH_HINT, GL_NICEST);
+    glHint(GL_POLYGON_SMOOTH_HINT, GL_NICEST);
+    
+    // Disable unnecessary features for 2D plotting
+    glDisable(GL_CULL_FACE);
+    glDisable(GL_LIGHTING);
+    
+    // Set initial viewport
+    glViewport(0, 0, width, height);
+    
+    // Core profiles reject some of the legacy state above; do not leak the error
+    while (glGetError() != GL_NO_ERROR) {}
+    
+    return true;
+}
+
+static bool cpl_create_programs(CPLRenderer* renderer) {
+    // Create shader program
+    renderer->program_id = cpl_create_shader_program();
+    if (renderer->program_id == 0) {
+        fprintf(stderr, "Failed to create shader program\n");
+        return false;
+    }
+    
+    // Get uniform locations
+    renderer->proj_mat_location = glGetUniformLocation(renderer->program_id, "proj_mat");
+    
+    // Create programs for the specialised plot types
+    renderer->shaders = cpl_create_shader_manager();
+    if (!renderer->shaders) {
+        fprintf(stderr, "Failed to create shader manager\n");
+        return false;
+    }
+    
+    return true;
+}
+
+static bool cpl_create_window_context(CPLRenderer* renderer, bool visible, size_t width, size_t height,
+                                      GLFWwindow* share) {
+    // GLFW stays initialized while any window (including the pool root) exists
+    if (cpl_glfw_users == 0 && !glfwInit()) {
+        fprintf(stderr, "Failed to initialize GLFW\n");
+        return false;
+    }
+    cpl_glfw_users++;
+    
+    // Set OpenGL version and profile
+    cpl_set_context_hints(visible);
+    
+    renderer->window = glfwCreateWindow((int)width, (int)height, "CPlotLib", NULL, share);
+    if (!renderer->window) {
+        fprintf(stderr, visible ? "Failed to create window\n" : "Failed to create hidden window\n");
+        cpl_release_glfw();
+        return false;
+    }
+    
+    glfwMakeContextCurrent(renderer->window);
+    return true;
+}
+
+static void cpl_release_glfw(void) {
+    if (cpl_glfw_users > 0 && --cpl_glfw_users == 0) {
+        glfwTerminate();
+    }
+}
+
+static void cpl_release_context(CPLRenderer* renderer) {
+#ifdef CPL_ENABLE_EGL
+    if (renderer->egl_context && renderer->egl_context != EGL_NO_CONTEXT) {
+        // The EGL display is process-wide and stays initialized for other renderers
+        eglMakeCurrent(renderer->egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        eglDestroyContext(renderer->egl_display, renderer->egl_context);
+        renderer->egl_context = EGL_NO_CONTEXT;
+        return;
+    }
+#endif
+    
+    if (renderer->window) {
+        glfwDestroyWindow(renderer->window);
+        renderer->window = NULL;
+        cpl_release_glfw();
+    }
+}
+
+static bool cpl_ensure_offscreen_target(CPLRenderer* renderer, int width, int height) {
+    // Frames render into the lower-left corner, so a larger target is reused
+    // (tiled exports alternate between full and edge tile sizes)
+    if (renderer->msaa_fbo && renderer->offscreen_width >= width && renderer->offscreen_height >= height) {
+        return true;
+    }
+    
+    cpl_delete_offscreen_target(renderer);
+    
+    // Multisampled color + depth target matching the window's 4x MSAA
+    glGenFramebuffers(1, &renderer->msaa_fbo);
+    glGenRenderbuffers(1, &renderer->msaa_color);
+    glGenRenderbuffers(1, &renderer->msaa_depth);
+    
+    glBindRenderbuffer(GL_RENDERBUFFER, renderer->msaa_color);
+    glRenderbufferStorageMultisample(GL_RENDERBUFFER, CPL_OFFSCREEN_SAMPLES, GL_RGBA8, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, renderer->msaa_depth);
+    glRenderbufferStorageMultisample(GL_RENDERBUFFER, CPL_OFFSCREEN_SAMPLES, GL_DEPTH_COMPONENT24, width, height);
+    
+    glBindFramebuffer(GL_FRAMEBUFFER, renderer->msaa_fbo);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderer->msaa_color);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, renderer->msaa_depth);
+    bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    
+    // Single-sample resolve target for glReadPixels
+    glGenFramebuffers(1, &renderer->resolve_fbo);
+    glGenRenderbuffers(1, &renderer->resolve_color);
+    
+    glBindRenderbuffer(GL_RENDERBUFFER, renderer->resolve_color);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    
+    glBindFramebuffer(GL_FRAMEBUFFER, renderer->resolve_fbo);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderer->resolve_color);
+    complete = complete && glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    
+    if (!complete) {
+        fprintf(stderr, "Failed to create offscreen framebuffer\n");
+        cpl_delete_offscreen_target(renderer);
+        return false;
+    }
+    
+    renderer->offscreen_width = width;
+    renderer->offscreen_height = height;
+    return true;
+}
+
+static void cpl_delete_offscreen_target(CPLRenderer* renderer) {
+    if (renderer->msaa_fbo) glDeleteFramebuffers(1, &renderer->msaa_fbo);
+    if (renderer->msaa_color) glDeleteRenderbuffers(1, &renderer->msaa_color);
+    if (renderer->msaa_depth) glDeleteRenderbuffers(1, &renderer->msaa_depth);
+    if (renderer->resolve_fbo) glDeleteFramebuffers(1, &renderer->resolve_fbo);
+    if (renderer->resolve_color) glDeleteRenderbuffers(1, &renderer->resolve_color);
+    
+    renderer->msaa_fbo = renderer->msaa_color = renderer->msaa_depth = 0;
+    renderer->resolve_fbo = renderer->resolve_color = 0;
+    renderer->offscreen_width = renderer->offscreen_height = 0;
+}
+
+static bool cpl_render_offscreen_target(struct CPLFigure* fig, int canvas_width, int canvas_height, const int* region) {
+    if (!cpl_renderer_has_gl(fig->renderer)) return false;
+    
+    CPLRenderer* renderer = fig->renderer;
+    int width = region[2];
+    int height = region[3];
+    
+    cpl_make_renderer_current(renderer);
+    if (!cpl_ensure_offscreen_target(renderer, width, height)) {
+        return false;
+    }
+    
+    glBindFramebuffer(GL_FRAMEBUFFER, renderer->msaa_fbo);
+    cpl_render_region(fig, canvas_width, canvas_height, region);
+    
+    // Resolve multisampling; the resolved image stays bound for reading
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, renderer->msaa_fbo);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, renderer->resolve_fbo);
+    glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, renderer->resolve_fbo);
+    return true;
+}
+
+static void cpl_save_gl_state(CPLGLState* state) {
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &state->draw_fbo);
+    glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &state->read_fbo);
+    glGetIntegerv(GL_VIEWPORT, state->viewport);
+    glGetIntegerv(GL_SCISSOR_BOX, state->scissor_box);
+    state->scissor_test = glIsEnabled(GL_SCISSOR_TEST);
+    glGetIntegerv(GL_CURRENT_PROGRAM, &state->program);
+    glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &state->vertex_array);
+    glGetIntegerv(GL_ARRAY_BUFFER_BINDING, &state->array_buffer);
+    for (GLuint i = 0; i < 3; i++) {
+        glGetVertexAttribfv(i + 1, GL_CURRENT_VERTEX_ATTRIB, state->vertex_attribs[i]);
+    }
+    
+    // Small multiples bind buffer textures, images and colormaps 2D textures, on units 0 and 1
+    glGetIntegerv(GL_ACTIVE_TEXTURE, &state->active_texture);
+    for (int unit = 0; unit < 2; unit++) {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        glGetIntegerv(GL_TEXTURE_BINDING_BUFFER, &state->texture_buffers[unit]);
+        glGetIntegerv(GL_TEXTURE_BINDING_2D, &state->textures_2d[unit]);
+    }
+    glActiveTexture((GLenum)state->active_texture);
+    glGetIntegerv(GL_PIXEL_UNPACK_BUFFER_BINDING, &state->unpack_buffer);
+    glGetIntegerv(GL_UNPACK_ALIGNMENT, &state->unpack_alignment);
+    glGetIntegerv(GL_UNPACK_ROW_LENGTH, &state->unpack_row_length);
+    glGetIntegerv(GL_PIXEL_PACK_BUFFER_BINDING, &state->pack_buffer);
+    glGetIntegerv(GL_PACK_ALIGNMENT, &state->pack_alignment);
+    glGetIntegerv(GL_PACK_ROW_LENGTH, &state->pack_row_length);
+    
+    glGetFloatv(GL_LINE_WIDTH, &state->line_width);
+    state->depth_test = glIsEnabled(GL_DEPTH_TEST);
+    glGetBooleanv(GL_DEPTH_WRITEMASK, &state->depth_mask);
+    glGetIntegerv(GL_DEPTH_FUNC, &state->depth_func);
+    state->blend = glIsEnabled(GL_BLEND);
+    glGetIntegerv(GL_BLEND_SRC_RGB, &state->blend_src_rgb);
+    glGetIntegerv(GL_BLEND_DST_RGB, &state->blend_dst_rgb);
+    glGetIntegerv(GL_BLEND_SRC_ALPHA, &state->blend_src_alpha);
+    glGetIntegerv(GL_BLEND_DST_ALPHA, &state->blend_dst_alpha);
+    glGetIntegerv(GL_BLEND_EQUATION_RGB, &state->blend_equation_rgb);
+    glGetIntegerv(GL_BLEND_EQUATION_ALPHA, &state->blend_equation_alpha);
+    state->stencil_test = glIsEnabled(GL_STENCIL_TEST);
+    state->cull_face = glIsEnabled(GL_CULL_FACE);
+    glGetBooleanv(GL_COLOR_WRITEMASK, state->color_mask);
+    glGetFloatv(GL_COLOR_CLEAR_VALUE, state->clear_color);
+    glGetFloatv(GL_DEPTH_CLEAR_VALUE, &state->clear_depth);
+}
+
+static void cpl_restore_gl_state(const CPLGLState* state) {
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, (GLuint)state->draw_fbo);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, (GLuint)state->read_fbo);
+    glViewport(state->viewport[0], state->viewport[1], state->viewport[2], state->viewport[3]);
+    glScissor(state->scissor_box[0], state->scissor_box[1], state->scissor_box[2], state->scissor_box[3]);
+    if (state->scissor_test) glEnable(GL_SCISSOR_TEST); else glDisable(GL_SCISSOR_TEST);
+    glUseProgram((GLuint)state->program);
+    glBindVertexArray((GLuint)state->vertex_array);
+    glBindBuffer(GL_ARRAY_BUFFER, (GLuint)state->array_buffer);
+    for (GLuint i = 0; i < 3; i++) {
+        glVertexAttrib4fv(i + 1, state->vertex_attribs[i]);
+    }
+    
+    for (int unit = 0; unit < 2; unit++) {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        glBindTexture(GL_TEXTURE_BUFFER, (GLuint)state->texture_buffers[unit]);
+        glBindTexture(GL_TEXTURE_2D, (GLuint)state->textures_2d[unit]);
+    }
+    glActiveTexture((GLenum)state->active_texture);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, (GLuint)state->unpack_buffer);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, state->unpack_alignment);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, state->unpack_row_length);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, (GLuint)state->pack_buffer);
+    glPixelStorei(GL_PACK_ALIGNMENT, state->pack_alignment);
+    glPixelStorei(GL_PACK_ROW_LENGTH, state->pack_row_length);
+    
+    glLineWidth(state->line_width);
+    if (state->depth_test) glEnable(GL_DEPTH_TEST); else glDisable(GL_DEPTH_TEST);
+    glDepthMask(state->depth_mask);
+    glDepthFunc((GLenum)state->depth_func);
+    if (state->blend) glEnable(GL_BLEND); else glDisable(GL_BLEND);
+    glBlendFuncSeparate((GLenum)state->blend_src_rgb, (GLenum)state->blend_dst_rgb,
+                        (GLenum)state->blend_src_alpha, (GLenum)state->blend_dst_alpha);
+    glBlendEquationSeparate((GLenum)state->blend_equation_rgb, (GLenum)state->blend_equation_alpha);
+    if (state->stencil_test) glEnable(GL_STENCIL_TEST); else glDisable(GL_STENCIL_TEST);
+    if (state->cull_face) glEnable(GL_CULL_FACE); else glDisable(GL_CULL_FACE);
+    glColorMask(state->color_mask[0], state->color_mask[1], state->color_mask[2], state->color_mask[3]);
+    glClearColor(state->clear_color[0], state->clear_color[1], state->clear_color[2], state->clear_color[3]);
+    glClearDepth(state->clear_depth);
+}
+
+#ifdef CPL_ENABLE_EGL
+static bool cpl_create_egl_context(CPLRenderer* renderer, EGLContext share) {
+    // Prefer the Mesa surfaceless platform; fall back to the default display
+    EGLDisplay display = EGL_NO_DISPLAY;
+    PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (get_platform_display) {
+        display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+    }
+    if (display == EGL_NO_DISPLAY) {
+        display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    }
+    
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, NULL, NULL)) {
+        fprintf(stderr, "Failed to initialize EGL display\n");
+        return false;
+    }
+    
+    if (!eglBindAPI(EGL_OPENGL_API)) {
+        fprintf(stderr, "EGL does not support desktop OpenGL\n");
+        return false;
+    }
+    
+    const EGLint config_attribs[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8, EGL_ALPHA_SIZE, 8,
+        EGL_NONE
+    };
+    EGLConfig config;
+    EGLint num_configs = 0;
+    if (!eglChooseConfig(display, config_attribs, &config, 1, &num_configs) || num_configs == 0) {
+        fprintf(stderr, "Failed to choose EGL config\n");
+        return false;
+    }
+    
+    const EGLint context_attribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    EGLContext context = eglCreateContext(display, config, share, context_attribs);
+    if (context == EGL_NO_CONTEXT) {
+        fprintf(stderr, "Failed to create EGL context\n");
+        return false;
+    }
+    
+    // Surfaceless: all rendering goes to the offscreen framebuffer
+    if (!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+        fprintf(stderr, "Failed to make EGL context current\n");
+        eglDestroyContext(display, context);
+        return false;
+    }
+    
+    renderer->egl_display = display;
+    renderer->egl_context = context;
+    return true;
+}
+#endif
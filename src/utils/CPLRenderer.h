@@ -4,16 +4,69 @@
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 #include <stddef.h>
+#include <stdbool.h>
 #include "CPLColors.h"
+#include "CPLShader.h"
 
-// Forward declaration
+#ifdef CPL_ENABLE_EGL
+#include <EGL/egl.h>
+#endif
+
+// Forward declarations
 struct CPLFigure;
+struct CPLPlot;
+struct CPLLine;
+struct CPLTraces;
+
+// Rendering backends
+typedef enum {
+    CPL_BACKEND_OPENGL = 0,      // GLFW window or headless EGL/GLFW context
+    CPL_BACKEND_SOFTWARE         // CPU rasterizer, no GL context at all
+} CPLBackend;
 
 // Renderer structure
 typedef struct CPLRenderer {
-    GLFWwindow* window;
+    CPLBackend backend;
+    GLFWwindow* window;          // NULL for EGL headless and software renderers
     GLuint program_id;
     GLuint proj_mat_location;
+    CPLShaderManager* shaders;   // Programs for the specialised plot types
+    
+    // Headless context (no window, no display server)
+    bool headless;
+#ifdef CPL_ENABLE_EGL
+    EGLDisplay egl_display;
+    EGLContext egl_context;
+#endif
+    
+    // Embedded figures draw in the host application's current context: no window,
+    // programs owned by the renderer (not shared with the pool root), never pooled
+    bool external;
+    
+    // Programs linked in this context rather than shared with the pool root
+    // (EGL renderers, which may draw on any thread)
+    bool own_programs;
+    
+    // Offscreen target: multisampled FBO resolved into a single-sample FBO for readback
+    GLuint msaa_fbo, msaa_color, msaa_depth;
+    GLuint resolve_fbo, resolve_color;
+    int offscreen_width, offscreen_height;
+    bool exporting;              // Frame read back by cpl_render_offscreen_region: GPU readbacks are waited for
+    
+    // Per-plot draw state: projection and visible NDC rectangle (padded for line
+    // widths and limited to the plot box). Identity/full for normal frames, a
+    // sub-rectangle for tiled exports.
+    float projection[16];
+    float visible[4];
+    int viewport[4];             // Current plot's viewport on the canvas
+    
+    // Scissor rectangles (x, y, width, height in framebuffer pixels): the whole
+    // frame, and the current plot's box, which data lines are clipped to
+    int scissor[4];
+    int clip[4];
+    
+    // Software backend: worker threads for tile rasterization
+    size_t raster_threads;
     
     // OpenGL info
     const GLubyte* renderer_name;
@@ -22,9 +75,32 @@ typedef struct CPLRenderer {
 
 // Renderer management
 CPLRenderer* cpl_create_renderer(size_t width, size_t height);
-void cpl_destroy_renderer(CPLRenderer* renderer);
+CPLRenderer* cpl_create_headless_renderer(size_t width, size_t height);
+CPLRenderer* cpl_create_software_renderer(void);
+CPLRenderer* cpl_create_external_renderer(void);   // Uses the caller's current GL context
+void cpl_destroy_renderer(CPLRenderer* renderer);  // Parks GL renderers in the pool for reuse
+void cpl_shutdown_renderers(void);                 // Frees parked renderers and shared programs
+void cpl_make_renderer_current(CPLRenderer* renderer);
+bool cpl_renderer_has_gl(const CPLRenderer* renderer);
 void cpl_run_render_loop(struct CPLFigure* fig);
 
+// Frame rendering
+void cpl_render_frame(struct CPLFigure* fig, int fb_width, int fb_height);
+void cpl_render_region(struct CPLFigure* fig, int canvas_width, int canvas_height, const int* region);
+void cpl_plot_viewport(const struct CPLPlot* plot, int fb_width, int fb_height, int* viewport);
+void cpl_plot_box_rect(const struct CPLPlot* plot, const int* viewport, int* rect);
+void cpl_line_visible_range(const struct CPLLine* line, float min_x, float max_x, size_t* first, size_t* count);
+void cpl_traces_visible_range(const struct CPLTraces* traces, float min_x, float max_x, size_t* first,
+                              size_t* count);
+bool cpl_render_offscreen_frame(struct CPLFigure* fig);
+bool cpl_render_offscreen_region(struct CPLFigure* fig, int canvas_width, int canvas_height, const int* region,
+                                 unsigned char* pixels, size_t row_pixels);
+bool cpl_max_offscreen_size(struct CPLFigure* fig, int* max_width, int* max_height);
+bool cpl_render_to_framebuffer(struct CPLFigure* fig, GLuint fbo, int x, int y, int width, int height);
+
+// Export helpers (CPLFigure.c)
+bool cpl_has_extension(const char* filename, const char* extension);   // Case-insensitive suffix test
+
 // OpenGL utilities
 void cpl_clear_screen(Color color);
 void cpl_swap_buffers(CPLRenderer* renderer);
@@ -1,4 +1,5 @@
 #include "CPLShader.h"
+#include "CPLProgramCache.h"
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -63,71 +64,438 @@ const char* CPL_GRID_FRAGMENT_SHADER_SOURCE =
 "    color = vec4(fragColor * pulse, line);\n"
 "}\n";
 
-const char* CPL_POINTS_VERTEX_SHADER_SOURCE = 
+// Small multiples: one instance per tile, series and tile records fetched from buffer textures
+const char* CPL_MULTIPLES_VERTEX_SHADER_SOURCE = 
+"#version 330 core\n"
+"out vec3 fragColor;\n"
+"uniform mat4 proj_mat;\n"
+"uniform samplerBuffer values;\n"
+"uniform samplerBuffer tiles;\n"
+"uniform int samples;\n"
+"uniform int mode;\n"
+"uniform vec3 frameColor;\n"
+"void main() {\n"
+"    // Tile record: rect (x0, y0, x1, y1), range (min, max, count, -), color\n"
+"    vec4 rect = texelFetch(tiles, gl_InstanceID * 3 + 0);\n"
+"    vec4 range = texelFetch(tiles, gl_InstanceID * 3 + 1);\n"
+"    vec2 t;\n"
+"    if (mode == 1) {\n"
+"        // Tile frame drawn as a line loop\n"
+"        t = vec2(gl_VertexID == 1 || gl_VertexID == 2 ? 1.0 : 0.0, gl_VertexID >= 2 ? 1.0 : 0.0);\n"
+"        fragColor = frameColor;\n"
+"    } else {\n"
+"        int count = int(range.z);\n"
+"        int i = min(gl_VertexID, max(count - 1, 0));\n"
+"        float v = texelFetch(values, gl_InstanceID * samples + i).r;\n"
+"        t.x = count > 1 ? float(i) / float(count - 1) : 0.5;\n"
+"        t.y = clamp((v - range.x) / max(range.y - range.x, 1e-30), 0.0, 1.0);\n"
+"        fragColor = texelFetch(tiles, gl_InstanceID * 3 + 2).rgb;\n"
+"    }\n"
+"    gl_Position = proj_mat * vec4(mix(rect.xy, rect.zw, t), 0.0, 1.0);\n"
+"}\n";
+
+const char* CPL_MULTIPLES_FRAGMENT_SHADER_SOURCE = 
+"#version 330 core\n"
+"in vec3 fragColor;\n"
+"out vec4 color;\n"
+"void main() {\n"
+"    color = vec4(fragColor, 1.0);\n"
+"}\n";
+
+// Data -> plot NDC mapping shared by the data and scatter shaders. Positions are
+// offsets from the origin in data units, plus their float residuals for
+// high-precision data (zero otherwise). Each axis is scaled (linear, log10,
+// symlog) and mapped onto the plot box, or the pair is taken as (angle, radius)
+// for polar plots.
+#define CPL_DATA_TRANSFORM_SOURCE \
+"uniform ivec2 scale;\n" \
+"uniform bool polar;\n" \
+"uniform vec2 origin;\n" \
+"uniform vec2 shiftHigh;\n" \
+"uniform vec2 shiftLow;\n" \
+"uniform vec2 axisMin;\n" \
+"uniform vec2 threshold;\n" \
+"uniform vec2 factor;\n" \
+"uniform vec2 boxMin;\n" \
+"uniform vec2 polarRadius;\n" \
+"float axisValue(float offset, float low, int mode, float origin, float shiftHigh, float shiftLow,\n" \
+"                float axisMin, float threshold) {\n" \
+"    // Linear axes add the origin's distance from the axis minimum as a hi/lo pair:\n" \
+"    // near the visible window the high parts cancel exactly, so deep zooms keep\n" \
+"    // the residuals' precision\n" \
+"    if (mode == 0) return (shiftHigh + offset) + (shiftLow + low);\n" \
+"    float v = origin + (offset + low);\n" \
+"    if (mode == 1) return max(log2(max(v, 1e-30)) * 0.30103, -30.0) - axisMin;\n" \
+"    return sign(v) * log2(1.0 + abs(v) / threshold) * 0.30103 - axisMin;\n" \
+"}\n" \
+"vec2 dataPosition(vec2 position, vec2 positionLow) {\n" \
+"    float y = axisValue(position.y, positionLow.y, scale.y, origin.y, shiftHigh.y, shiftLow.y, axisMin.y, threshold.y);\n" \
+"    if (polar) {\n" \
+"        float angle = origin.x + (position.x + positionLow.x);\n" \
+"        return max(y * factor.y, 0.0) * polarRadius * vec2(cos(angle), sin(angle));\n" \
+"    }\n" \
+"    float x = axisValue(position.x, positionLow.x, scale.x, origin.x, shiftHigh.x, shiftLow.x, axisMin.x, threshold.x);\n" \
+"    return boxMin + vec2(x, y) * factor;\n" \
+"}\n"
+
+// Data lines (attribute 2: high-precision residuals)
+const char* CPL_DATA_VERTEX_SHADER_SOURCE = 
 "#version 330 core\n"
 "layout(location = 0) in vec2 position;\n"
 "layout(location = 1) in vec3 color;\n"
+"layout(location = 2) in vec2 positionLow;\n"
 "out vec3 fragColor;\n"
-"out float pointSize;\n"
 "uniform mat4 proj_mat;\n"
-"uniform float time;\n"
+CPL_DATA_TRANSFORM_SOURCE
 "void main() {\n"
-"    gl_Position = proj_mat * vec4(position, 0.0, 1.0);\n"
+"    gl_Position = proj_mat * vec4(dataPosition(position, positionLow), 0.0, 1.0);\n"
+"    fragColor = color;\n"
+"}\n";
+
+// Scatter points: one instance per point, a quad around it from the vertex index
+// (triangle strip). Color and diameter are per-point attributes or constants.
+const char* CPL_POINTS_VERTEX_SHADER_SOURCE = 
+"#version 330 core\n"
+"layout(location = 0) in vec2 position;\n"
+"layout(location = 1) in vec4 color;\n"
+"layout(location = 2) in vec2 positionLow;\n"
+"layout(location = 3) in float size;\n"
+"out vec4 fragColor;\n"
+"out vec2 pointCoord;\n"
+"out float pointRadius;\n"
+"uniform mat4 proj_mat;\n"
+"uniform vec2 pixelSize;\n"
+CPL_DATA_TRANSFORM_SOURCE
+"void main() {\n"
+"    // Disc radius plus the half-pixel AA ramp; the quad leaves another half pixel\n"
+"    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1) * 2.0 - 1.0;\n"
+"    pointRadius = max(0.5 * size, 0.5) + 0.5;\n"
+"    pointCoord = corner * (pointRadius + 0.5);\n"
+"    vec2 p = dataPosition(position, positionLow) + pointCoord * pixelSize;\n"
+"    gl_Position = proj_mat * vec4(p, 0.0, 1.0);\n"
 "    fragColor = color;\n"
-"    \n"
-"    // Dynamic point size with slight animation\n"
-"    pointSize = 8.0 + 2.0 * sin(time + position.x * 10.0);\n"
-"    gl_PointSize = pointSize;\n"
 "}\n";
 
 const char* CPL_POINTS_FRAGMENT_SHADER_SOURCE = 
 "#version 330 core\n"
-"in vec3 fragColor;\n"
-"in float pointSize;\n"
+"in vec4 fragColor;\n"
+"in vec2 pointCoord;\n"
+"in float pointRadius;\n"
 "out vec4 color;\n"
-"uniform float time;\n"
 "void main() {\n"
-"    // Create circular points with smooth edges\n"
-"    vec2 center = gl_PointCoord - 0.5;\n"
-"    float dist = length(center);\n"
-"    \n"
-"    // Smooth circular mask\n"
-"    float alpha = 1.0 - smoothstep(0.4, 0.5, dist);\n"
-"    \n"
-"    // Add subtle glow effect\n"
-"    float glow = 1.0 - smoothstep(0.0, 0.3, dist);\n"
-"    \n"
-"    color = vec4(fragColor + glow * 0.3, alpha);\n"
+"    // Pixel coverage of the disc (the software rasterizer uses the same ramp)\n"
+"    float coverage = clamp(pointRadius - length(pointCoord), 0.0, 1.0);\n"
+"    if (coverage <= 0.0) discard;\n"
+"    color = vec4(fragColor.rgb, fragColor.a * coverage);\n"
 "}\n";
 
+// Histogram bars: one instance per bin with its count as the only attribute.
+// The bar is a triangle strip along its bottom and top edges from the vertex
+// index, split into `segments` steps so polar bars follow their arcs.
 const char* CPL_FILLED_VERTEX_SHADER_SOURCE = 
 "#version 330 core\n"
+"layout(location = 0) in float height;\n"
+"uniform mat4 proj_mat;\n"
+"uniform float binMin;\n"
+"uniform float binWidth;\n"
+"uniform int segments;\n"
+CPL_DATA_TRANSFORM_SOURCE
+"void main() {\n"
+"    float x = binMin + (float(gl_InstanceID) + float(gl_VertexID >> 1) / float(segments)) * binWidth;\n"
+"    float y = (gl_VertexID & 1) == 1 ? height : 0.0;\n"
+"    gl_Position = proj_mat * vec4(dataPosition(vec2(x, y), vec2(0.0)), 0.0, 1.0);\n"
+"}\n";
+
+const char* CPL_FILLED_FRAGMENT_SHADER_SOURCE = 
+"#version 330 core\n"
+"out vec4 color;\n"
+"uniform vec4 fillColor;\n"
+"void main() {\n"
+"    color = fillColor;\n"
+"}\n";
+
+// Quiver arrows: one instance per arrow (tail offset and vector), drawn as three
+// line segments from the vertex index: tail-tip, then a barb back from the tip
+// to each side. The head is a fraction of the arrow's on-screen length, as in
+// cpl_quiver_arrow. Colored by the filled fragment shader.
+const char* CPL_QUIVER_VERTEX_SHADER_SOURCE = 
+"#version 330 core\n"
 "layout(location = 0) in vec2 position;\n"
-"layout(location = 1) in vec3 color;\n"
+"layout(location = 1) in vec2 delta;\n"
+"uniform mat4 proj_mat;\n"
+"uniform vec2 pixelSize;\n"
+"uniform vec2 head;\n"
+"uniform float stretch;\n"
+CPL_DATA_TRANSFORM_SOURCE
+"void main() {\n"
+"    vec2 tail = dataPosition(position, vec2(0.0));\n"
+"    vec2 tip = dataPosition(position + delta * stretch, vec2(0.0));\n"
+"    vec2 d = (tip - tail) / pixelSize;\n"
+"    float len = length(d);\n"
+"    vec2 dir = len > 0.0 ? d / len : vec2(0.0);\n"
+"    float side = gl_VertexID == 3 ? 1.0 : -1.0;\n"
+"    vec2 barb = tip - head.x * len * (dir + side * head.y * vec2(-dir.y, dir.x)) * pixelSize;\n"
+"    vec2 p = gl_VertexID == 0 ? tail : (gl_VertexID == 3 || gl_VertexID == 5) ? barb : tip;\n"
+"    gl_Position = proj_mat * vec4(p, 0.0, 1.0);\n"
+"}\n";
+
+// Candlesticks: one instance per candle (bucket start as a hi/lo pair, open,
+// high, low and close), two quads from the vertex index: the body from open to
+// close across the bucket less the gaps, then the wick from low to high, a
+// pixel wide. Both are at least a pixel tall, as in cpl_candles_rects.
+const char* CPL_CANDLES_VERTEX_SHADER_SOURCE = 
+"#version 330 core\n"
+"layout(location = 0) in vec2 start;\n"
+"layout(location = 1) in vec4 prices;\n"
 "out vec3 fragColor;\n"
-"out vec2 worldPos;\n"
 "uniform mat4 proj_mat;\n"
+"uniform vec2 pixelSize;\n"
+"uniform float bucket;\n"
+"uniform float gap;\n"
+"uniform vec3 upColor;\n"
+"uniform vec3 downColor;\n"
+CPL_DATA_TRANSFORM_SOURCE
 "void main() {\n"
-"    gl_Position = proj_mat * vec4(position, 0.0, 1.0);\n"
-"    fragColor = color;\n"
-"    worldPos = position;\n"
+"    int corner = gl_VertexID % 6;\n"
+"    if (corner > 2) corner -= 2;\n"
+"    vec2 lo, hi;\n"
+"    if (gl_VertexID < 6) {\n"
+"        vec2 a = dataPosition(vec2(start.x, prices.x), vec2(start.y + gap * bucket, 0.0));\n"
+"        vec2 b = dataPosition(vec2(start.x, prices.w), vec2(start.y + (1.0 - gap) * bucket, 0.0));\n"
+"        vec2 grow = max(pixelSize - abs(b - a), 0.0) * 0.5;\n"
+"        lo = min(a, b) - grow;\n"
+"        hi = max(a, b) + grow;\n"
+"    } else {\n"
+"        vec2 a = dataPosition(vec2(start.x, prices.z), vec2(start.y + 0.5 * bucket, 0.0));\n"
+"        vec2 b = dataPosition(vec2(start.x, prices.y), vec2(start.y + 0.5 * bucket, 0.0));\n"
+"        lo = vec2(a.x - 0.5 * pixelSize.x, min(a.y, b.y));\n"
+"        hi = vec2(a.x + 0.5 * pixelSize.x, max(a.y, b.y));\n"
+"    }\n"
+"    vec2 p = mix(lo, hi, vec2(corner & 1, corner >> 1));\n"
+"    gl_Position = proj_mat * vec4(p, 0.0, 1.0);\n"
+"    fragColor = prices.w >= prices.x ? upColor : downColor;\n"
 "}\n";
 
-const char* CPL_FILLED_FRAGMENT_SHADER_SOURCE = 
+// Colormap lookup: CPL_COLORMAP_STOPS evenly spaced RGB stops, linearly
+// interpolated (cpl_colormap_color on the CPU)
+#define CPL_COLORMAP_SOURCE \
+"uniform vec3 colormap[9];\n" \
+"vec3 colormapColor(float t) {\n" \
+"    float x = clamp(t, 0.0, 1.0) * 8.0;\n" \
+"    int i = min(int(x), 7);\n" \
+"    return mix(colormap[i], colormap[i + 1], x - float(i));\n" \
+"}\n"
+
+// Density scatters: one quad over the plot box (triangle strip from the vertex
+// index), one count texel per box pixel
+const char* CPL_DENSITY_VERTEX_SHADER_SOURCE = 
 "#version 330 core\n"
-"in vec3 fragColor;\n"
-"in vec2 worldPos;\n"
+"out vec2 gridCoord;\n"
+"uniform mat4 proj_mat;\n"
+"uniform vec4 rect;\n"
+"void main() {\n"
+"    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);\n"
+"    gridCoord = corner;\n"
+"    gl_Position = proj_mat * vec4(mix(rect.xy, rect.zw, corner), 0.0, 1.0);\n"
+"}\n";
+
+const char* CPL_DENSITY_FRAGMENT_SHADER_SOURCE = 
+"#version 330 core\n"
+"in vec2 gridCoord;\n"
 "out vec4 color;\n"
-"uniform float time;\n"
+"uniform sampler2D counts;\n"
+"uniform int norm;\n"
+"uniform float maxCount;\n"
+"uniform float levels[256];\n"
+"uniform int levelBase;\n"
+CPL_COLORMAP_SOURCE
 "void main() {\n"
-"    // Add subtle gradient effect\n"
-"    float gradient = 0.8 + 0.2 * sin(worldPos.x * 2.0 + worldPos.y * 2.0);\n"
-"    \n"
-"    // Add animated border effect\n"
-"    float border = 1.0 - smoothstep(0.8, 1.0, abs(worldPos.x)) * \n"
-"                   smoothstep(0.8, 1.0, abs(worldPos.y));\n"
-"    \n"
-"    color = vec4(fragColor * gradient * border, 0.8);\n"
+"    ivec2 size = textureSize(counts, 0);\n"
+"    ivec2 cell = min(ivec2(gridCoord * vec2(size)), size - 1);\n"
+"    float count = texelFetch(counts, cell, 0).r;\n"
+"    if (count <= 0.0) discard;\n"
+"    float t;\n"
+"    if (norm == 2) {\n"
+"        t = log(1.0 + count) / log(1.0 + maxCount);\n"
+"    } else if (norm == 3) {\n"
+"        // Interpolated position among the equalization levels (cpl_density_level)\n"
+"        int low = 0;\n"
+"        int high = 255;\n"
+"        while (low < high) {\n"
+"            int mid = (low + high + 1) / 2;\n"
+"            if (levels[mid] <= count) low = mid; else high = mid - 1;\n"
+"        }\n"
+"        float position = float(low);\n"
+"        if (low < 255 && levels[low + 1] > levels[low]) {\n"
+"            position += (count - levels[low]) / (levels[low + 1] - levels[low]);\n"
+"        }\n"
+"        t = levelBase < 255 ? (position - float(levelBase)) / float(255 - levelBase) : 1.0;\n"
+"    } else {\n"
+"        t = count / maxCount;\n"
+"    }\n"
+"    color = vec4(colormapColor(t), 1.0);\n"
+"}\n";
+
+// Persistence traces: one vertex per sample holding its y offset; vertex IDs run
+// through the traces back to back, and the shared x offsets and each trace's
+// frame come from buffer textures. Weights are added into a float target. Mode
+// 1 instead covers the target with a quad scaling it by `fade` (multiplicative
+// blending).
+const char* CPL_TRACES_VERTEX_SHADER_SOURCE = 
+"#version 330 core\n"
+"layout(location = 0) in float value;\n"
+"out float weight;\n"
+"uniform mat4 proj_mat;\n"
+"uniform samplerBuffer xs;\n"
+"uniform usamplerBuffer frames;\n"
+"uniform int samples;\n"
+"uniform uint frame;\n"
+"uniform float decay;\n"
+"uniform int mode;\n"
+"uniform float fade;\n"
+CPL_DATA_TRANSFORM_SOURCE
+"void main() {\n"
+"    if (mode == 1) {\n"
+"        weight = fade;\n"
+"        gl_Position = vec4(vec2(gl_VertexID & 1, gl_VertexID >> 1) * 2.0 - 1.0, 0.0, 1.0);\n"
+"        return;\n"
+"    }\n"
+"    int trace = gl_VertexID / samples;\n"
+"    float x = texelFetch(xs, gl_VertexID - trace * samples).r;\n"
+"    uint age = frame - texelFetch(frames, trace).r;\n"
+"    weight = age == 0u ? 1.0 : pow(decay, float(age));\n"
+"    gl_Position = proj_mat * vec4(dataPosition(vec2(x, value), vec2(0.0)), 0.0, 1.0);\n"
+"}\n";
+
+const char* CPL_TRACES_FRAGMENT_SHADER_SOURCE = 
+"#version 330 core\n"
+"in float weight;\n"
+"out vec4 color;\n"
+"void main() {\n"
+"    color = vec4(weight);\n"
+"}\n";
+
+// Waterfall: one quad over the plot box. Each fragment is mapped back to data
+// coordinates (dataPosition inverted), which pick a bin and a row age; `newest`
+// offsets the age into the ring texture, so scrolling never moves texels.
+// Linear axes stay relative to the axis minimum (imageMin is too).
+const char* CPL_WATERFALL_VERTEX_SHADER_SOURCE = 
+"#version 330 core\n"
+"out vec2 plotPosition;\n"
+"uniform mat4 proj_mat;\n"
+"uniform vec4 rect;\n"
+"void main() {\n"
+"    plotPosition = mix(rect.xy, rect.zw, vec2(gl_VertexID & 1, gl_VertexID >> 1));\n"
+"    gl_Position = proj_mat * vec4(plotPosition, 0.0, 1.0);\n"
+"}\n";
+
+const char* CPL_WATERFALL_FRAGMENT_SHADER_SOURCE = 
+"#version 330 core\n"
+"in vec2 plotPosition;\n"
+"out vec4 color;\n"
+"uniform sampler2D values;\n"
+"uniform ivec2 scale;\n"
+"uniform bool polar;\n"
+"uniform vec2 axisMin;\n"
+"uniform vec2 threshold;\n"
+"uniform vec2 factor;\n"
+"uniform vec2 boxMin;\n"
+"uniform vec2 polarRadius;\n"
+"uniform vec2 imageMin;\n"
+"uniform vec2 imageSize;\n"
+"uniform int newest;\n"
+"uniform int filled;\n"
+"uniform vec2 levels;\n"
+"uniform bool decibels;\n"
+CPL_COLORMAP_SOURCE
+"float imageFraction(float t, int mode, float axisMin, float threshold, float imageMin, float imageSize) {\n"
+"    if (mode == 0) return (t - imageMin) / imageSize;\n"
+"    float s = axisMin + t;\n"
+"    float v = mode == 1 ? exp2(s * 3.321928) : sign(s) * threshold * (exp2(abs(s) * 3.321928) - 1.0);\n"
+"    return (v - imageMin) / imageSize;\n"
+"}\n"
+"void main() {\n"
+"    vec2 u;\n"
+"    if (polar) {\n"
+"        vec2 q = plotPosition / polarRadius;\n"
+"        u.x = mod(atan(q.y, q.x) - imageMin.x, 6.2831853) / imageSize.x;\n"
+"        u.y = imageFraction(length(q) / factor.y, scale.y, axisMin.y, threshold.y, imageMin.y, imageSize.y);\n"
+"    } else {\n"
+"        vec2 t = (plotPosition - boxMin) / factor;\n"
+"        u.x = imageFraction(t.x, scale.x, axisMin.x, threshold.x, imageMin.x, imageSize.x);\n"
+"        u.y = imageFraction(t.y, scale.y, axisMin.y, threshold.y, imageMin.y, imageSize.y);\n"
+"    }\n"
+"    if (!(u.x >= 0.0 && u.x < 1.0 && u.y >= 0.0 && u.y < 1.0)) discard;\n"
+"    ivec2 size = textureSize(values, 0);\n"
+"    int age = size.y - 1 - min(int(u.y * float(size.y)), size.y - 1);\n"
+"    if (age >= filled) discard;\n"
+"    int row = newest - age;\n"
+"    if (row < 0) row += size.y;\n"
+"    float value = texelFetch(values, ivec2(min(int(u.x * float(size.x)), size.x - 1), row), 0).r;\n"
+"    if (decibels) value = 10.0 * log2(value) * 0.30103;\n"
+"    float level = (value - levels.x) / (levels.y - levels.x);\n"
+"    if (isnan(level)) discard;\n"
+"    color = vec4(colormapColor(level), 1.0);\n"
+"}\n";
+
+// Matrix tiles: one quad per tile on cartesian plots, a grid of cells x cells
+// quads following the arcs on polar plots (two triangles each, corners from the
+// vertex index). Each fragment is mapped back to its offset from the matrix
+// origin (dataPosition inverted), so log scales sample the right element;
+// texture row 0 is the tile's top row.
+const char* CPL_MATRIX_VERTEX_SHADER_SOURCE = 
+"#version 330 core\n"
+"out vec2 plotPosition;\n"
+"uniform mat4 proj_mat;\n"
+"uniform vec2 tileMin;\n"
+"uniform vec2 tileSize;\n"
+"uniform int cells;\n"
+CPL_DATA_TRANSFORM_SOURCE
+"const int corners[6] = int[6](0, 1, 2, 2, 1, 3);\n"
+"void main() {\n"
+"    int quad = gl_VertexID / 6;\n"
+"    int corner = corners[gl_VertexID - quad * 6];\n"
+"    vec2 uv = vec2(quad % cells + (corner & 1), quad / cells + (corner >> 1)) / float(cells);\n"
+"    plotPosition = dataPosition(tileMin + uv * tileSize, vec2(0.0));\n"
+"    gl_Position = proj_mat * vec4(plotPosition, 0.0, 1.0);\n"
+"}\n";
+
+const char* CPL_MATRIX_FRAGMENT_SHADER_SOURCE = 
+"#version 330 core\n"
+"in vec2 plotPosition;\n"
+"out vec4 color;\n"
+"uniform sampler2D tile;\n"
+"uniform vec2 tileMin;\n"
+"uniform vec2 tileSize;\n"
+"uniform vec2 textureMax;\n"
+"uniform float valueScale;\n"
+"uniform vec2 levels;\n"
+CPL_DATA_TRANSFORM_SOURCE
+CPL_COLORMAP_SOURCE
+"float axisOffset(float t, int mode, float origin, float shiftHigh, float shiftLow, float axisMin, float threshold) {\n"
+"    if (mode == 0) return (t - shiftHigh) - shiftLow;\n"
+"    float s = axisMin + t;\n"
+"    float v = mode == 1 ? exp2(s * 3.321928) : sign(s) * threshold * (exp2(abs(s) * 3.321928) - 1.0);\n"
+"    return v - origin;\n"
+"}\n"
+"void main() {\n"
+"    vec2 offset;\n"
+"    if (polar) {\n"
+"        vec2 q = plotPosition / polarRadius;\n"
+"        float center = tileMin.x + 0.5 * tileSize.x;\n"
+"        offset.x = mod(atan(q.y, q.x) - origin.x - center + 3.1415927, 6.2831853) - 3.1415927 + center;\n"
+"        offset.y = axisOffset(length(q) / factor.y, scale.y, origin.y, shiftHigh.y, shiftLow.y, axisMin.y, threshold.y);\n"
+"    } else {\n"
+"        vec2 t = (plotPosition - boxMin) / factor;\n"
+"        offset.x = axisOffset(t.x, scale.x, origin.x, shiftHigh.x, shiftLow.x, axisMin.x, threshold.x);\n"
+"        offset.y = axisOffset(t.y, scale.y, origin.y, shiftHigh.y, shiftLow.y, axisMin.y, threshold.y);\n"
+"    }\n"
+"    // Fragments between a polar tile's chords and its arcs clamp to the edge texels\n"
+"    vec2 uv = clamp((offset - tileMin) / tileSize, 0.0, 1.0);\n"
+"    float value = texture(tile, vec2(uv.x, 1.0 - uv.y) * textureMax).r * valueScale;\n"
+"    float level = (value - levels.x) / (levels.y - levels.x);\n"
+"    if (isnan(level)) discard;\n"
+"    color = vec4(colormapColor(level), 1.0);\n"
 "}\n";
 
 static GLuint cpl_compile_shader(GLenum type, const char* source) {
@@ -149,26 +517,40 @@ static GLuint cpl_compile_shader(GLenum type, const char* source) {
     return shader;
 }
 
-GLuint cpl_create_shader_program(void) {
+// Links a program from a cached binary when possible, else from source
+static GLuint cpl_link_program(const char* vertex_source, const char* fragment_source) {
+    GLuint program = cpl_program_cache_load(vertex_source, fragment_source);
+    if (program) {
+        return program;
+    }
+    
     // Compile vertex shader
-    GLuint vertex_shader = cpl_compile_shader(GL_VERTEX_SHADER, CPL_VERTEX_SHADER_SOURCE);
+    GLuint vertex_shader = cpl_compile_shader(GL_VERTEX_SHADER, vertex_source);
     if (vertex_shader == 0) {
         return 0;
     }
     
     // Compile fragment shader
-    GLuint fragment_shader = cpl_compile_shader(GL_FRAGMENT_SHADER, CPL_FRAGMENT_SHADER_SOURCE);
+    GLuint fragment_shader = cpl_compile_shader(GL_FRAGMENT_SHADER, fragment_source);
     if (fragment_shader == 0) {
         glDeleteShader(vertex_shader);
         return 0;
     }
     
-    // Create program
-    GLuint program = glCreateProgram();
+    // Create program; ask for a retrievable binary so the cache can store it
+    bool cacheable = cpl_program_cache_supported();
+    program = glCreateProgram();
+    if (cacheable) {
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
     glAttachShader(program, vertex_shader);
     glAttachShader(program, fragment_shader);
     glLinkProgram(program);
     
+    // Clean up shaders
+    glDeleteShader(vertex_shader);
+    glDeleteShader(fragment_shader);
+    
     // Check linking status
     GLint success;
     glGetProgramiv(program, GL_LINK_STATUS, &success);
@@ -177,24 +559,35 @@ GLuint cpl_create_shader_program(void) {
         glGetProgramInfoLog(program, 512, NULL, info_log);
         fprintf(stderr, "Shader program linking failed: %s\n", info_log);
         glDeleteProgram(program);
-        glDeleteShader(vertex_shader);
-        glDeleteShader(fragment_shader);
         return 0;
     }
     
-    // Clean up shaders
-    glDeleteShader(vertex_shader);
-    glDeleteShader(fragment_shader);
+    if (cacheable) {
+        cpl_program_cache_store(program, vertex_source, fragment_source);
+    }
     
     return program;
 }
 
+GLuint cpl_create_shader_program(void) {
+    return cpl_link_program(CPL_VERTEX_SHADER_SOURCE, CPL_FRAGMENT_SHADER_SOURCE);
+}
+
 void cpl_destroy_shader_program(GLuint program) {
     if (program) {
         glDeleteProgram(program);
     }
 }
 
+// GLSL names of the CPLUniform entries, in enum order
+static const char* const cpl_uniform_names[CPL_UNIFORM_COUNT] = {
+    "scale", "polar", "axisMin", "threshold", "factor", "boxMin", "polarRadius", "origin", "shiftHigh", "shiftLow",
+    "pixelSize", "mode", "fade", "samples", "frame", "decay", "xs", "frames", "rect", "values", "tiles",
+    "frameColor", "imageMin", "imageSize", "newest", "filled", "levels", "decibels", "colormap", "tile", "cells",
+    "valueScale", "tileMin", "tileSize", "textureMax", "binMin", "binWidth", "segments", "fillColor", "head",
+    "stretch", "bucket", "gap", "upColor", "downColor", "counts", "norm", "maxCount", "levelBase"
+};
+
 // Advanced shader manager implementation
 CPLShaderManager* cpl_create_shader_manager(void) {
     CPLShaderManager* manager = (CPLShaderManager*)calloc(1, sizeof(CPLShaderManager));
@@ -205,61 +598,50 @@ CPLShaderManager* cpl_create_shader_manager(void) {
         CPL_VERTEX_SHADER_SOURCE,
         CPL_GRID_VERTEX_SHADER_SOURCE,
         CPL_POINTS_VERTEX_SHADER_SOURCE,
-        CPL_FILLED_VERTEX_SHADER_SOURCE
+        CPL_FILLED_VERTEX_SHADER_SOURCE,
+        CPL_MULTIPLES_VERTEX_SHADER_SOURCE,
+        CPL_DATA_VERTEX_SHADER_SOURCE,
+        CPL_DENSITY_VERTEX_SHADER_SOURCE,
+        CPL_TRACES_VERTEX_SHADER_SOURCE,
+        CPL_WATERFALL_VERTEX_SHADER_SOURCE,
+        CPL_MATRIX_VERTEX_SHADER_SOURCE,
+        CPL_QUIVER_VERTEX_SHADER_SOURCE,
+        CPL_CANDLES_VERTEX_SHADER_SOURCE
     };
     
     const char* fragment_sources[CPL_SHADER_COUNT] = {
         CPL_FRAGMENT_SHADER_SOURCE,
         CPL_GRID_FRAGMENT_SHADER_SOURCE,
         CPL_POINTS_FRAGMENT_SHADER_SOURCE,
-        CPL_FILLED_FRAGMENT_SHADER_SOURCE
+        CPL_FILLED_FRAGMENT_SHADER_SOURCE,
+        CPL_MULTIPLES_FRAGMENT_SHADER_SOURCE,
+        CPL_FRAGMENT_SHADER_SOURCE,
+        CPL_DENSITY_FRAGMENT_SHADER_SOURCE,
+        CPL_TRACES_FRAGMENT_SHADER_SOURCE,
+        CPL_WATERFALL_FRAGMENT_SHADER_SOURCE,
+        CPL_MATRIX_FRAGMENT_SHADER_SOURCE,
+        CPL_FILLED_FRAGMENT_SHADER_SOURCE,
+        CPL_FRAGMENT_SHADER_SOURCE
     };
     
-    // Compile all shader programs
+    // Compile (or load) all shader programs
     for (int i = 0; i < CPL_SHADER_COUNT; i++) {
-        GLuint vertex_shader = cpl_compile_shader(GL_VERTEX_SHADER, vertex_sources[i]);
-        if (vertex_shader == 0) {
-            cpl_destroy_shader_manager(manager);
-            return NULL;
-        }
-        
-        GLuint fragment_shader = cpl_compile_shader(GL_FRAGMENT_SHADER, fragment_sources[i]);
-        if (fragment_shader == 0) {
-            glDeleteShader(vertex_shader);
+        manager->programs[i] = cpl_link_program(vertex_sources[i], fragment_sources[i]);
+        if (manager->programs[i] == 0) {
+            fprintf(stderr, "Failed to create shader program %d\n", i);
             cpl_destroy_shader_manager(manager);
             return NULL;
         }
         
-        // Create and link program
-        manager->programs[i] = glCreateProgram();
-        glAttachShader(manager->programs[i], vertex_shader);
-        glAttachShader(manager->programs[i], fragment_shader);
-        glLinkProgram(manager->programs[i]);
-        
-        // Check linking status
-        GLint success;
-        glGetProgramiv(manager->programs[i], GL_LINK_STATUS, &success);
-        if (!success) {
-            char info_log[512];
-            glGetProgramInfoLog(manager->programs[i], 512, NULL, info_log);
-            fprintf(stderr, "Shader program %d linking failed: %s\n", i, info_log);
-            glDeleteProgram(manager->programs[i]);
-            glDeleteShader(vertex_shader);
-            glDeleteShader(fragment_shader);
-            cpl_destroy_shader_manager(manager);
-            return NULL;
-        }
-        
-        // Clean up individual shaders
-        glDeleteShader(vertex_shader);
-        glDeleteShader(fragment_shader);
-        
         // Cache uniform locations for performance
         manager->proj_mat_locations[i] = glGetUniformLocation(manager->programs[i], "proj_mat");
         manager->color_locations[i] = glGetUniformLocation(manager->programs[i], "color");
         manager->time_locations[i] = glGetUniformLocation(manager->programs[i], "time");
         manager->resolution_locations[i] = glGetUniformLocation(manager->programs[i], "resolution");
         manager->line_width_locations[i] = glGetUniformLocation(manager->programs[i], "lineWidth");
+        for (int u = 0; u < CPL_UNIFORM_COUNT; u++) {
+            manager->uniform_locations[i][u] = glGetUniformLocation(manager->programs[i], cpl_uniform_names[u]);
+        }
     }
     
     manager->initialized = true;
@@ -8,11 +8,77 @@
 typedef enum {
     CPL_SHADER_BASIC = 0,      // Basic line rendering
     CPL_SHADER_GRID,           // Grid rendering with anti-aliasing
-    CPL_SHADER_POINTS,         // Point rendering
-    CPL_SHADER_FILLED,         // Filled polygon rendering
+    CPL_SHADER_POINTS,         // Scatter points: instanced discs through the data transform
+    CPL_SHADER_FILLED,         // Histogram bars: instanced per bin through the data transform
+    CPL_SHADER_MULTIPLES,      // Instanced small-multiples sparklines
+    CPL_SHADER_DATA,           // Data lines: axis scales and polar mapping from data coordinates
+    CPL_SHADER_DENSITY,        // Density scatters: count texture normalized and colormapped per pixel
+    CPL_SHADER_TRACES,         // Persistence traces: faded weights added into a float target
+    CPL_SHADER_WATERFALL,      // Waterfall: ring texture rows looked up per plot box pixel
+    CPL_SHADER_MATRIX,         // Matrix images: one texture tile at a time through the data transform
+    CPL_SHADER_QUIVER,         // Quiver arrows: instanced per arrow through the data transform
+    CPL_SHADER_CANDLES,        // Candlesticks: instanced body and wick per candle through the data transform
     CPL_SHADER_COUNT
 } CPLShaderType;
 
+// Uniforms set on every draw of the plot shaders; their locations are looked
+// up once per program at link time (-1 where a program does not use one)
+typedef enum {
+    // Data transform (cpl_set_view_uniforms)
+    CPL_UNIFORM_SCALE = 0,
+    CPL_UNIFORM_POLAR,
+    CPL_UNIFORM_AXIS_MIN,
+    CPL_UNIFORM_THRESHOLD,
+    CPL_UNIFORM_FACTOR,
+    CPL_UNIFORM_BOX_MIN,
+    CPL_UNIFORM_POLAR_RADIUS,
+    CPL_UNIFORM_ORIGIN,
+    CPL_UNIFORM_SHIFT_HIGH,
+    CPL_UNIFORM_SHIFT_LOW,
+    
+    // Plot type parameters
+    CPL_UNIFORM_PIXEL_SIZE,
+    CPL_UNIFORM_MODE,
+    CPL_UNIFORM_FADE,
+    CPL_UNIFORM_SAMPLES,
+    CPL_UNIFORM_FRAME,
+    CPL_UNIFORM_DECAY,
+    CPL_UNIFORM_XS,
+    CPL_UNIFORM_FRAMES,
+    CPL_UNIFORM_RECT,
+    CPL_UNIFORM_VALUES,
+    CPL_UNIFORM_TILES,
+    CPL_UNIFORM_FRAME_COLOR,
+    CPL_UNIFORM_IMAGE_MIN,
+    CPL_UNIFORM_IMAGE_SIZE,
+    CPL_UNIFORM_NEWEST,
+    CPL_UNIFORM_FILLED,
+    CPL_UNIFORM_LEVELS,
+    CPL_UNIFORM_DECIBELS,
+    CPL_UNIFORM_COLORMAP,
+    CPL_UNIFORM_TILE,
+    CPL_UNIFORM_CELLS,
+    CPL_UNIFORM_VALUE_SCALE,
+    CPL_UNIFORM_TILE_MIN,
+    CPL_UNIFORM_TILE_SIZE,
+    CPL_UNIFORM_TEXTURE_MAX,
+    CPL_UNIFORM_BIN_MIN,
+    CPL_UNIFORM_BIN_WIDTH,
+    CPL_UNIFORM_SEGMENTS,
+    CPL_UNIFORM_FILL_COLOR,
+    CPL_UNIFORM_HEAD,
+    CPL_UNIFORM_STRETCH,
+    CPL_UNIFORM_BUCKET,
+    CPL_UNIFORM_GAP,
+    CPL_UNIFORM_UP_COLOR,
+    CPL_UNIFORM_DOWN_COLOR,
+    CPL_UNIFORM_COUNTS,
+    CPL_UNIFORM_NORM,
+    CPL_UNIFORM_MAX_COUNT,
+    CPL_UNIFORM_LEVEL_BASE,
+    CPL_UNIFORM_COUNT
+} CPLUniform;
+
 // Shader program structure
 typedef struct {
     GLuint programs[CPL_SHADER_COUNT];
@@ -21,6 +87,7 @@ typedef struct {
     GLint time_locations[CPL_SHADER_COUNT];
     GLint resolution_locations[CPL_SHADER_COUNT];
     GLint line_width_locations[CPL_SHADER_COUNT];
+    GLint uniform_locations[CPL_SHADER_COUNT][CPL_UNIFORM_COUNT];
     bool initialized;
 } CPLShaderManager;
 
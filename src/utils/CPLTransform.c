@@ -0,0 +1,185 @@
+#include "CPLTransform.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+// Internal function declarations
+static double cpl_view_axis(const CPLViewTransform* view, int axis, double origin, double offset);
+static float cpl_round_down(double value);
+static double cpl_axis_inverse(CPLAxisScale scale, double value, double threshold);
+
+// Constants
+#define CPL_LOG_FLOOR -30.0          // log10 of the smallest value drawn on log axes
+#define CPL_LOG_MIN_RANGE 1e-6       // Non-positive log limits become this fraction of the maximum
+
+void cpl_view_transform(const CPLPlot* plot, const int* viewport, CPLViewTransform* view) {
+    const double* ranges[2] = { plot->x_range, plot->y_range };
+    float margin = plot->data ? plot->data->margin : 0.0f;
+
+    view->scale[0] = plot->x_scale;
+    view->scale[1] = plot->y_scale;
+    view->polar = plot->polar;
+
+    for (int axis = 0; axis < 2; axis++) {
+        double low = ranges[axis][0];
+        double high = ranges[axis][1];
+        view->threshold[axis] = plot->symlog_threshold[axis];
+
+        // Log axes need positive limits
+        if (view->scale[axis] == CPL_SCALE_LOG10) {
+            if (!(high > 0.0)) high = 1.0;
+            if (!(low > 0.0)) low = high * CPL_LOG_MIN_RANGE;
+        }
+
+        double t_low = cpl_axis_transform(view->scale[axis], low, view->threshold[axis]);
+        double t_high = cpl_axis_transform(view->scale[axis], high, view->threshold[axis]);
+        if (!(t_high > t_low)) {
+            // Degenerate range: a unit span centred on the value
+            t_low -= 0.5;
+            t_high = t_low + 1.0;
+        }
+
+        // The polar radius axis maps onto [0, 1] of the circle instead of the box
+        double size = view->polar && axis == 1 ? 1.0 : 2.0 - 2.0 * margin;
+        view->min[axis] = t_low;
+        view->factor[axis] = size / (t_high - t_low);
+        view->box_min[axis] = -1.0f + margin;
+    }
+
+    // Polar plots use the largest circle that fits the box in pixels, so they
+    // stay round in non-square viewports
+    view->radius[0] = view->radius[1] = 1.0f - margin;
+    if (view->polar) {
+        if (viewport && viewport[2] > 0 && viewport[3] > 0) {
+            if (viewport[2] > viewport[3]) {
+                view->radius[0] *= (float)viewport[3] / (float)viewport[2];
+            } else {
+                view->radius[1] *= (float)viewport[2] / (float)viewport[3];
+            }
+        }
+    }
+}
+
+double cpl_axis_transform(CPLAxisScale scale, double value, double threshold) {
+    switch (scale) {
+        case CPL_SCALE_LOG10:
+            return value > 0.0 ? fmax(log10(value), CPL_LOG_FLOOR) : CPL_LOG_FLOOR;
+        case CPL_SCALE_SYMLOG:
+            return copysign(log10(1.0 + fabs(value) / threshold), value);
+        default:
+            return value;
+    }
+}
+
+void cpl_view_map(const CPLViewTransform* view, const double* origin, const float* vertex, const float* low,
+                  float* ndc) {
+    double offset[2] = { vertex[0], vertex[1] };
+    if (low) {
+        offset[0] += low[0];
+        offset[1] += low[1];
+    }
+    double y = cpl_view_axis(view, 1, origin[1], offset[1]);
+
+    if (view->polar) {
+        double angle = origin[0] + offset[0];
+        double r = y * view->factor[1];
+        if (r < 0.0) r = 0.0;
+        ndc[0] = (float)(r * view->radius[0] * cos(angle));
+        ndc[1] = (float)(r * view->radius[1] * sin(angle));
+        return;
+    }
+
+    double x = cpl_view_axis(view, 0, origin[0], offset[0]);
+    ndc[0] = view->box_min[0] + (float)(x * view->factor[0]);
+    ndc[1] = view->box_min[1] + (float)(y * view->factor[1]);
+}
+
+void cpl_view_unmap(const CPLViewTransform* view, const double* ndc, double* data) {
+    if (view->polar) {
+        double x = ndc[0] / view->radius[0];
+        double y = ndc[1] / view->radius[1];
+        data[0] = atan2(y, x);
+        data[1] = cpl_axis_inverse(view->scale[1], view->min[1] + sqrt(x * x + y * y) / view->factor[1],
+                                   view->threshold[1]);
+        return;
+    }
+
+    for (int axis = 0; axis < 2; axis++) {
+        double value = view->min[axis] + (ndc[axis] - view->box_min[axis]) / view->factor[axis];
+        data[axis] = cpl_axis_inverse(view->scale[axis], value, view->threshold[axis]);
+    }
+}
+
+bool cpl_view_window(const CPLViewTransform* view, const double* origin, const float* bounds, const float* ndc_rect,
+                     float* window) {
+    if (view->polar) {
+        window[0] = window[1] = -INFINITY;
+        window[2] = window[3] = INFINITY;
+        return true;
+    }
+
+    // Every scale is monotonic, so the rectangle maps corner to corner
+    for (int axis = 0; axis < 2; axis++) {
+        double low = view->min[axis] + (ndc_rect[axis] - view->box_min[axis]) / view->factor[axis];
+        double high = view->min[axis] + (ndc_rect[axis + 2] - view->box_min[axis]) / view->factor[axis];
+        low = cpl_axis_inverse(view->scale[axis], low, view->threshold[axis]);
+        high = cpl_axis_inverse(view->scale[axis], high, view->threshold[axis]);
+        window[axis] = cpl_round_down(low - origin[axis]);
+        window[axis + 2] = -cpl_round_down(origin[axis] - high);
+    }
+
+    // Data that is all NaN has inverted bounds and never passes
+    // Stored offsets are rounded to nearest, so an outward-rounded window keeps
+    // every sample whose exact value is inside
+    return !(bounds[0] > window[2] || bounds[2] < window[0] || bounds[1] > window[3] || bounds[3] < window[1]);
+}
+
+void cpl_split_double(double value, float* high, float* low) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    // Infinities and NaN have no residual
+    if ((bits >> 52 & 0x7ff) == 0x7ff) {
+        *high = (float)value;
+        *low = 0.0f;
+        return;
+    }
+
+    // The high part keeps the top 24 significand bits (truncated towards zero).
+    // It is cut with integer operations because compilers may fold
+    // value - (double)(float)value to zero (-ffast-math, vectorized code).
+    bits &= ~(uint64_t)0x1fffffff;
+    double truncated;
+    memcpy(&truncated, &bits, sizeof(truncated));
+    *high = (float)truncated;
+    *low = (float)(value - truncated);
+}
+
+// Internal helper functions
+// Transformed value minus the axis minimum. Linear axes subtract in the
+// origin's frame first, so deep zooms keep the offsets' full precision.
+static double cpl_view_axis(const CPLViewTransform* view, int axis, double origin, double offset) {
+    if (view->scale[axis] == CPL_SCALE_LINEAR) {
+        return (origin - view->min[axis]) + offset;
+    }
+    return cpl_axis_transform(view->scale[axis], origin + offset, view->threshold[axis]) - view->min[axis];
+}
+
+static float cpl_round_down(double value) {
+    float high, low;
+    cpl_split_double(value, &high, &low);
+    return low < 0.0f ? nextafterf(high, -INFINITY) : high;
+}
+
+static double cpl_axis_inverse(CPLAxisScale scale, double value, double threshold) {
+    switch (scale) {
+        case CPL_SCALE_LOG10:
+            // Everything at or below the floor (including clipped values) is drawn there
+            return value <= CPL_LOG_FLOOR ? -INFINITY : pow(10.0, value);
+        case CPL_SCALE_SYMLOG:
+            return copysign(threshold * (pow(10.0, fabs(value)) - 1.0), value);
+        default:
+            return value;
+    }
+}
@@ -0,0 +1,47 @@
+#ifndef CPL_TRANSFORM_H
+#define CPL_TRANSFORM_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include "CPLPlot.h"
+
+// Data -> NDC mapping of one plot, taken from its current ranges, axis scales
+// and polar flag. Lines store float offsets from a per-line origin; the data
+// vertex shader (CPL_SHADER_DATA) and the CPU backends map them the same way,
+// so changing a range or scale never touches line data.
+typedef struct CPLViewTransform {
+    CPLAxisScale scale[2];
+    bool polar;                  // x is the angle in radians, y the radius
+    double threshold[2];         // Symlog linear range
+    double min[2];               // Transformed axis minimum
+    double factor[2];            // NDC per transformed unit (polar radius: fraction of the circle)
+    float box_min[2];            // NDC of the plot box's lower-left corner
+    float radius[2];             // Polar: NDC half-extents of the largest circle in the box
+} CPLViewTransform;
+
+// Mapping for a plot drawn into `viewport` (x, y, width, height; only its aspect matters)
+void cpl_view_transform(const CPLPlot* plot, const int* viewport, CPLViewTransform* view);
+
+// Axis scale function (identity, log10 or symlog)
+double cpl_axis_transform(CPLAxisScale scale, double value, double threshold);
+
+// NDC position of a line vertex (x, y offsets relative to `origin`, plus the
+// residuals in `low` for high-precision lines; NULL otherwise)
+void cpl_view_map(const CPLViewTransform* view, const double* origin, const float* vertex, const float* low,
+                  float* ndc);
+
+// Data coordinates at an NDC position, inverting cpl_view_map (polar: the angle
+// in (-pi, pi] and the radius). Log axes give -INFINITY at or below their floor.
+void cpl_view_unmap(const CPLViewTransform* view, const double* ndc, double* data);
+
+// Double-float split: high + low carries ~48 bits of `value`. The high part is
+// `value` truncated to float, so it is monotonic in `value` like a plain cast.
+void cpl_split_double(double value, float* high, float* low);
+
+// Offset-space window, relative to `origin`, covering the NDC rectangle (min x,
+// min y, max x, max y). Returns false when `bounds` (offsets of a line or
+// scatter) miss it. Polar views do not cull.
+bool cpl_view_window(const CPLViewTransform* view, const double* origin, const float* bounds, const float* ndc_rect,
+                     float* window);
+
+#endif // CPL_TRANSFORM_H
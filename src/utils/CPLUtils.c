@@ -1,6 +1,16 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include "CPLUtils.h"
 #include "CPLPlot.h"
 #include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+// Constants
+#define CPL_MAX_WORKER_THREADS 16
 
 void cpl_make_ortho_matrix(float left, float right, float bottom, float top, float* out) {
     if (!out) return;
@@ -46,3 +56,49 @@ float cpl_clamp(float value, float min, float max) {
 float cpl_lerp(float a, float b, float t) {
     return a + t * (b - a);
 }
+
+bool cpl_is_finite(double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return (bits >> 52 & 0x7ff) != 0x7ff;
+}
+
+bool cpl_is_finitef(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return (bits >> 23 & 0xff) != 0xff;
+}
+
+bool cpl_is_nan(double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return (bits & ~((uint64_t)1 << 63)) > (uint64_t)0x7ff0000000000000;
+}
+
+bool cpl_is_nanf(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return (bits & 0x7fffffffu) > 0x7f800000u;
+}
+
+size_t cpl_image_default_threads(void) {
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cores < 1) return 1;
+    return cores > CPL_MAX_WORKER_THREADS ? CPL_MAX_WORKER_THREADS : (size_t)cores;
+}
+
+void cpl_run_workers(void* workers, size_t size, size_t count, void* (*main)(void*)) {
+    unsigned char* base = (unsigned char*)workers;
+    pthread_t* threads = (pthread_t*)calloc(count, sizeof(pthread_t));
+    bool* started = (bool*)calloc(count, sizeof(bool));
+    for (size_t i = 1; i < count; i++) {
+        if (threads && started) started[i] = pthread_create(&threads[i], NULL, main, base + i * size) == 0;
+        if (!threads || !started || !started[i]) main(base + i * size);
+    }
+    main(base);
+    for (size_t i = 1; threads && started && i < count; i++) {
+        if (started[i]) pthread_join(threads[i], NULL);
+    }
+    free(threads);
+    free(started);
+}
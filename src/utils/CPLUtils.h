@@ -18,4 +18,18 @@ void cpl_warning(const char* message);
 float cpl_clamp(float value, float min, float max);
 float cpl_lerp(float a, float b, float t);
 
+// NaN/infinity tests on the bit pattern; -ffast-math lets compilers fold isnan()/isfinite() to constants
+bool cpl_is_finite(double value);
+bool cpl_is_finitef(float value);
+bool cpl_is_nan(double value);
+bool cpl_is_nanf(float value);
+
+// Worker threads (cpl_image_default_threads is declared in CPLPlot.h: one per core, at most 16)
+
+// Fan-out for data-parallel work: main() is called once per element of `workers`
+// (`count` elements of `size` bytes). Worker 0 runs on the calling thread, and a
+// worker whose thread cannot be started runs inline, so every worker always runs.
+// A `size` of 0 hands every worker the same element (workers draining one queue).
+void cpl_run_workers(void* workers, size_t size, size_t count, void* (*main)(void*));
+
 #endif // CPL_UTILS_H
@@ -0,0 +1,1253 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "CPLVector.h"
+#include "CPLRenderer.h"
+#include "CPLGeometry.h"
+#include "CPLTransform.h"
+#include "CPLDensity.h"
+#include "CPLWaterfall.h"
+#include "CPLMatrix.h"
+#include "CPLHistogram.h"
+#include "CPLContour.h"
+#include "CPLQuiver.h"
+#include "CPLCandles.h"
+#include "CPLImage.h"
+#include "CPLUtils.h"
+#include "CPLPlot.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <math.h>
+#include <zlib.h>
+
+// External function declarations
+size_t cpl_small_multiple_vertices(const CPLSmallMultiples* multiples, size_t index, bool frame, float* vertices);
+
+// Constants
+#define CPL_VECTOR_BUFFER_SIZE (64 * 1024)
+#define CPL_VECTOR_COLUMN_WIDTH 0.25f       // Decimation bucket width in pixels (4x zoom headroom)
+#define CPL_VECTOR_COORD_LIMIT 1e7f         // Far off-page points are clamped (the clip hides them)
+#define CPL_VECTOR_PDF_SCALE 0.75f          // Pixels to points at 96 dpi
+#define CPL_VECTOR_PDF_OBJECTS 7
+#define CPL_VECTOR_POINT_CELLS 4            // Scatter coverage cells per pixel (same headroom as the columns)
+
+// PDF image XObject (and its alpha soft mask), written after the content stream
+typedef struct {
+    int width, height;
+    unsigned char* rgb;         // Deflated DeviceRGB samples, top row first
+    unsigned char* alpha;       // Deflated DeviceGray soft mask
+    size_t rgb_size, alpha_size;
+    size_t offsets[2];          // File offsets of the image and mask objects
+} CPLVectorImage;
+
+// Buffered output stream; PDF content streams are deflated on the fly
+typedef struct {
+    FILE* file;
+    char text[CPL_VECTOR_BUFFER_SIZE];
+    size_t length;
+    size_t offset;              // Bytes already written to the file (PDF xref offsets)
+    z_stream zstream;
+    bool deflating;
+    bool pdf;
+    bool failed;
+    float height;               // SVG y axis points down
+    bool opacities[256];        // PDF: opacities used by the content (graphics states /a0 ... /a255)
+    CPLVectorImage* images;     // PDF: images used by the content (/Im0 ...)
+    size_t num_images, image_capacity;
+} CPLVectorWriter;
+
+// Point in figure pixels (origin bottom-left)
+typedef struct {
+    float x, y;
+    unsigned int color;         // 0xRRGGBB
+    size_t index;               // Position in the source strip
+} CPLVectorPoint;
+
+// Current path element: one stroke color and width
+typedef struct {
+    bool open;
+    unsigned int color;
+    float width;
+    bool pending_move;          // Next segment starts a new subpath at `last`
+    bool has_last;
+    CPLVectorPoint last;
+    long last_x, last_y;        // `last` in output hundredths of a pixel
+} CPLVectorPath;
+
+// Current scatter element: discs sharing a color, opacity and diameter
+typedef struct {
+    bool open;
+    unsigned int color;
+    unsigned int opacity;       // 0-255
+    long diameter;              // Hundredths of a pixel
+} CPLVectorDiscs;
+
+// First/min/max/last of a run of strip vertices inside one pixel column slice
+typedef struct {
+    bool active;
+    float column;
+    CPLVectorPoint first, min, max, last;
+} CPLVectorBucket;
+
+// Internal function declarations
+static bool cpl_vector_open(CPLVectorWriter* writer, const char* filename, bool pdf, float height);
+static bool cpl_vector_close(CPLVectorWriter* writer);
+static void cpl_vector_figure(CPLVectorWriter* writer, const CPLFigure* fig);
+static void cpl_vector_plot(CPLVectorWriter* writer, CPLPlot* plot, size_t plot_index, const int* viewport);
+static void cpl_vector_multiples(CPLVectorWriter* writer, const CPLPlot* plot, size_t plot_index, const int* viewport);
+static void cpl_vector_segments(CPLVectorWriter* writer, CPLVectorPath* path, const float* vertices, size_t count,
+                                const int* viewport, bool closed);
+static void cpl_vector_strip(CPLVectorWriter* writer, CPLVectorPath* path, const float* vertices, size_t count,
+                             const int* viewport, const CPLViewTransform* view, const double* origin,
+                             const float* low);
+static void cpl_vector_flush_bucket(CPLVectorWriter* writer, CPLVectorPath* path, CPLVectorBucket* bucket);
+static void cpl_vector_scatter(CPLVectorWriter* writer, const CPLScatter* scatter, const int* viewport,
+                               const CPLViewTransform* view, const int* box);
+static bool cpl_vector_scatter_point(const CPLScatter* scatter, size_t index, const int* viewport,
+                                     const CPLViewTransform* view, const int* box, CPLVectorPoint* point,
+                                     float* diameter, unsigned int* opacity);
+static void cpl_vector_disc(CPLVectorWriter* writer, CPLVectorDiscs* discs, const CPLVectorPoint* point, float diameter,
+                            unsigned int opacity);
+static void cpl_vector_density(CPLVectorWriter* writer, CPLDensity* density, CPLDensityNorm norm,
+                               CPLColormap colormap, const int* box);
+static void cpl_vector_waterfall(CPLVectorWriter* writer, const CPLPlot* plot, const int* viewport, const int* box);
+static void cpl_vector_matrix(CPLVectorWriter* writer, const CPLPlot* plot, const int* viewport, const int* box);
+static void cpl_vector_histogram(CPLVectorWriter* writer, const CPLHistogram* histogram, const int* viewport,
+                                 const CPLViewTransform* view, const float* ndc_rect);
+static void cpl_vector_candles(CPLVectorWriter* writer, const CPLCandles* candles, const int* viewport,
+                               const CPLViewTransform* view, const float* ndc_rect);
+static void cpl_vector_image(CPLVectorWriter* writer, const unsigned char* pixels, int width, int height,
+                             const int* rect);
+static void cpl_vector_base64(CPLVectorWriter* writer, const unsigned char* data, size_t length);
+static unsigned char* cpl_vector_compress(const unsigned char* data, size_t length, size_t* compressed);
+static bool cpl_vector_point(const float* vertex, size_t index, const int* viewport, const CPLViewTransform* view,
+                             const double* origin, const float* low, CPLVectorPoint* point);
+static void cpl_vector_pixel(const float* ndc, const int* viewport, CPLVectorPoint* point);
+static void cpl_vector_begin_style(CPLVectorWriter* writer, CPLVectorPath* path, float width);
+static void cpl_vector_move_to(CPLVectorPath* path, const CPLVectorPoint* point);
+static void cpl_vector_line_to(CPLVectorWriter* writer, CPLVectorPath* path, const CPLVectorPoint* point);
+static void cpl_vector_end_element(CPLVectorWriter* writer, CPLVectorPath* path);
+static void cpl_vector_coords(CPLVectorWriter* writer, long x, long y);
+static char* cpl_vector_format(char* out, long hundredths);
+static unsigned int cpl_vector_pack_color(float r, float g, float b);
+static void cpl_vector_puts(CPLVectorWriter* writer, const char* text);
+static void cpl_vector_printf(CPLVectorWriter* writer, const char* format, ...);
+static void cpl_vector_reserve(CPLVectorWriter* writer, size_t bytes);
+static void cpl_vector_flush(CPLVectorWriter* writer, int mode);
+static void cpl_vector_raw(CPLVectorWriter* writer, const void* data, size_t length);
+static bool cpl_vector_begin_deflate(CPLVectorWriter* writer);
+static void cpl_vector_end_deflate(CPLVectorWriter* writer);
+static void cpl_vector_error(const char* message);
+
+// Public exporters
+bool cpl_write_svg(const CPLFigure* fig, const char* filename) {
+    if (!fig || !filename) return false;
+
+    CPLVectorWriter* writer = (CPLVectorWriter*)malloc(sizeof(CPLVectorWriter));
+    if (!writer || !cpl_vector_open(writer, filename, false, (float)fig->height)) {
+        free(writer);
+        return false;
+    }
+
+    cpl_vector_printf(writer,
+                      "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                      "<svg xmlns=\"http://www.w3.org/2000/svg\" xmlns:xlink=\"http://www.w3.org/1999/xlink\" "
+                      "width=\"%zu\" height=\"%zu\" viewBox=\"0 0 %zu %zu\">\n",
+                      fig->width, fig->height, fig->width, fig->height);
+    cpl_vector_printf(writer, "<rect width=\"100%%\" height=\"100%%\" fill=\"#%06x\"/>\n",
+                      cpl_vector_pack_color(fig->bg_color.r, fig->bg_color.g, fig->bg_color.b));
+    cpl_vector_figure(writer, fig);
+    cpl_vector_puts(writer, "</svg>\n");
+
+    bool ok = cpl_vector_close(writer);
+    free(writer);
+    return ok;
+}
+
+bool cpl_write_pdf(const CPLFigure* fig, const char* filename) {
+    if (!fig || !filename) return false;
+
+    CPLVectorWriter* writer = (CPLVectorWriter*)malloc(sizeof(CPLVectorWriter));
+    if (!writer || !cpl_vector_open(writer, filename, true, (float)fig->height)) {
+        free(writer);
+        return false;
+    }
+
+    // Object offsets for the cross-reference table (object 0 is the free list head)
+    size_t offsets[CPL_VECTOR_PDF_OBJECTS] = { 0 };
+    char page_width[32], page_height[32];
+    *cpl_vector_format(page_width, lrintf(fig->width * CPL_VECTOR_PDF_SCALE * 100.0f)) = '\0';
+    *cpl_vector_format(page_height, lrintf(fig->height * CPL_VECTOR_PDF_SCALE * 100.0f)) = '\0';
+
+    cpl_vector_puts(writer, "%PDF-1.4\n%\xE2\xE3\xCF\xD3\n");
+    offsets[1] = writer->offset + writer->length;
+    cpl_vector_puts(writer, "1 0 obj\n<< /Type /Catalog /Pages 2 0 R >>\nendobj\n");
+    offsets[2] = writer->offset + writer->length;
+    cpl_vector_puts(writer, "2 0 obj\n<< /Type /Pages /Kids [3 0 R] /Count 1 >>\nendobj\n");
+    offsets[3] = writer->offset + writer->length;
+    cpl_vector_printf(writer,
+                      "3 0 obj\n<< /Type /Page /Parent 2 0 R /MediaBox [0 0 %s %s] /Contents 4 0 R /Resources 6 0 R >>\n"
+                      "endobj\n", page_width, page_height);
+
+    // Content stream; its length is only known afterwards, so it is an indirect object
+    offsets[4] = writer->offset + writer->length;
+    cpl_vector_puts(writer, "4 0 obj\n<< /Length 5 0 R /Filter /FlateDecode >>\nstream\n");
+    cpl_vector_flush(writer, Z_NO_FLUSH);
+    size_t stream_start = writer->offset;
+
+    if (cpl_vector_begin_deflate(writer)) {
+        cpl_vector_printf(writer, "%g 0 0 %g 0 0 cm\n1 J 1 j\n", CPL_VECTOR_PDF_SCALE, CPL_VECTOR_PDF_SCALE);
+        cpl_vector_printf(writer, "%.3f %.3f %.3f rg 0 0 %zu %zu re f\n",
+                          fig->bg_color.r, fig->bg_color.g, fig->bg_color.b, fig->width, fig->height);
+        cpl_vector_figure(writer, fig);
+        cpl_vector_end_deflate(writer);
+    }
+    size_t stream_length = writer->offset - stream_start;
+
+    cpl_vector_puts(writer, "\nendstream\nendobj\n");
+    offsets[5] = writer->offset + writer->length;
+    cpl_vector_printf(writer, "5 0 obj\n%zu\nendobj\n", stream_length);
+
+    // Graphics states for the translucent scatter points and histogram bars
+    // (stroke and fill opacity) and the images, also
+    // known only afterwards; image k is object 7 + 2k, its mask the next one
+    offsets[6] = writer->offset + writer->length;
+    cpl_vector_puts(writer, "6 0 obj\n<< /ExtGState <<");
+    for (int i = 0; i < 256; i++) {
+        if (writer->opacities[i]) cpl_vector_printf(writer, " /a%d << /CA %.4f /ca %.4f >>", i, i / 255.0f, i / 255.0f);
+    }
+    cpl_vector_puts(writer, " >> /XObject <<");
+    for (size_t i = 0; i < writer->num_images; i++) {
+        cpl_vector_printf(writer, " /Im%zu %zu 0 R", i, CPL_VECTOR_PDF_OBJECTS + 2 * i);
+    }
+    cpl_vector_puts(writer, " >> >>\nendobj\n");
+
+    for (size_t i = 0; i < writer->num_images; i++) {
+        CPLVectorImage* image = &writer->images[i];
+        size_t object = CPL_VECTOR_PDF_OBJECTS + 2 * i;
+        image->offsets[0] = writer->offset + writer->length;
+        cpl_vector_printf(writer,
+                          "%zu 0 obj\n<< /Type /XObject /Subtype /Image /Width %d /Height %d /ColorSpace /DeviceRGB "
+                          "/BitsPerComponent 8 /SMask %zu 0 R /Filter /FlateDecode /Length %zu >>\nstream\n",
+                          object, image->width, image->height, object + 1, image->rgb_size);
+        cpl_vector_flush(writer, Z_NO_FLUSH);
+        cpl_vector_raw(writer, image->rgb, image->rgb_size);
+        cpl_vector_puts(writer, "\nendstream\nendobj\n");
+
+        image->offsets[1] = writer->offset + writer->length;
+        cpl_vector_printf(writer,
+                          "%zu 0 obj\n<< /Type /XObject /Subtype /Image /Width %d /Height %d /ColorSpace /DeviceGray "
+                          "/BitsPerComponent 8 /Filter /FlateDecode /Length %zu >>\nstream\n",
+                          object + 1, image->width, image->height, image->alpha_size);
+        cpl_vector_flush(writer, Z_NO_FLUSH);
+        cpl_vector_raw(writer, image->alpha, image->alpha_size);
+        cpl_vector_puts(writer, "\nendstream\nendobj\n");
+    }
+
+    size_t num_objects = CPL_VECTOR_PDF_OBJECTS + 2 * writer->num_images;
+    size_t xref_offset = writer->offset + writer->length;
+    cpl_vector_printf(writer, "xref\n0 %zu\n0000000000 65535 f \n", num_objects);
+    for (int i = 1; i < CPL_VECTOR_PDF_OBJECTS; i++) {
+        cpl_vector_printf(writer, "%010zu 00000 n \n", offsets[i]);
+    }
+    for (size_t i = 0; i < writer->num_images; i++) {
+        cpl_vector_printf(writer, "%010zu 00000 n \n%010zu 00000 n \n", writer->images[i].offsets[0],
+                          writer->images[i].offsets[1]);
+    }
+    cpl_vector_printf(writer, "trailer\n<< /Size %zu /Root 1 0 R >>\nstartxref\n%zu\n%%%%EOF\n",
+                      num_objects, xref_offset);
+
+    bool ok = cpl_vector_close(writer);
+    free(writer);
+    return ok;
+}
+
+// Figure traversal
+static void cpl_vector_figure(CPLVectorWriter* writer, const CPLFigure* fig) {
+    for (size_t i = 0; i < fig->num_plots; i++) {
+        CPLPlot* plot = fig->plots[i];
+        if (!plot || !plot->data) continue;
+
+        int viewport[4];
+        cpl_plot_viewport(plot, (int)fig->width, (int)fig->height, viewport);
+        if (plot->data->multiples) {
+            cpl_vector_multiples(writer, plot, i, viewport);
+        } else {
+            cpl_vector_plot(writer, plot, i, viewport);
+        }
+    }
+}
+
+static void cpl_vector_plot(CPLVectorWriter* writer, CPLPlot* plot, size_t plot_index, const int* viewport) {
+    // Clip to the plot viewport, as glViewport does
+    if (writer->pdf) {
+        cpl_vector_printf(writer, "q %d %d %d %d re W n\n", viewport[0], viewport[1], viewport[2], viewport[3]);
+    } else {
+        cpl_vector_printf(writer,
+                          "<clipPath id=\"plot%zu\"><rect x=\"%d\" y=\"%d\" width=\"%d\" height=\"%d\"/></clipPath>\n"
+                          "<g clip-path=\"url(#plot%zu)\" fill=\"none\" stroke-linecap=\"round\" stroke-linejoin=\"round\">\n",
+                          plot_index, viewport[0], (int)writer->height - viewport[1] - viewport[3],
+                          viewport[2], viewport[3], plot_index);
+    }
+
+    CPLVectorPath path;
+    memset(&path, 0, sizeof(path));
+
+    // Grid below the box, data on top (matches the software rasterizer)
+    if (plot->show_grid && plot->data->grid) {
+        const CPLGeometry* grid = plot->data->grid;
+        size_t count = cpl_grid_vertex_count(grid->grid_lines);
+        float* vertices = (float*)malloc(count * 5 * sizeof(float));
+        if (vertices) {
+            cpl_build_grid_vertices(grid->margin, grid->grid_lines, grid->show_axes, vertices);
+            cpl_vector_begin_style(writer, &path, plot->grid_line_width);
+            cpl_vector_segments(writer, &path, vertices, count, viewport, false);
+            free(vertices);
+        } else {
+            cpl_vector_error("Failed to allocate grid vertices");
+        }
+    }
+
+    if (plot->data->box) {
+        float vertices[20]; // 4 vertices * (2 coords + 3 color)
+        cpl_build_box_vertices(plot->data->box->margin, vertices);
+        cpl_vector_begin_style(writer, &path, plot->box_line_width);
+        cpl_vector_segments(writer, &path, vertices, cpl_box_vertex_count(), viewport, true);
+    }
+
+    // Data is clipped to the plot box, as the GL scissor does
+    cpl_vector_end_element(writer, &path);
+    int box[4];
+    cpl_plot_box_rect(plot, viewport, box);
+    if (writer->pdf) {
+        cpl_vector_printf(writer, "q %d %d %d %d re W n\n", box[0], box[1], box[2], box[3]);
+    } else {
+        cpl_vector_printf(writer,
+                          "<clipPath id=\"data%zu\"><rect x=\"%d\" y=\"%d\" width=\"%d\" height=\"%d\"/></clipPath>\n"
+                          "<g clip-path=\"url(#data%zu)\">\n",
+                          plot_index, box[0], (int)writer->height - box[1] - box[3], box[2], box[3], plot_index);
+    }
+
+    // Images lie below the lines, the matrix lowest
+    if (plot->data->matrix) {
+        cpl_vector_matrix(writer, plot, viewport, box);
+    }
+    if (plot->data->waterfall && plot->data->waterfall->filled > 0) {
+        cpl_vector_waterfall(writer, plot, viewport, box);
+    }
+
+    // Lines that miss the box are skipped, and sorted lines only emit the
+    // samples inside it (plus a line width)
+    float pad = 0.5f * plot->line_width + 1.0f;
+    float pad_x = pad * 2.0f / (float)viewport[2];
+    float pad_y = pad * 2.0f / (float)viewport[3];
+    float ndc_rect[4] = {
+        -1.0f + plot->data->margin - pad_x, -1.0f + plot->data->margin - pad_y,
+        1.0f - plot->data->margin + pad_x, 1.0f - plot->data->margin + pad_y
+    };
+
+    CPLViewTransform view;
+    cpl_view_transform(plot, viewport, &view);
+
+    // Histogram bars below the lines
+    if (plot->data->histogram) {
+        cpl_vector_histogram(writer, plot->data->histogram, viewport, &view, ndc_rect);
+    }
+    if (plot->data->candles) {
+        cpl_vector_candles(writer, plot->data->candles, viewport, &view, ndc_rect);
+    }
+
+    // Contour lines below the plotted lines; consecutive polylines of one color share a path element
+    const CPLContour* contour = plot->data->contour;
+    if (contour && cpl_contour_visible(contour, &view, ndc_rect)) {
+        cpl_vector_begin_style(writer, &path, plot->line_width);
+        for (size_t i = 0; i < contour->num_polylines; i++) {
+            cpl_vector_strip(writer, &path, contour->vertices + (size_t)contour->firsts[i] * 5,
+                             (size_t)contour->counts[i], viewport, &view, contour->origin, NULL);
+        }
+    }
+
+    // Quiver arrows as a shaft and a barb-tip-barb polyline each, all in one path element
+    const CPLQuiver* quiver = plot->data->quiver;
+    size_t arrows = quiver ? cpl_quiver_count(quiver, &view, viewport, ndc_rect) : 0;
+    if (arrows > 0) {
+        static const int points[5] = { 0, 1, 3, 2, 5 };
+        float stretch = cpl_quiver_stretch(quiver, arrows);
+        cpl_vector_begin_style(writer, &path, plot->line_width);
+        for (size_t i = 0; i < arrows; i++) {
+            float ndc[12];
+            if (!cpl_quiver_arrow(quiver, i, &view, viewport, stretch, ndc_rect, ndc)) continue;
+
+            float vertices[5 * 5];
+            for (int k = 0; k < 5; k++) {
+                vertices[k * 5] = ndc[2 * points[k]];
+                vertices[k * 5 + 1] = ndc[2 * points[k] + 1];
+                vertices[k * 5 + 2] = quiver->color.r;
+                vertices[k * 5 + 3] = quiver->color.g;
+                vertices[k * 5 + 4] = quiver->color.b;
+            }
+            cpl_vector_strip(writer, &path, vertices, 2, viewport, NULL, NULL, NULL);
+            cpl_vector_strip(writer, &path, vertices + 2 * 5, 3, viewport, NULL, NULL, NULL);
+        }
+    }
+
+    for (size_t i = 0; i < plot->data->num_lines; i++) {
+        const CPLLine* line = &plot->data->lines[i];
+        if (!line->vertices || line->num_vertices < 2) continue;
+
+        float window[4];
+        if (!cpl_view_window(&view, line->origin, line->bounds, ndc_rect, window)) continue;
+
+        size_t first, count;
+        cpl_line_visible_range(line, window[0], window[2], &first, &count);
+        if (count < 2) continue;
+
+        cpl_vector_begin_style(writer, &path, plot->line_width);
+        cpl_vector_strip(writer, &path, line->vertices + first * 5, count, viewport, &view, line->origin,
+                         line->low ? line->low + first * 2 : NULL);
+    }
+
+    cpl_vector_end_element(writer, &path);
+
+    // Persistence traces above the lines
+    if (plot->data->traces && plot->data->traces->num_traces > 0) {
+        cpl_vector_density(writer, cpl_traces_grid(plot, viewport), plot->data->traces->norm, plot->colormap, box);
+    }
+
+    // Scatters above the lines, as one density image or point by point
+    if (plot->density != CPL_DENSITY_OFF) {
+        cpl_vector_density(writer, cpl_density_update(plot, viewport), plot->density, plot->colormap, box);
+    } else {
+        for (size_t i = 0; i < plot->data->num_scatters; i++) {
+            const CPLScatter* scatter = &plot->data->scatters[i];
+            if (!scatter->is_loaded) continue;
+
+            float radius = 0.5f * scatter->max_size + 1.0f;
+            float scatter_rect[4] = {
+                ndc_rect[0] - radius * 2.0f / (float)viewport[2], ndc_rect[1] - radius * 2.0f / (float)viewport[3],
+                ndc_rect[2] + radius * 2.0f / (float)viewport[2], ndc_rect[3] + radius * 2.0f / (float)viewport[3]
+            };
+            float window[4];
+            if (!cpl_view_window(&view, scatter->origin, scatter->bounds, scatter_rect, window)) continue;
+            cpl_vector_scatter(writer, scatter, viewport, &view, box);
+        }
+    }
+
+    cpl_vector_puts(writer, writer->pdf ? "Q\nQ\n" : "</g>\n</g>\n");
+}
+
+// Small multiples draw only their tiles, as in GL: every series as a strip
+// clipped to its tile (values are clamped into it), then every frame
+static void cpl_vector_multiples(CPLVectorWriter* writer, const CPLPlot* plot, size_t plot_index, const int* viewport) {
+    const CPLSmallMultiples* multiples = plot->data->multiples;
+    size_t num_tiles = multiples->rows * multiples->cols;
+    size_t capacity = multiples->samples > 4 ? multiples->samples : 4;
+    float* vertices = (float*)malloc(capacity * 5 * sizeof(float));
+    if (!vertices) {
+        cpl_vector_error("Failed to allocate small multiple vertices");
+        return;
+    }
+
+    if (writer->pdf) {
+        cpl_vector_printf(writer, "q %d %d %d %d re W n\n", viewport[0], viewport[1], viewport[2], viewport[3]);
+    } else {
+        cpl_vector_printf(writer,
+                          "<clipPath id=\"plot%zu\"><rect x=\"%d\" y=\"%d\" width=\"%d\" height=\"%d\"/></clipPath>\n"
+                          "<g clip-path=\"url(#plot%zu)\" fill=\"none\" stroke-linecap=\"round\" stroke-linejoin=\"round\">\n",
+                          plot_index, viewport[0], (int)writer->height - viewport[1] - viewport[3],
+                          viewport[2], viewport[3], plot_index);
+    }
+
+    CPLVectorPath path;
+    memset(&path, 0, sizeof(path));
+
+    // The clip keeps round caps and joins from spilling into the neighbouring tiles
+    int pad = (int)ceilf(0.5f * plot->line_width) + 1;
+    for (size_t i = 0; i < num_tiles; i++) {
+        const float* rect = multiples->tiles + i * CPL_TILE_FLOATS;
+        int x0 = (int)floorf((float)viewport[0] + (rect[0] + 1.0f) * 0.5f * (float)viewport[2]) - pad;
+        int y0 = (int)floorf((float)viewport[1] + (rect[1] + 1.0f) * 0.5f * (float)viewport[3]) - pad;
+        int x1 = (int)ceilf((float)viewport[0] + (rect[2] + 1.0f) * 0.5f * (float)viewport[2]) + pad;
+        int y1 = (int)ceilf((float)viewport[1] + (rect[3] + 1.0f) * 0.5f * (float)viewport[3]) + pad;
+        size_t count = cpl_small_multiple_vertices(multiples, i, false, vertices);
+        if (count < 2) continue;
+
+        if (writer->pdf) {
+            cpl_vector_printf(writer, "q %d %d %d %d re W n\n", x0, y0, x1 - x0, y1 - y0);
+        } else {
+            cpl_vector_printf(writer,
+                              "<clipPath id=\"tile%zu_%zu\"><rect x=\"%d\" y=\"%d\" width=\"%d\" height=\"%d\"/></clipPath>\n"
+                              "<g clip-path=\"url(#tile%zu_%zu)\">\n",
+                              plot_index, i, x0, (int)writer->height - y1, x1 - x0, y1 - y0, plot_index, i);
+        }
+        cpl_vector_begin_style(writer, &path, plot->line_width);
+        cpl_vector_strip(writer, &path, vertices, count, viewport, NULL, NULL, NULL);
+        cpl_vector_end_element(writer, &path);
+        cpl_vector_puts(writer, writer->pdf ? "Q\n" : "</g>\n");
+    }
+
+    cpl_vector_begin_style(writer, &path, plot->box_line_width);
+    for (size_t i = 0; i < num_tiles; i++) {
+        size_t count = cpl_small_multiple_vertices(multiples, i, true, vertices);
+        cpl_vector_segments(writer, &path, vertices, count, viewport, true);
+    }
+    cpl_vector_end_element(writer, &path);
+
+    cpl_vector_puts(writer, writer->pdf ? "Q\n" : "</g>\n");
+    free(vertices);
+}
+
+// Geometry emission
+static void cpl_vector_segments(CPLVectorWriter* writer, CPLVectorPath* path, const float* vertices, size_t count,
+                                const int* viewport, bool closed) {
+    CPLVectorPoint a, b;
+
+    if (closed) {
+        // Line loop: one subpath through all vertices and back to the start
+        for (size_t i = 0; i <= count; i++) {
+            if (!cpl_vector_point(vertices + (i % count) * 5, i, viewport, NULL, NULL, NULL, &b)) return;
+            if (i == 0) {
+                cpl_vector_move_to(path, &b);
+            } else {
+                cpl_vector_line_to(writer, path, &b);
+            }
+        }
+        return;
+    }
+
+    // Independent segments (GL_LINES)
+    for (size_t i = 0; i + 1 < count; i += 2) {
+        if (!cpl_vector_point(vertices + i * 5, i, viewport, NULL, NULL, NULL, &a) ||
+            !cpl_vector_point(vertices + (i + 1) * 5, i + 1, viewport, NULL, NULL, NULL, &b)) {
+            continue;
+        }
+        cpl_vector_move_to(path, &a);
+        cpl_vector_line_to(writer, path, &b);
+    }
+}
+
+static void cpl_vector_strip(CPLVectorWriter* writer, CPLVectorPath* path, const float* vertices, size_t count,
+                             const int* viewport, const CPLViewTransform* view, const double* origin,
+                             const float* low) {
+    // M4 decimation: consecutive vertices in the same column slice reduce to their
+    // first, lowest, highest and last point, in original order. Any polyline drawn
+    // through a slice narrower than a pixel covers the same pixels.
+    CPLVectorBucket bucket;
+    bucket.active = false;
+    path->has_last = false;
+
+    for (size_t i = 0; i < count; i++) {
+        CPLVectorPoint point;
+        if (!cpl_vector_point(vertices + i * 5, i, viewport, view, origin, low ? low + i * 2 : NULL, &point)) {
+            // Non-finite data breaks the line, like a gap in the series
+            cpl_vector_flush_bucket(writer, path, &bucket);
+            path->has_last = false;
+            continue;
+        }
+
+        float column = floorf(point.x / CPL_VECTOR_COLUMN_WIDTH);
+        if (bucket.active && column == bucket.column) {
+            if (point.y < bucket.min.y) bucket.min = point;
+            if (point.y > bucket.max.y) bucket.max = point;
+            bucket.last = point;
+            continue;
+        }
+
+        cpl_vector_flush_bucket(writer, path, &bucket);
+        bucket.active = true;
+        bucket.column = column;
+        bucket.first = bucket.min = bucket.max = bucket.last = point;
+    }
+
+    cpl_vector_flush_bucket(writer, path, &bucket);
+}
+
+static void cpl_vector_flush_bucket(CPLVectorWriter* writer, CPLVectorPath* path, CPLVectorBucket* bucket) {
+    if (!bucket->active) return;
+    bucket->active = false;
+
+    // Emit the (up to) four extremes in source order, skipping duplicates
+    const CPLVectorPoint* points[4] = { &bucket->first, &bucket->min, &bucket->max, &bucket->last };
+    if (points[1]->index > points[2]->index) {
+        points[1] = &bucket->max;
+        points[2] = &bucket->min;
+    }
+
+    size_t previous = (size_t)-1;
+    for (int i = 0; i < 4; i++) {
+        if (i > 0 && points[i]->index == previous) continue;
+        previous = points[i]->index;
+
+        if (path->has_last) {
+            cpl_vector_line_to(writer, path, points[i]);
+        } else {
+            cpl_vector_move_to(path, points[i]);
+        }
+    }
+}
+
+// Scatter points become zero-length strokes with round caps, which both formats
+// draw as discs. Millions of points would make the file unusable, so points
+// hidden under later opaque points are dropped: walking from the topmost point
+// down, quarter-pixel cells fully inside an opaque disc are marked covered, and
+// a point whose disc only touches covered cells is skipped.
+static void cpl_vector_scatter(CPLVectorWriter* writer, const CPLScatter* scatter, const int* viewport,
+                               const CPLViewTransform* view, const int* box) {
+    long cols = (long)(box[2] > 0 ? box[2] : 0) * CPL_VECTOR_POINT_CELLS;
+    long rows = (long)(box[3] > 0 ? box[3] : 0) * CPL_VECTOR_POINT_CELLS;
+    if (cols == 0 || rows == 0) return;
+
+    unsigned char* covered = (unsigned char*)calloc((size_t)(cols * rows), 1);
+    unsigned char* keep = (unsigned char*)calloc(scatter->num_points, 1);
+    if (!covered || !keep) {
+        cpl_vector_error("Failed to allocate scatter cells");
+        free(covered);
+        free(keep);
+        return;
+    }
+
+    CPLVectorPoint point;
+    float diameter;
+    unsigned int opacity;
+    for (size_t i = scatter->num_points; i-- > 0;) {
+        if (!cpl_vector_scatter_point(scatter, i, viewport, view, box, &point, &diameter, &opacity)) continue;
+
+        // Disc centre and radius in cells; the range is limited to the box
+        float cx = (point.x - (float)box[0]) * CPL_VECTOR_POINT_CELLS;
+        float cy = (point.y - (float)box[1]) * CPL_VECTOR_POINT_CELLS;
+        float radius = 0.5f * diameter * CPL_VECTOR_POINT_CELLS;
+        long x0 = (long)floorf(cx - radius), x1 = (long)floorf(cx + radius);
+        long y0 = (long)floorf(cy - radius), y1 = (long)floorf(cy + radius);
+        if (x0 < 0) x0 = 0;
+        if (y0 < 0) y0 = 0;
+        if (x1 >= cols) x1 = cols - 1;
+        if (y1 >= rows) y1 = rows - 1;
+        float radius2 = radius * radius;
+
+        bool hidden = true;
+        for (long y = y0; y <= y1 && hidden; y++) {
+            // Nearest point of the cell row to the centre
+            float dy = cy < (float)y ? (float)y - cy : (cy > (float)(y + 1) ? cy - (float)(y + 1) : 0.0f);
+            for (long x = x0; x <= x1; x++) {
+                float dx = cx < (float)x ? (float)x - cx : (cx > (float)(x + 1) ? cx - (float)(x + 1) : 0.0f);
+                if (dx * dx + dy * dy < radius2 && !covered[y * cols + x]) {
+                    hidden = false;
+                    break;
+                }
+            }
+        }
+        if (hidden) continue;
+        keep[i] = 1;
+
+        if (opacity < 255) continue;
+        for (long y = y0; y <= y1; y++) {
+            // Farthest point of the cell row from the centre
+            float dy = fmaxf(fabsf((float)y - cy), fabsf((float)(y + 1) - cy));
+            for (long x = x0; x <= x1; x++) {
+                float dx = fmaxf(fabsf((float)x - cx), fabsf((float)(x + 1) - cx));
+                if (dx * dx + dy * dy <= radius2) covered[y * cols + x] = 1;
+            }
+        }
+    }
+
+    CPLVectorDiscs discs;
+    memset(&discs, 0, sizeof(discs));
+    for (size_t i = 0; i < scatter->num_points; i++) {
+        if (!keep[i]) continue;
+        cpl_vector_scatter_point(scatter, i, viewport, view, box, &point, &diameter, &opacity);
+        cpl_vector_disc(writer, &discs, &point, diameter, opacity);
+    }
+    if (discs.open) {
+        cpl_vector_puts(writer, writer->pdf ? "S\n" : "\"/>\n");
+    }
+
+    free(covered);
+    free(keep);
+}
+
+// Figure pixel position, diameter and opacity of a scatter point; false when it
+// is not finite, fully transparent or its disc misses the plot box
+static bool cpl_vector_scatter_point(const CPLScatter* scatter, size_t index, const int* viewport,
+                                     const CPLViewTransform* view, const int* box, CPLVectorPoint* point,
+                                     float* diameter, unsigned int* opacity) {
+    float ndc[2];
+    cpl_view_map(view, scatter->origin, scatter->offsets + index * 2, scatter->low ? scatter->low + index * 2 : NULL,
+                 ndc);
+    if (!cpl_is_finitef(ndc[0]) || !cpl_is_finitef(ndc[1])) return false;
+    cpl_vector_pixel(ndc, viewport, point);
+    point->index = index;
+
+    // Discs are never thinner than a pixel, as in the other backends
+    float size = scatter->sizes ? (float)scatter->sizes[index] : scatter->size;
+    *diameter = size > 1.0f ? size : 1.0f;
+    float radius = 0.5f * *diameter;
+    if (point->x + radius <= (float)box[0] || point->x - radius >= (float)(box[0] + box[2]) ||
+        point->y + radius <= (float)box[1] || point->y - radius >= (float)(box[1] + box[3])) {
+        return false;
+    }
+
+    if (scatter->colors) {
+        const unsigned char* rgba = scatter->colors + index * 4;
+        point->color = ((unsigned int)rgba[0] << 16) | ((unsigned int)rgba[1] << 8) | rgba[2];
+        *opacity = rgba[3];
+    } else {
+        point->color = cpl_vector_pack_color(scatter->color.r, scatter->color.g, scatter->color.b);
+        float alpha = scatter->color.a < 0.0f ? 0.0f : (scatter->color.a > 1.0f ? 1.0f : scatter->color.a);
+        *opacity = (unsigned int)(alpha * 255.0f + 0.5f);
+    }
+    return *opacity > 0;
+}
+
+static void cpl_vector_disc(CPLVectorWriter* writer, CPLVectorDiscs* discs, const CPLVectorPoint* point, float diameter,
+                            unsigned int opacity) {
+    long width = lrintf(diameter * 100.0f);
+    if (!discs->open || discs->color != point->color || discs->opacity != opacity || discs->diameter != width) {
+        if (discs->open) {
+            cpl_vector_puts(writer, writer->pdf ? "S\n" : "\"/>\n");
+        }
+        discs->open = true;
+        discs->color = point->color;
+        discs->opacity = opacity;
+        discs->diameter = width;
+
+        char text[32];
+        *cpl_vector_format(text, width) = '\0';
+        unsigned int color = point->color;
+        if (writer->pdf) {
+            writer->opacities[opacity] = true;
+            cpl_vector_printf(writer, "%s w %.3f %.3f %.3f RG /a%u gs\n", text, ((color >> 16) & 0xFF) / 255.0f,
+                              ((color >> 8) & 0xFF) / 255.0f, (color & 0xFF) / 255.0f, opacity);
+        } else if (opacity < 255) {
+            cpl_vector_printf(writer, "<path stroke=\"#%06x\" stroke-width=\"%s\" stroke-opacity=\"%.3f\" d=\"",
+                              color, text, opacity / 255.0f);
+        } else {
+            cpl_vector_printf(writer, "<path stroke=\"#%06x\" stroke-width=\"%s\" d=\"", color, text);
+        }
+    }
+
+    long x = lrintf(point->x * 100.0f);
+    long y = lrintf(point->y * 100.0f);
+    cpl_vector_puts(writer, writer->pdf ? "" : "M");
+    cpl_vector_coords(writer, x, y);
+    cpl_vector_puts(writer, writer->pdf ? " m " : " ");
+    cpl_vector_coords(writer, x, y);
+    cpl_vector_puts(writer, writer->pdf ? " l\n" : "");
+}
+
+// Density grid (scatter counts or trace weights) colored into an image of the
+// plot box, one image pixel per figure pixel
+static void cpl_vector_density(CPLVectorWriter* writer, CPLDensity* density, CPLDensityNorm norm,
+                               CPLColormap colormap, const int* box) {
+    if (!density) return;
+
+    size_t row_bytes = (size_t)density->width * 4;
+    unsigned char* pixels = (unsigned char*)malloc(row_bytes * (size_t)density->height);
+    if (!pixels) {
+        cpl_vector_error("Failed to allocate density image");
+        return;
+    }
+
+    // Both formats store the top row first
+    const int cells[4] = { 0, 0, density->width, density->height };
+    if (cpl_density_colors(density, norm, colormap, cells,
+                           pixels + row_bytes * (size_t)(density->height - 1), -(ptrdiff_t)row_bytes)) {
+        cpl_vector_image(writer, pixels, density->width, density->height, box);
+    }
+    free(pixels);
+}
+
+// Waterfall colors of the plot box, one image pixel per figure pixel
+static void cpl_vector_waterfall(CPLVectorWriter* writer, const CPLPlot* plot, const int* viewport, const int* box) {
+    if (box[2] <= 0 || box[3] <= 0) return;
+
+    size_t row_bytes = (size_t)box[2] * 4;
+    unsigned char* pixels = (unsigned char*)malloc(row_bytes * (size_t)box[3]);
+    if (!pixels) {
+        cpl_vector_error("Failed to allocate waterfall image");
+        return;
+    }
+
+    const int cells[4] = { 0, 0, box[2], box[3] };
+    if (cpl_waterfall_colors(plot, viewport, box, cells, pixels + row_bytes * (size_t)(box[3] - 1),
+                             -(ptrdiff_t)row_bytes)) {
+        cpl_vector_image(writer, pixels, box[2], box[3], box);
+    }
+    free(pixels);
+}
+
+// Matrix colors of the plot box, one image pixel per figure pixel
+static void cpl_vector_matrix(CPLVectorWriter* writer, const CPLPlot* plot, const int* viewport, const int* box) {
+    if (box[2] <= 0 || box[3] <= 0) return;
+
+    size_t row_bytes = (size_t)box[2] * 4;
+    unsigned char* pixels = (unsigned char*)malloc(row_bytes * (size_t)box[3]);
+    if (!pixels) {
+        cpl_vector_error("Failed to allocate matrix image");
+        return;
+    }
+
+    const int cells[4] = { 0, 0, box[2], box[3] };
+    if (cpl_matrix_colors(plot, viewport, box, cells, pixels + row_bytes * (size_t)(box[3] - 1),
+                          -(ptrdiff_t)row_bytes)) {
+        cpl_vector_image(writer, pixels, box[2], box[3], box);
+    }
+    free(pixels);
+}
+
+// Histogram bars as one filled path: each non-empty bar is a closed subpath
+// along its bottom and top edges, split into steps on polar plots like the GL bars
+static void cpl_vector_histogram(CPLVectorWriter* writer, const CPLHistogram* histogram, const int* viewport,
+                                 const CPLViewTransform* view, const float* ndc_rect) {
+    size_t first, count;
+    if (!cpl_histogram_visible_bins(histogram, view, ndc_rect, &first, &count)) return;
+
+    float alpha = histogram->color.a < 0.0f ? 0.0f : (histogram->color.a > 1.0f ? 1.0f : histogram->color.a);
+    unsigned int opacity = (unsigned int)(alpha * 255.0f + 0.5f);
+    if (opacity == 0) return;
+    unsigned int color = cpl_vector_pack_color(histogram->color.r, histogram->color.g, histogram->color.b);
+    if (writer->pdf) {
+        // The fill opacity is restored with the graphics state
+        writer->opacities[opacity] = true;
+        cpl_vector_printf(writer, "q %.3f %.3f %.3f rg /a%u gs\n", ((color >> 16) & 0xFF) / 255.0f,
+                          ((color >> 8) & 0xFF) / 255.0f, (color & 0xFF) / 255.0f, opacity);
+    } else if (opacity < 255) {
+        cpl_vector_printf(writer, "<path fill=\"#%06x\" fill-opacity=\"%.3f\" d=\"", color, opacity / 255.0f);
+    } else {
+        cpl_vector_printf(writer, "<path fill=\"#%06x\" d=\"", color);
+    }
+
+    const double origin[2] = { histogram->origin, 0.0 };
+    double width = (histogram->range[1] - histogram->range[0]) / (double)histogram->bins;
+    int segments = cpl_histogram_segments(view);
+    for (size_t bin = first; bin < first + count; bin++) {
+        if (histogram->counts[bin] == 0) continue;
+
+        // Bottom edge left to right, then the top edge back; steps that land on
+        // the previous output point (the centre of polar bars) are skipped
+        long last_x = 0, last_y = 0;
+        for (int k = 0; k <= 2 * segments + 1; k++) {
+            int step = k <= segments ? k : 2 * segments + 1 - k;
+            float vertex[2] = {
+                (float)(histogram->range[0] + ((double)bin + (double)step / segments) * width - histogram->origin),
+                k <= segments ? 0.0f : (float)histogram->counts[bin]
+            };
+            float ndc[2];
+            cpl_view_map(view, origin, vertex, NULL, ndc);
+            CPLVectorPoint point;
+            cpl_vector_pixel(ndc, viewport, &point);
+            long x = lrintf(point.x * 100.0f);
+            long y = lrintf(point.y * 100.0f);
+            if (k > 0 && x == last_x && y == last_y) continue;
+            last_x = x;
+            last_y = y;
+            if (writer->pdf) {
+                cpl_vector_coords(writer, x, y);
+                cpl_vector_puts(writer, k == 0 ? " m\n" : " l\n");
+            } else {
+                cpl_vector_puts(writer, k == 0 ? "M" : " ");
+                cpl_vector_coords(writer, x, y);
+            }
+        }
+        cpl_vector_puts(writer, writer->pdf ? "h\n" : "Z");
+    }
+    cpl_vector_puts(writer, writer->pdf ? "f\nQ\n" : "\"/>\n");
+}
+
+// Candlesticks: one filled path per color holding the bodies and wicks of its
+// candles as rectangles
+static void cpl_vector_candles(CPLVectorWriter* writer, const CPLCandles* candles, const int* viewport,
+                               const CPLViewTransform* view, const float* ndc_rect) {
+    int level;
+    size_t first, count;
+    if (!cpl_candles_view(candles, view, viewport, ndc_rect, &level, &first, &count)) return;
+
+    const CPLCandleLevel* chosen = &candles->levels[level];
+    for (int up = 1; up >= 0; up--) {
+        const Color* rgb = up ? &candles->up : &candles->down;
+        unsigned int color = cpl_vector_pack_color(rgb->r, rgb->g, rgb->b);
+        if (writer->pdf) {
+            cpl_vector_printf(writer, "q %.3f %.3f %.3f rg\n", ((color >> 16) & 0xFF) / 255.0f,
+                              ((color >> 8) & 0xFF) / 255.0f, (color & 0xFF) / 255.0f);
+        } else {
+            cpl_vector_printf(writer, "<path fill=\"#%06x\" d=\"", color);
+        }
+
+        for (size_t i = first; i < first + count; i++) {
+            const CPLCandle* candle = &chosen->candles[i];
+            if ((candle->close >= candle->open) != (up == 1)) continue;
+            float rects[8];
+            if (!cpl_candles_rects(candles, level, i, view, viewport, rects)) continue;
+
+            for (int r = 0; r < 2; r++) {
+                CPLVectorPoint corners[2];
+                cpl_vector_pixel(rects + 4 * r, viewport, &corners[0]);
+                cpl_vector_pixel(rects + 4 * r + 2, viewport, &corners[1]);
+                long xs[2] = { lrintf(corners[0].x * 100.0f), lrintf(corners[1].x * 100.0f) };
+                long ys[2] = { lrintf(corners[0].y * 100.0f), lrintf(corners[1].y * 100.0f) };
+                for (int k = 0; k < 4; k++) {
+                    long x = xs[(k == 1 || k == 2) ? 1 : 0];
+                    long y = ys[k >= 2 ? 1 : 0];
+                    if (writer->pdf) {
+                        cpl_vector_coords(writer, x, y);
+                        cpl_vector_puts(writer, k == 0 ? " m\n" : " l\n");
+                    } else {
+                        cpl_vector_puts(writer, k == 0 ? "M" : " ");
+                        cpl_vector_coords(writer, x, y);
+                    }
+                }
+                cpl_vector_puts(writer, writer->pdf ? "h\n" : "Z");
+            }
+        }
+        cpl_vector_puts(writer, writer->pdf ? "f\nQ\n" : "\"/>\n");
+    }
+}
+
+// Top-down RGBA image stretched over `rect` (x, y, width, height in figure
+// pixels): an inline PNG in SVG, an image XObject with a soft mask in PDF
+static void cpl_vector_image(CPLVectorWriter* writer, const unsigned char* pixels, int width, int height,
+                             const int* rect) {
+    size_t count = (size_t)width * (size_t)height;
+
+    if (!writer->pdf) {
+        unsigned char* png = NULL;
+        size_t size = cpl_encode_png(pixels, (size_t)width, (size_t)height, (ptrdiff_t)width * 4,
+                                     cpl_image_default_threads(), &png);
+        if (size == 0) {
+            cpl_vector_error("Failed to encode vector image");
+            return;
+        }
+        cpl_vector_printf(writer,
+                          "<image x=\"%d\" y=\"%d\" width=\"%d\" height=\"%d\" preserveAspectRatio=\"none\" "
+                          "style=\"image-rendering:pixelated\" xlink:href=\"data:image/png;base64,",
+                          rect[0], (int)writer->height - rect[1] - rect[3], rect[2], rect[3]);
+        cpl_vector_base64(writer, png, size);
+        cpl_vector_puts(writer, "\"/>\n");
+        free(png);
+        return;
+    }
+
+    if (writer->num_images >= writer->image_capacity) {
+        size_t capacity = writer->image_capacity == 0 ? 4 : writer->image_capacity * 2;
+        CPLVectorImage* images = (CPLVectorImage*)realloc(writer->images, capacity * sizeof(CPLVectorImage));
+        if (!images) {
+            cpl_vector_error("Failed to allocate vector images");
+            return;
+        }
+        writer->images = images;
+        writer->image_capacity = capacity;
+    }
+
+    // Split into color and alpha planes, deflated now so only the compressed
+    // data waits for the end of the file
+    unsigned char* rgb = (unsigned char*)malloc(count * 3);
+    unsigned char* alpha = (unsigned char*)malloc(count);
+    CPLVectorImage image;
+    memset(&image, 0, sizeof(image));
+    if (rgb && alpha) {
+        for (size_t i = 0; i < count; i++) {
+            memcpy(rgb + i * 3, pixels + i * 4, 3);
+            alpha[i] = pixels[i * 4 + 3];
+        }
+        image.rgb = cpl_vector_compress(rgb, count * 3, &image.rgb_size);
+        image.alpha = cpl_vector_compress(alpha, count, &image.alpha_size);
+    }
+    free(rgb);
+    free(alpha);
+    if (!image.rgb || !image.alpha) {
+        cpl_vector_error("Failed to compress vector image");
+        free(image.rgb);
+        free(image.alpha);
+        return;
+    }
+
+    image.width = width;
+    image.height = height;
+    cpl_vector_printf(writer, "q %d 0 0 %d %d %d cm /Im%zu Do Q\n", rect[2], rect[3], rect[0], rect[1],
+                      writer->num_images);
+    writer->images[writer->num_images++] = image;
+}
+
+static void cpl_vector_base64(CPLVectorWriter* writer, const unsigned char* data, size_t length) {
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    for (size_t i = 0; i < length; i += 3) {
+        cpl_vector_reserve(writer, 4);
+        char* out = writer->text + writer->length;
+        unsigned long triple = (unsigned long)data[i] << 16;
+        if (i + 1 < length) triple |= (unsigned long)data[i + 1] << 8;
+        if (i + 2 < length) triple |= data[i + 2];
+        out[0] = alphabet[(triple >> 18) & 63];
+        out[1] = alphabet[(triple >> 12) & 63];
+        out[2] = i + 1 < length ? alphabet[(triple >> 6) & 63] : '=';
+        out[3] = i + 2 < length ? alphabet[triple & 63] : '=';
+        writer->length += 4;
+    }
+}
+
+static unsigned char* cpl_vector_compress(const unsigned char* data, size_t length, size_t* compressed) {
+    uLongf size = compressBound((uLong)length);
+    unsigned char* out = (unsigned char*)malloc(size);
+    if (!out || compress2(out, &size, data, (uLong)length, Z_DEFAULT_COMPRESSION) != Z_OK) {
+        free(out);
+        return NULL;
+    }
+    *compressed = size;
+    return out;
+}
+
+// Vertices are NDC, or data offsets from `origin` (plus residuals in `low`, if
+// any) mapped through `view` when given
+static bool cpl_vector_point(const float* vertex, size_t index, const int* viewport, const CPLViewTransform* view,
+                             const double* origin, const float* low, CPLVectorPoint* point) {
+    float ndc[2] = { vertex[0], vertex[1] };
+    if (view) {
+        cpl_view_map(view, origin, vertex, low, ndc);
+    }
+    if (!cpl_is_finitef(ndc[0]) || !cpl_is_finitef(ndc[1])) return false;
+
+    cpl_vector_pixel(ndc, viewport, point);
+    point->color = cpl_vector_pack_color(vertex[2], vertex[3], vertex[4]);
+    point->index = index;
+    return true;
+}
+
+// NDC -> figure pixels, as glViewport maps them
+static void cpl_vector_pixel(const float* ndc, const int* viewport, CPLVectorPoint* point) {
+    float x = (float)viewport[0] + (ndc[0] + 1.0f) * 0.5f * (float)viewport[2];
+    float y = (float)viewport[1] + (ndc[1] + 1.0f) * 0.5f * (float)viewport[3];
+    point->x = x < -CPL_VECTOR_COORD_LIMIT ? -CPL_VECTOR_COORD_LIMIT : (x > CPL_VECTOR_COORD_LIMIT ? CPL_VECTOR_COORD_LIMIT : x);
+    point->y = y < -CPL_VECTOR_COORD_LIMIT ? -CPL_VECTOR_COORD_LIMIT : (y > CPL_VECTOR_COORD_LIMIT ? CPL_VECTOR_COORD_LIMIT : y);
+}
+
+// Path elements: a new element starts whenever the stroke color changes
+static void cpl_vector_begin_style(CPLVectorWriter* writer, CPLVectorPath* path, float width) {
+    cpl_vector_end_element(writer, path);
+    path->width = width;
+    path->has_last = false;
+}
+
+static void cpl_vector_move_to(CPLVectorPath* path, const CPLVectorPoint* point) {
+    path->last = *point;
+    path->has_last = true;
+    path->pending_move = true;
+}
+
+static void cpl_vector_line_to(CPLVectorWriter* writer, CPLVectorPath* path, const CPLVectorPoint* point) {
+    if (!path->has_last) {
+        cpl_vector_move_to(path, point);
+        return;
+    }
+
+    long x = lrintf(point->x * 100.0f);
+    long y = lrintf(point->y * 100.0f);
+
+    // Segments take the color of their start vertex
+    unsigned int color = path->last.color;
+    if (!path->open || path->color != color) {
+        cpl_vector_end_element(writer, path);
+        path->open = true;
+        path->color = color;
+        path->pending_move = true;
+
+        char width[32];
+        *cpl_vector_format(width, lrintf(path->width * 100.0f)) = '\0';
+        if (writer->pdf) {
+            cpl_vector_printf(writer, "%s w %.3f %.3f %.3f RG\n", width,
+                              ((color >> 16) & 0xFF) / 255.0f, ((color >> 8) & 0xFF) / 255.0f, (color & 0xFF) / 255.0f);
+        } else {
+            cpl_vector_printf(writer, "<path stroke=\"#%06x\" stroke-width=\"%s\" d=\"", color, width);
+        }
+    }
+
+    if (path->pending_move) {
+        path->last_x = lrintf(path->last.x * 100.0f);
+        path->last_y = lrintf(path->last.y * 100.0f);
+        cpl_vector_puts(writer, writer->pdf ? "" : "M");
+        cpl_vector_coords(writer, path->last_x, path->last_y);
+        cpl_vector_puts(writer, writer->pdf ? " m\n" : "");
+        path->pending_move = false;
+    } else if (x == path->last_x && y == path->last_y) {
+        // Below output precision
+        path->last = *point;
+        return;
+    }
+
+    // SVG: coordinate pairs after a moveto are implicit linetos
+    cpl_vector_puts(writer, writer->pdf ? "" : " ");
+    cpl_vector_coords(writer, x, y);
+    cpl_vector_puts(writer, writer->pdf ? " l\n" : "");
+
+    path->last = *point;
+    path->last_x = x;
+    path->last_y = y;
+}
+
+static void cpl_vector_end_element(CPLVectorWriter* writer, CPLVectorPath* path) {
+    if (!path->open) return;
+    cpl_vector_puts(writer, writer->pdf ? "S\n" : "\"/>\n");
+    path->open = false;
+}
+
+// Number formatting
+static void cpl_vector_coords(CPLVectorWriter* writer, long x, long y) {
+    // SVG y grows downwards
+    if (!writer->pdf) {
+        y = lrintf(writer->height * 100.0f) - y;
+    }
+
+    cpl_vector_reserve(writer, 48);
+    char* out = writer->text + writer->length;
+    out = cpl_vector_format(out, x);
+    *out++ = ' ';
+    out = cpl_vector_format(out, y);
+    writer->length = (size_t)(out - writer->text);
+}
+
+static char* cpl_vector_format(char* out, long hundredths) {
+    // Fixed point with at most two decimals and no trailing zeros; much cheaper
+    // than printf's %g and exact at the precision that is written
+    unsigned long value = hundredths < 0 ? (unsigned long)(-hundredths) : (unsigned long)hundredths;
+    if (hundredths < 0) *out++ = '-';
+
+    unsigned long whole = value / 100;
+    unsigned int fraction = (unsigned int)(value % 100);
+
+    char digits[24];
+    int n = 0;
+    do {
+        digits[n++] = (char)('0' + whole % 10);
+        whole /= 10;
+    } while (whole);
+    while (n) *out++ = digits[--n];
+
+    if (fraction) {
+        *out++ = '.';
+        *out++ = (char)('0' + fraction / 10);
+        if (fraction % 10) *out++ = (char)('0' + fraction % 10);
+    }
+    return out;
+}
+
+static unsigned int cpl_vector_pack_color(float r, float g, float b) {
+    float channels[3] = { r, g, b };
+    unsigned int packed = 0;
+    for (int i = 0; i < 3; i++) {
+        float c = channels[i] < 0.0f ? 0.0f : (channels[i] > 1.0f ? 1.0f : channels[i]);
+        packed = (packed << 8) | (unsigned int)(c * 255.0f + 0.5f);
+    }
+    return packed;
+}
+
+// Buffered writer
+static bool cpl_vector_open(CPLVectorWriter* writer, const char* filename, bool pdf, float height) {
+    memset(writer, 0, sizeof(*writer));
+    writer->pdf = pdf;
+    writer->height = height;
+    writer->file = fopen(filename, "wb");
+    if (!writer->file) {
+        cpl_vector_error("Failed to open vector output file");
+        return false;
+    }
+    return true;
+}
+
+static bool cpl_vector_close(CPLVectorWriter* writer) {
+    for (size_t i = 0; i < writer->num_images; i++) {
+        free(writer->images[i].rgb);
+        free(writer->images[i].alpha);
+    }
+    free(writer->images);
+
+    cpl_vector_flush(writer, Z_NO_FLUSH);
+    if (fclose(writer->file) != 0) writer->failed = true;
+    if (writer->failed) {
+        cpl_vector_error("Failed to write vector output");
+    }
+    return !writer->failed;
+}
+
+static void cpl_vector_puts(CPLVectorWriter* writer, const char* text) {
+    size_t length = strlen(text);
+    while (length > 0) {
+        cpl_vector_reserve(writer, 1);
+        size_t chunk = CPL_VECTOR_BUFFER_SIZE - writer->length;
+        if (chunk > length) chunk = length;
+        memcpy(writer->text + writer->length, text, chunk);
+        writer->length += chunk;
+        text += chunk;
+        length -= chunk;
+    }
+}
+
+static void cpl_vector_printf(CPLVectorWriter* writer, const char* format, ...) {
+    char line[512];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    if (length < 0 || (size_t)length >= sizeof(line)) {
+        writer->failed = true;
+        return;
+    }
+    cpl_vector_puts(writer, line);
+}
+
+static void cpl_vector_reserve(CPLVectorWriter* writer, size_t bytes) {
+    if (writer->length + bytes > CPL_VECTOR_BUFFER_SIZE) {
+        cpl_vector_flush(writer, Z_NO_FLUSH);
+    }
+}
+
+static void cpl_vector_flush(CPLVectorWriter* writer, int mode) {
+    if (!writer->deflating) {
+        cpl_vector_raw(writer, writer->text, writer->length);
+        writer->length = 0;
+        return;
+    }
+
+    unsigned char chunk[16 * 1024];
+    writer->zstream.next_in = (Bytef*)writer->text;
+    writer->zstream.avail_in = (uInt)writer->length;
+    do {
+        writer->zstream.next_out = chunk;
+        writer->zstream.avail_out = sizeof(chunk);
+        if (deflate(&writer->zstream, mode) == Z_STREAM_ERROR) {
+            writer->failed = true;
+            break;
+        }
+        cpl_vector_raw(writer, chunk, sizeof(chunk) - writer->zstream.avail_out);
+    } while (writer->zstream.avail_out == 0);
+    writer->length = 0;
+}
+
+static void cpl_vector_raw(CPLVectorWriter* writer, const void* data, size_t length) {
+    if (length == 0 || writer->failed) return;
+    if (fwrite(data, 1, length, writer->file) != length) {
+        writer->failed = true;
+        return;
+    }
+    writer->offset += length;
+}
+
+static bool cpl_vector_begin_deflate(CPLVectorWriter* writer) {
+    cpl_vector_flush(writer, Z_NO_FLUSH);
+    memset(&writer->zstream, 0, sizeof(writer->zstream));
+    if (deflateInit(&writer->zstream, Z_DEFAULT_COMPRESSION) != Z_OK) {
+        writer->failed = true;
+        return false;
+    }
+    writer->deflating = true;
+    return true;
+}
+
+static void cpl_vector_end_deflate(CPLVectorWriter* writer) {
+    cpl_vector_flush(writer, Z_FINISH);
+    deflateEnd(&writer->zstream);
+    writer->deflating = false;
+}
+
+static void cpl_vector_error(const char* message) {
+    fprintf(stderr, "CPlotLib Error: %s\n", message);
+}
@@ -0,0 +1,18 @@
+#ifndef CPL_VECTOR_H
+#define CPL_VECTOR_H
+
+#include <stdbool.h>
+
+// Forward declaration
+struct CPLFigure;
+
+// Vector exporters for publication output.
+// Both walk the figure's plots directly (no rendering) and stream through a
+// fixed-size buffered writer, so memory use does not grow with series length.
+// Line strips are decimated per fraction of a pixel column (first/min/max/last
+// of each run), which is lossless at the figure's resolution. Coordinates are
+// in figure pixels; PDF pages are scaled to 96 dpi.
+bool cpl_write_svg(const struct CPLFigure* fig, const char* filename);
+bool cpl_write_pdf(const struct CPLFigure* fig, const char* filename);
+
+#endif // CPL_VECTOR_H
@@ -0,0 +1,142 @@
+#include "CPLWaterfall.h"
+#include "CPLUtils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+// Internal function declarations
+static double cpl_waterfall_fraction(const CPLWaterfall* waterfall, const CPLViewTransform* view, int axis,
+                                     double value);
+static void cpl_waterfall_error(const char* message);
+
+// Constants
+#define CPL_WATERFALL_COLORMAP_ENTRIES 256
+#define CPL_TWO_PI 6.283185307179586
+
+bool cpl_waterfall_cell(const CPLWaterfall* waterfall, const CPLViewTransform* view, const double* data,
+                        size_t* bin, size_t* age) {
+    double u = cpl_waterfall_fraction(waterfall, view, 0, data[0]);
+    double v = cpl_waterfall_fraction(waterfall, view, 1, data[1]);
+    if (!(u >= 0.0 && u < 1.0 && v >= 0.0 && v < 1.0)) return false;
+
+    // The newest row is at the top of the image
+    *bin = (size_t)(u * (double)waterfall->bins);
+    *age = waterfall->rows - 1 - (size_t)(v * (double)waterfall->rows);
+    if (*bin >= waterfall->bins) *bin = waterfall->bins - 1;
+    return *age < waterfall->filled;
+}
+
+bool cpl_waterfall_colors(const CPLPlot* plot, const int* viewport, const int* box, const int* cells,
+                          unsigned char* pixels, ptrdiff_t stride) {
+    const CPLWaterfall* waterfall = plot && plot->data ? plot->data->waterfall : NULL;
+    if (!waterfall || cells[2] <= 0 || cells[3] <= 0) return false;
+
+    CPLViewTransform view;
+    cpl_view_transform(plot, viewport, &view);
+
+    unsigned char* lut = (unsigned char*)malloc(CPL_WATERFALL_COLORMAP_ENTRIES * 3);
+    size_t* columns = (size_t*)malloc((size_t)cells[2] * sizeof(size_t));
+    size_t* ages = (size_t*)malloc((size_t)cells[3] * sizeof(size_t));
+    if (!lut || !columns || !ages) {
+        cpl_waterfall_error("Failed to allocate waterfall image");
+        free(lut);
+        free(columns);
+        free(ages);
+        return false;
+    }
+    for (int i = 0; i < CPL_WATERFALL_COLORMAP_ENTRIES; i++) {
+        Color c = cpl_colormap_color(plot->colormap, (float)i / (float)(CPL_WATERFALL_COLORMAP_ENTRIES - 1));
+        lut[i * 3 + 0] = (unsigned char)(c.r * 255.0f + 0.5f);
+        lut[i * 3 + 1] = (unsigned char)(c.g * 255.0f + 0.5f);
+        lut[i * 3 + 2] = (unsigned char)(c.b * 255.0f + 0.5f);
+    }
+
+    // Pixel centres in NDC of the viewport
+    double ndc_scale[2], ndc_shift[2];
+    for (int axis = 0; axis < 2; axis++) {
+        ndc_scale[axis] = 2.0 / (double)viewport[2 + axis];
+        ndc_shift[axis] = (double)(box[axis] + cells[axis] - viewport[axis]) + 0.5;
+    }
+
+    // Cartesian axes are independent: bins per column and rows per row of pixels
+    if (!view.polar) {
+        for (int x = 0; x < cells[2]; x++) {
+            double ndc[2] = { (ndc_shift[0] + x) * ndc_scale[0] - 1.0, 0.0 };
+            double data[2];
+            cpl_view_unmap(&view, ndc, data);
+            double u = cpl_waterfall_fraction(waterfall, &view, 0, data[0]);
+            columns[x] = u >= 0.0 && u < 1.0 ? (size_t)(u * (double)waterfall->bins) : SIZE_MAX;
+            if (columns[x] != SIZE_MAX && columns[x] >= waterfall->bins) columns[x] = waterfall->bins - 1;
+        }
+        for (int y = 0; y < cells[3]; y++) {
+            double ndc[2] = { 0.0, (ndc_shift[1] + y) * ndc_scale[1] - 1.0 };
+            double data[2];
+            cpl_view_unmap(&view, ndc, data);
+            double v = cpl_waterfall_fraction(waterfall, &view, 1, data[1]);
+            size_t age = v >= 0.0 && v < 1.0 ? waterfall->rows - 1 - (size_t)(v * (double)waterfall->rows) : SIZE_MAX;
+            ages[y] = age < waterfall->filled ? age : SIZE_MAX;
+        }
+    }
+
+    float span = waterfall->levels[1] - waterfall->levels[0];
+    for (int y = 0; y < cells[3]; y++) {
+        unsigned char* out = pixels + (ptrdiff_t)y * stride;
+        for (int x = 0; x < cells[2]; x++, out += 4) {
+            size_t bin = SIZE_MAX, age = SIZE_MAX;
+            if (view.polar) {
+                double ndc[2] = { (ndc_shift[0] + x) * ndc_scale[0] - 1.0, (ndc_shift[1] + y) * ndc_scale[1] - 1.0 };
+                double data[2];
+                cpl_view_unmap(&view, ndc, data);
+                if (!cpl_waterfall_cell(waterfall, &view, data, &bin, &age)) bin = SIZE_MAX;
+            } else {
+                bin = columns[x];
+                age = ages[y];
+            }
+            if (bin == SIZE_MAX || age == SIZE_MAX) {
+                memset(out, 0, 4);
+                continue;
+            }
+
+            size_t ring = (waterfall->newest + waterfall->rows - age) % waterfall->rows;
+            float value = waterfall->values[ring * waterfall->bins + bin];
+            if (waterfall->decibels) value = 10.0f * log10f(value);
+            float t = (value - waterfall->levels[0]) / span;
+            if (cpl_is_nanf(t)) {
+                memset(out, 0, 4);
+                continue;
+            }
+            t = t > 0.0f ? (t < 1.0f ? t : 1.0f) : 0.0f;
+            const unsigned char* rgb = lut + (int)(t * (float)(CPL_WATERFALL_COLORMAP_ENTRIES - 1) + 0.5f) * 3;
+            out[0] = rgb[0];
+            out[1] = rgb[1];
+            out[2] = rgb[2];
+            out[3] = 255;
+        }
+    }
+
+    free(lut);
+    free(columns);
+    free(ages);
+    return true;
+}
+
+// Internal helper functions
+// Position of a data coordinate across the image extent of an axis ([0, 1)
+// inside); polar angles wrap into the turn starting at x_min
+static double cpl_waterfall_fraction(const CPLWaterfall* waterfall, const CPLViewTransform* view, int axis,
+                                     double value) {
+    const double* range = axis == 0 ? waterfall->x_range : waterfall->y_range;
+    double offset = value - range[0];
+    if (view->polar && axis == 0) {
+        offset = fmod(offset, CPL_TWO_PI);
+        if (offset < 0.0) offset += CPL_TWO_PI;
+    }
+    return offset / (range[1] - range[0]);
+}
+
+static void cpl_waterfall_error(const char* message) {
+    fprintf(stderr, "CPlotLib Error: %s\n", message);
+}
@@ -0,0 +1,26 @@
+#ifndef CPL_WATERFALL_H
+#define CPL_WATERFALL_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include "CPLPlot.h"
+#include "CPLTransform.h"
+
+// Waterfall images are drawn per pixel of the plot box: each pixel is mapped
+// back to data coordinates, which pick a bin and a row of the ring. The GPU
+// does this in the waterfall fragment shader; the CPU backends call
+// cpl_waterfall_colors, which follows the same steps.
+
+// Bin and row age (0: newest row) at data coordinates; false outside the image
+// or in rows not received yet. Polar x is an angle taken modulo 2 pi from x_min.
+bool cpl_waterfall_cell(const CPLWaterfall* waterfall, const CPLViewTransform* view, const double* data,
+                        size_t* bin, size_t* age);
+
+// CPU backends: RGBA8 colors of the waterfall of `plot` drawn into `viewport`
+// (canvas pixels) for the pixels `cells` (x, y, width, height, relative to the
+// plot box `box`), row y written at pixels + y * stride (bottom-up). Pixels
+// outside the image are transparent.
+bool cpl_waterfall_colors(const CPLPlot* plot, const int* viewport, const int* box, const int* cells,
+                          unsigned char* pixels, ptrdiff_t stride);
+
+#endif // CPL_WATERFALL_H
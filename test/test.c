@@ -1,12 +1,1473 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include "CPlotLib.h"
+#include <GL/glew.h>
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <zlib.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// Display-free checks run on software figures, and on headless figures when
+// an EGL context is available; `--headless` skips the windowed tests at the end
+static int failures = 0;
+static char temp_dir[] = "/tmp/cplotlib-test-XXXXXX";
+
+#define CHECK(condition, message)                                                   \
+    do {                                                                            \
+        if (!(condition)) {                                                         \
+            fprintf(stderr, "FAILED: %s (%s:%d)\n", message, __FILE__, __LINE__);   \
+            failures++;                                                             \
+        }                                                                           \
+    } while (0)
+
+// Test helpers
+static unsigned char* render_pixels(CPLFigure* fig) {
+    unsigned char* pixels = malloc(fig->width * fig->height * 4);
+    if (pixels && !cpl_render_offscreen(fig, pixels)) {
+        free(pixels);
+        return NULL;
+    }
+    return pixels;
+}
+
+static void temp_path(char* path, size_t size, const char* name) {
+    snprintf(path, size, "%s/%s", temp_dir, name);
+}
+
+// The contents are NUL-terminated, so text formats can be searched as strings
+static unsigned char* read_file(const char* path, size_t* size) {
+    FILE* file = fopen(path, "rb");
+    if (!file) return NULL;
+    fseek(file, 0, SEEK_END);
+    long length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    unsigned char* data = length > 0 ? malloc((size_t)length + 1) : NULL;
+    if (data && fread(data, 1, (size_t)length, file) != (size_t)length) {
+        free(data);
+        data = NULL;
+    }
+    if (data) data[length] = '\0';
+    fclose(file);
+    *size = data ? (size_t)length : 0;
+    return data;
+}
+
+static size_t read_u32(const unsigned char* p) {
+    return ((size_t)p[0] << 24) | ((size_t)p[1] << 16) | ((size_t)p[2] << 8) | (size_t)p[3];
+}
+
+// Decodes an 8-bit RGBA PNG into top-down rows
+static unsigned char* decode_png(const unsigned char* data, size_t size, size_t* width, size_t* height) {
+    static const unsigned char signature[8] = { 137, 'P', 'N', 'G', 13, 10, 26, 10 };
+    if (size < 8 || memcmp(data, signature, 8) != 0) return NULL;
+
+    unsigned char* idat = NULL;
+    size_t idat_size = 0;
+    *width = *height = 0;
+    for (size_t at = 8; at + 12 <= size;) {
+        size_t length = read_u32(data + at);
+        const unsigned char* type = data + at + 4;
+        const unsigned char* body = data + at + 8;
+        if (at + 12 + length > size) break;
+        if (memcmp(type, "IHDR", 4) == 0) {
+            *width = read_u32(body);
+            *height = read_u32(body + 4);
+            if (body[8] != 8 || body[9] != 6) break;
+        } else if (memcmp(type, "IDAT", 4) == 0) {
+            unsigned char* grown = realloc(idat, idat_size + length);
+            if (!grown) break;
+            idat = grown;
+            memcpy(idat + idat_size, body, length);
+            idat_size += length;
+        }
+        at += 12 + length;
+    }
+
+    size_t row_bytes = *width * 4;
+    uLongf raw_size = (uLongf)((row_bytes + 1) * *height);
+    unsigned char* raw = raw_size ? malloc(raw_size) : NULL;
+    unsigned char* pixels = raw_size ? malloc(row_bytes * *height) : NULL;
+    bool ok = idat && raw && pixels && uncompress(raw, &raw_size, idat, (uLong)idat_size) == Z_OK &&
+              raw_size == (row_bytes + 1) * *height;
+    free(idat);
+
+    // Undo the per-row filters
+    for (size_t y = 0; ok && y < *height; y++) {
+        unsigned char filter = raw[y * (row_bytes + 1)];
+        const unsigned char* in = raw + y * (row_bytes + 1) + 1;
+        unsigned char* out = pixels + y * row_bytes;
+        const unsigned char* up = y > 0 ? out - row_bytes : NULL;
+        for (size_t i = 0; i < row_bytes; i++) {
+            int a = i >= 4 ? out[i - 4] : 0;
+            int b = up ? up[i] : 0;
+            int c = up && i >= 4 ? up[i - 4] : 0;
+            int predictor = 0;
+            if (filter == 1) predictor = a;
+            else if (filter == 2) predictor = b;
+            else if (filter == 3) predictor = (a + b) / 2;
+            else if (filter == 4) {
+                int p = a + b - c;
+                int pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+                predictor = pa <= pb && pa <= pc ? a : (pb <= pc ? b : c);
+            } else if (filter != 0) {
+                ok = false;
+            }
+            out[i] = (unsigned char)(in[i] + predictor);
+        }
+    }
+    free(raw);
+    if (!ok) {
+        free(pixels);
+        return NULL;
+    }
+    return pixels;
+}
+
+// Decodes a 4-channel QOI image into top-down rows
+static unsigned char* decode_qoi(const unsigned char* data, size_t size, size_t* width, size_t* height) {
+    if (size < 22 || memcmp(data, "qoif", 4) != 0 || data[12] != 4) return NULL;
+    *width = read_u32(data + 4);
+    *height = read_u32(data + 8);
+    size_t count = *width * *height;
+    unsigned char* pixels = count ? malloc(count * 4) : NULL;
+    if (!pixels) return NULL;
+
+    unsigned char index[64][4];
+    memset(index, 0, sizeof(index));
+    unsigned char px[4] = { 0, 0, 0, 255 };
+    size_t at = 14, run = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (run > 0) {
+            run--;
+        } else if (at < size - 8) {
+            unsigned char op = data[at++];
+            if (op == 0xFE) {
+                memcpy(px, data + at, 3);
+                at += 3;
+            } else if (op == 0xFF) {
+                memcpy(px, data + at, 4);
+                at += 4;
+            } else if ((op & 0xC0) == 0x00) {
+                memcpy(px, index[op], 4);
+            } else if ((op & 0xC0) == 0x40) {
+                px[0] += ((op >> 4) & 3) - 2;
+                px[1] += ((op >> 2) & 3) - 2;
+                px[2] += (op & 3) - 2;
+            } else if ((op & 0xC0) == 0x80) {
+                int dg = (op & 0x3F) - 32;
+                unsigned char next = data[at++];
+                px[0] += dg - 8 + ((next >> 4) & 0x0F);
+                px[1] += dg;
+                px[2] += dg - 8 + (next & 0x0F);
+            } else {
+                run = op & 0x3F;
+            }
+            memcpy(index[(px[0] * 3 + px[1] * 5 + px[2] * 7 + px[3] * 11) % 64], px, 4);
+        }
+        memcpy(pixels + i * 4, px, 4);
+    }
+    return pixels;
+}
+
+// Pixels where `image` (top-down) differs from the bottom-up readback `pixels`
+static size_t readback_differences(const unsigned char* image, const unsigned char* pixels, size_t width,
+                                   size_t height) {
+    size_t differing = 0;
+    for (size_t y = 0; y < height; y++) {
+        const unsigned char* row = pixels + (height - 1 - y) * width * 4;
+        for (size_t x = 0; x < width; x++) {
+            if (memcmp(image + (y * width + x) * 4, row + x * 4, 4) != 0) differing++;
+        }
+    }
+    return differing;
+}
+
+static bool matches_readback(const unsigned char* image, const unsigned char* pixels, size_t width, size_t height) {
+    return readback_differences(image, pixels, width, height) == 0;
+}
+
+static size_t count_pixels(const unsigned char* pixels, size_t width, const int* rect, bool (*match)(const unsigned char*)) {
+    size_t count = 0;
+    for (int y = rect[1]; y < rect[1] + rect[3]; y++) {
+        for (int x = rect[0]; x < rect[0] + rect[2]; x++) {
+            if (match(pixels + ((size_t)y * width + (size_t)x) * 4)) count++;
+        }
+    }
+    return count;
+}
+
+static bool is_red(const unsigned char* px) {
+    return px[0] > 160 && px[1] < 100 && px[2] < 100;
+}
+
+static bool is_not_white(const unsigned char* px) {
+    return px[0] < 240 || px[1] < 240 || px[2] < 240;
+}
+
+static size_t differing_pixels(const unsigned char* a, const unsigned char* b, size_t count) {
+    size_t differing = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (memcmp(a + i * 4, b + i * 4, 4) != 0) differing++;
+    }
+    return differing;
+}
+
+// Figure pixel (from the top-left) of a data point on a single linear plot
+static void data_to_screen(const CPLPlot* plot, double x, double y, double* screen) {
+    const CPLFigure* fig = plot->figure;
+    double margin = plot->data->margin;
+    double tx = (x - plot->x_range[0]) / (plot->x_range[1] - plot->x_range[0]);
+    double ty = (y - plot->y_range[0]) / (plot->y_range[1] - plot->y_range[0]);
+    screen[0] = (0.5 * margin + (1.0 - margin) * tx) * (double)fig->width;
+    screen[1] = (double)fig->height - (0.5 * margin + (1.0 - margin) * ty) * (double)fig->height;
+}
+
+static CPLFigure* software_line_figure(size_t width, size_t height, size_t n_points) {
+    CPLFigure* fig = cpl_create_software_figure(width, height);
+    if (!fig) return NULL;
+    double* x = malloc(n_points * sizeof(double));
+    double* y = malloc(n_points * sizeof(double));
+    if (x && y) {
+        for (size_t i = 0; i < n_points; i++) {
+            x[i] = 2.0 * M_PI * ((double)i / (n_points - 1));
+            y[i] = sin(3.0 * x[i]) + 0.2 * sin(57.0 * x[i]);
+        }
+        CPLPlot* plot = cpl_add_plot(fig);
+        cpl_set_x_range(plot, 0.0, 2.0 * M_PI);
+        cpl_set_y_range(plot, -1.5, 1.5);
+        cpl_plot(plot, x, y, n_points, COLOR_RED, NULL, NULL);
+    }
+    free(x);
+    free(y);
+    return fig;
+}
+
+// Headless (EGL) figures, or NULL when this machine has no offscreen GL
+static bool headless_checked = false;
+static bool headless_available = false;
+
+static CPLFigure* headless_figure(size_t width, size_t height) {
+    if (headless_checked && !headless_available) return NULL;
+    CPLFigure* fig = cpl_create_headless_figure(width, height);
+    headless_checked = true;
+    headless_available = fig != NULL;
+    return fig;
+}
+
+// Image encoders and cpl_save_figure
+static void test_image_output(void) {
+    printf("Test: PNG and QOI round-trips...\n");
+    CPLFigure* fig = software_line_figure(321, 203, 2000);
+    unsigned char* pixels = fig ? render_pixels(fig) : NULL;
+    CHECK(pixels != NULL, "software figure renders offscreen");
+    if (!pixels) {
+        cpl_free_figure(fig);
+        return;
+    }
+
+    size_t width = fig->width, height = fig->height;
+    ptrdiff_t stride = (ptrdiff_t)width * 4;
+    const unsigned char* top_row = pixels + (height - 1) * width * 4;
+    for (size_t threads = 1; threads <= 4; threads += 3) {
+        unsigned char* encoded = NULL;
+        size_t size = cpl_encode_png(top_row, width, height, -stride, threads, &encoded);
+        size_t w, h;
+        unsigned char* image = size ? decode_png(encoded, size, &w, &h) : NULL;
+        CHECK(image && w == width && h == height, "PNG decodes to the figure size");
+        CHECK(image && matches_readback(image, pixels, width, height), "PNG round-trips the pixels");
+        free(image);
+        free(encoded);
+    }
+
+    unsigned char* encoded = NULL;
+    size_t size = cpl_encode_qoi(top_row, width, height, -stride, &encoded);
+    size_t w, h;
+    unsigned char* image = size ? decode_qoi(encoded, size, &w, &h) : NULL;
+    CHECK(image && w == width && h == height, "QOI decodes to the figure size");
+    CHECK(image && matches_readback(image, pixels, width, height), "QOI round-trips the pixels");
+    free(image);
+    free(encoded);
+
+    // Files written by cpl_save_figure hold the same frame
+    const char* names[2] = { "figure.png", "figure.qoi" };
+    for (int i = 0; i < 2; i++) {
+        char path[256];
+        temp_path(path, sizeof(path), names[i]);
+        cpl_save_figure(fig, path);
+        unsigned char* file = read_file(path, &size);
+        image = !file ? NULL : (i == 0 ? decode_png(file, size, &w, &h) : decode_qoi(file, size, &w, &h));
+        CHECK(image && w == width && h == height && matches_readback(image, pixels, width, height),
+              "cpl_save_figure writes the rendered frame");
+        free(image);
+        free(file);
+        unlink(path);
+    }
+
+    free(pixels);
+    cpl_free_figure(fig);
+}
+
+// Software rasterizer
+static void test_software_raster(void) {
+    printf("Test: Software rasterizer...\n");
+    CPLFigure* fig = cpl_create_software_figure(200, 100);
+    CHECK(fig != NULL, "software figure is created");
+    if (!fig) return;
+
+    // A horizontal red line through the middle of the plot box
+    CPLPlot* plot = cpl_add_plot(fig);
+    cpl_show_grid(plot, false);
+    cpl_set_x_range(plot, -1.0, 1.0);
+    cpl_set_y_range(plot, -1.0, 1.0);
+    double x[2] = { -1.0, 1.0 }, y[2] = { 0.0, 0.0 };
+    cpl_plot(plot, x, y, 2, COLOR_RED, NULL, NULL);
+
+    unsigned char* pixels = render_pixels(fig);
+    CHECK(pixels != NULL, "software figure renders offscreen");
+    if (pixels) {
+        int middle[4] = { 20, 48, 160, 4 };
+        int above[4] = { 20, 60, 160, 20 };
+        CHECK(count_pixels(pixels, 200, middle, is_red) >= 160, "line covers the middle rows");
+        CHECK(count_pixels(pixels, 200, above, is_red) == 0, "no line pixels away from the line");
+    }
+    free(pixels);
+    cpl_free_figure(fig);
+
+    // Segments touching NaN or infinite samples are left out
+    fig = cpl_create_software_figure(200, 100);
+    if (!fig) return;
+    plot = cpl_add_plot(fig);
+    cpl_set_x_range(plot, -1.0, 1.0);
+    cpl_set_y_range(plot, -1.0, 1.0);
+    double gaps_x[5] = { -1.0, -0.5, 0.0, 0.5, 1.0 }, gaps_y[5] = { 0.0, NAN, 0.0, INFINITY, 0.0 };
+    cpl_plot(plot, gaps_x, gaps_y, 5, COLOR_RED, NULL, NULL);
+    pixels = render_pixels(fig);
+    if (pixels) {
+        int box[4] = { 0, 0, 200, 100 };
+        CHECK(count_pixels(pixels, 200, box, is_red) == 0, "non-finite samples draw nothing");
+    }
+    free(pixels);
+    cpl_free_figure(fig);
+
+    // Small multiples draw their series inside their own tiles, and every frame
+    fig = cpl_create_software_figure(200, 100);
+    if (!fig) return;
+    plot = cpl_add_small_multiples(fig, 2, 2, 64);
+    CHECK(plot != NULL, "software figures hold small multiples");
+    if (plot) {
+        double series[200];
+        for (size_t i = 0; i < 200; i++) series[i] = sin(i * 0.1);
+        cpl_set_small_multiple(plot, 0, series, 200, COLOR_RED);
+        pixels = render_pixels(fig);
+        if (pixels) {
+            int first[4] = { 8, 56, 84, 36 }, others[4] = { 100, 0, 100, 100 }, frame[4] = { 100, 0, 100, 50 };
+            CHECK(count_pixels(pixels, 200, first, is_red) > 80, "the series is drawn in its tile");
+            CHECK(count_pixels(pixels, 200, others, is_red) == 0, "other tiles stay empty");
+            CHECK(count_pixels(pixels, 200, frame, is_not_white) > 100, "empty tiles keep their frames");
+        }
+        free(pixels);
+    }
+    cpl_free_figure(fig);
+}
+
+// Vector export with per-column decimation
+static void test_vector_export(void) {
+    printf("Test: SVG and PDF export...\n");
+    CPLFigure* fig = software_line_figure(800, 600, 1000000);
+    if (!fig) return;
+
+    char path[256];
+    temp_path(path, sizeof(path), "figure.svg");
+    cpl_save_figure(fig, path);
+    size_t size;
+    unsigned char* file = read_file(path, &size);
+    CHECK(file && size > 5 && memcmp(file, "<?xml", 5) == 0, "SVG is written");
+    CHECK(file && strstr((const char*)file + size - 16, "</svg>") != NULL, "SVG is complete");
+    CHECK(size < 2000000, "a million samples decimate to a few points per pixel column");
+    free(file);
+    unlink(path);
+
+    temp_path(path, sizeof(path), "figure.pdf");
+    cpl_save_figure(fig, path);
+    file = read_file(path, &size);
+    CHECK(file && size > 5 && memcmp(file, "%PDF-", 5) == 0, "PDF is written");
+    CHECK(file && size > 6 && memcmp(file + size - 6, "%%EOF\n", 6) == 0, "PDF is complete");
+    free(file);
+    unlink(path);
+
+    cpl_free_figure(fig);
+
+    // Small multiples: each series is a path clipped to its tile
+    fig = cpl_create_software_figure(200, 100);
+    CPLPlot* plot = fig ? cpl_add_small_multiples(fig, 2, 2, 64) : NULL;
+    if (plot) {
+        double series[200];
+        for (size_t i = 0; i < 200; i++) series[i] = sin(i * 0.1);
+        cpl_set_small_multiple(plot, 0, series, 200, COLOR_RED);
+        temp_path(path, sizeof(path), "multiples.svg");
+        cpl_save_figure(fig, path);
+        file = read_file(path, &size);
+        const char* tile = file ? strstr((const char*)file, "<g clip-path=\"url(#tile0_0)\">\n") : NULL;
+        CHECK(tile && strncmp(strchr(tile, '\n') + 1, "<path stroke=\"#ff0000\"", 22) == 0,
+              "small multiple series are exported in their tiles");
+        CHECK(file && !strstr((const char*)file, "#tile0_1"), "empty tiles export no series");
+        free(file);
+        unlink(path);
+    }
+    cpl_free_figure(fig);
+}
+
+// Tiled export: bands of a large software render match one frame
+static void test_tiled_export(void) {
+    printf("Test: Tiled export...\n");
+    CPLFigure* small = software_line_figure(300, 200, 5000);
+    CPLFigure* large = software_line_figure(700, 900, 5000);
+    unsigned char* pixels = large ? render_pixels(large) : NULL;
+    CHECK(small && pixels, "software figures render");
+    if (small && pixels) {
+        char path[256];
+        temp_path(path, sizeof(path), "tiled.png");
+        CHECK(cpl_save_figure_tiled(small, path, 700, 900), "tiled export succeeds");
+        size_t size, w, h;
+        unsigned char* file = read_file(path, &size);
+        unsigned char* image = file ? decode_png(file, size, &w, &h) : NULL;
+        CHECK(image && w == 700 && h == 900, "tiled export has the requested size");
+        // Bands are rasterized relative to their own origin; rounding may move a few edge pixels
+        CHECK(image && readback_differences(image, pixels, 700, 900) < 700 * 900 / 1000,
+              "tiled bands match a single render");
+        free(image);
+        free(file);
+        unlink(path);
+    }
+    free(pixels);
+    cpl_free_figure(small);
+    cpl_free_figure(large);
+}
+
+// Visible-range culling: zooming into a sorted series draws the
+// same pixels as plotting only the samples around the view
+static void test_culling(void) {
+    printf("Test: Visible-range culling...\n");
+    const size_t n = 200000;
+    double* x = malloc(n * sizeof(double));
+    double* y = malloc(n * sizeof(double));
+    if (!x || !y) {
+        free(x);
+        free(y);
+        return;
+    }
+    for (size_t i = 0; i < n; i++) {
+        x[i] = (double)i / (double)n;
+        y[i] = sin(x[i] * 400.0);
+    }
+
+    unsigned char* pixels[2] = { NULL, NULL };
+    for (int subset = 0; subset < 2; subset++) {
+        CPLFigure* fig = cpl_create_software_figure(400, 300);
+        if (!fig) break;
+        CPLPlot* plot = cpl_add_plot(fig);
+        cpl_set_x_range(plot, 0.4, 0.45);
+        cpl_set_y_range(plot, -1.2, 1.2);
+        size_t first = subset ? (size_t)(0.39 * n) : 0;
+        size_t count = subset ? (size_t)(0.07 * n) : n;
+        cpl_plot(plot, x + first, y + first, count, COLOR_RED, NULL, NULL);
+        pixels[subset] = render_pixels(fig);
+        cpl_free_figure(fig);
+    }
+    CHECK(pixels[0] && pixels[1], "zoomed figures render");
+    if (pixels[0] && pixels[1]) {
+        CHECK(differing_pixels(pixels[0], pixels[1], 400 * 300) < 400 * 300 / 200,
+              "culled draw matches the visible samples");
+    }
+    free(pixels[0]);
+    free(pixels[1]);
+
+    // A NaN anywhere disables the binary search, on the vector and scalar paths
+    CPLFigure* fig = cpl_create_software_figure(100, 100);
+    if (fig) {
+        CPLPlot* plot = cpl_add_plot(fig);
+        size_t holes[3] = { 7, 8, n - 1 };
+        for (int k = 0; k < 3; k++) {
+            double saved = x[holes[k]];
+            x[holes[k]] = NAN;
+            cpl_plot(plot, x, y, k < 2 ? 11 : n, COLOR_RED, NULL, NULL);
+            x[holes[k]] = saved;
+        }
+        cpl_plot(plot, x, y, n, COLOR_RED, NULL, NULL);
+        const CPLLine* lines = plot->data->lines;
+        CHECK(!lines[0].monotonic_x && !lines[1].monotonic_x && !lines[2].monotonic_x && lines[3].monotonic_x,
+              "series with NaN x are not treated as sorted");
+        cpl_free_figure(fig);
+    }
+    free(x);
+    free(y);
+}
+
+// Picking: the pick index agrees with a brute-force search
+static void test_picking(void) {
+    printf("Test: Picking...\n");
+    CPLFigure* fig = cpl_create_software_figure(640, 480);
+    if (!fig) return;
+    CPLPlot* plot = cpl_add_plot(fig);
+    cpl_set_x_range(plot, 0.0, 1.0);
+    cpl_set_y_range(plot, 0.0, 1.0);
+
+    // A sorted series (block index) and a random cloud (grid index)
+    enum { N = 20000 };
+    static double x[2][N], y[2][N];
+    srand(39);
+    for (size_t i = 0; i < N; i++) {
+        x[0][i] = (double)i / N;
+        y[0][i] = 0.5 + 0.4 * sin(x[0][i] * 40.0);
+        x[1][i] = rand() / (double)RAND_MAX;
+        y[1][i] = rand() / (double)RAND_MAX;
+    }
+    cpl_plot(plot, x[0], y[0], N, COLOR_RED, NULL, NULL);
+    cpl_plot(plot, x[1], y[1], N, COLOR_BLUE, NULL, NULL);
+
+    int mismatches = 0;
+    for (int q = 0; q < 200; q++) {
+        double query[2] = { 40.0 + rand() % 560, 30.0 + rand() % 420 };
+        CPLPickResult result;
+        bool found = cpl_pick(plot, query[0], query[1], 10.0, &result);
+
+        double best = 100.0;
+        for (int line = 0; line < 2; line++) {
+            for (size_t i = 0; i < N; i++) {
+                double screen[2];
+                data_to_screen(plot, x[line][i], y[line][i], screen);
+                double dx = screen[0] - query[0], dy = screen[1] - query[1];
+                if (dx * dx + dy * dy < best) best = dx * dx + dy * dy;
+            }
+        }
+        bool expected = best < 100.0;
+        if (found != expected || (found && fabs(result.distance - sqrt(best)) > 0.05)) mismatches++;
+    }
+    CHECK(mismatches == 0, "pick finds the nearest sample");
+
+    CPLPickResult result;
+    double screen[2];
+    data_to_screen(plot, x[1][123], y[1][123], screen);
+    CHECK(cpl_pick(plot, screen[0], screen[1], 0.5, &result) && result.line == 1 && result.index == 123,
+          "pick on a sample returns it");
+
+    // NaN samples are never picked, whichever index the line gets
+    CPLPlot* gaps = cpl_add_plot(fig);
+    cpl_set_x_range(gaps, 0.0, 1.0);
+    cpl_set_y_range(gaps, 0.0, 1.0);
+    double gap_x[3] = { 0.0, NAN, 1.0 }, gap_y[3] = { 0.0, 0.5, 1.0 };
+    cpl_plot(gaps, gap_x, gap_y, 3, COLOR_RED, NULL, NULL);
+    bool picked = false;
+    for (int q = 0; q < 64; q++) {
+        picked |= cpl_pick(gaps, 40.0 + q * 9.0, 30.0 + q * 6.5, 20.0, &result) && result.index == 1;
+    }
+    CHECK(!picked, "pick skips NaN samples");
+
+    // Scatter points go through the same grid index and are drawn over lines
+    CPLPlot* cloud = cpl_add_plot(fig);
+    cpl_set_x_range(cloud, 0.0, 1.0);
+    cpl_set_y_range(cloud, 0.0, 1.0);
+    cpl_plot(cloud, x[1], y[1], N, COLOR_RED, NULL, NULL);
+    cpl_scatter(cloud, x[1], y[1], N, COLOR_BLUE, 4.0f, NULL, NULL);
+    mismatches = 0;
+    for (int q = 0; q < 200; q++) {
+        double query[2] = { 40.0 + rand() % 560, 30.0 + rand() % 420 };
+        bool found = cpl_pick(cloud, query[0], query[1], 10.0, &result);
+        double best = 100.0;
+        for (size_t i = 0; i < N; i++) {
+            double point[2];
+            data_to_screen(cloud, x[1][i], y[1][i], point);
+            double dx = point[0] - query[0], dy = point[1] - query[1];
+            if (dx * dx + dy * dy < best) best = dx * dx + dy * dy;
+        }
+        bool expected = best < 100.0;
+        if (found != expected || (found && (!result.scatter || fabs(result.distance - sqrt(best)) > 0.05))) {
+            mismatches++;
+        }
+    }
+    CHECK(mismatches == 0, "pick finds the nearest scatter point");
+    data_to_screen(cloud, x[1][77], y[1][77], screen);
+    CHECK(cpl_pick(cloud, screen[0], screen[1], 0.5, &result) && result.scatter && result.line == 0 &&
+          result.index == 77 && fabs(result.x - x[1][77]) < 1e-6, "pick on a point returns it");
+    cpl_free_figure(fig);
+}
+
+// Axis transforms: a log axis draws the same pixels as the
+// logarithm of the data on a linear axis
+static void test_axis_scales(void) {
+    printf("Test: Log axis transform...\n");
+    enum { N = 500 };
+    double x[N], y[N], log_x[N];
+    for (size_t i = 0; i < N; i++) {
+        x[i] = pow(10.0, 4.0 * i / (N - 1));
+        log_x[i] = log10(x[i]);
+        y[i] = sin(log_x[i] * 3.0);
+    }
+
+    unsigned char* pixels[2] = { NULL, NULL };
+    for (int scale = 0; scale < 2; scale++) {
+        CPLFigure* fig = cpl_create_software_figure(400, 300);
+        if (!fig) break;
+        CPLPlot* plot = cpl_add_plot(fig);
+        cpl_set_y_range(plot, -1.2, 1.2);
+        if (scale) {
+            cpl_set_x_scale(plot, CPL_SCALE_LOG10);
+            cpl_set_x_range(plot, 1.0, 1e4);
+            cpl_plot(plot, x, y, N, COLOR_RED, NULL, NULL);
+        } else {
+            cpl_set_x_range(plot, 0.0, 4.0);
+            cpl_plot(plot, log_x, y, N, COLOR_RED, NULL, NULL);
+        }
+        pixels[scale] = render_pixels(fig);
+        cpl_free_figure(fig);
+    }
+    CHECK(pixels[0] && pixels[1], "figures render");
+    if (pixels[0] && pixels[1]) {
+        CHECK(differing_pixels(pixels[0], pixels[1], 400 * 300) < 400 * 300 / 200, "log axis matches log data");
+    }
+    free(pixels[0]);
+    free(pixels[1]);
+}
+
+// Double-float positions: a deep zoom far from the data origin
+// draws the same pixels as the same samples near zero
+static void test_high_precision(void) {
+    printf("Test: High-precision deep zoom...\n");
+    enum { N = 201 };
+    double x[N + 2], y[N + 2], near_x[N];
+    x[0] = 0.0;
+    y[0] = 0.0;
+    for (size_t i = 0; i < N; i++) {
+        near_x[i] = 0.005 * i;
+        x[i + 1] = 5e6 + near_x[i];
+        y[i + 1] = sin(near_x[i] * 20.0);
+    }
+    x[N + 1] = 1e7;
+    y[N + 1] = 0.0;
+
+    unsigned char* pixels[2] = { NULL, NULL };
+    for (int far = 0; far < 2; far++) {
+        CPLFigure* fig = cpl_create_software_figure(400, 300);
+        if (!fig) break;
+        CPLPlot* plot = cpl_add_plot(fig);
+        cpl_show_grid(plot, false);
+        cpl_set_y_range(plot, -1.2, 1.2);
+        if (far) {
+            cpl_set_high_precision(plot, true);
+            cpl_set_x_range(plot, 5e6, 5e6 + 1.0);
+            cpl_plot(plot, x, y, N + 2, COLOR_RED, NULL, NULL);
+        } else {
+            cpl_set_x_range(plot, 0.0, 1.0);
+            cpl_plot(plot, near_x, y + 1, N, COLOR_RED, NULL, NULL);
+        }
+        pixels[far] = render_pixels(fig);
+        cpl_free_figure(fig);
+    }
+    CHECK(pixels[0] && pixels[1], "figures render");
+    if (pixels[0] && pixels[1]) {
+        CHECK(differing_pixels(pixels[0], pixels[1], 400 * 300) < 400 * 300 / 200,
+              "deep zoom keeps sub-float precision");
+    }
+    free(pixels[0]);
+    free(pixels[1]);
+}
+
+// Scatter plots and density mode
+static void test_scatter(void) {
+    printf("Test: Scatter and density...\n");
+    CPLFigure* fig = cpl_create_software_figure(400, 300);
+    if (!fig) return;
+    CPLPlot* plot = cpl_add_plot(fig);
+    cpl_show_grid(plot, false);
+    cpl_set_x_range(plot, 0.0, 1.0);
+    cpl_set_y_range(plot, 0.0, 1.0);
+    double x[1] = { 0.25 }, y[1] = { 0.75 };
+    cpl_scatter(plot, x, y, 1, COLOR_RED, 9.0f, NULL, NULL);
+
+    unsigned char* pixels = render_pixels(fig);
+    if (pixels) {
+        double screen[2];
+        data_to_screen(plot, 0.25, 0.75, screen);
+        int dot[4] = { (int)screen[0] - 6, 300 - (int)screen[1] - 6, 12, 12 };
+        int box[4] = { 25, 20, 350, 260 };
+        size_t inside = count_pixels(pixels, 400, dot, is_red);
+        CHECK(inside >= 40 && inside <= 90, "a 9 px dot is drawn at its position");
+        CHECK(count_pixels(pixels, 400, box, is_red) == inside, "nothing is drawn elsewhere");
+    }
+    free(pixels);
+    cpl_free_figure(fig);
+
+    // Density of a cloud in the left half leaves the right half of the box empty
+    fig = cpl_create_software_figure(400, 300);
+    if (!fig) return;
+    plot = cpl_add_plot(fig);
+    cpl_show_grid(plot, false);
+    cpl_set_x_range(plot, 0.0, 1.0);
+    cpl_set_y_range(plot, 0.0, 1.0);
+    enum { SIDE = 600, N = SIDE * SIDE };
+    static double cloud_x[N], cloud_y[N];
+    for (size_t i = 0; i < N; i++) {
+        cloud_x[i] = 0.05 + 0.4 * (double)(i % SIDE) / SIDE;
+        cloud_y[i] = 0.05 + 0.9 * (double)(i / SIDE) / SIDE;
+    }
+    cpl_scatter(plot, cloud_x, cloud_y, N, COLOR_RED, 1.0f, NULL, NULL);
+    cpl_set_density(plot, CPL_DENSITY_LINEAR);
+    pixels = render_pixels(fig);
+    if (pixels) {
+        int left[4] = { 50, 50, 120, 200 };
+        int right[4] = { 220, 50, 150, 200 };
+        CHECK(count_pixels(pixels, 400, left, is_not_white) == 120 * 200, "dense half is filled");
+        CHECK(count_pixels(pixels, 400, right, is_not_white) == 0, "empty half stays clear");
+    }
+    free(pixels);
+    cpl_free_figure(fig);
+}
+
+// Persistence traces: a flat trace lights one row of the box
+static void test_persistence(void) {
+    printf("Test: Persistence traces...\n");
+    CPLFigure* fig = cpl_create_software_figure(400, 300);
+    if (!fig) return;
+    CPLPlot* plot = cpl_add_plot(fig);
+    cpl_show_grid(plot, false);
+    cpl_set_x_range(plot, 0.0, 1.0);
+    cpl_set_y_range(plot, 0.0, 1.0);
+    enum { SAMPLES = 64 };
+    double x[SAMPLES], y[4 * SAMPLES];
+    for (size_t i = 0; i < SAMPLES; i++) x[i] = (double)i / (SAMPLES - 1);
+    for (size_t i = 0; i < 4 * SAMPLES; i++) y[i] = 0.5;
+    y[SAMPLES + 10] = NAN;     // A gap in one trace draws nothing
+    cpl_set_persistence(plot, x, SAMPLES, 1.0f, CPL_DENSITY_LINEAR);
+    cpl_add_traces(plot, y, 4);
+    CHECK(plot->data->traces && plot->data->traces->num_traces == 4, "traces are stored");
 
-int main() {
+    unsigned char* pixels = render_pixels(fig);
+    if (pixels) {
+        int middle[4] = { 30, 148, 340, 4 };
+        int above[4] = { 30, 170, 340, 100 };
+        CHECK(count_pixels(pixels, 400, middle, is_not_white) >= 340, "trace row is lit");
+        CHECK(count_pixels(pixels, 400, above, is_not_white) == 0, "other rows stay clear");
+    }
+    free(pixels);
+    cpl_free_figure(fig);
+}
+
+// Waterfall ring buffer
+static void test_waterfall(void) {
+    printf("Test: Waterfall ring buffer...\n");
+    CPLFigure* fig = cpl_create_software_figure(200, 100);
+    if (!fig) return;
+    CPLPlot* plot = cpl_add_plot(fig);
+    cpl_set_waterfall(plot, 4, 8, 0.0, 1.0, 0.0, 1.0);
+    CPLWaterfall* waterfall = plot->data->waterfall;
+    CHECK(waterfall != NULL, "waterfall is created");
+    if (!waterfall) {
+        cpl_free_figure(fig);
+        return;
+    }
+
+    // Row r holds the value r in every bin; 11 rows scroll the oldest 3 out
+    float rows[11 * 4];
+    for (size_t i = 0; i < 11 * 4; i++) rows[i] = (float)(i / 4);
+    cpl_add_waterfall_rows(plot, rows, 5);
+    CHECK(waterfall->filled == 5, "rows fill the ring");
+    cpl_add_waterfall_rows(plot, rows + 5 * 4, 6);
+    CHECK(waterfall->filled == 8, "the ring holds at most `rows` rows");
+    bool ordered = true;
+    for (size_t age = 0; age < 8; age++) {
+        size_t ring_row = (waterfall->newest + 8 - age) % 8;
+        if (waterfall->values[ring_row * 4] != (float)(10 - age)) ordered = false;
+    }
+    CHECK(ordered, "the newest rows are kept in order");
+
+    // NaN extents and levels are rejected
+    float levels[2] = { waterfall->levels[0], waterfall->levels[1] };
+    cpl_set_waterfall_levels(plot, 0.0f, NAN, false);
+    CHECK(waterfall->levels[0] == levels[0] && waterfall->levels[1] == levels[1], "NaN levels are ignored");
+    CPLPlot* invalid = cpl_add_plot(fig);
+    cpl_set_waterfall(invalid, 4, 8, 0.0, NAN, 0.0, 1.0);
+    CHECK(invalid->data->waterfall == NULL, "a NaN extent creates no waterfall");
+    cpl_free_figure(fig);
+}
+
+// Matrix pyramid: coarser levels reduce 2x2 elements
+static void test_matrix(void) {
+    printf("Test: Matrix pyramid...\n");
+    const size_t size = 1030;
+    float* data = malloc(size * size * sizeof(float));
+    CPLFigure* fig = cpl_create_software_figure(200, 100);
+    if (!data || !fig) {
+        free(data);
+        cpl_free_figure(fig);
+        return;
+    }
+    for (size_t i = 0; i < size * size; i++) data[i] = (float)(i % 7) + (float)(i / size);
+    data[1] = NAN;
+    data[2] = INFINITY;
+
+    const CPLMatrixReduce reduces[3] = { CPL_MATRIX_MEAN, CPL_MATRIX_MIN, CPL_MATRIX_MAX };
+    for (int r = 0; r < 3; r++) {
+        CPLPlot* plot = cpl_add_plot(fig);
+        cpl_imshow(plot, data, CPL_MATRIX_FLOAT32, size, size, NULL, reduces[r]);
+        CPLMatrix* matrix = plot->data->matrix;
+        CHECK(matrix && matrix->num_levels == 3, "levels halve until one tile holds the matrix");
+        if (!matrix || matrix->num_levels < 2) continue;
+        CHECK(matrix->mips[1].width == 515 && matrix->mips[2].width == 258, "odd levels round up");
+
+        // Element (5, 3) of level 1 covers elements (10..11, 6..7); (0, 0) has a NaN
+        const float* level0 = data;
+        const float* level1 = (const float*)matrix->mips[1].values;
+        float block[4] = { level0[6 * size + 10], level0[6 * size + 11], level0[7 * size + 10], level0[7 * size + 11] };
+        float expected = r == 0 ? (block[0] + block[1] + block[2] + block[3]) / 4.0f
+                       : r == 1 ? fminf(fminf(block[0], block[1]), fminf(block[2], block[3]))
+                                : fmaxf(fmaxf(block[0], block[1]), fmaxf(block[2], block[3]));
+        CHECK(fabsf(level1[3 * 515 + 5] - expected) < 1e-4f, "level 1 reduces 2x2 elements");
+        if (r == 0) {
+            float corner = (level0[0] + level0[size] + level0[size + 1]) / 3.0f;
+            CHECK(fabsf(level1[0] - corner) < 1e-4f, "the mean skips NaN elements");
+            CHECK(matrix->levels[0] == 0.0f && matrix->levels[1] < 1e30f, "default levels skip non-finite elements");
+        }
+    }
+    free(data);
+    cpl_free_figure(fig);
+}
+
+// Histogram counts
+static void test_histogram(void) {
+    printf("Test: Histogram counts...\n");
+    CPLFigure* fig = cpl_create_software_figure(200, 100);
+    if (!fig) return;
+    CPLPlot* plot = cpl_add_plot(fig);
+
+    enum { N = 1000003, BINS = 37 };
+    double* data = malloc(N * sizeof(double));
+    if (!data) {
+        cpl_free_figure(fig);
+        return;
+    }
+    srand(47);
+    for (size_t i = 0; i < N; i++) data[i] = -3.0 + 8.0 * rand() / (double)RAND_MAX;
+    data[0] = -2.0;
+    data[1] = 4.0;
+
+    const double range[2] = { -2.0, 4.0 };
+    cpl_hist(plot, data, N, BINS, range, COLOR_BLUE);
+    CPLHistogram* histogram = plot->data->histogram;
+    CHECK(histogram && histogram->bins == BINS, "histogram is created");
+    if (histogram) {
+        uint64_t expected[BINS] = { 0 };
+        for (size_t i = 0; i < N; i++) {
+            if (data[i] < range[0] || data[i] > range[1]) continue;
+            size_t bin = (size_t)((data[i] - range[0]) / (range[1] - range[0]) * BINS);
+            expected[bin < BINS ? bin : BINS - 1]++;
+        }
+        CHECK(memcmp(histogram->counts, expected, sizeof(expected)) == 0, "parallel counts match a serial count");
+
+        cpl_hist_add(plot, data, N);
+        bool doubled = true;
+        for (size_t bin = 0; bin < BINS; bin++) {
+            if (histogram->counts[bin] != 2 * expected[bin]) doubled = false;
+        }
+        CHECK(doubled, "cpl_hist_add counts into the same bins");
+    }
+
+    // Without a range, the data range is used and the maximum lands in the last bin
+    double small[5] = { 1.0, 2.0, 2.5, 3.0, 5.0 };
+    cpl_hist(plot, small, 5, 4, NULL, COLOR_BLUE);
+    histogram = plot->data->histogram;
+    CHECK(histogram && histogram->range[0] == 1.0 && histogram->range[1] == 5.0, "auto range spans the data");
+    CHECK(histogram && histogram->counts[0] == 1 && histogram->counts[1] == 2 && histogram->counts[2] == 1 &&
+          histogram->counts[3] == 1, "auto-range counts");
+
+    // NaN and infinite samples neither widen the auto range nor get counted
+    double gaps[7] = { 1.0, 2.0, 2.5, 3.0, 5.0, NAN, INFINITY };
+    cpl_hist(plot, gaps, 7, 4, NULL, COLOR_BLUE);
+    histogram = plot->data->histogram;
+    CHECK(histogram && histogram->range[0] == 1.0 && histogram->range[1] == 5.0, "auto range skips non-finite samples");
+    CHECK(histogram && histogram->counts[0] + histogram->counts[1] + histogram->counts[2] + histogram->counts[3] == 5,
+          "non-finite samples are not counted");
+    free(data);
+    cpl_free_figure(fig);
+}
+
+// Contour stitching: each circle is one closed polyline across the row bands
+static void test_contour(void) {
+    printf("Test: Contour stitching...\n");
+    CPLFigure* fig = cpl_create_software_figure(200, 100);
+    if (!fig) return;
+    CPLPlot* plot = cpl_add_plot(fig);
+
+    enum { NX = 300, NY = 257 };
+    static float field[NX * NY];
+    for (size_t j = 0; j < NY; j++) {
+        for (size_t i = 0; i < NX; i++) {
+            double dx = (double)i + 0.5 - 150.0, dy = (double)(NY - 1 - j) + 0.5 - 128.0;
+            field[j * NX + i] = (float)sqrt(dx * dx + dy * dy);
+        }
+    }
+    field[128 * NX + 220] = NAN;     // A hole between the circles adds no contour
+    const double levels[2] = { 40.0, 100.0 };
+    cpl_contour(plot, field, NX, NY, NULL, levels, 2);
+    CPLContour* contour = plot->data->contour;
+    CHECK(contour && contour->num_polylines == 2, "one polyline per circle");
+    if (!contour) {
+        cpl_free_figure(fig);
+        return;
+    }
+
+    bool closed = true, on_circle = true;
+    for (size_t p = 0; p < contour->num_polylines; p++) {
+        const float* first = contour->vertices + (size_t)contour->firsts[p] * 5;
+        const float* last = first + (size_t)(contour->counts[p] - 1) * 5;
+        if (fabsf(first[0] - last[0]) > 1e-3f || fabsf(first[1] - last[1]) > 1e-3f) closed = false;
+        for (int v = 0; v < contour->counts[p]; v++) {
+            const float* vertex = first + (size_t)v * 5;
+            double dx = contour->origin[0] + vertex[0] - 150.0, dy = contour->origin[1] + vertex[1] - 128.0;
+            double radius = sqrt(dx * dx + dy * dy);
+            if (fabs(radius - 40.0) > 0.1 && fabs(radius - 100.0) > 0.1) on_circle = false;
+        }
+    }
+    CHECK(closed, "polylines close on themselves");
+    CHECK(on_circle, "vertices lie on the level set");
+
+    const double invalid_levels[1] = { NAN };
+    CPLPlot* invalid = cpl_add_plot(fig);
+    cpl_contour(invalid, field, NX, NY, NULL, invalid_levels, 1);
+    CHECK(invalid->data->contour == NULL, "NaN levels are rejected");
+    cpl_free_figure(fig);
+}
+
+// Quiver thinning: every level of a lattice is an exact stride subset
+static void test_quiver(void) {
+    printf("Test: Quiver thinning...\n");
+    CPLFigure* fig = cpl_create_software_figure(200, 100);
+    if (!fig) return;
+    CPLPlot* plot = cpl_add_plot(fig);
+
+    enum { GRID = 64 };
+    static double x[GRID * GRID], y[GRID * GRID], u[GRID * GRID], v[GRID * GRID];
+    for (size_t j = 0; j < GRID; j++) {
+        for (size_t i = 0; i < GRID; i++) {
+            x[j * GRID + i] = (double)i;
+            y[j * GRID + i] = (double)j;
+            u[j * GRID + i] = 1.0;
+            v[j * GRID + i] = 0.5;
+        }
+    }
+    cpl_quiver(plot, x, y, u, v, GRID * GRID, 1.0f, COLOR_BLUE);
+    CPLQuiver* quiver = plot->data->quiver;
+    CHECK(quiver && quiver->num_arrows == GRID * GRID, "every arrow is stored");
+    if (!quiver) {
+        cpl_free_figure(fig);
+        return;
+    }
+
+    bool strided = true;
+    for (size_t side = 1, level = 0; side <= GRID; side *= 2, level++) {
+        size_t stride = GRID / side;
+        if (quiver->level_ends[level] != side * side) strided = false;
+        for (size_t k = 0; k < quiver->level_ends[level]; k++) {
+            const float* record = quiver->records + k * 4;
+            long tail_x = lround(quiver->origin[0] + record[0]);
+            long tail_y = lround(quiver->origin[1] + record[1]);
+            if (tail_x % (long)stride != 0 || tail_y % (long)stride != 0) strided = false;
+        }
+    }
+    CHECK(strided, "lattice levels thin to exact strides");
+    CHECK(quiver->level_ends[CPL_QUIVER_LEVELS - 1] == GRID * GRID, "the last level holds every arrow");
+
+    // Arrows with a NaN or infinite component are dropped
+    u[5] = NAN;
+    y[9] = INFINITY;
+    cpl_quiver(plot, x, y, u, v, GRID * GRID, 1.0f, COLOR_BLUE);
+    quiver = plot->data->quiver;
+    CHECK(quiver && quiver->num_arrows == GRID * GRID - 2, "non-finite arrows are skipped");
+    cpl_free_figure(fig);
+}
+
+// Candle aggregation
+static bool same_candles(const CPLCandles* a, const CPLCandles* b) {
+    for (int level = 0; level < CPL_CANDLE_LEVELS; level++) {
+        if (a->levels[level].count != b->levels[level].count) return false;
+        for (size_t i = 0; i < a->levels[level].count; i++) {
+            const CPLCandle* p = &a->levels[level].candles[i];
+            const CPLCandle* q = &b->levels[level].candles[i];
+            if (p->time != q->time || p->open != q->open || p->high != q->high || p->low != q->low ||
+                p->close != q->close || fabs(p->volume - q->volume) > 1e-6) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static void test_candles(void) {
+    printf("Test: Candle aggregation...\n");
+    CPLFigure* fig = cpl_create_software_figure(200, 100);
+    if (!fig) return;
+    CPLPlot* in_order = cpl_add_plot(fig);
+    CPLPlot* reversed = cpl_add_plot(fig);
+    cpl_set_candles(in_order, COLOR_GREEN, COLOR_RED);
+    cpl_set_candles(reversed, COLOR_GREEN, COLOR_RED);
+
+    enum { N = 50000 };
+    static double time[N], price[N], volume[N];
+    const double start = 1704067200.0 + 3 * 86400.0 + 7.0;
+    double walk = 100.0;
+    srand(50);
+    for (size_t i = 0; i < N; i++) {
+        time[i] = start + (double)i * 0.7 + (rand() % 100) * 0.001;
+        walk += (rand() / (double)RAND_MAX - 0.5) * 0.3;
+        price[i] = walk;
+        volume[i] = 1.0 + rand() % 10;
+    }
+    for (size_t done = 0; done < N; done += 1000) {
+        cpl_add_ticks(in_order, time + done, price + done, volume + done, 1000);
+    }
+    for (size_t done = N; done > 0; done -= 1000) {
+        cpl_add_ticks(reversed, time + done - 1000, price + done - 1000, volume + done - 1000, 1000);
+    }
+    const CPLCandles* candles = in_order->data->candles;
+    CHECK(same_candles(candles, reversed->data->candles), "tick order does not change the candles");
+
+    // Every coarse candle aggregates the 1 s candles of its bucket
+    bool consistent = true;
+    double total_volume = 0.0;
+    for (size_t i = 0; i < N; i++) total_volume += volume[i];
+    for (int level = 0; level < CPL_CANDLE_LEVELS; level++) {
+        const CPLCandleLevel* coarse = &candles->levels[level];
+        const CPLCandleLevel* fine = &candles->levels[0];
+        double level_volume = 0.0;
+        size_t j = 0;
+        for (size_t i = 0; i < coarse->count; i++) {
+            const CPLCandle* candle = &coarse->candles[i];
+            level_volume += candle->volume;
+            while (j < fine->count && fine->candles[j].time < candle->time) j++;
+            double high = -INFINITY, low = INFINITY;
+            const CPLCandle* open = NULL;
+            const CPLCandle* close = NULL;
+            for (; j < fine->count && fine->candles[j].time < candle->time + coarse->size; j++) {
+                const CPLCandle* part = &fine->candles[j];
+                if (!open) open = part;
+                close = part;
+                high = fmax(high, part->high);
+                low = fmin(low, part->low);
+            }
+            if (!open || candle->open != open->open || candle->close != close->close || candle->high != high ||
+                candle->low != low) {
+                consistent = false;
+            }
+        }
+        if (fabs(level_volume - total_volume) > 1e-6 * total_volume) consistent = false;
+    }
+    CHECK(consistent, "coarse candles aggregate the 1 s candles");
+
+    // Ticks within one second: open first, close last by time, not by arrival
+    CPLPlot* plot = cpl_add_plot(fig);
+    cpl_set_candles(plot, COLOR_GREEN, COLOR_RED);
+    double t[4] = { 100.5, 100.1, 100.9, 100.3 }, p[4] = { 2.0, 1.0, 4.0, 0.5 };
+    cpl_add_ticks(plot, t, p, NULL, 4);
+    const CPLCandleLevel* seconds = &plot->data->candles->levels[0];
+    CHECK(seconds->count == 1 && seconds->candles[0].time == 100.0, "ticks share one 1 s bucket");
+    CHECK(seconds->count == 1 && seconds->candles[0].open == 1.0 && seconds->candles[0].close == 4.0 &&
+          seconds->candles[0].high == 4.0 && seconds->candles[0].low == 0.5, "OHLC of one bucket");
+
+    // Ticks with a NaN or infinite time or price are dropped; a NaN volume counts as zero
+    double gap_t[3] = { NAN, 100.2, INFINITY }, gap_p[3] = { 3.0, NAN, 3.0 }, gap_v[3] = { 1.0, 1.0, 1.0 };
+    cpl_add_ticks(plot, gap_t, gap_p, gap_v, 3);
+    double nan_t[1] = { 100.7 }, nan_p[1] = { 2.5 }, nan_v[1] = { NAN };
+    cpl_add_ticks(plot, nan_t, nan_p, nan_v, 1);
+    seconds = &plot->data->candles->levels[0];
+    CHECK(seconds->count == 1 && seconds->candles[0].high == 4.0 && seconds->candles[0].low == 0.5 &&
+          seconds->candles[0].volume == 0.0, "non-finite ticks are skipped");
+    cpl_free_figure(fig);
+}
+
+// Headless GL checks; skipped without an EGL device
+static void test_headless(void) {
+    printf("Test: Headless rendering...\n");
+    CPLFigure* fig = headless_figure(64, 48);
+    if (!fig) {
+        printf("  (skipped: no headless OpenGL)\n");
+        return;
+    }
+    cpl_free_figure(fig);
+
+    // Subplots share one plot box geometry
+    fig = headless_figure(400, 300);
+    cpl_add_subplots(fig, 2, 2);
+    for (size_t i = 0; i < 4; i++) {
+        double x[2] = { 0.0, 1.0 }, y[2] = { 0.0, 1.0 };
+        cpl_plot(cpl_get_subplot(fig, i), x, y, 2, COLOR_BLUE, NULL, NULL);
+    }
+    CPLGeometry* box = cpl_get_subplot(fig, 0)->data->box;
+    bool shared = box != NULL;
+    for (size_t i = 1; i < 4; i++) {
+        if (cpl_get_subplot(fig, i)->data->box != box) shared = false;
+    }
+    CHECK(shared && box->ref_count == 4, "subplots share the plot box geometry");
+    cpl_free_figure(fig);
+
+    // Small multiples keep min/max of each decimated series
+    fig = headless_figure(400, 300);
+    CPLPlot* plot = cpl_add_small_multiples(fig, 4, 4, 32);
+    CHECK(plot != NULL, "small multiples are created");
+    if (plot) {
+        double series[1000];
+        for (size_t i = 0; i < 1000; i++) series[i] = sin(i * 0.05) + (i == 517 ? 3.0 : 0.0);
+        cpl_set_small_multiple(plot, 5, series, 1000, COLOR_BLUE);
+        const float* tile = plot->data->multiples->tiles + 5 * 12;
+        CHECK(tile[6] <= 32.0f && fabsf(tile[5] - (float)series[517]) < 1e-5f, "decimation keeps the peak");
+    }
+    cpl_free_figure(fig);
+
+    // Recycled renderers draw the same frame
+    unsigned char* frames[2] = { NULL, NULL };
+    for (int i = 0; i < 2; i++) {
+        fig = headless_figure(320, 240);
+        if (!fig) break;
+        plot = cpl_add_plot(fig);
+        double x[3] = { 0.0, 0.5, 1.0 }, y[3] = { 0.0, 1.0, 0.0 };
+        cpl_plot(plot, x, y, 3, COLOR_RED, NULL, NULL);
+        frames[i] = render_pixels(fig);
+        cpl_free_figure(fig);
+    }
+    CHECK(frames[0] && frames[1] && memcmp(frames[0], frames[1], 320 * 240 * 4) == 0,
+          "pooled renderers start from a clean state");
+    free(frames[0]);
+    free(frames[1]);
+
+    // Data without residuals ignores a stale constant residual attribute
+    fig = headless_figure(160, 120);
+    if (fig) {
+        plot = cpl_add_plot(fig);
+        cpl_set_x_range(plot, 0.0, 1.0);
+        cpl_set_y_range(plot, 0.0, 1.0);
+        double x[3] = { 0.1, 0.5, 0.9 }, y[3] = { 0.2, 0.8, 0.2 };
+        float grid[9] = { 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+        double extent[4] = { 0.0, 1.0, 0.0, 1.0 }, level = 0.5;
+        cpl_plot(plot, x, y, 3, COLOR_RED, NULL, NULL);
+        cpl_scatter(plot, x, y, 3, COLOR_BLUE, 6.0f, NULL, NULL);
+        cpl_contour(plot, grid, 3, 3, extent, &level, 1);
+        frames[0] = render_pixels(fig);
+        glVertexAttrib2f(2, 0.25f, 0.25f);
+        frames[1] = render_pixels(fig);
+        CHECK(frames[0] && frames[1] && memcmp(frames[0], frames[1], 160 * 120 * 4) == 0,
+              "lines, scatters and contours set their residual attribute");
+        free(frames[0]);
+        free(frames[1]);
+        cpl_free_figure(fig);
+    }
+
+    // Recording writes one Y4M frame per rendered frame
+    char path[256];
+    temp_path(path, sizeof(path), "record.y4m");
+    fig = headless_figure(64, 48);
+    if (fig) {
+        cpl_add_plot(fig);
+        CHECK(cpl_start_recording(fig, path, CPL_RECORD_Y4M, 30), "recording starts");
+        cpl_render_frames(fig, 3);
+        cpl_stop_recording(fig);
+        size_t size;
+        unsigned char* file = read_file(path, &size);
+        const char* header = "YUV4MPEG2 W64 H48 ";
+        CHECK(file && size > strlen(header) && memcmp(file, header, strlen(header)) == 0, "Y4M header");
+        const unsigned char* body = file ? memchr(file, '\n', size) : NULL;
+        CHECK(body && (size_t)(file + size - (body + 1)) == 3 * (6 + 64 * 48 * 3), "three 4:4:4 frames");
+        free(file);
+        unlink(path);
+        cpl_free_figure(fig);
+    }
+
+    // Persistence weights reach the normalization a frame late, but exports wait
+    // for them: traces added between frames export like a fresh figure
+    enum { SAMPLES = 32 };
+    double tx[SAMPLES], ty[4 * SAMPLES];
+    for (size_t i = 0; i < SAMPLES; i++) tx[i] = (double)i / (SAMPLES - 1);
+    for (size_t i = 0; i < 4 * SAMPLES; i++) ty[i] = i < 3 * SAMPLES ? 0.5 : 0.25;
+    for (int i = 0; i < 2; i++) {
+        frames[i] = NULL;
+        fig = headless_figure(200, 150);
+        if (!fig) break;
+        plot = cpl_add_plot(fig);
+        cpl_show_grid(plot, false);
+        cpl_set_x_range(plot, 0.0, 1.0);
+        cpl_set_y_range(plot, 0.0, 1.0);
+        cpl_set_persistence(plot, tx, SAMPLES, 1.0f, CPL_DENSITY_LINEAR);
+        if (i == 0) {
+            cpl_add_traces(plot, ty, 2);
+            cpl_render_frames(fig, 1);
+            cpl_add_traces(plot, ty + 2 * SAMPLES, 2);
+        } else {
+            cpl_add_traces(plot, ty, 4);
+        }
+        frames[i] = render_pixels(fig);
+        cpl_free_figure(fig);
+    }
+    CHECK(frames[0] && frames[1] && memcmp(frames[0], frames[1], 200 * 150 * 4) == 0,
+          "exported traces use the current weights");
+    free(frames[0]);
+    free(frames[1]);
+}
+
+// Embedded figures draw with the host's context and hand its state back
+static void test_embedded(void) {
+    printf("Test: Embedded state restore...\n");
+    CPLFigure* host = headless_figure(64, 48);
+    unsigned char* pixels = host ? render_pixels(host) : NULL;     // Leaves the host context current
+    CPLFigure* fig = pixels ? cpl_create_embedded_figure(128, 96) : NULL;
+    free(pixels);
+    if (!fig) {
+        printf("  (skipped: no headless OpenGL)\n");
+        cpl_free_figure(host);
+        return;
+    }
+    CPLPlot* plot = cpl_add_plot(fig);
+    float image[16];
+    for (int i = 0; i < 16; i++) image[i] = (float)i;
+    cpl_imshow(plot, image, CPL_MATRIX_FLOAT32, 4, 4, NULL, CPL_MATRIX_MEAN);
+    double corner[1] = { 0.5 };
+    cpl_scatter(plot, corner, corner, 1, COLOR_RED, 4.0f, NULL, NULL);     // Sets constant attributes
+
+    // The host renders into its own texture and has other textures bound on units 0 and 1
+    GLuint textures[3], fbo;
+    glGenTextures(3, textures);
+    glBindTexture(GL_TEXTURE_2D, textures[2]);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 128, 96, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glGenFramebuffers(1, &fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, textures[2], 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, textures[0]);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, textures[1]);
+
+    // ... and its own pixel unpack buffer and unpack layout
+    GLuint unpack;
+    glGenBuffers(1, &unpack);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, unpack);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, 64, NULL, GL_STREAM_DRAW);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 2);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 3);
+
+    // ... and constant vertex attributes of its own
+    for (GLuint i = 1; i <= 3; i++) glVertexAttrib4f(i, 0.5f, 0.25f, 0.125f, 1.0f);
+
+    cpl_render_figure_to(fig, fbo, 0, 0, 128, 96);
+    GLint active = 0, bound[2] = { 0, 0 };
+    glGetIntegerv(GL_ACTIVE_TEXTURE, &active);
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &bound[1]);
+    glActiveTexture(GL_TEXTURE0);
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &bound[0]);
+    CHECK(active == GL_TEXTURE1 && bound[0] == (GLint)textures[0] && bound[1] == (GLint)textures[1],
+          "2D texture bindings of units 0 and 1 are restored");
+    GLint unpack_buffer = 0, alignment = 0, row_length = 0;
+    glGetIntegerv(GL_PIXEL_UNPACK_BUFFER_BINDING, &unpack_buffer);
+    glGetIntegerv(GL_UNPACK_ALIGNMENT, &alignment);
+    glGetIntegerv(GL_UNPACK_ROW_LENGTH, &row_length);
+    CHECK(unpack_buffer == (GLint)unpack && alignment == 2 && row_length == 3, "unpack state is restored");
+    bool attribs = true;
+    for (GLuint i = 1; i <= 3; i++) {
+        GLfloat value[4];
+        glGetVertexAttribfv(i, GL_CURRENT_VERTEX_ATTRIB, value);
+        if (value[0] != 0.5f || value[1] != 0.25f || value[2] != 0.125f || value[3] != 1.0f) attribs = false;
+    }
+    CHECK(attribs, "constant vertex attributes are restored");
+
+    // The matrix was uploaded from client memory despite the host's unpack buffer
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glDeleteBuffers(1, &unpack);
+    unsigned char centre[4] = { 0, 0, 0, 0 };
+    glReadPixels(64, 48, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, centre);
+    CHECK(!(centre[0] == 255 && centre[1] == 255 && centre[2] == 255), "the matrix is drawn");
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteFramebuffers(1, &fbo);
+    glDeleteTextures(3, textures);
+    cpl_free_figure(fig);
+    cpl_free_figure(host);
+}
+
+// Batch export: concurrent workers draw what sequential saves draw,
+// with each job's own ranges and colours
+static void build_batch_job(CPLFigure* fig, void* user_data) {
+    int job = *(const int*)user_data;
+    enum { POINTS = 4000 };
+    double* x = malloc(2 * POINTS * sizeof(double));
+    if (!x) return;
+    double* y = x + POINTS;
+    for (size_t i = 0; i < POINTS; i++) {
+        x[i] = (double)i / (POINTS - 1);
+        y[i] = sin(x[i] * 12.0 + job) * 0.5 + 0.5;
+    }
+    CPLPlot* plot = cpl_add_plot(fig);
+    cpl_set_x_range(plot, -0.1 * job, 1.0 + 0.2 * job);
+    cpl_set_y_range(plot, -0.5 * job, 1.0 + 0.3 * job);
+    Color colors[4] = { COLOR_RED, COLOR_BLUE, COLOR_GREEN, COLOR_BLACK };
+    cpl_plot(plot, x, y, POINTS, colors[job % 4], NULL, NULL);
+    cpl_scatter(plot, x, y, POINTS, colors[(job + 1) % 4], 3.0f + (float)(job % 3), NULL, NULL);
+    cpl_hist(plot, y, POINTS, 16, NULL, colors[(job + 2) % 4]);
+    free(x);
+}
+
+static void test_batch_export(void) {
+    printf("Test: Batch export...\n");
+    if (!headless_available) {
+        printf("  (skipped: no headless OpenGL)\n");
+        return;
+    }
+    enum { JOBS = 24 };
+    int ids[JOBS];
+    char paths[JOBS][256];
+    CPLExportJob jobs[JOBS];
+    memset(jobs, 0, sizeof(jobs));
+    for (int i = 0; i < JOBS; i++) {
+        ids[i] = i;
+        char name[32];
+        snprintf(name, sizeof(name), "batch_%d.png", i);
+        temp_path(paths[i], sizeof(paths[i]), name);
+        jobs[i].filename = paths[i];
+        jobs[i].width = 240;
+        jobs[i].height = 180;
+        jobs[i].build = build_batch_job;
+        jobs[i].user_data = &ids[i];
+    }
+    CHECK(cpl_export_batch(jobs, JOBS, 6) == JOBS, "every batch job is written");
+
+    int mismatches = 0;
+    char path[256];
+    temp_path(path, sizeof(path), "sequential.png");
+    for (int i = 0; i < JOBS; i++) {
+        CPLFigure* fig = headless_figure(240, 180);
+        if (!fig) break;
+        build_batch_job(fig, &ids[i]);
+        cpl_save_figure(fig, path);
+        cpl_free_figure(fig);
+
+        size_t sizes[2], w[2], h[2];
+        unsigned char* files[2] = { read_file(paths[i], &sizes[0]), read_file(path, &sizes[1]) };
+        unsigned char* images[2] = { NULL, NULL };
+        for (int k = 0; k < 2; k++) {
+            if (files[k]) images[k] = decode_png(files[k], sizes[k], &w[k], &h[k]);
+        }
+        if (!images[0] || !images[1] || w[0] != w[1] || h[0] != h[1] ||
+            memcmp(images[0], images[1], w[0] * h[0] * 4) != 0) {
+            mismatches++;
+        }
+        for (int k = 0; k < 2; k++) {
+            free(images[k]);
+            free(files[k]);
+        }
+        unlink(paths[i]);
+        unlink(path);
+    }
+    CHECK(mismatches == 0, "batch images match sequential saves");
+}
+
+// Program binary cache: a fresh start stores binaries and reloads them
+static size_t remove_entries(const char* dir, bool remove) {
+    size_t entries = 0;
+    DIR* listing = opendir(dir);
+    struct dirent* entry;
+    while (listing && (entry = readdir(listing)) != NULL) {
+        if (entry->d_name[0] == '.') continue;
+        entries++;
+        if (remove) {
+            char path[512];
+            snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name);
+            unlink(path);
+        }
+    }
+    if (listing) closedir(listing);
+    return entries;
+}
+
+static void test_program_cache(void) {
+    printf("Test: Program binary cache...\n");
+    if (!headless_available) {
+        printf("  (skipped: no headless OpenGL)\n");
+        return;
+    }
+    char dir[256];
+    temp_path(dir, sizeof(dir), "shaders");
+    if (mkdir(dir, 0700) != 0) return;
+
+    // Shared programs are dropped so the next figure links (and stores) them
+    cpl_terminate();
+    setenv("CPL_SHADER_CACHE_DIR", dir, 1);
+    CPLFigure* fig = headless_figure(32, 32);
+    cpl_free_figure(fig);
+    CHECK(remove_entries(dir, false) > 0, "linked programs are stored");
+
+    // A second start loads them and still renders
+    cpl_terminate();
+    fig = headless_figure(32, 32);
+    unsigned char* pixels = fig ? render_pixels(fig) : NULL;
+    CHECK(pixels != NULL, "cached programs render");
+    free(pixels);
+    cpl_free_figure(fig);
+    cpl_terminate();
+
+    unsetenv("CPL_SHADER_CACHE_DIR");
+    remove_entries(dir, true);
+    rmdir(dir);
+}
+
+static int run_headless_tests(void) {
+    if (!mkdtemp(temp_dir)) {
+        fprintf(stderr, "FAILED: Could not create a temporary directory\n");
+        return 1;
+    }
+
+    test_image_output();
+    test_software_raster();
+    test_vector_export();
+    test_tiled_export();
+    test_culling();
+    test_picking();
+    test_axis_scales();
+    test_high_precision();
+    test_scatter();
+    test_persistence();
+    test_waterfall();
+    test_matrix();
+    test_histogram();
+    test_contour();
+    test_quiver();
+    test_candles();
+    test_headless();
+    test_embedded();
+    test_batch_export();
+    test_program_cache();
+
+    rmdir(temp_dir);
+    if (failures == 0) printf("✓ Headless checks passed\n\n");
+    return failures;
+}
+
+int main(int argc, char** argv) {
     printf("CPlotLib Test (C)\n");
     printf("================\n\n");
 
+    if (run_headless_tests() != 0) {
+        fprintf(stderr, "FAILED: %d headless check(s)\n", failures);
+        cpl_terminate();
+        return EXIT_FAILURE;
+    }
+    if (argc > 1 && strcmp(argv[1], "--headless") == 0) {
+        cpl_terminate();
+        printf("All tests passed! 🎉\n");
+        return EXIT_SUCCESS;
+    }
+
     // Test 1: Basic figure creation
     printf("Test 1: Creating figure...\n");
     CPLFigure* fig = cpl_create_figure(800, 600);